@@ -7,6 +7,8 @@
 
 #include "mesh.h"
 #include "common.glsl"
+#include "vertex.glsl"
+#include "instance.glsl"
 
 vec3 quad[4] = vec3[]
 (
@@ -18,7 +20,7 @@ vec3 quad[4] = vec3[]
 
 layout(set = 0, binding = 0) readonly buffer vertex_block
 {
-   vertex verts[];
+   vertex_gpu verts[];
 };
 
 layout(set = 0, binding = 1) readonly buffer mesh_draw_block
@@ -26,6 +28,12 @@ layout(set = 0, binding = 1) readonly buffer mesh_draw_block
    mesh_draw draws[];
 };
 
+// first instance of the indirect command is the instance_offset of its draw
+layout(set = 0, binding = 2) readonly buffer mesh_instance_block
+{
+   mesh_instance instances[];
+};
+
 layout(location = 0) out vec3 out_normal;
 layout(location = 1) out vec3 out_world_frag_pos;
 layout(location = 2) out vec2 out_uv;
@@ -33,9 +41,12 @@ layout(location = 3) flat out uint out_draw_ID;
 
 void main()
 {
-    int draw_ID = gl_DrawIDARB;
+    // the draws of a range start at its first batch
+    int draw_ID = int(globals.draw_offset) + gl_DrawIDARB;
+    mesh_instance instance = instances[gl_InstanceIndex];
+    mat3 rotation = instance_rotation_matrix(instance_rotation(instance));
+    mat4 world = instance_world(instance, rotation);
 
-    vertex v;
     vec3 p = vec3(0.f);
     vec3 n = vec3(0.f);
     vec2 t = vec2(0.f);
@@ -44,11 +55,12 @@ void main()
 
     if(!globals.draw_ground_plane)
     {
-        p = vec3(verts[gl_VertexIndex].vx, verts[gl_VertexIndex].vy, verts[gl_VertexIndex].vz) * 1.f;
-        n = vec3(verts[gl_VertexIndex].nx, verts[gl_VertexIndex].ny, verts[gl_VertexIndex].nz);
-        t = vec2(verts[gl_VertexIndex].tu, verts[gl_VertexIndex].tv);
+        vertex_gpu v = verts[gl_VertexIndex];
+        p = vertex_position(v, draws[draw_ID]);
+        n = vertex_normal(v);
+        t = vertex_uv(v);
 
-        world_pos = draws[draw_ID].world * vec4(p, 1.0);
+        world_pos = world * vec4(p, 1.0);
     }
     else
     {
@@ -58,10 +70,8 @@ void main()
 
     gl_Position = globals.projection * globals.view * world_pos;
 
-    // Decode normal and transform to world space using inverse transpose
-    vec3 normal = (n - 127.5) / 127.5;
-    mat3 normal_matrix = transpose(inverse(mat3(draws[draw_ID].world)));
-    vec3 world_normal = normalize(normal_matrix * normal);
+    // inverse transpose of rotation and scale is the rotation of the inverse scale
+    vec3 world_normal = instance_normal(instance, rotation, n);
     vec2 texcoord = t;
 
     out_normal = world_normal;
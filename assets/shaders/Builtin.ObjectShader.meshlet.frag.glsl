@@ -30,23 +30,28 @@ layout(set = 0, binding = 2) readonly buffer mesh_draw_block
    mesh_draw draws[];
 };
 
+layout(set = 0, binding = 5) readonly buffer material_block
+{
+   material materials[];
+};
+
 void main()
 {
 #if DEBUG
    out_color = in_color;
 #else
-    mesh_draw draw = draws[in_draw_ID];
+    material m = materials[draws[in_draw_ID].material];
     vec3 light_color = vec3(1.f);
     float ambient = 0.f;
 
    vec4 albedo = vec4(.5, .5, .5, 1);
    vec3 emissive = vec3(0.0);
 
-   if(draw.albedo != -1)
-      albedo = texture(textures[draw.albedo], in_uv).rgba;
+   if(m.albedo != -1)
+      albedo = texture(textures[m.albedo], in_uv).rgba;
    
-   if(draw.emissive != -1)
-      emissive = texture(textures[draw.emissive], in_uv).rgb;
+   if(m.emissive != -1)
+      emissive = texture(textures[m.emissive], in_uv).rgb;
 
    //float diffuse_factor = max(dot(normalize(in_normal), normalize(vec3(1, 1, 0))), 0.0);
    //vec3 diffuse = diffuse_factor * light_color;
@@ -9,13 +9,12 @@
 
 #include "mesh.h"
 #include "common.glsl"
+#include "vertex.glsl"
+#include "instance.glsl"
 
-// number of threads inside the work group
-layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
-layout(triangles, max_vertices = 64, max_primitives = 127) out;
-
-const uint max_vertices = 64;
-const uint max_primitives = 127;
+// number of threads inside the work group - specialized from the device preferred size
+layout(local_size_x_id = 0, local_size_y = 1, local_size_z = 1) in;
+layout(triangles, max_vertices = MESHLET_MAX_VERTICES, max_primitives = MESHLET_MAX_TRIANGLES) out;
 
 vec3 quad[4] = vec3[]
 (
@@ -27,7 +26,7 @@ vec3 quad[4] = vec3[]
 
 layout(set = 0, binding = 0) readonly buffer vertex_block
 {
-   vertex verts[];
+   vertex_gpu verts[];
 };
 
 layout(set = 0, binding = 1) readonly buffer meshlet_block
@@ -40,6 +39,11 @@ layout(set = 0, binding = 2) readonly buffer mesh_draw_block
    mesh_draw draws[];
 };
 
+layout(set = 0, binding = 4) readonly buffer mesh_instance_block
+{
+   mesh_instance instances[];
+};
+
 layout(location = 0) out vec4 out_color[];
 layout(location = 1) out vec2 out_uv[];
 layout(location = 2) out vec3 out_wp[];
@@ -69,7 +73,13 @@ uint32_t hash_index(uint32_t a)
 
 void main()
 {
-    int draw_ID = gl_DrawIDARB;
+    // the draws of a range start at its first batch
+    int draw_ID = int(globals.draw_offset) + gl_DrawIDARB;
+
+    // x walks the meshlets of the mesh, y the instances of the batch
+    mesh_instance instance = instances[draws[draw_ID].instance_offset + gl_WorkGroupID.y];
+    mat3 rotation = instance_rotation_matrix(instance_rotation(instance));
+    mat4 world = instance_world(instance, rotation);
 
     uint mi = draws[draw_ID].mesh_offset + gl_WorkGroupID.x;    // global meshlet index
     uint ti = gl_LocalInvocationID.x;     // thread index
@@ -77,8 +87,6 @@ void main()
     uint vertex_count = meshlets[mi].vertex_count;
     uint triangle_count = meshlets[mi].triangle_count;
 
-    mat3 normal_matrix = transpose(inverse(mat3(draws[draw_ID].world)));
-
 #if DEBUG
     uint h = hash_index(mi);
     vec3 meshlet_color = vec3(float(h & 255), float((h >> 8) & 255), float((h >> 16) & 255)) / 255.f;
@@ -88,34 +96,33 @@ void main()
     if(ti == 0)
       SetMeshOutputsEXT(vertex_count, triangle_count);
 
-    for(uint i = ti; i < vertex_count; i += 64)
+    for(uint i = ti; i < vertex_count; i += gl_WorkGroupSize.x)
     {
       uint vi = meshlets[mi].vertex_index_buffer[i];
 
       uint vertex_offset = draws[draw_ID].vertex_offset;
-      vertex v = verts[vertex_offset + vi];
-      vec4 wp = draws[draw_ID].world * vec4(vec3(v.vx, v.vy, v.vz), 1.0f);
+      vertex_gpu v = verts[vertex_offset + vi];
+      vec4 wp = world * vec4(vertex_position(v, draws[draw_ID]), 1.0f);
       vec4 vo = globals.projection * globals.view * wp;
-      vec3 n = vec3(v.nx, v.ny, v.nz);
 
       gl_MeshVerticesEXT[i].gl_Position = vo;
       out_wp[i] = wp.xyz;
 
-      vec3 normal = (n - 127.5) / 127.5;
-      vec3 world_normal = normalize(normal_matrix * normal);
+      vec3 normal = vertex_normal(v);
+      vec3 world_normal = instance_normal(instance, rotation, normal);
 
 #if DEBUG
       out_color[i] = vec4(meshlet_color, 1.0);
 #else
       out_color[i] = vec4(vec3(normal), 1.0);
 #endif
-      vec2 texcoord = vec2(v.tu, v.tv);
+      vec2 texcoord = vertex_uv(v);
       out_uv[i] = texcoord;
       out_normal[i] = world_normal;
       out_draw_ID[i] = draw_ID;
     }
 
-    for(uint i = ti; i < triangle_count; i += 64)
+    for(uint i = ti; i < triangle_count; i += gl_WorkGroupSize.x)
     {
       // one triangle - 3 primitive indices
       uint i0 = meshlets[mi].primitive_indices[3*i + 0];
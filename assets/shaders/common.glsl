@@ -8,6 +8,7 @@ layout(push_constant) uniform push_constants_block
     float near;
     float far;
     float ar;
+    uint draw_offset;
     bool draw_ground_plane;
 } globals;
 
@@ -0,0 +1,45 @@
+#if !defined(_INSTANCE_GLSL)
+#define _INSTANCE_GLSL
+
+// mesh_instance decode - the rotation and scale become the matrix of the instance, normals go through
+// the rotation and the inverse scale instead of the inverse transpose of the whole matrix
+
+vec4 instance_rotation(mesh_instance i)
+{
+   return normalize(vec4(unpackSnorm2x16(i.rotation[0]), unpackSnorm2x16(i.rotation[1])));
+}
+
+// columns of the rotation of a unit quaternion xyzw
+mat3 instance_rotation_matrix(vec4 q)
+{
+   vec3 q2 = q.xyz * 2.0;
+   float xx = q.x * q2.x, yy = q.y * q2.y, zz = q.z * q2.z;
+   float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+   float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+
+   return mat3(1.0 - (yy + zz), xy + wz, xz - wy,
+               xy - wz, 1.0 - (xx + zz), yz + wx,
+               xz + wy, yz - wx, 1.0 - (xx + yy));
+}
+
+vec3 instance_scale(mesh_instance i)
+{
+   return vec3(i.scale[0], i.scale[1], i.scale[2]);
+}
+
+mat4 instance_world(mesh_instance i, mat3 rotation)
+{
+   vec3 s = instance_scale(i);
+
+   return mat4(vec4(rotation[0] * s.x, 0.0),
+               vec4(rotation[1] * s.y, 0.0),
+               vec4(rotation[2] * s.z, 0.0),
+               vec4(i.position[0], i.position[1], i.position[2], 1.0));
+}
+
+vec3 instance_normal(mesh_instance i, mat3 rotation, vec3 n)
+{
+   return normalize(rotation * (n / instance_scale(i)));
+}
+
+#endif
@@ -8,25 +8,83 @@ struct vertex
    float tu, tv;        // texture
 };
 
-struct meshlet
+// compact vertex - 16 bytes instead of 24, decoded by vertex.glsl
+struct vertex_quantized
 {
-   uint32_t vertex_index_buffer[64];  // unique indices into the mesh vertex buffer
-   uint8_t primitive_indices[127*3];
-   uint8_t triangle_count;
-   uint8_t vertex_count;
+   uint32_t pxy;        // snorm16 position relative to the bounds of the mesh draw
+   uint32_t pzw;        // z and an unused w so ray tracing reads it as R16G16B16A16_SNORM
+   uint32_t n;          // snorm16 octahedral normal
+   uint32_t t;          // half float uv
 };
 
-struct mesh_draw
+// the vertex buffer layout, build the code and the shaders with -DVERTEX_QUANTIZED=1 for the compact one
+#if !defined(VERTEX_QUANTIZED)
+#define VERTEX_QUANTIZED 0
+#endif
+
+#if VERTEX_QUANTIZED
+#define vertex_gpu vertex_quantized
+#else
+#define vertex_gpu vertex
+#endif
+
+// meshlet limits shared by the builder and the mesh shader - override both with -D at build time
+#define MESHLET_DEFAULT_MAX_VERTICES 64
+#define MESHLET_DEFAULT_MAX_TRIANGLES 127
+
+#if !defined(MESHLET_MAX_VERTICES)
+#define MESHLET_MAX_VERTICES MESHLET_DEFAULT_MAX_VERTICES
+#endif
+
+#if !defined(MESHLET_MAX_TRIANGLES)
+#define MESHLET_MAX_TRIANGLES MESHLET_DEFAULT_MAX_TRIANGLES
+#endif
+
+// counts only widen when the triangle limit does not fit a byte
+#if MESHLET_MAX_TRIANGLES > 255
+#define meshlet_count_t uint32_t
+#else
+#define meshlet_count_t uint8_t
+#endif
+
+#define meshlet_declare(name, max_vertices, max_triangles, count_type) \
+struct name \
+{ \
+   uint32_t vertex_index_buffer[max_vertices];  /* unique indices into the mesh vertex buffer */ \
+   uint8_t primitive_indices[(max_triangles)*3]; \
+   count_type triangle_count; \
+   count_type vertex_count; \
+}
+
+meshlet_declare(meshlet, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, meshlet_count_t);
+
+// textures of a material, shared by every draw that uses it - indices into texture descriptors, -1 for none
+struct material
 {
-   uint32_t albedo;      // indices into texture descriptors
+   uint32_t albedo;
    uint32_t normal;
    uint32_t metal;
    uint32_t emissive;
    uint32_t ao;
+};
+
+// one per draw batch - every instance of a mesh is drawn by the same indirect command
+struct mesh_draw
+{
+   uint32_t material;         // index into the materials
    uint32_t mesh_offset;
    uint32_t vertex_offset;
+   uint32_t instance_offset;  // first mesh_instance of the batch
+   float position_center[3];  // quantized positions decode to center + extent * p
+   float position_extent[3];
+};
 
-   mat4 world;           // world transform - TODO: use pos, quat, scale in future
+// world transform as translation, rotation and scale, turned into a matrix by instance.glsl
+struct mesh_instance
+{
+   float position[3];
+   float scale[3];            // per axis, negative when the transform mirrors
+   uint32_t rotation[2];      // snorm16 quaternion xy and zw
 };
 
 #endif
@@ -0,0 +1,54 @@
+#if !defined(_VERTEX_GLSL)
+#define _VERTEX_GLSL
+
+// vertex_gpu decode - the float layout reads through, the quantized one unpacks
+
+#if VERTEX_QUANTIZED
+
+vec3 vertex_position(vertex_gpu v, mesh_draw d)
+{
+   vec3 p = vec3(unpackSnorm2x16(v.pxy), unpackSnorm2x16(v.pzw).x);
+   vec3 center = vec3(d.position_center[0], d.position_center[1], d.position_center[2]);
+   vec3 extent = vec3(d.position_extent[0], d.position_extent[1], d.position_extent[2]);
+
+   return center + extent * p;
+}
+
+vec3 vertex_normal(vertex_gpu v)
+{
+   vec2 e = unpackSnorm2x16(v.n);
+   vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+   // unfold the lower hemisphere
+   float t = max(-n.z, 0.0);
+   n.x += n.x >= 0.0 ? -t : t;
+   n.y += n.y >= 0.0 ? -t : t;
+
+   return normalize(n);
+}
+
+vec2 vertex_uv(vertex_gpu v)
+{
+   return unpackHalf2x16(v.t);
+}
+
+#else
+
+vec3 vertex_position(vertex_gpu v, mesh_draw d)
+{
+   return vec3(v.vx, v.vy, v.vz);
+}
+
+vec3 vertex_normal(vertex_gpu v)
+{
+   return (vec3(v.nx, v.ny, v.nz) - 127.5) / 127.5;
+}
+
+vec2 vertex_uv(vertex_gpu v)
+{
+   return vec2(v.tu, v.tv);
+}
+
+#endif
+
+#endif
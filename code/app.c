@@ -171,6 +171,10 @@ void app_start(hw* hw, s8 asset_file)
 
    hw->state.asset_file = asset_file;
 
+   // benchmarks measure the meshlet path
+   if(hw->state.bench_frames)
+      hw->state.is_mesh_shading = true;
+
    if(!vk_initialize(hw))
    {
       printf("Could not initialize all the required subsystems for Vulkan backend\n");
@@ -179,7 +183,8 @@ void app_start(hw* hw, s8 asset_file)
 
    printf("Vulkan backend initialized succesfully!\n");
 
-   hw_event_loop_start(hw, app_frame, app_input_handle);
+   if(!hw->state.cook)
+      hw_event_loop_start(hw, app_frame, app_input_handle);
    vk_uninitialize(hw);
 
    printf("Vulkan backend uninitialized succesfully!\n");
@@ -60,6 +60,15 @@ align_struct app_state
    app_camera camera;
    s8 asset_file;  // TODO: for testing
    f64 frame_delta_in_seconds;
+   u32 bench_frames;  // non zero renders this many unsynced frames, logs the timings and quits
+   u32 stream_budget_mb;  // non zero streams the geometry through this much memory instead of loading it whole
+   u32 texture_budget_mb; // non zero streams the texture mips the camera needs within this much video memory
+   u32 frames_in_flight;  // frames the cpu records ahead of the gpu, zero picks the default
+   u32 record_threads;    // job threads recording the draws into secondary command buffers, zero records them inline
+   bool cook;         // rebuilds the cooked scene next to the gltf and quits after the load
+   bool texture_trace;  // logs the decode, mip and compression time of every texture
+   bool graphics_uploads;  // uploads on the graphics queue even when the device has a transfer queue
+   bool instance_draws;    // a draw per instance instead of the indirect commands, recording grows with the instances
    bool is_mesh_shading;
    bool draw_axis;
 } app_state;
@@ -0,0 +1,3207 @@
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 202000L
+#   error "This code requires C23 or later"
+#endif
+
+#define _CRT_SECURE_NO_WARNINGS 1
+
+// meshlets are stored in the widest swept layout, the builder limits are picked at runtime
+#define MESHLET_MAX_VERTICES 128
+#define MESHLET_MAX_TRIANGLES 256
+
+#include <Windows.h>
+#include <psapi.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "common.h"
+#include "arena.h"
+#include "math.h"
+
+#define CGLTF_IMPLEMENTATION
+#include "../extern/cgltf/cgltf.h"
+
+#include "meshlet.c"
+#include "gltf_accessor.c"
+
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "../extern/stb_image.h"
+
+#include "win32_file_io.c"
+#include "texture_mip.c"
+#include "texture_bc.c"
+#include "ktx2.c"
+#include "texture_stream.c"
+#include "hash.c"
+#include "gltf_jobs.c"
+#include "meshopt_decode.c"
+#include "gltf_source.c"
+#include "gltf_stream.c"
+#include "vertex_quantize.c"
+#include "scene_graph.c"
+#include "draw_batch.c"
+#include "tlsf.c"
+#include "win32_job.c"
+
+// standalone cpu benchmarks - results are printed as one json object per line for regression tracking
+
+void* hw_virtual_memory_commit(void* address, usize size)
+{
+   return VirtualAlloc(address, size, MEM_COMMIT, PAGE_READWRITE);
+}
+
+void hw_virtual_memory_decommit(void* address, usize size)
+{
+   VirtualFree(address, size, MEM_DECOMMIT);
+}
+
+static i64 bench_counter()
+{
+   LARGE_INTEGER result;
+   QueryPerformanceCounter(&result);
+
+   return result.QuadPart;
+}
+
+static f64 bench_seconds_elapsed(i64 begin, i64 end)
+{
+   LARGE_INTEGER frequency;
+   QueryPerformanceFrequency(&frequency);
+
+   return ((f64)end - (f64)begin) / (f64)frequency.QuadPart;
+}
+
+static void bench_json_string(const char* s)
+{
+   putchar('"');
+   for(; *s; ++s)
+   {
+      if(*s == '"' || *s == '\\')
+         putchar('\\');
+      putchar(*s);
+   }
+   putchar('"');
+}
+
+align_struct bench_mesh
+{
+   vertex* vertices;
+   u32* indices;
+   size vertex_count;
+   size index_count;
+} bench_mesh;
+
+typedef array(bench_mesh) bench_meshes;
+
+static bool bench_gltf_load(bench_meshes* meshes, arena* a, const char* path)
+{
+   cgltf_options options = {0};
+   cgltf_data* data = 0;
+
+   if(cgltf_parse_file(&options, path, &data) != cgltf_result_success)
+      return false;
+
+   if(cgltf_load_buffers(&options, data, path) != cgltf_result_success)
+   {
+      cgltf_free(data);
+      return false;
+   }
+
+   size primitive_count = 0;
+   for(usize i = 0; i < data->meshes_count; ++i)
+      primitive_count += data->meshes[i].primitives_count;
+
+   if(primitive_count == 0)
+   {
+      cgltf_free(data);
+      return false;
+   }
+
+   bench_meshes result = {a};
+   array_resize(result, primitive_count);
+
+   for(usize i = 0; i < data->meshes_count; ++i)
+   {
+      cgltf_mesh* gltf_mesh = data->meshes + i;
+      for(usize p = 0; p < gltf_mesh->primitives_count; ++p)
+      {
+         cgltf_primitive* prim = gltf_mesh->primitives + p;
+         if(prim->type != cgltf_primitive_type_triangles)
+            continue;
+
+         cgltf_accessor* position_accessor = 0;
+         for(usize j = 0; j < prim->attributes_count; ++j)
+            if(prim->attributes[j].type == cgltf_attribute_type_position)
+               position_accessor = prim->attributes[j].data;
+
+         if(!position_accessor || position_accessor->count == 0)
+            continue;
+
+         bench_mesh mesh = {0};
+         mesh.vertex_count = position_accessor->count;
+         mesh.vertices = push(a, vertex, mesh.vertex_count);
+
+         gltf_vertices_read(mesh.vertices, mesh.vertex_count, position_accessor, 0, 0);
+
+         mesh.index_count = prim->indices ? prim->indices->count : mesh.vertex_count;
+         mesh.index_count -= mesh.index_count % 3;
+         if(mesh.index_count == 0)
+            continue;
+
+         mesh.indices = push(a, u32, mesh.index_count);
+
+         if(prim->indices)
+            cgltf_accessor_unpack_indices(prim->indices, mesh.indices, 4, mesh.index_count);
+         else
+            for(size k = 0; k < mesh.index_count; ++k)
+               mesh.indices[k] = (u32)k;
+
+         array_add(result, mesh);
+      }
+   }
+
+   cgltf_free(data);
+
+   *meshes = result;
+
+   return result.count > 0;
+}
+
+// positions and faces only - enough for the meshlet builders
+static bool bench_obj_load(bench_meshes* meshes, arena* a, const char* path)
+{
+   FILE* file = fopen(path, "rb");
+   if(!file)
+      return false;
+
+   fseek(file, 0, SEEK_END);
+   long file_size = ftell(file);
+   fseek(file, 0, SEEK_SET);
+
+   if(file_size <= 0)
+   {
+      fclose(file);
+      return false;
+   }
+
+   char* text = push(a, char, file_size + 1);
+   size read_size = fread(text, 1, file_size, file);
+   fclose(file);
+
+   if(read_size != (size)file_size)
+      return false;
+
+   size vertex_count = 0;
+   size index_count = 0;
+
+   // first pass counts, second pass fills
+   bench_mesh mesh = {0};
+   for(u32 pass = 0; pass < 2; ++pass)
+   {
+      size v = 0, f = 0;
+
+      for(char* line = text; line < text + file_size;)
+      {
+         char* line_end = line;
+         while(line_end < text + file_size && *line_end != '\n')
+            line_end++;
+
+         if(line[0] == 'v' && line[1] == ' ')
+         {
+            if(pass == 1)
+            {
+               char* s = line + 2;
+               mesh.vertices[v].vx = strtof(s, &s);
+               mesh.vertices[v].vy = strtof(s, &s);
+               mesh.vertices[v].vz = strtof(s, &s);
+            }
+            v++;
+         }
+         else if(line[0] == 'f' && line[1] == ' ')
+         {
+            u32 face[3] = {0};
+            u32 corner = 0;
+
+            for(char* s = line + 2;;)
+            {
+               while(s < line_end && (*s == ' ' || *s == '\t'))
+                  s++;
+               if(s >= line_end || *s == '\r')
+                  break;
+
+               long index = strtol(s, &s, 10);
+               u32 vi = index < 0 ? (u32)((long)v + index) : (u32)(index - 1);
+
+               // skip texture and normal indices
+               while(s < line_end && *s != ' ' && *s != '\t' && *s != '\r')
+                  s++;
+
+               // triangle fan
+               if(corner < 2)
+                  face[corner] = vi;
+               else
+               {
+                  if(pass == 1)
+                  {
+                     mesh.indices[f + 0] = face[0];
+                     mesh.indices[f + 1] = face[1];
+                     mesh.indices[f + 2] = vi;
+                  }
+                  f += 3;
+                  face[1] = vi;
+               }
+               corner++;
+            }
+         }
+
+         line = line_end + 1;
+      }
+
+      if(pass == 0)
+      {
+         vertex_count = v;
+         index_count = f;
+
+         if(vertex_count == 0 || index_count == 0)
+            return false;
+
+         mesh.vertex_count = vertex_count;
+         mesh.index_count = index_count;
+         mesh.vertices = push(a, vertex, vertex_count);
+         mesh.indices = push(a, u32, index_count);
+      }
+   }
+
+   for(size i = 0; i < index_count; ++i)
+      if(mesh.indices[i] >= vertex_count)
+         return false;
+
+   bench_meshes result = {a};
+   array_resize(result, 1);
+   array_add(result, mesh);
+
+   *meshes = result;
+
+   return true;
+}
+
+typedef void (*bench_meshlet_builder)(array_meshlet* result, arena s, u8* meshlet_vertices, const bench_mesh* mesh, meshlet_limits limits);
+
+static void bench_meshlet_build_greedy(array_meshlet* result, arena s, u8* meshlet_vertices, const bench_mesh* mesh, meshlet_limits limits)
+{
+   (void)s;
+   meshlet_build(result, meshlet_vertices, mesh->indices, mesh->index_count, 0, limits);
+}
+
+static void bench_meshlet_build_spatial(array_meshlet* result, arena s, u8* meshlet_vertices, const bench_mesh* mesh, meshlet_limits limits)
+{
+   meshlet_build_spatial(result, s, meshlet_vertices, mesh->vertices, mesh->indices, mesh->index_count, 0, limits);
+}
+
+static const struct
+{
+   const char* name;
+   bench_meshlet_builder build;
+} bench_meshlet_builders[] =
+{
+   {"greedy", bench_meshlet_build_greedy},
+   {"spatial", bench_meshlet_build_spatial},
+};
+
+// vendor preferred limits, see meshlet_sweep.bat for the matching gpu runs
+static const meshlet_limits bench_meshlet_sweep_limits[] =
+{
+   {32, 64},
+   {64, 84},
+   {64, 126},
+   {MESHLET_DEFAULT_MAX_VERTICES, MESHLET_DEFAULT_MAX_TRIANGLES},
+   {96, 192},
+   {128, 128},
+   {128, 256},
+};
+
+// gpu side size of a meshlet_declare()d struct with these limits
+static size bench_meshlet_bytes(meshlet_limits limits)
+{
+   size count_bytes = limits.max_triangles > 255 ? sizeof(u32) : sizeof(u8);
+   size bytes = limits.max_vertices*sizeof(u32) + limits.max_triangles*3 + 2*count_bytes;
+
+   return (bytes + sizeof(u32) - 1) & ~(sizeof(u32) - 1);
+}
+
+// viewpoints around each mesh for the cone culling estimate
+static const f32 bench_view_directions[][3] =
+{
+   {1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {0.f, -1.f, 0.f}, {0.f, 0.f, 1.f}, {0.f, 0.f, -1.f},
+   { 0.57735f,  0.57735f,  0.57735f}, {-0.57735f,  0.57735f,  0.57735f},
+   { 0.57735f, -0.57735f,  0.57735f}, {-0.57735f, -0.57735f,  0.57735f},
+   { 0.57735f,  0.57735f, -0.57735f}, {-0.57735f,  0.57735f, -0.57735f},
+   { 0.57735f, -0.57735f, -0.57735f}, {-0.57735f, -0.57735f, -0.57735f},
+};
+
+align_struct bench_meshlet_stats
+{
+   size meshlet_count;
+   size triangle_count;
+   size vertex_count;           // vertices of the source meshes
+   size meshlet_vertex_count;   // vertices summed over all meshlets
+   size tested_meshlets;
+   size culled_meshlets;
+   size backfacing_triangles;
+   size culled_triangles;
+   f64 radius_sum;
+   f64 build_seconds;
+} bench_meshlet_stats;
+
+static int bench_f32_compare(const void* a, const void* b)
+{
+   f32 fa = *(const f32*)a;
+   f32 fb = *(const f32*)b;
+
+   return (fa > fb) - (fa < fb);
+}
+
+static void bench_meshlet_cone_cull(bench_meshlet_stats* stats, const bench_mesh* mesh, const array_meshlet* meshlets, const meshlet_bounds* bounds)
+{
+   f32 lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+   f32 hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+   for(size i = 0; i < mesh->vertex_count; ++i)
+   {
+      const f32 p[3] = {mesh->vertices[i].vx, mesh->vertices[i].vy, mesh->vertices[i].vz};
+      for(u32 k = 0; k < 3; ++k)
+      {
+         lo[k] = p[k] < lo[k] ? p[k] : lo[k];
+         hi[k] = p[k] > hi[k] ? p[k] : hi[k];
+      }
+   }
+
+   const f32 center[3] = {(lo[0] + hi[0])*.5f, (lo[1] + hi[1])*.5f, (lo[2] + hi[2])*.5f};
+   const f32 half[3] = {(hi[0] - lo[0])*.5f, (hi[1] - lo[1])*.5f, (hi[2] - lo[2])*.5f};
+   const f32 radius = sqrtf(half[0]*half[0] + half[1]*half[1] + half[2]*half[2]);
+
+   for(u32 d = 0; d < array_count(bench_view_directions); ++d)
+   {
+      const f32* dir = bench_view_directions[d];
+      const f32 eye[3] = {center[0] + dir[0]*radius*3.f, center[1] + dir[1]*radius*3.f, center[2] + dir[2]*radius*3.f};
+
+      for(size j = 0; j < meshlets->count; ++j)
+      {
+         const meshlet* ml = meshlets->data + j;
+         const meshlet_bounds* b = bounds + j;
+
+         // conservative perspective test against the bounding sphere
+         const f32 to_center[3] = {b->center[0] - eye[0], b->center[1] - eye[1], b->center[2] - eye[2]};
+         const f32 distance = sqrtf(to_center[0]*to_center[0] + to_center[1]*to_center[1] + to_center[2]*to_center[2]);
+         const f32 along_axis = to_center[0]*b->cone_axis[0] + to_center[1]*b->cone_axis[1] + to_center[2]*b->cone_axis[2];
+
+         const bool culled = along_axis >= b->cone_cutoff*distance + b->radius;
+
+         stats->tested_meshlets++;
+         stats->culled_meshlets += culled;
+
+         for(u32 t = 0; t < ml->triangle_count; ++t)
+         {
+            const vertex* v0 = mesh->vertices + ml->vertex_index_buffer[ml->primitive_indices[t*3 + 0]];
+            const vertex* v1 = mesh->vertices + ml->vertex_index_buffer[ml->primitive_indices[t*3 + 1]];
+            const vertex* v2 = mesh->vertices + ml->vertex_index_buffer[ml->primitive_indices[t*3 + 2]];
+
+            const f32 e0[3] = {v1->vx - v0->vx, v1->vy - v0->vy, v1->vz - v0->vz};
+            const f32 e1[3] = {v2->vx - v0->vx, v2->vy - v0->vy, v2->vz - v0->vz};
+            const f32 n[3] = {e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0]};
+            const f32 view[3] = {v0->vx - eye[0], v0->vy - eye[1], v0->vz - eye[2]};
+
+            // degenerate triangles are neither
+            if(n[0]*view[0] + n[1]*view[1] + n[2]*view[2] > 0.f)
+            {
+               stats->backfacing_triangles++;
+               stats->culled_triangles += culled;
+            }
+         }
+      }
+   }
+}
+
+static void bench_meshlet_run(arena* a, arena s, const bench_meshes* meshes, const char* file, const char* bench_name, const char* builder_name, bench_meshlet_builder build, meshlet_limits limits, u32 iterations)
+{
+   bench_meshlet_stats stats = {0};
+
+   size max_vertex_count = 0;
+   for(size m = 0; m < meshes->count; ++m)
+   {
+      max_vertex_count = meshes->data[m].vertex_count > max_vertex_count ? meshes->data[m].vertex_count : max_vertex_count;
+      stats.vertex_count += meshes->data[m].vertex_count;
+   }
+
+   u8* meshlet_vertices = push(&s, u8, max_vertex_count);
+   array_meshlet* results = push(&s, array_meshlet, meshes->count);
+
+   // every iteration rebuilds into the same memory, the fastest run is reported
+   stats.build_seconds = DBL_MAX;
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      arena run = *a;
+
+      i64 begin = bench_counter();
+
+      for(size m = 0; m < meshes->count; ++m)
+      {
+         const bench_mesh* mesh = meshes->data + m;
+
+         // 0xff means the vertex index is not in use yet
+         pointer_clear_to(meshlet_vertices, 0xff, mesh->vertex_count);
+
+         results[m] = (array_meshlet){&run};
+         build(results + m, s, meshlet_vertices, mesh, limits);
+      }
+
+      f64 seconds = bench_seconds_elapsed(begin, bench_counter());
+      stats.build_seconds = seconds < stats.build_seconds ? seconds : stats.build_seconds;
+   }
+
+   for(size m = 0; m < meshes->count; ++m)
+      stats.meshlet_count += results[m].count;
+
+   if(stats.meshlet_count == 0)
+      return;
+
+   f32* radii = push(&s, f32, stats.meshlet_count);
+   size radius_count = 0;
+
+   for(size m = 0; m < meshes->count; ++m)
+   {
+      const bench_mesh* mesh = meshes->data + m;
+      const array_meshlet* meshlets = results + m;
+
+      if(meshlets->count == 0)
+         continue;
+
+      arena bounds_scratch = s;
+      meshlet_bounds* bounds = push(&bounds_scratch, meshlet_bounds, meshlets->count);
+
+      for(size j = 0; j < meshlets->count; ++j)
+      {
+         const meshlet* ml = meshlets->data + j;
+
+         stats.triangle_count += ml->triangle_count;
+         stats.meshlet_vertex_count += ml->vertex_count;
+
+         bounds[j] = meshlet_bounds_compute(ml, mesh->vertices);
+
+         radii[radius_count++] = bounds[j].radius;
+         stats.radius_sum += bounds[j].radius;
+      }
+
+      bench_meshlet_cone_cull(&stats, mesh, meshlets, bounds);
+   }
+
+   qsort(radii, radius_count, sizeof(f32), bench_f32_compare);
+
+   const size max_vertices = limits.max_vertices;
+   const size max_triangles = limits.max_triangles;
+
+   const f64 meshlet_count = (f64)stats.meshlet_count;
+
+   printf("{\"bench\":\"%s\",\"file\":", bench_name);
+   bench_json_string(file);
+   printf(",\"builder\":\"%s\",\"max_vertices\":%zu,\"max_triangles\":%zu", builder_name, max_vertices, max_triangles);
+   printf(",\"meshes\":%zu,\"vertices\":%zu,\"triangles\":%zu,\"meshlets\":%zu", meshes->count, stats.vertex_count, stats.triangle_count, stats.meshlet_count);
+   printf(",\"meshlet_bytes\":%zu", stats.meshlet_count * bench_meshlet_bytes(limits));
+   printf(",\"vertex_fill\":%.4f", (f64)stats.meshlet_vertex_count / (meshlet_count * (f64)max_vertices));
+   printf(",\"triangle_fill\":%.4f", (f64)stats.triangle_count / (meshlet_count * (f64)max_triangles));
+   printf(",\"vertex_duplication\":%.4f", (f64)stats.meshlet_vertex_count / (f64)stats.vertex_count);
+   printf(",\"radius_min\":%.6f,\"radius_p50\":%.6f,\"radius_p90\":%.6f,\"radius_max\":%.6f,\"radius_mean\":%.6f",
+          radii[0], radii[radius_count/2], radii[(radius_count*9)/10], radii[radius_count - 1], stats.radius_sum / meshlet_count);
+   printf(",\"cone_culled_meshlets\":%.4f", (f64)stats.culled_meshlets / (f64)stats.tested_meshlets);
+   printf(",\"cone_cull_efficiency\":%.4f", stats.backfacing_triangles ? (f64)stats.culled_triangles / (f64)stats.backfacing_triangles : 0.0);
+   printf(",\"build_ms\":%.3f,\"triangles_per_second\":%.0f}\n", stats.build_seconds * 1000.0, (f64)stats.triangle_count / stats.build_seconds);
+}
+
+static bool bench_meshes_load(bench_meshes* meshes, arena* a, const char* file)
+{
+   const size file_len = strlen(file);
+   const bool is_obj = file_len > 4 && _stricmp(file + file_len - 4, ".obj") == 0;
+
+   if(!(is_obj ? bench_obj_load(meshes, a, file) : bench_gltf_load(meshes, a, file)))
+   {
+      printf("Could not load mesh: %s\n", file);
+      return false;
+   }
+
+   return true;
+}
+
+static bool bench_meshlet(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 10;
+   iterations = iterations > 0 ? iterations : 1;
+
+   bench_meshes meshes = {0};
+   if(!bench_meshes_load(&meshes, a, file))
+      return false;
+
+   const meshlet_limits limits = {MESHLET_DEFAULT_MAX_VERTICES, MESHLET_DEFAULT_MAX_TRIANGLES};
+
+   for(u32 i = 0; i < array_count(bench_meshlet_builders); ++i)
+      bench_meshlet_run(a, s, &meshes, file, "meshlet", bench_meshlet_builders[i].name, bench_meshlet_builders[i].build, limits, iterations);
+
+   return true;
+}
+
+// every builder against every limit configuration, optionally only the one given on the command line
+static bool bench_meshlet_sweep(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 10;
+   iterations = iterations > 0 ? iterations : 1;
+
+   const meshlet_limits* configs = bench_meshlet_sweep_limits;
+   size config_count = array_count(bench_meshlet_sweep_limits);
+
+   meshlet_limits custom = {0};
+   if(argc > 3)
+   {
+      custom.max_vertices = (u32)atoi(argv[2]);
+      custom.max_triangles = (u32)atoi(argv[3]);
+
+      if(custom.max_vertices == 0 || custom.max_vertices > MESHLET_MAX_VERTICES ||
+         custom.max_triangles == 0 || custom.max_triangles > MESHLET_MAX_TRIANGLES)
+      {
+         printf("Could not sweep meshlet limits %u/%u: supported up to %u/%u\n",
+                custom.max_vertices, custom.max_triangles, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+         return false;
+      }
+
+      configs = &custom;
+      config_count = 1;
+   }
+
+   bench_meshes meshes = {0};
+   if(!bench_meshes_load(&meshes, a, file))
+      return false;
+
+   for(size c = 0; c < config_count; ++c)
+      for(u32 i = 0; i < array_count(bench_meshlet_builders); ++i)
+         bench_meshlet_run(a, s, &meshes, file, "sweep", bench_meshlet_builders[i].name, bench_meshlet_builders[i].build, configs[c], iterations);
+
+   return true;
+}
+
+// the vertex attributes of the loader for one primitive
+align_struct bench_gltf_primitive
+{
+   const cgltf_accessor* position;
+   const cgltf_accessor* normal;
+   const cgltf_accessor* texcoord;
+   const cgltf_accessor* indices;
+   usize vertex_offset;
+   usize index_offset;
+} bench_gltf_primitive;
+
+typedef array(bench_gltf_primitive) bench_gltf_primitives;
+
+static void bench_gltf_convert(const bench_gltf_primitives* primitives, vertex* vertices, u32* indices, bool bulk, f64* vertex_seconds, f64* index_seconds)
+{
+   i64 begin = bench_counter();
+
+   for(size i = 0; i < primitives->count; ++i)
+   {
+      const bench_gltf_primitive* p = primitives->data + i;
+      if(bulk)
+         gltf_vertices_read(vertices + p->vertex_offset, p->position->count, p->position, p->normal, p->texcoord);
+      else
+         gltf_vertices_read_generic(vertices + p->vertex_offset, 0, p->position->count, p->position, p->normal, p->texcoord);
+   }
+
+   i64 middle = bench_counter();
+
+   for(size i = 0; i < primitives->count; ++i)
+   {
+      const bench_gltf_primitive* p = primitives->data + i;
+      if(bulk)
+         gltf_indices_read(indices + p->index_offset, p->indices);
+      else
+         gltf_indices_read_generic(indices + p->index_offset, p->indices);
+   }
+
+   *vertex_seconds = bench_seconds_elapsed(begin, middle);
+   *index_seconds = bench_seconds_elapsed(middle, bench_counter());
+}
+
+// per stage timings of the gltf load with the generic and the bulk accessor conversion
+static bool bench_gltf(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 10;
+   iterations = iterations > 0 ? iterations : 1;
+
+   cgltf_options options = {0};
+   cgltf_data* data = 0;
+
+   i64 begin = bench_counter();
+
+   if(cgltf_parse_file(&options, file, &data) != cgltf_result_success)
+   {
+      printf("Could not parse gltf: %s\n", file);
+      return false;
+   }
+
+   i64 parsed = bench_counter();
+
+   if(cgltf_load_buffers(&options, data, file) != cgltf_result_success)
+   {
+      printf("Could not load gltf buffers: %s\n", file);
+      cgltf_free(data);
+      return false;
+   }
+
+   i64 loaded = bench_counter();
+
+   if(cgltf_validate(data) != cgltf_result_success)
+   {
+      printf("Could not validate gltf: %s\n", file);
+      cgltf_free(data);
+      return false;
+   }
+
+   i64 validated = bench_counter();
+
+   bench_gltf_primitives primitives = {a};
+   size primitive_count = 0;
+   for(usize i = 0; i < data->meshes_count; ++i)
+      primitive_count += data->meshes[i].primitives_count;
+
+   if(primitive_count == 0)
+   {
+      cgltf_free(data);
+      return false;
+   }
+
+   array_resize(primitives, primitive_count);
+
+   usize vertex_count = 0;
+   usize index_count = 0;
+   usize bulk_count = 0;
+
+   for(usize i = 0; i < data->meshes_count; ++i)
+   {
+      cgltf_mesh* mesh = data->meshes + i;
+      for(usize p = 0; p < mesh->primitives_count; ++p)
+      {
+         cgltf_primitive* prim = mesh->primitives + p;
+         bench_gltf_primitive bp = {0};
+
+         for(usize j = 0; j < prim->attributes_count; ++j)
+         {
+            cgltf_attribute* attr = prim->attributes + j;
+
+            cgltf_attribute_type attr_type;
+            i32 attr_index;
+            cgltf_parse_attribute_type(attr->name, &attr_type, &attr_index);
+
+            if(attr_type == cgltf_attribute_type_position)
+               bp.position = attr->data;
+            else if(attr_type == cgltf_attribute_type_normal)
+               bp.normal = attr->data;
+            else if(attr_type == cgltf_attribute_type_texcoord && attr_index == 0)
+               bp.texcoord = attr->data;
+         }
+
+         if(prim->type != cgltf_primitive_type_triangles || !bp.position || !prim->indices)
+            continue;
+
+         bp.indices = prim->indices;
+         bp.vertex_offset = vertex_count;
+         bp.index_offset = index_count;
+
+         vertex_count += bp.position->count;
+         index_count += bp.indices->count;
+
+         arena probe = s;
+         if(gltf_vertices_read_bulk(push(&probe, vertex, bp.position->count + 1), bp.position->count, bp.position, bp.normal, bp.texcoord))
+            bulk_count++;
+
+         array_add(primitives, bp);
+      }
+   }
+
+   if(vertex_count == 0 || index_count == 0)
+   {
+      cgltf_free(data);
+      return false;
+   }
+
+   vertex* generic_vertices = push(&s, vertex, vertex_count);
+   vertex* bulk_vertices = push(&s, vertex, vertex_count);
+   u32* generic_indices = push(&s, u32, index_count);
+   u32* bulk_indices = push(&s, u32, index_count);
+
+   const char* paths[] = {"generic", "bulk"};
+   for(u32 path = 0; path < array_count(paths); ++path)
+   {
+      f64 vertex_seconds = DBL_MAX;
+      f64 index_seconds = DBL_MAX;
+
+      for(u32 it = 0; it < iterations; ++it)
+      {
+         f64 vs = 0, is = 0;
+         bench_gltf_convert(&primitives, path ? bulk_vertices : generic_vertices, path ? bulk_indices : generic_indices, path == 1, &vs, &is);
+
+         vertex_seconds = vs < vertex_seconds ? vs : vertex_seconds;
+         index_seconds = is < index_seconds ? is : index_seconds;
+      }
+
+      // the bulk path has to produce the exact bytes of the generic one
+      const bool match = memcmp(generic_vertices, bulk_vertices, vertex_count*sizeof(vertex)) == 0 &&
+                         memcmp(generic_indices, bulk_indices, index_count*sizeof(u32)) == 0;
+
+      const f64 ms = 1e3;
+
+      printf("{\"bench\":\"gltf\",\"file\":");
+      bench_json_string(file);
+      printf(",\"path\":\"%s\",\"primitives\":%zu,\"bulk_primitives\":%zu,\"vertices\":%zu,\"indices\":%zu",
+             paths[path], primitives.count, bulk_count, vertex_count, index_count);
+      printf(",\"parse_ms\":%.3f,\"buffers_ms\":%.3f,\"validate_ms\":%.3f",
+             bench_seconds_elapsed(begin, parsed) * ms, bench_seconds_elapsed(parsed, loaded) * ms, bench_seconds_elapsed(loaded, validated) * ms);
+      printf(",\"vertices_ms\":%.3f,\"indices_ms\":%.3f,\"vertices_per_second\":%.0f", vertex_seconds * ms, index_seconds * ms, (f64)vertex_count / vertex_seconds);
+      printf(",\"match\":%s}\n", path == 0 || match ? "true" : "false");
+   }
+
+   cgltf_free(data);
+
+   return true;
+}
+
+// cpu side of the gltf load - texture decodes, vertex conversion and meshlet builds - with 1, 2, 4 .. max threads
+static bool bench_load(arena* a, arena s, hw_jobs* jobs, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 5;
+   iterations = iterations > 0 ? iterations : 1;
+
+   u32 max_thread_count = jobs->thread_count;
+   if(argc > 2 && atoi(argv[2]) > 0)
+      max_thread_count = min((u32)atoi(argv[2]), max_thread_count);
+
+   cgltf_options options = {0};
+   cgltf_data* data = 0;
+
+   if(cgltf_parse_file(&options, file, &data) != cgltf_result_success)
+   {
+      printf("Could not parse gltf: %s\n", file);
+      return false;
+   }
+
+   if(cgltf_load_buffers(&options, data, file) != cgltf_result_success)
+   {
+      printf("Could not load gltf buffers: %s\n", file);
+      cgltf_free(data);
+      return false;
+   }
+
+   size primitive_count = 0;
+   usize vertex_count = 0;
+   usize index_count = 0;
+   for(usize i = 0; i < data->meshes_count; ++i)
+   {
+      primitive_count += data->meshes[i].primitives_count;
+      for(usize p = 0; p < data->meshes[i].primitives_count; ++p)
+      {
+         cgltf_primitive* prim = data->meshes[i].primitives + p;
+         vertex_count += prim->attributes_count ? prim->attributes[0].data->count : 0;
+         index_count += prim->indices ? prim->indices->count : 0;
+      }
+   }
+
+   if(primitive_count == 0 || vertex_count == 0 || index_count == 0)
+   {
+      cgltf_free(data);
+      return false;
+   }
+
+   vertex* vertices = push(a, vertex, vertex_count);
+   u32* indices = push(a, u32, index_count);
+
+   gltf_load_jobs load_jobs = {0};
+   load_jobs.limits = meshlet_default_limits;
+   load_jobs.primitives = push(a, gltf_primitive_job, primitive_count);
+   load_jobs.textures = data->textures_count ? push(a, gltf_texture_job, data->textures_count) : 0;
+
+   usize vertex_offset = 0;
+   usize index_offset = 0;
+
+   for(usize i = 0; i < data->meshes_count; ++i)
+   {
+      cgltf_mesh* mesh = data->meshes + i;
+      for(usize p = 0; p < mesh->primitives_count; ++p)
+      {
+         cgltf_primitive* prim = mesh->primitives + p;
+         gltf_primitive_job job = {0};
+
+         for(usize j = 0; j < prim->attributes_count; ++j)
+         {
+            cgltf_attribute* attr = prim->attributes + j;
+
+            cgltf_attribute_type attr_type;
+            i32 attr_index;
+            cgltf_parse_attribute_type(attr->name, &attr_type, &attr_index);
+
+            if(attr_type == cgltf_attribute_type_position)
+               job.position = attr->data;
+            else if(attr_type == cgltf_attribute_type_normal)
+               job.normal = attr->data;
+            else if(attr_type == cgltf_attribute_type_texcoord && attr_index == 0)
+               job.texcoord = attr->data;
+         }
+
+         if(prim->type != cgltf_primitive_type_triangles || !job.position || !prim->indices)
+            continue;
+
+         if(vertex_offset + job.position->count > vertex_count)
+            continue;
+
+         job.index_accessor = prim->indices;
+         job.vertices = vertices + vertex_offset;
+         job.indices = indices + index_offset;
+         job.vertex_count = job.position->count;
+
+         vertex_offset += job.position->count;
+         index_offset += prim->indices->count;
+
+         load_jobs.primitives[load_jobs.primitive_count++] = job;
+      }
+   }
+
+   for(usize i = 0; i < data->textures_count; ++i)
+   {
+      cgltf_image* img = data->textures[i].image;
+      if(!img || !img->uri)
+         continue;
+
+      cgltf_decode_uri(img->uri);
+      load_jobs.textures[load_jobs.texture_count++].path = gltf_uri_path(a, s8(img->uri), s8(file));
+   }
+
+   f64 serial_seconds = 0;
+
+   for(u32 thread_count = 1;; thread_count = min(thread_count*2, max_thread_count))
+   {
+      hw_jobs sweep_jobs = *jobs;
+      sweep_jobs.thread_count = thread_count;
+
+      f64 seconds = DBL_MAX;
+      size meshlet_count = 0;
+      u32 texture_failures = 0;
+
+      for(u32 it = 0; it < iterations; ++it)
+      {
+         i64 begin = bench_counter();
+         sweep_jobs.parallel_for(&sweep_jobs, gltf_load_job, &load_jobs, load_jobs.texture_count + load_jobs.primitive_count);
+         f64 elapsed = bench_seconds_elapsed(begin, bench_counter());
+
+         seconds = elapsed < seconds ? elapsed : seconds;
+
+         meshlet_count = 0;
+         for(u32 i = 0; i < load_jobs.primitive_count; ++i)
+            meshlet_count += load_jobs.primitives[i].meshlets.count;
+
+         texture_failures = 0;
+         for(u32 i = 0; i < load_jobs.texture_count; ++i)
+         {
+            texture_failures += load_jobs.textures[i].pixels == 0;
+            stbi_image_free(load_jobs.textures[i].pixels);
+            load_jobs.textures[i].pixels = 0;
+         }
+      }
+
+      if(thread_count == 1)
+         serial_seconds = seconds;
+
+      const f64 ms = 1e3;
+
+      printf("{\"bench\":\"load\",\"file\":");
+      bench_json_string(file);
+      printf(",\"threads\":%u,\"primitives\":%u,\"textures\":%u,\"texture_failures\":%u,\"vertices\":%zu,\"meshlets\":%zu",
+             thread_count, load_jobs.primitive_count, load_jobs.texture_count, texture_failures, vertex_offset, meshlet_count);
+      printf(",\"jobs_ms\":%.3f,\"speedup\":%.2f}\n", seconds * ms, serial_seconds / seconds);
+
+      if(thread_count == max_thread_count)
+         break;
+   }
+
+   cgltf_free(data);
+
+   return true;
+}
+
+// one grid primitive of the synthetic scene
+#define BENCH_STREAM_GRID 256
+
+align_struct bench_stream_totals
+{
+   usize vertex_count;
+   usize index_count;
+   usize meshlet_count;
+   u64 checksum;
+   bool ordered;     // chunks arrived back to back
+} bench_stream_totals;
+
+static bool bench_stream_sink(void* user, const gltf_stream_chunk* chunk)
+{
+   bench_stream_totals* totals = user;
+
+   totals->ordered = totals->ordered && chunk->vertex_offset == totals->vertex_count &&
+                     chunk->index_offset == totals->index_count && chunk->meshlet_offset == totals->meshlet_count;
+
+   // touch the chunk like an upload would
+   for(usize i = 0; i < chunk->index_count; ++i)
+      totals->checksum += chunk->indices[i];
+   for(usize i = 0; i < chunk->meshlet_count; ++i)
+      totals->checksum += chunk->meshlets[i].vertex_count + chunk->meshlets[i].triangle_count;
+
+   totals->vertex_count += chunk->vertex_count;
+   totals->index_count += chunk->index_count;
+   totals->meshlet_count += chunk->meshlet_count;
+
+   return true;
+}
+
+// writes grid primitives until the file reaches gigabytes, streams it back through budget bytes
+static bool bench_stream(arena* a, arena s, hw_jobs* jobs, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const f64 gigabytes = atof(argv[0]);
+   const size budget = argc > 1 && atoi(argv[1]) > 0 ? MB((size)atoi(argv[1])) : GLTF_STREAM_DEFAULT_BUDGET;
+   const char* path = argc > 2 ? argv[2] : "bench_stream.bin";
+
+   const usize grid = BENCH_STREAM_GRID;
+   const usize vertex_count = grid * grid;
+   const usize index_count = (grid - 1) * (grid - 1) * 6;
+
+   // positions, normals, uvs and indices of a primitive are back to back
+   const size position_bytes = vertex_count * 3*sizeof(f32);
+   const size normal_bytes = vertex_count * 3*sizeof(f32);
+   const size uv_bytes = vertex_count * 2*sizeof(f32);
+   const size primitive_bytes = position_bytes + normal_bytes + uv_bytes + index_count*sizeof(u32);
+
+   const u32 primitive_count = max((u32)(gigabytes * GB(1) / primitive_bytes), 1u);
+   const size file_size = primitive_count * primitive_bytes;
+
+   i64 begin = bench_counter();
+
+   win32_file_view file = {0};
+   if(!win32_file_map_write(&file, path, file_size))
+   {
+      printf("Could not create the synthetic scene: %s\n", path);
+      return false;
+   }
+
+   for(u32 p = 0; p < primitive_count; ++p)
+   {
+      u8* base = (u8*)file.data + p*primitive_bytes;
+      f32* positions = (f32*)base;
+      f32* normals = (f32*)(base + position_bytes);
+      f32* uvs = (f32*)(base + position_bytes + normal_bytes);
+      u32* indices = (u32*)(base + position_bytes + normal_bytes + uv_bytes);
+
+      for(usize y = 0; y < grid; ++y)
+         for(usize x = 0; x < grid; ++x)
+         {
+            const usize v = y*grid + x;
+            const f32 u = (f32)x / (grid - 1);
+            const f32 w = (f32)y / (grid - 1);
+
+            positions[v*3 + 0] = (f32)p + u;
+            positions[v*3 + 1] = 0.0f;
+            positions[v*3 + 2] = w;
+            normals[v*3 + 0] = 0.0f;
+            normals[v*3 + 1] = 1.0f;
+            normals[v*3 + 2] = 0.0f;
+            uvs[v*2 + 0] = u;
+            uvs[v*2 + 1] = w;
+         }
+
+      usize i = 0;
+      for(u32 y = 0; y < grid - 1; ++y)
+         for(u32 x = 0; x < grid - 1; ++x)
+         {
+            const u32 v = y*(u32)grid + x;
+            indices[i++] = v;
+            indices[i++] = v + (u32)grid;
+            indices[i++] = v + 1;
+            indices[i++] = v + 1;
+            indices[i++] = v + (u32)grid;
+            indices[i++] = v + (u32)grid + 1;
+         }
+   }
+
+   win32_file_unmap(&file);
+
+   const f64 write_seconds = bench_seconds_elapsed(begin, bench_counter());
+
+   if(!win32_file_map(&file, path))
+   {
+      printf("Could not map the synthetic scene: %s\n", path);
+      DeleteFileA(path);
+      return false;
+   }
+
+   // gltf document of the scene, the buffer is the mapping
+   cgltf_buffer* buffer = push(a, cgltf_buffer, 1);
+   buffer->size = file_size;
+   buffer->data = file.data;
+
+   cgltf_buffer_view* views = push(a, cgltf_buffer_view, 4*primitive_count);
+   cgltf_accessor* accessors = push(a, cgltf_accessor, 4*primitive_count);
+   gltf_primitive_job* primitives = push(a, gltf_primitive_job, primitive_count);
+
+   const cgltf_type types[4] = {cgltf_type_vec3, cgltf_type_vec3, cgltf_type_vec2, cgltf_type_scalar};
+   const cgltf_component_type components[4] = {cgltf_component_type_r_32f, cgltf_component_type_r_32f, cgltf_component_type_r_32f, cgltf_component_type_r_32u};
+   const size strides[4] = {3*sizeof(f32), 3*sizeof(f32), 2*sizeof(f32), sizeof(u32)};
+   const usize counts[4] = {vertex_count, vertex_count, vertex_count, index_count};
+
+   for(u32 p = 0; p < primitive_count; ++p)
+   {
+      size offset = p*primitive_bytes;
+      for(u32 k = 0; k < 4; ++k)
+      {
+         cgltf_buffer_view* view = views + p*4 + k;
+         view->buffer = buffer;
+         view->offset = offset;
+         view->size = counts[k] * strides[k];
+
+         cgltf_accessor* accessor = accessors + p*4 + k;
+         accessor->buffer_view = view;
+         accessor->type = types[k];
+         accessor->component_type = components[k];
+         accessor->count = counts[k];
+         accessor->stride = strides[k];
+
+         offset += view->size;
+      }
+
+      primitives[p] = (gltf_primitive_job)
+      {
+         .position = accessors + p*4 + 0,
+         .normal = accessors + p*4 + 1,
+         .texcoord = accessors + p*4 + 2,
+         .index_accessor = accessors + p*4 + 3,
+         .vertex_count = vertex_count,
+      };
+   }
+
+   begin = bench_counter();
+
+   gltf_stream_stats stats = {0};
+   bench_stream_totals totals = {.ordered = true};
+   bool result = gltf_stream_primitives(s, jobs, primitives, primitive_count, budget, meshlet_default_limits,
+                                        bench_stream_sink, &totals, &stats);
+
+   const f64 stream_seconds = bench_seconds_elapsed(begin, bench_counter());
+
+   win32_file_unmap(&file);
+   DeleteFileA(path);
+
+   if(!result)
+      return false;
+
+   // bytes the scene takes fully converted, what a whole load would keep in memory
+   const size scene_bytes = stats.vertex_count*sizeof(vertex) + stats.index_count*sizeof(u32) + stats.meshlet_count*sizeof(meshlet);
+   const f64 ms = 1e3;
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"stream\",\"threads\":%u,\"primitives\":%u,\"file_mb\":%.1f,\"scene_mb\":%.1f",
+          jobs->thread_count, primitive_count, file_size * mb, scene_bytes * mb);
+   printf(",\"budget_mb\":%.1f,\"peak_mb\":%.1f,\"within_budget\":%s,\"oversized\":%u,\"chunks\":%zu",
+          budget * mb, stats.peak_bytes * mb, stats.peak_bytes <= budget ? "true" : "false", stats.oversized_count, stats.chunk_count);
+   printf(",\"vertices\":%zu,\"indices\":%zu,\"meshlets\":%zu,\"ordered\":%s,\"checksum\":%llu",
+          stats.vertex_count, stats.index_count, stats.meshlet_count, totals.ordered ? "true" : "false", (unsigned long long)totals.checksum);
+   printf(",\"write_ms\":%.3f,\"stream_ms\":%.3f,\"stream_mb_per_s\":%.1f}\n",
+          write_seconds * ms, stream_seconds * ms, file_size * mb / stream_seconds);
+
+   return totals.ordered && stats.peak_bytes <= budget;
+}
+
+align_struct bench_memory
+{
+   size private_bytes;   // committed memory of the process, heap copies land here
+   size working_set;     // resident pages including the touched parts of mappings
+} bench_memory;
+
+static bench_memory bench_memory_usage()
+{
+   PROCESS_MEMORY_COUNTERS_EX counters = {.cb = sizeof(counters)};
+   GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&counters, sizeof(counters));
+
+   return (bench_memory){counters.PrivateUsage, counters.WorkingSetSize};
+}
+
+// bytes of the cgltf buffers that live on the heap instead of in a mapping
+static size bench_glb_heap_bytes(const gltf_source* source)
+{
+   size result = 0;
+   for(usize i = 0; i < source->data->buffers_count; ++i)
+   {
+      const u8* data = source->data->buffers[i].data;
+      const u8* file = source->file.data;
+
+      if(data && !(data >= file && data < file + source->file.size))
+         result += source->data->buffers[i].size;
+   }
+
+   return result;
+}
+
+// parse, buffers and accessor conversion of one file. memory is sampled after the buffer load so
+// the conversion output in the reused scratch does not skew the second file
+static bool bench_glb_file(arena s, const char* file, u32 iterations)
+{
+   f64 parse_seconds = DBL_MAX, buffer_seconds = DBL_MAX, convert_seconds = DBL_MAX;
+   size private_bytes = 0, working_set = 0, heap_bytes = 0;
+   usize vertex_count = 0;
+   bool glb = false;
+
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      arena scratch = s;
+      gltf_source source = {0};
+
+      const bench_memory before = bench_memory_usage();
+      i64 begin = bench_counter();
+
+      if(!gltf_source_open(&source, s8(file)) || !gltf_source_parse(&source))
+      {
+         printf("Could not parse gltf: %s\n", file);
+         gltf_source_close(&source);
+         return false;
+      }
+
+      i64 parsed = bench_counter();
+
+      if(!gltf_source_buffers_load(&source, &scratch, s8(file), false))
+      {
+         printf("Could not load gltf buffers: %s\n", file);
+         gltf_source_close(&source);
+         return false;
+      }
+
+      i64 loaded = bench_counter();
+      const bench_memory after = bench_memory_usage();
+
+      gltf_load_jobs load_jobs = {0};
+      gltf_primitive_jobs_create(&scratch, source.data, &load_jobs);
+
+      // touch every accessor like the loader does
+      vertex_count = 0;
+      for(u32 i = 0; i < load_jobs.primitive_count; ++i)
+      {
+         gltf_primitive_job* job = load_jobs.primitives + i;
+         if(job->vertex_count == 0 || !job->index_accessor)
+            continue;
+
+         arena convert = scratch;
+         vertex* vertices = push(&convert, vertex, job->vertex_count);
+         u32* indices = push(&convert, u32, job->index_accessor->count);
+
+         gltf_vertices_read(vertices, job->vertex_count, job->position, job->normal, job->texcoord);
+         gltf_indices_read(indices, job->index_accessor);
+
+         vertex_count += job->vertex_count;
+      }
+
+      i64 converted = bench_counter();
+
+      parse_seconds = min(parse_seconds, bench_seconds_elapsed(begin, parsed));
+      buffer_seconds = min(buffer_seconds, bench_seconds_elapsed(parsed, loaded));
+      convert_seconds = min(convert_seconds, bench_seconds_elapsed(loaded, converted));
+
+      private_bytes = max(private_bytes, after.private_bytes > before.private_bytes ? after.private_bytes - before.private_bytes : 0);
+      working_set = max(working_set, after.working_set > before.working_set ? after.working_set - before.working_set : 0);
+      heap_bytes = bench_glb_heap_bytes(&source);
+      glb = gltf_source_is_glb(&source.file);
+
+      gltf_source_close(&source);
+   }
+
+   const f64 ms = 1e3;
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"glb\",\"file\":");
+   bench_json_string(file);
+   printf(",\"glb\":%s,\"vertices\":%zu,\"heap_buffer_mb\":%.2f,\"private_delta_mb\":%.2f,\"working_set_delta_mb\":%.2f",
+          glb ? "true" : "false", vertex_count, heap_bytes * mb, private_bytes * mb, working_set * mb);
+   printf(",\"parse_ms\":%.3f,\"buffers_ms\":%.3f,\"convert_ms\":%.3f,\"total_ms\":%.3f}\n",
+          parse_seconds * ms, buffer_seconds * ms, convert_seconds * ms, (parse_seconds + buffer_seconds + convert_seconds) * ms);
+
+   return true;
+}
+
+// the same scene as gltf with external buffers and as glb read in place
+static bool bench_glb(arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   u32 iterations = argc > 2 ? (u32)atoi(argv[2]) : 5;
+   iterations = iterations > 0 ? iterations : 1;
+
+   bool result = bench_glb_file(s, argv[0], iterations);
+   if(argc > 1)
+      result = bench_glb_file(s, argv[1], iterations) && result;
+
+   return result;
+}
+
+// size and worst error of the 16 byte vertices against the float ones, and the vertex bytes the meshlets fetch
+static bool bench_quantize(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+
+   bench_meshes meshes = {0};
+   if(!bench_meshes_load(&meshes, a, file))
+      return false;
+
+   const meshlet_limits limits = {MESHLET_DEFAULT_MAX_VERTICES, MESHLET_DEFAULT_MAX_TRIANGLES};
+
+   vertex_quantize_error error = {0};
+   size meshlet_vertex_count = 0;
+   f64 quantize_seconds = 0.0;
+
+   for(size m = 0; m < meshes.count; ++m)
+   {
+      const bench_mesh* mesh = meshes.data + m;
+      if(mesh->vertex_count == 0 || mesh->index_count == 0)
+         continue;
+
+      arena mesh_scratch = s;
+      vertex_quantized* quantized = push(&mesh_scratch, vertex_quantized, mesh->vertex_count);
+
+      i64 begin = bench_counter();
+
+      const vertex_quantize_bounds bounds = vertex_quantize_bounds_compute(mesh->vertices, mesh->vertex_count);
+      vertex_quantize(quantized, mesh->vertices, mesh->vertex_count, bounds);
+
+      quantize_seconds += bench_seconds_elapsed(begin, bench_counter());
+
+      vertex_quantize_error_measure(&error, quantized, mesh->vertices, mesh->vertex_count, bounds);
+
+      // every meshlet reads its own vertices once
+      u8* meshlet_vertices = push(&mesh_scratch, u8, mesh->vertex_count);
+      pointer_clear_to(meshlet_vertices, 0xff, mesh->vertex_count);
+
+      array_meshlet meshlets = {&mesh_scratch};
+      meshlet_build(&meshlets, meshlet_vertices, mesh->indices, mesh->index_count, 0, limits);
+
+      for(size i = 0; i < meshlets.count; ++i)
+         meshlet_vertex_count += meshlets.data[i].vertex_count;
+   }
+
+   if(error.vertex_count == 0)
+   {
+      printf("Could not quantize mesh: %s has no triangles\n", file);
+      return false;
+   }
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"quantize\",\"file\":");
+   bench_json_string(file);
+   printf(",\"vertex_count\":%zu,\"float_stride\":%zu,\"quantized_stride\":%zu",
+          error.vertex_count, sizeof(vertex), sizeof(vertex_quantized));
+   printf(",\"float_mb\":%.3f,\"quantized_mb\":%.3f",
+          (f64)(error.vertex_count * sizeof(vertex)) * mb, (f64)(error.vertex_count * sizeof(vertex_quantized)) * mb);
+   printf(",\"meshlet_fetch_float_mb\":%.3f,\"meshlet_fetch_quantized_mb\":%.3f",
+          (f64)(meshlet_vertex_count * sizeof(vertex)) * mb, (f64)(meshlet_vertex_count * sizeof(vertex_quantized)) * mb);
+   printf(",\"position_max_error\":%.8f,\"position_max_relative\":%.8f,\"normal_max_degrees\":%.4f,\"uv_max_error\":%.8f",
+          error.position_max, error.position_max_relative, error.normal_max_degrees, error.uv_max);
+   printf(",\"quantize_ms\":%.3f}\n", quantize_seconds * 1000.0);
+
+   return true;
+}
+
+static u32 bench_random(u32* state)
+{
+   // xorshift32
+   u32 x = *state;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+
+   return *state = x;
+}
+
+static f32 bench_random_unit(u32* state)
+{
+   return (f32)(bench_random(state) >> 8) / (f32)(1u << 24);
+}
+
+// a node as the loader kept it before the scene graph, the world is found by walking the parents
+align_struct bench_scene_node
+{
+   u32 parent;
+   f32 translation[3];
+   f32 rotation[4];
+   f32 scale[3];
+} bench_scene_node;
+
+static mat4 bench_scene_node_local(const bench_scene_node* node)
+{
+   mat4 result;
+   quaternion_to_matrix(node->rotation, result.data);
+
+   for(u32 c = 0; c < 3; ++c)
+      for(u32 r = 0; r < 3; ++r)
+         result.data[c*4 + r] *= node->scale[c];
+
+   result.data[12] = node->translation[0];
+   result.data[13] = node->translation[1];
+   result.data[14] = node->translation[2];
+
+   return result;
+}
+
+// random forest of node_count nodes in shuffled order, so parents are not stored before their children
+static bench_scene_node* bench_scene_nodes_create(arena* a, arena s, u32 node_count, u32* state)
+{
+   u32* shuffle = push(&s, u32, node_count);
+   for(u32 i = 0; i < node_count; ++i)
+      shuffle[i] = i;
+
+   for(u32 i = node_count - 1; i > 0; --i)
+   {
+      const u32 j = bench_random(state) % (i + 1);
+      const u32 t = shuffle[i];
+      shuffle[i] = shuffle[j];
+      shuffle[j] = t;
+   }
+
+   bench_scene_node* nodes = push(a, bench_scene_node, node_count);
+
+   for(u32 i = 0; i < node_count; ++i)
+   {
+      bench_scene_node* node = nodes + shuffle[i];
+
+      // a parent drawn from the earlier nodes keeps it a forest, about one in 64 nodes is a root
+      const bool root = i == 0 || bench_random(state) % 64 == 0;
+      node->parent = root ? SCENE_GRAPH_ROOT : shuffle[bench_random(state) % i];
+
+      f32 q[4], l = 0.0f;
+      for(u32 k = 0; k < 4; ++k)
+      {
+         q[k] = bench_random_unit(state) * 2.0f - 1.0f;
+         l += q[k]*q[k];
+      }
+
+      l = l > 0.0f ? 1.0f / sqrtf(l) : 0.0f;
+      for(u32 k = 0; k < 4; ++k)
+         node->rotation[k] = l > 0.0f ? q[k] * l : (k == 3 ? 1.0f : 0.0f);
+
+      for(u32 k = 0; k < 3; ++k)
+      {
+         node->translation[k] = bench_random_unit(state) * 2.0f - 1.0f;
+         node->scale[k] = 0.9f + bench_random_unit(state) * 0.2f;
+      }
+   }
+
+   return nodes;
+}
+
+// flattened scene graph against the per node parent walk, and incremental updates of a few dirty nodes
+static bool bench_scene(arena* a, arena s, int argc, char** argv)
+{
+   u32 node_count = argc > 0 ? (u32)atoi(argv[0]) : 100000;
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 10;
+   f64 dirty_percent = argc > 2 ? atof(argv[2]) : 1.0;
+
+   node_count = node_count > 0 ? node_count : 1;
+   iterations = iterations > 0 ? iterations : 1;
+   dirty_percent = clamp(dirty_percent, 0.0, 100.0);
+
+   u32 state = 0x9e3779b9u;
+   bench_scene_node* nodes = bench_scene_nodes_create(a, s, node_count, &state);
+
+   u32* parents = push(a, u32, node_count);
+   for(u32 i = 0; i < node_count; ++i)
+      parents[i] = nodes[i].parent;
+
+   f64 build_seconds = DBL_MAX, walk_seconds = DBL_MAX, full_seconds = DBL_MAX, dirty_seconds = DBL_MAX;
+   u32 max_depth = 0;
+   usize dirty_updated = 0;
+   const u32 dirty_count = (u32)((f64)node_count * dirty_percent / 100.0);
+
+   mat4* walk_world = push(a, mat4, node_count);
+   scene_graph graph = {0};
+
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      // the old path, every node walks up to its root
+      i64 begin = bench_counter();
+
+      for(u32 i = 0; i < node_count; ++i)
+      {
+         mat4 world = bench_scene_node_local(nodes + i);
+         u32 depth = 0;
+
+         for(u32 p = nodes[i].parent; p != SCENE_GRAPH_ROOT; p = nodes[p].parent, ++depth)
+            world = mat4_mul(bench_scene_node_local(nodes + p), world);
+
+         walk_world[i] = world;
+         max_depth = max(max_depth, depth);
+      }
+
+      walk_seconds = min(walk_seconds, bench_seconds_elapsed(begin, bench_counter()));
+
+      arena run = s;
+      begin = bench_counter();
+
+      if(!scene_graph_build(&graph, &run, parents, node_count))
+         return false;
+
+      for(u32 i = 0; i < node_count; ++i)
+         scene_graph_local_set(&graph, graph.sorted[i], nodes[i].translation, nodes[i].rotation, nodes[i].scale);
+
+      build_seconds = min(build_seconds, bench_seconds_elapsed(begin, bench_counter()));
+
+      begin = bench_counter();
+      scene_graph_update(&graph);
+      full_seconds = min(full_seconds, bench_seconds_elapsed(begin, bench_counter()));
+
+      if(dirty_count == 0)
+         continue;
+
+      // move a few random nodes, their subtrees follow
+      for(u32 i = 0; i < dirty_count; ++i)
+      {
+         const u32 node = bench_random(&state) % node_count;
+         const f32 translation[3] = {graph.translation[0][node] + 0.01f, graph.translation[1][node], graph.translation[2][node]};
+         scene_graph_local_set(&graph, node, translation, 0, 0);
+      }
+
+      begin = bench_counter();
+      const u32 updated = scene_graph_update(&graph);
+      dirty_seconds = min(dirty_seconds, bench_seconds_elapsed(begin, bench_counter()));
+
+      dirty_updated += updated;
+
+      // put them back for the comparison below
+      for(u32 i = 0; i < node_count; ++i)
+         scene_graph_local_set(&graph, graph.sorted[i], nodes[i].translation, 0, 0);
+
+      scene_graph_update(&graph);
+   }
+
+   f64 max_error = 0.0;
+   for(u32 i = 0; i < node_count; ++i)
+      for(u32 k = 0; k < 16; ++k)
+         max_error = max(max_error, fabs((f64)graph.world[graph.sorted[i]].data[k] - walk_world[i].data[k]));
+
+   const f64 ms = 1000.0;
+
+   printf("{\"bench\":\"scene\",\"node_count\":%u,\"max_depth\":%u,\"walk_ms\":%.3f,\"build_ms\":%.3f,\"update_ms\":%.3f",
+          node_count, max_depth, walk_seconds * ms, build_seconds * ms, full_seconds * ms);
+
+   if(dirty_count > 0)
+      printf(",\"dirty_nodes\":%u,\"dirty_updated_nodes\":%.0f,\"dirty_update_ms\":%.3f",
+             dirty_count, (f64)dirty_updated / iterations, dirty_seconds * ms);
+
+   printf(",\"max_error\":%.8f}\n", max_error);
+
+   return true;
+}
+
+align_struct bench_text
+{
+   char* data;
+   size len;
+   size cap;
+} bench_text;
+
+static void bench_text_printf(bench_text* text, const char* format, ...)
+{
+   va_list args;
+   va_start(args, format);
+   int len = vsnprintf(text->data + text->len, text->cap - text->len, format, args);
+   va_end(args);
+
+   assert(len >= 0 && text->len + len < text->cap);
+   text->len += len;
+}
+
+// uv sphere with interleaved attributes kept apart - positions, normals, uvs then indices
+align_struct bench_instance_mesh
+{
+   f32* positions;
+   f32* normals;
+   f32* uvs;
+   u32* indices;
+   u32 vertex_count;
+   u32 index_count;
+} bench_instance_mesh;
+
+#define BENCH_INSTANCE_RADIUS 0.4f
+
+static bench_instance_mesh bench_instance_mesh_create(arena* a, u32 segments)
+{
+   const u32 rings = segments / 2;
+
+   bench_instance_mesh mesh = {0};
+   mesh.vertex_count = (rings + 1) * (segments + 1);
+   mesh.index_count = rings * segments * 6;
+   mesh.positions = push(a, f32, mesh.vertex_count * 3);
+   mesh.normals = push(a, f32, mesh.vertex_count * 3);
+   mesh.uvs = push(a, f32, mesh.vertex_count * 2);
+   mesh.indices = push(a, u32, mesh.index_count);
+
+   for(u32 r = 0; r <= rings; ++r)
+      for(u32 g = 0; g <= segments; ++g)
+      {
+         const u32 v = r*(segments + 1) + g;
+         const f32 theta = PI * r / rings;
+         const f32 phi = 2.0f * PI * g / segments;
+         const f32 n[3] = {sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)};
+
+         for(u32 k = 0; k < 3; ++k)
+         {
+            mesh.normals[v*3 + k] = n[k];
+            mesh.positions[v*3 + k] = n[k] * BENCH_INSTANCE_RADIUS;
+         }
+
+         mesh.uvs[v*2 + 0] = (f32)g / segments;
+         mesh.uvs[v*2 + 1] = (f32)r / rings;
+      }
+
+   u32 i = 0;
+   for(u32 r = 0; r < rings; ++r)
+      for(u32 g = 0; g < segments; ++g)
+      {
+         const u32 v = r*(segments + 1) + g;
+         mesh.indices[i++] = v;
+         mesh.indices[i++] = v + 1;
+         mesh.indices[i++] = v + segments + 1;
+         mesh.indices[i++] = v + 1;
+         mesh.indices[i++] = v + segments + 2;
+         mesh.indices[i++] = v + segments + 1;
+      }
+
+   return mesh;
+}
+
+// gltf and bin of the instanced scene, every node is a grid cell drawing one of the meshes
+static bool bench_instances_write(arena s, const char* gltf_path, const bench_instance_mesh* meshes, u32 mesh_count,
+                                  const u32* node_meshes, u32 node_count)
+{
+   const size gltf_len = strlen(gltf_path);
+   if(gltf_len < 5 || _stricmp(gltf_path + gltf_len - 5, ".gltf") != 0)
+   {
+      printf("Could not write the instanced scene: %s is not a .gltf path\n", gltf_path);
+      return false;
+   }
+
+   // the bin sits next to the gltf with the same name
+   char* bin_path = push(&s, char, gltf_len + 1);
+   memcpy(bin_path, gltf_path, gltf_len - 5);
+   memcpy(bin_path + gltf_len - 5, ".bin", 5);
+
+   const char* bin_name = bin_path;
+   for(const char* c = bin_path; *c; ++c)
+      if(*c == '/' || *c == '\\')
+         bin_name = c + 1;
+
+   size bin_size = 0;
+   for(u32 m = 0; m < mesh_count; ++m)
+      bin_size += meshes[m].vertex_count * 8*sizeof(f32) + meshes[m].index_count * sizeof(u32);
+
+   win32_file_view bin = {0};
+   if(!win32_file_map_write(&bin, bin_path, bin_size))
+   {
+      printf("Could not write the instanced scene: %s\n", bin_path);
+      return false;
+   }
+
+   bench_text text = {.cap = KB(4) + node_count*128 + mesh_count*KB(1)};
+   text.data = push(&s, char, text.cap);
+
+   const u32 grid = (u32)ceilf(sqrtf((f32)node_count));
+
+   bench_text_printf(&text, "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[");
+   for(u32 i = 0; i < node_count; ++i)
+      bench_text_printf(&text, i ? ",%u" : "%u", i);
+
+   bench_text_printf(&text, "]}],\"nodes\":[");
+   for(u32 i = 0; i < node_count; ++i)
+      bench_text_printf(&text, "%s{\"mesh\":%u,\"translation\":[%u,0,%u]}", i ? "," : "", node_meshes[i], i % grid, i / grid);
+
+   bench_text_printf(&text, "],\"meshes\":[");
+   for(u32 m = 0; m < mesh_count; ++m)
+      bench_text_printf(&text, "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%u,\"NORMAL\":%u,\"TEXCOORD_0\":%u},\"indices\":%u}]}",
+                        m ? "," : "", m*4, m*4 + 1, m*4 + 2, m*4 + 3);
+
+   bench_text_printf(&text, "],\"buffers\":[{\"uri\":\"%s\",\"byteLength\":%lld}],\"bufferViews\":[", bin_name, (long long)bin_size);
+
+   size offset = 0;
+   for(u32 m = 0; m < mesh_count; ++m)
+   {
+      const bench_instance_mesh* mesh = meshes + m;
+      const size view_sizes[4] =
+      {
+         mesh->vertex_count * 3*sizeof(f32), mesh->vertex_count * 3*sizeof(f32),
+         mesh->vertex_count * 2*sizeof(f32), mesh->index_count * sizeof(u32),
+      };
+      const void* view_data[4] = {mesh->positions, mesh->normals, mesh->uvs, mesh->indices};
+
+      for(u32 v = 0; v < 4; ++v)
+      {
+         memcpy((u8*)bin.data + offset, view_data[v], view_sizes[v]);
+         bench_text_printf(&text, "%s{\"buffer\":0,\"byteOffset\":%lld,\"byteLength\":%lld}", m || v ? "," : "",
+                           (long long)offset, (long long)view_sizes[v]);
+         offset += view_sizes[v];
+      }
+   }
+
+   win32_file_unmap(&bin);
+
+   bench_text_printf(&text, "],\"accessors\":[");
+   for(u32 m = 0; m < mesh_count; ++m)
+   {
+      const u32 view = m*4;
+      const u32 vertex_count = meshes[m].vertex_count;
+      const f32 r = BENCH_INSTANCE_RADIUS;
+
+      bench_text_printf(&text, "%s{\"bufferView\":%u,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\",\"min\":[%g,%g,%g],\"max\":[%g,%g,%g]}",
+                        m ? "," : "", view, vertex_count, -r, -r, -r, r, r, r);
+      bench_text_printf(&text, ",{\"bufferView\":%u,\"componentType\":5126,\"count\":%u,\"type\":\"VEC3\"}", view + 1, vertex_count);
+      bench_text_printf(&text, ",{\"bufferView\":%u,\"componentType\":5126,\"count\":%u,\"type\":\"VEC2\"}", view + 2, vertex_count);
+      bench_text_printf(&text, ",{\"bufferView\":%u,\"componentType\":5125,\"count\":%u,\"type\":\"SCALAR\"}", view + 3, meshes[m].index_count);
+   }
+
+   bench_text_printf(&text, "]}\n");
+
+   win32_file_view gltf = {0};
+   if(!win32_file_map_write(&gltf, gltf_path, text.len))
+   {
+      printf("Could not write the instanced scene: %s\n", gltf_path);
+      return false;
+   }
+
+   memcpy(gltf.data, text.data, text.len);
+   win32_file_unmap(&gltf);
+
+   return true;
+}
+
+// packs random node transforms like buffer_instances_create and decodes them like instance.glsl,
+// returns the largest difference to the matrix relative to its largest element
+static f64 bench_instance_transform_error(u32* state, u32 count)
+{
+   f64 result = 0;
+
+   for(u32 i = 0; i < count; ++i)
+   {
+      f32 q[4], s[3];
+      f32 ql = 0;
+      for(u32 k = 0; k < 4; ++k)
+      {
+         q[k] = bench_random_unit(state) * 2.0f - 1.0f;
+         ql += q[k]*q[k];
+      }
+      for(u32 k = 0; k < 4; ++k)
+         q[k] /= sqrtf(max(ql, 1e-12f));
+      for(u32 k = 0; k < 3; ++k)
+         s[k] = 0.1f + bench_random_unit(state) * 10.0f;
+
+      // mirrored every fourth node
+      if(i % 4 == 3)
+         s[0] = s[1] = s[2] = -s[0];
+
+      mat4 world;
+      quaternion_to_matrix(q, world.data);
+      for(u32 c = 0; c < 3; ++c)
+         for(u32 r = 0; r < 3; ++r)
+            world.data[c*4 + r] *= s[c];
+      for(u32 k = 0; k < 3; ++k)
+         world.data[12 + k] = (bench_random_unit(state) * 2.0f - 1.0f) * 100.0f;
+
+      struct mesh_instance packed;
+      f32 rotation[4];
+      transform_decompose(packed.position, rotation, packed.scale, world.data);
+      packed.rotation[0] = (u32)(u16)FP_snorm16(rotation[0]) | ((u32)(u16)FP_snorm16(rotation[1]) << 16);
+      packed.rotation[1] = (u32)(u16)FP_snorm16(rotation[2]) | ((u32)(u16)FP_snorm16(rotation[3]) << 16);
+
+      f32 decoded_q[4] =
+      {
+         FP_from_snorm16((i16)(packed.rotation[0] & 0xffff)), FP_from_snorm16((i16)(packed.rotation[0] >> 16)),
+         FP_from_snorm16((i16)(packed.rotation[1] & 0xffff)), FP_from_snorm16((i16)(packed.rotation[1] >> 16)),
+      };
+      const f32 dl = sqrtf(decoded_q[0]*decoded_q[0] + decoded_q[1]*decoded_q[1] + decoded_q[2]*decoded_q[2] + decoded_q[3]*decoded_q[3]);
+      for(u32 k = 0; k < 4; ++k)
+         decoded_q[k] /= dl;
+
+      mat4 decoded;
+      quaternion_to_matrix(decoded_q, decoded.data);
+      for(u32 c = 0; c < 3; ++c)
+         for(u32 r = 0; r < 3; ++r)
+            decoded.data[c*4 + r] *= packed.scale[c];
+      for(u32 k = 0; k < 3; ++k)
+         decoded.data[12 + k] = packed.position[k];
+
+      f64 largest = 0, error = 0;
+      for(u32 k = 0; k < 16; ++k)
+      {
+         largest = max(largest, fabs((f64)world.data[k]));
+         error = max(error, fabs((f64)world.data[k] - decoded.data[k]));
+      }
+
+      result = max(result, error / largest);
+   }
+
+   return result;
+}
+
+// draw commands and per draw bytes of one command per instance against one per mesh
+static bool bench_instances(arena* a, arena s, int argc, char** argv)
+{
+   u32 node_count = argc > 0 ? (u32)atoi(argv[0]) : 10000;
+   u32 mesh_count = argc > 1 ? (u32)atoi(argv[1]) : 4;
+   const char* gltf_path = argc > 2 ? argv[2] : 0;
+
+   node_count = node_count > 0 ? node_count : 1;
+   mesh_count = clamp(mesh_count, 1u, node_count);
+
+   bench_instance_mesh* meshes = push(a, bench_instance_mesh, mesh_count);
+   size* meshlet_counts = push(a, size, mesh_count);
+   const meshlet_limits limits = {MESHLET_DEFAULT_MAX_VERTICES, MESHLET_DEFAULT_MAX_TRIANGLES};
+
+   for(u32 m = 0; m < mesh_count; ++m)
+   {
+      meshes[m] = bench_instance_mesh_create(a, 8 + 8*m);
+
+      arena mesh_scratch = s;
+      u8* meshlet_vertices = push(&mesh_scratch, u8, meshes[m].vertex_count);
+      pointer_clear_to(meshlet_vertices, 0xff, meshes[m].vertex_count);
+
+      array_meshlet meshlets = {&mesh_scratch};
+      meshlet_build(&meshlets, meshlet_vertices, meshes[m].indices, meshes[m].index_count, 0, limits);
+      meshlet_counts[m] = meshlets.count;
+   }
+
+   // nodes pick their mesh at random so the batches have to sort them
+   u32 state = 0x2545f491u;
+   u32* node_meshes = push(a, u32, node_count);
+   for(u32 i = 0; i < node_count; ++i)
+      node_meshes[i] = bench_random(&state) % mesh_count;
+
+   if(gltf_path && !bench_instances_write(s, gltf_path, meshes, mesh_count, node_meshes, node_count))
+      return false;
+
+   u32* order = push(a, u32, node_count);
+   array_draw_batch batches = {0};
+   f64 batch_seconds = DBL_MAX;
+
+   for(u32 it = 0; it < 10; ++it)
+   {
+      // the batches grow in their own arena, the sort uses the scratch
+      arena batch_storage = *a;
+      batches = (array_draw_batch){&batch_storage};
+
+      i64 begin = bench_counter();
+      draw_batches_build(&batches, order, s, node_meshes, node_count, meshlet_counts, mesh_count);
+      batch_seconds = min(batch_seconds, bench_seconds_elapsed(begin, bench_counter()));
+   }
+
+   size work_groups = 0;
+   for(u32 i = 0; i < node_count; ++i)
+      work_groups += meshlet_counts[node_meshes[i]];
+
+   // without instancing every instance has its own command and draw
+   const size draw_bytes = sizeof(struct mesh_draw) + sizeof(struct mesh_instance);
+
+   // VkDrawIndexedIndirectCommand and VkDrawMeshTasksIndirectCommandEXT, the bench has no vulkan headers
+   const size indexed_command_bytes = 5*sizeof(u32);
+   const size mesh_tasks_command_bytes = 3*sizeof(u32);
+
+   printf("{\"bench\":\"instances\",\"instance_count\":%u,\"mesh_count\":%u,\"mesh_work_groups\":%zu",
+          node_count, mesh_count, work_groups);
+   printf(",\"draw_commands\":%u,\"batched_draw_commands\":%zu", node_count, batches.count);
+   printf(",\"indexed_indirect_bytes\":%zu,\"batched_indexed_indirect_bytes\":%zu",
+          node_count * indexed_command_bytes, batches.count * indexed_command_bytes);
+   printf(",\"mesh_tasks_indirect_bytes\":%zu,\"batched_mesh_tasks_indirect_bytes\":%zu",
+          node_count * mesh_tasks_command_bytes, batches.count * mesh_tasks_command_bytes);
+   printf(",\"draw_bytes\":%zu,\"batched_draw_bytes\":%zu",
+          node_count * draw_bytes, batches.count * sizeof(struct mesh_draw) + node_count * sizeof(struct mesh_instance));
+   printf(",\"draw_record_bytes\":%zu,\"inline_texture_draw_record_bytes\":%zu,\"instance_record_bytes\":%zu,\"matrix_instance_record_bytes\":%zu",
+          sizeof(struct mesh_draw), sizeof(struct mesh_draw) - sizeof(u32) + sizeof(struct material), sizeof(struct mesh_instance), sizeof(mat4));
+   printf(",\"transform_max_relative_error\":%.2e", bench_instance_transform_error(&state, node_count));
+   printf(",\"batch_ms\":%.3f}\n", batch_seconds * 1000.0);
+
+   return true;
+}
+
+// minimal EXT_meshopt_compression encoders, the bench needs streams for the decoders and has no
+// encoder library. they follow the format, not the compression level of the reference encoder
+
+static u8* bench_meshopt_bytes_encode(u8* data, const u8* values, usize count)
+{
+   const usize group_count = count / MESHOPT_GROUP_SIZE;
+   u8* header = data;
+   data += (group_count + 3) / 4;
+   memset(header, 0, (group_count + 3) / 4);
+
+   for(usize g = 0; g < group_count; ++g)
+   {
+      const u8* group = values + g*MESHOPT_GROUP_SIZE;
+
+      // the smallest of 0, 2, 4 and 8 bits with the values that do not fit as extra bytes
+      u32 best = 3;
+      usize best_size = MESHOPT_GROUP_SIZE;
+      for(u32 bitslog2 = 0; bitslog2 < 3; ++bitslog2)
+      {
+         const u32 bits = bitslog2 ? 1u << bitslog2 : 0;
+         const u32 sentinel = bits ? (1u << bits) - 1 : 0;
+
+         usize group_size = MESHOPT_GROUP_SIZE * bits / 8;
+         for(u32 i = 0; i < MESHOPT_GROUP_SIZE; ++i)
+            group_size += bits ? group[i] >= sentinel : group[i] != 0 ? MESHOPT_GROUP_SIZE : 0;
+
+         if(group_size < best_size)
+         {
+            best = bitslog2;
+            best_size = group_size;
+         }
+      }
+
+      header[g / 4] |= (u8)(best << ((g % 4) * 2));
+
+      if(best == 3)
+      {
+         memcpy(data, group, MESHOPT_GROUP_SIZE);
+         data += MESHOPT_GROUP_SIZE;
+      }
+      else if(best > 0)
+      {
+         const u32 bits = 1u << best;
+         const u32 sentinel = (1u << bits) - 1;
+
+         for(u32 i = 0; i < MESHOPT_GROUP_SIZE; i += 8 / bits)
+         {
+            u8 packed = 0;
+            for(u32 k = 0; k < 8 / bits; ++k)
+               packed = (u8)((packed << bits) | min((u32)group[i + k], sentinel));
+            *data++ = packed;
+         }
+
+         for(u32 i = 0; i < MESHOPT_GROUP_SIZE; ++i)
+            if(group[i] >= sentinel)
+               *data++ = group[i];
+      }
+   }
+
+   return data;
+}
+
+static usize bench_meshopt_vertices_bound(usize count, usize vertex_size)
+{
+   const usize block_size = meshopt_vertex_block_size(vertex_size);
+   const usize block_count = (count + block_size - 1) / block_size;
+
+   return 1 + block_count*vertex_size*((block_size/MESHOPT_GROUP_SIZE + 3)/4 + block_size) + max(vertex_size, (usize)MESHOPT_TAIL_MIN);
+}
+
+static usize bench_meshopt_vertices_encode(u8* out, const void* vertices, usize count, usize vertex_size)
+{
+   const u8* in = vertices;
+   const usize block_size = meshopt_vertex_block_size(vertex_size);
+
+   u8* data = out;
+   *data++ = MESHOPT_VERTEX_HEADER;
+
+   u8 last_vertex[256] = {0};
+   if(count > 0)
+      memcpy(last_vertex, in, vertex_size);
+
+   u8 column[MESHOPT_VERTEX_BLOCK_MAX];
+   for(usize offset = 0; offset < count; offset += block_size)
+   {
+      const usize block_count = min(count - offset, block_size);
+      const usize count_aligned = (block_count + MESHOPT_GROUP_SIZE - 1) & ~(usize)(MESHOPT_GROUP_SIZE - 1);
+
+      for(usize k = 0; k < vertex_size; ++k)
+      {
+         memset(column, 0, sizeof(column));
+
+         u8 p = last_vertex[k];
+         for(usize i = 0; i < block_count; ++i)
+         {
+            const u8 delta = (u8)(in[(offset + i)*vertex_size + k] - p);
+            column[i] = (u8)((delta << 1) ^ (u8)((i8)delta >> 7));
+            p = in[(offset + i)*vertex_size + k];
+         }
+
+         data = bench_meshopt_bytes_encode(data, column, count_aligned);
+      }
+
+      memcpy(last_vertex, in + (offset + block_count - 1)*vertex_size, vertex_size);
+   }
+
+   // the first vertex is the base of the first block
+   const usize tail_size = max(vertex_size, (usize)MESHOPT_TAIL_MIN);
+   memset(data, 0, tail_size - vertex_size);
+   data += tail_size - vertex_size;
+   if(count > 0)
+      memcpy(data, in, vertex_size);
+   data += vertex_size;
+
+   return (usize)(data - out);
+}
+
+static u8* bench_meshopt_vbyte_encode(u8* data, u32 v)
+{
+   do
+   {
+      *data++ = (u8)((v & 127) | (v > 127 ? 128 : 0));
+      v >>= 7;
+   } while(v);
+
+   return data;
+}
+
+static u8* bench_meshopt_index_encode(u8* data, u32 index, u32 last)
+{
+   const u32 d = index - last;
+
+   return bench_meshopt_vbyte_encode(data, (d << 1) ^ (u32)((i32)d >> 31));
+}
+
+static i32 bench_meshopt_vertex_find(const meshopt_index_fifos* fifos, u32 v)
+{
+   for(u32 i = 0; i < 16; ++i)
+      if(fifos->vertices[(fifos->vertex_offset - 1 - i) & 15] == v)
+         return (i32)i;
+
+   return -1;
+}
+
+// the same codes the decoder reads, version 1
+static usize bench_meshopt_indices_encode(u8* out, const u32* indices, usize index_count)
+{
+   // the codes of the second kind the table path can express, without reset and free indices
+   static const u8 code_table[16] = {0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00};
+   static const u32 rotations[3][3] = {{0, 1, 2}, {1, 2, 0}, {2, 0, 1}};
+
+   meshopt_index_fifos fifos = {0};
+   memset(fifos.edges, 0xff, sizeof(fifos.edges));
+   memset(fifos.vertices, 0xff, sizeof(fifos.vertices));
+
+   u32 next = 0, last = 0;
+
+   out[0] = MESHOPT_INDEX_HEADER | 1;
+   u8* code = out + 1;
+   u8* data = code + index_count/3;
+
+   for(usize i = 0; i < index_count; i += 3)
+   {
+      const u32* tri = indices + i;
+
+      // an edge of the last 16 in the winding of the triangle, the triangle is rotated to start with it
+      i32 edge = -1, rotation = 0;
+      for(u32 e = 0; e < 16 && edge < 0; ++e)
+      {
+         const u32* fifo_edge = fifos.edges[(fifos.edge_offset - 1 - e) & 15];
+
+         for(u32 r = 0; r < 3 && edge < 0; ++r)
+         {
+            if(fifo_edge[0] == tri[rotations[r][0]] && fifo_edge[1] == tri[rotations[r][1]])
+            {
+               edge = (i32)e;
+               rotation = (i32)r;
+            }
+         }
+      }
+
+      if(edge >= 0 && edge < 15)
+      {
+         const u32 a = tri[rotations[rotation][0]], b = tri[rotations[rotation][1]], c = tri[rotations[rotation][2]];
+
+         const i32 fc = bench_meshopt_vertex_find(&fifos, c);
+         u32 fec = fc >= 1 && fc < 13 ? (u32)fc : c == next ? (next++, 0) : 15;
+
+         if(fec == 15 && c + 1 == last)
+            fec = 13, last = c;
+         else if(fec == 15 && c == last + 1)
+            fec = 14, last = c;
+
+         *code++ = (u8)((edge << 4) | fec);
+
+         if(fec == 15)
+         {
+            data = bench_meshopt_index_encode(data, c, last);
+            last = c;
+         }
+
+         meshopt_vertex_push(&fifos, c, fec == 0 || fec >= 13);
+         meshopt_edge_push(&fifos, c, b);
+         meshopt_edge_push(&fifos, a, c);
+         continue;
+      }
+
+      // the vertex that is next goes first
+      rotation = tri[1] == next ? 1 : tri[2] == next ? 2 : 0;
+      const u32 a = tri[rotations[rotation][0]], b = tri[rotations[rotation][1]], c = tri[rotations[rotation][2]];
+
+      const bool reset = a == 0 && b == 1 && c == 2 && next > 0;
+      if(reset)
+      {
+         next = 0;
+         memset(fifos.vertices, 0xff, sizeof(fifos.vertices));
+      }
+
+      const i32 fb = bench_meshopt_vertex_find(&fifos, b);
+      const i32 fc = bench_meshopt_vertex_find(&fifos, c);
+
+      const u32 fea = a == next ? (next++, 0) : 15;
+      const u32 feb = fb >= 0 && fb < 14 ? (u32)fb + 1 : b == next ? (next++, 0) : 15;
+      const u32 fec = fc >= 0 && fc < 14 ? (u32)fc + 1 : c == next ? (next++, 0) : 15;
+
+      const u8 codeaux = (u8)((feb << 4) | fec);
+      i32 table_index = -1;
+      for(i32 k = 0; k < 14 && table_index < 0; ++k)
+         if(code_table[k] == codeaux)
+            table_index = k;
+
+      if(fea == 0 && table_index >= 0 && !reset)
+         *code++ = (u8)(0xf0 | table_index);
+      else
+      {
+         *code++ = (u8)(0xf0 | 14 | fea);
+         *data++ = codeaux;
+      }
+
+      if(fea == 15)
+         data = bench_meshopt_index_encode(data, a, last), last = a;
+      if(feb == 15)
+         data = bench_meshopt_index_encode(data, b, last), last = b;
+      if(fec == 15)
+         data = bench_meshopt_index_encode(data, c, last), last = c;
+
+      meshopt_vertex_push(&fifos, a, true);
+      meshopt_vertex_push(&fifos, b, feb == 0 || feb == 15);
+      meshopt_vertex_push(&fifos, c, fec == 0 || fec == 15);
+
+      meshopt_edge_push(&fifos, b, a);
+      meshopt_edge_push(&fifos, c, b);
+      meshopt_edge_push(&fifos, a, c);
+   }
+
+   // the table doubles as the padding of the decoder
+   memcpy(data, code_table, sizeof(code_table));
+   data += sizeof(code_table);
+
+   return (usize)(data - out);
+}
+
+static usize bench_meshopt_index_sequence_encode(u8* out, const u32* indices, usize index_count)
+{
+   u32 last[2] = {0};
+   u32 baseline = 0;
+
+   u8* data = out;
+   *data++ = MESHOPT_SEQUENCE_HEADER | 1;
+
+   for(usize i = 0; i < index_count; ++i)
+   {
+      // a delta that does not fit a byte switches to the other baseline
+      const i32 cd = (i32)(indices[i] - last[baseline]);
+      baseline ^= (cd < 0 ? -cd : cd) >= 30;
+
+      const u32 d = indices[i] - last[baseline];
+      const u32 v = (d << 1) ^ (u32)((i32)d >> 31);
+
+      data = bench_meshopt_vbyte_encode(data, (v << 1) | baseline);
+      last[baseline] = indices[i];
+   }
+
+   memset(data, 0, 4);
+
+   return (usize)(data + 4 - out);
+}
+
+// i8 or i16 octahedral xy with the length in z, the input of the octahedral filter
+static void bench_meshopt_normals_encode(void* out, const bench_mesh* mesh, usize stride)
+{
+   const f32 one = stride == 4 ? 127.0f : 32767.0f;
+
+   for(size i = 0; i < mesh->vertex_count; ++i)
+   {
+      f32 n[3], e[2];
+      vertex_quantize_normal_unpack(n, mesh->vertices + i);
+      FP_octahedral_encode(e, n);
+
+      const i32 v[4] = {meshopt_round(e[0]*one), meshopt_round(e[1]*one), (i32)one, 0};
+      for(u32 k = 0; k < 4; ++k)
+      {
+         if(stride == 4)
+            ((i8*)out)[i*4 + k] = (i8)v[k];
+         else
+            ((i16*)out)[i*4 + k] = (i16)v[k];
+      }
+   }
+}
+
+// 24 bit mantissa and the exponent of every position component, the input of the exponential filter
+static void bench_meshopt_positions_encode(u32* out, const bench_mesh* mesh)
+{
+   for(size i = 0; i < mesh->vertex_count; ++i)
+   {
+      const f32 p[3] = {mesh->vertices[i].vx, mesh->vertices[i].vy, mesh->vertices[i].vz};
+
+      for(u32 k = 0; k < 3; ++k)
+      {
+         i32 e = 0;
+         const f32 m = frexpf(p[k], &e);
+         const i32 mantissa = p[k] == 0.0f ? 0 : meshopt_round(m * (f32)(1 << 22));
+         const i32 exponent = p[k] == 0.0f ? 0 : e - 22;
+
+         out[i*3 + k] = ((u32)exponent << 24) | ((u32)mantissa & 0xffffff);
+      }
+   }
+}
+
+// the triangle codec keeps the winding but may start a triangle at another corner
+static bool bench_triangles_equal(const u32* a, const u32* b, usize index_count)
+{
+   for(usize i = 0; i < index_count; i += 3)
+   {
+      bool equal = false;
+      for(u32 r = 0; r < 3; ++r)
+         equal |= a[i] == b[i + r] && a[i + 1] == b[i + (r + 1) % 3] && a[i + 2] == b[i + (r + 2) % 3];
+
+      if(!equal)
+         return false;
+   }
+
+   return true;
+}
+
+align_struct bench_meshopt_stream
+{
+   u8* vertices;
+   u8* indices;
+   u8* sequence;
+   usize vertex_bytes;
+   usize index_bytes;
+   usize sequence_bytes;
+} bench_meshopt_stream;
+
+// vertex, triangle and sequence codecs and the filters, every decode is checked against the source
+static bool bench_meshopt(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 10;
+   iterations = iterations > 0 ? iterations : 1;
+
+   bench_meshes meshes = {0};
+   if(!bench_meshes_load(&meshes, a, file))
+      return false;
+
+   bench_meshopt_stream* streams = push(a, bench_meshopt_stream, meshes.count);
+   usize vertex_count = 0, index_count = 0, vertex_bytes = 0, index_bytes = 0, sequence_bytes = 0;
+
+   i64 begin = bench_counter();
+
+   for(size m = 0; m < meshes.count; ++m)
+   {
+      const bench_mesh* mesh = meshes.data + m;
+      bench_meshopt_stream* stream = streams + m;
+
+      stream->vertices = push(a, u8, bench_meshopt_vertices_bound(mesh->vertex_count, sizeof(vertex)));
+      stream->indices = push(a, u8, 1 + mesh->index_count/3*17 + 16);
+      stream->sequence = push(a, u8, 1 + mesh->index_count*5 + 4);
+
+      stream->vertex_bytes = bench_meshopt_vertices_encode(stream->vertices, mesh->vertices, mesh->vertex_count, sizeof(vertex));
+      stream->index_bytes = bench_meshopt_indices_encode(stream->indices, mesh->indices, mesh->index_count);
+      stream->sequence_bytes = bench_meshopt_index_sequence_encode(stream->sequence, mesh->indices, mesh->index_count);
+
+      vertex_count += mesh->vertex_count;
+      index_count += mesh->index_count;
+      vertex_bytes += stream->vertex_bytes;
+      index_bytes += stream->index_bytes;
+      sequence_bytes += stream->sequence_bytes;
+   }
+
+   const f64 encode_seconds = bench_seconds_elapsed(begin, bench_counter());
+
+   f64 scalar_seconds = DBL_MAX, simd_seconds = DBL_MAX, index_seconds = DBL_MAX, sequence_seconds = DBL_MAX;
+   f64 octahedral_scalar_seconds = DBL_MAX, octahedral_seconds = DBL_MAX, exponential_scalar_seconds = DBL_MAX, exponential_seconds = DBL_MAX;
+   usize mismatches = 0;
+
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      f64 seconds[8] = {0};
+
+      for(size m = 0; m < meshes.count; ++m)
+      {
+         const bench_mesh* mesh = meshes.data + m;
+         const bench_meshopt_stream* stream = streams + m;
+         const usize vertex_size = sizeof(vertex);
+         const usize count = mesh->vertex_count;
+
+         arena mesh_scratch = s;
+         vertex* scalar = push(&mesh_scratch, vertex, count + 1);
+         vertex* simd = push(&mesh_scratch, vertex, count + 1);
+         u32* indices = push(&mesh_scratch, u32, mesh->index_count + 1);
+         u32* sequence = push(&mesh_scratch, u32, mesh->index_count + 1);
+
+         begin = bench_counter();
+         bool decoded = meshopt_vertices_decode_with(scalar, count, vertex_size, stream->vertices, stream->vertex_bytes, false);
+         seconds[0] += bench_seconds_elapsed(begin, bench_counter());
+
+         begin = bench_counter();
+         decoded = meshopt_vertices_decode_with(simd, count, vertex_size, stream->vertices, stream->vertex_bytes, true) && decoded;
+         seconds[1] += bench_seconds_elapsed(begin, bench_counter());
+
+         begin = bench_counter();
+         decoded = meshopt_indices_decode(indices, mesh->index_count, sizeof(u32), stream->indices, stream->index_bytes) && decoded;
+         seconds[2] += bench_seconds_elapsed(begin, bench_counter());
+
+         begin = bench_counter();
+         decoded = meshopt_index_sequence_decode(sequence, mesh->index_count, sizeof(u32), stream->sequence, stream->sequence_bytes) && decoded;
+         seconds[3] += bench_seconds_elapsed(begin, bench_counter());
+
+         mismatches += !decoded || memcmp(scalar, mesh->vertices, count*vertex_size) != 0 || memcmp(simd, mesh->vertices, count*vertex_size) != 0 ||
+                       !bench_triangles_equal(mesh->indices, indices, mesh->index_count) ||
+                       memcmp(sequence, mesh->indices, mesh->index_count*sizeof(u32)) != 0;
+
+         // the filters run in place, both paths get the same input and have to agree to the bit
+         i16* normals_scalar = push(&mesh_scratch, i16, count*4 + 1);
+         i16* normals = push(&mesh_scratch, i16, count*4 + 1);
+         u32* positions_scalar = push(&mesh_scratch, u32, count*3 + 1);
+         u32* positions = push(&mesh_scratch, u32, count*3 + 1);
+
+         bench_meshopt_normals_encode(normals_scalar, mesh, 8);
+         memcpy(normals, normals_scalar, count*8);
+         bench_meshopt_positions_encode(positions_scalar, mesh);
+         memcpy(positions, positions_scalar, count*12);
+
+         begin = bench_counter();
+         meshopt_filter_octahedral_scalar(normals_scalar, count, 8);
+         seconds[4] += bench_seconds_elapsed(begin, bench_counter());
+
+         begin = bench_counter();
+         meshopt_filter_octahedral(normals, count, 8);
+         seconds[5] += bench_seconds_elapsed(begin, bench_counter());
+
+         begin = bench_counter();
+         meshopt_filter_exponential_scalar(positions_scalar, count*3);
+         seconds[6] += bench_seconds_elapsed(begin, bench_counter());
+
+         begin = bench_counter();
+         meshopt_filter_exponential(positions, count*3);
+         seconds[7] += bench_seconds_elapsed(begin, bench_counter());
+
+         mismatches += memcmp(normals_scalar, normals, count*8) != 0 || memcmp(positions_scalar, positions, count*12) != 0;
+
+         // i8 octahedral has its own lane layout
+         i8* normals8_scalar = push(&mesh_scratch, i8, count*4 + 1);
+         i8* normals8 = push(&mesh_scratch, i8, count*4 + 1);
+         bench_meshopt_normals_encode(normals8_scalar, mesh, 4);
+         memcpy(normals8, normals8_scalar, count*4);
+
+         meshopt_filter_octahedral_scalar(normals8_scalar, count, 4);
+         meshopt_filter_octahedral(normals8, count, 4);
+         mismatches += memcmp(normals8_scalar, normals8, count*4) != 0;
+      }
+
+      scalar_seconds = min(scalar_seconds, seconds[0]);
+      simd_seconds = min(simd_seconds, seconds[1]);
+      index_seconds = min(index_seconds, seconds[2]);
+      sequence_seconds = min(sequence_seconds, seconds[3]);
+      octahedral_scalar_seconds = min(octahedral_scalar_seconds, seconds[4]);
+      octahedral_seconds = min(octahedral_seconds, seconds[5]);
+      exponential_scalar_seconds = min(exponential_scalar_seconds, seconds[6]);
+      exponential_seconds = min(exponential_seconds, seconds[7]);
+   }
+
+   if(mismatches > 0)
+   {
+      printf("Could not decode meshopt streams: %zu of %zu decodes differ from the source\n", mismatches, (usize)(meshes.count*iterations));
+      return false;
+   }
+
+   const f64 mb = 1.0 / (MB(1));
+   const f64 vertex_mb = (f64)(vertex_count*sizeof(vertex)) * mb;
+   const f64 index_mb = (f64)(index_count*sizeof(u32)) * mb;
+
+   printf("{\"bench\":\"meshopt\",\"file\":");
+   bench_json_string(file);
+   printf(",\"vertices\":%zu,\"indices\":%zu,\"vertex_mb\":%.3f,\"index_mb\":%.3f", vertex_count, index_count, vertex_mb, index_mb);
+   printf(",\"vertex_ratio\":%.3f,\"index_ratio\":%.3f,\"sequence_ratio\":%.3f",
+          (f64)vertex_bytes / (f64)(vertex_count*sizeof(vertex)), (f64)index_bytes / (f64)(index_count*sizeof(u32)),
+          (f64)sequence_bytes / (f64)(index_count*sizeof(u32)));
+   printf(",\"encode_ms\":%.3f", encode_seconds * 1000.0);
+   printf(",\"vertex_scalar_mb_s\":%.0f,\"vertex_simd_mb_s\":%.0f", vertex_mb / scalar_seconds, vertex_mb / simd_seconds);
+   printf(",\"index_mb_s\":%.0f,\"sequence_mb_s\":%.0f", index_mb / index_seconds, index_mb / sequence_seconds);
+   printf(",\"octahedral_scalar_mb_s\":%.0f,\"octahedral_simd_mb_s\":%.0f",
+          (f64)(vertex_count*8) * mb / octahedral_scalar_seconds, (f64)(vertex_count*8) * mb / octahedral_seconds);
+   printf(",\"exponential_scalar_mb_s\":%.0f,\"exponential_simd_mb_s\":%.0f}\n",
+          (f64)(vertex_count*12) * mb / exponential_scalar_seconds, (f64)(vertex_count*12) * mb / exponential_seconds);
+
+   return true;
+}
+
+// largest per channel difference of two chains
+static u32 bench_mips_difference(const u8* a, const u8* b, size count)
+{
+   u32 result = 0;
+   for(size i = 0; i < count; ++i)
+      result = max(result, (u32)abs((i32)a[i] - (i32)b[i]));
+
+   return result;
+}
+
+// mean absolute difference of the alpha test coverage of every level to the base level
+static f64 bench_mips_coverage_error(const u8* pixels, const texture_mip_chain* chain)
+{
+   const texture_mip_level* base = chain->levels;
+   const f64 coverage = (f64)texture_mip_coverage(pixels, (size)base->width * base->height) / ((size)base->width * base->height);
+
+   f64 result = 0;
+   for(u32 i = 1; i < chain->level_count; ++i)
+   {
+      const texture_mip_level* level = chain->levels + i;
+      const size texels = (size)level->width * level->height;
+      result += fabs((f64)texture_mip_coverage(pixels + level->offset, texels) / texels - coverage);
+   }
+
+   return chain->level_count > 1 ? result / (chain->level_count - 1) : 0;
+}
+
+// mip chain generation of one image with every filter, in MPixel/s of the base level
+static bool bench_mips(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const char* file = argv[0];
+   u32 iterations = argc > 1 ? (u32)atoi(argv[1]) : 10;
+   iterations = iterations > 0 ? iterations : 1;
+
+   i32 width = 0, height = 0, channels = 0;
+   u8* image = stbi_load(file, &width, &height, &channels, STBI_rgb_alpha);
+   if(!image)
+   {
+      printf("Could not load image: %s\n", file);
+      return false;
+   }
+
+   const texture_mip_chain chain = texture_mip_chain_layout((u32)width, (u32)height);
+   const size base_bytes = (size)width * height * 4;
+
+   // box and kaiser, each scalar and sse, as srgb color with alpha test
+   const texture_mip_filter filters[4] = {texture_mip_box, texture_mip_box, texture_mip_kaiser, texture_mip_kaiser};
+   const u32 flags[4] = {texture_mip_scalar, 0, texture_mip_scalar, 0};
+   const u32 color = texture_mip_srgb | texture_mip_alpha_test;
+
+   u8* chains[4];
+   f64 seconds[4] = {DBL_MAX, DBL_MAX, DBL_MAX, DBL_MAX};
+
+   for(u32 k = 0; k < 4; ++k)
+   {
+      chains[k] = push(a, u8, chain.size);
+      memcpy(chains[k], image, base_bytes);
+
+      for(u32 it = 0; it < iterations; ++it)
+      {
+         i64 begin = bench_counter();
+         texture_mips_generate(chains[k], &chain, filters[k], flags[k] | color, s);
+         seconds[k] = min(seconds[k], bench_seconds_elapsed(begin, bench_counter()));
+      }
+   }
+
+   // the linear path and the coverage left without the alpha test
+   u8* linear = push(a, u8, chain.size);
+   u8* uncorrected = push(a, u8, chain.size);
+   memcpy(linear, image, base_bytes);
+   memcpy(uncorrected, image, base_bytes);
+
+   f64 linear_seconds = DBL_MAX;
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      i64 begin = bench_counter();
+      texture_mips_generate(linear, &chain, texture_mip_kaiser, 0, s);
+      linear_seconds = min(linear_seconds, bench_seconds_elapsed(begin, bench_counter()));
+   }
+
+   texture_mips_generate(uncorrected, &chain, texture_mip_kaiser, texture_mip_srgb, s);
+
+   stbi_image_free(image);
+
+   const f64 mpixels = (f64)width * height * 1e-6;
+
+   printf("{\"bench\":\"mips\",\"file\":");
+   bench_json_string(file);
+   printf(",\"width\":%d,\"height\":%d,\"levels\":%u,\"chain_bytes\":%zu,\"base_bytes\":%zu", width, height, chain.level_count, chain.size, base_bytes);
+   printf(",\"box_scalar_mpixel_s\":%.1f,\"box_simd_mpixel_s\":%.1f", mpixels / seconds[0], mpixels / seconds[1]);
+   printf(",\"kaiser_scalar_mpixel_s\":%.1f,\"kaiser_simd_mpixel_s\":%.1f,\"kaiser_linear_simd_mpixel_s\":%.1f",
+          mpixels / seconds[2], mpixels / seconds[3], mpixels / linear_seconds);
+   printf(",\"box_simd_max_difference\":%u,\"kaiser_simd_max_difference\":%u",
+          bench_mips_difference(chains[0], chains[1], chain.size), bench_mips_difference(chains[2], chains[3], chain.size));
+   printf(",\"coverage_error\":%.4f,\"uncorrected_coverage_error\":%.4f}\n",
+          bench_mips_coverage_error(chains[3], &chain), bench_mips_coverage_error(uncorrected, &chain));
+
+   return true;
+}
+
+// reference decoders of one block to 16 rgba texels, bc1 in the mode its endpoint order selects
+static void bench_bc1_decode(u8 out[64], const u8 block[8])
+{
+   const u16 c0 = (u16)(block[0] | (block[1] << 8)), c1 = (u16)(block[2] | (block[3] << 8));
+
+   f32 palette[4][4];
+   texture_bc_565_expand(palette[0], c0);
+   texture_bc_565_expand(palette[1], c1);
+   palette[0][3] = palette[1][3] = 255.0f;
+
+   for(u32 k = 0; k < 3; ++k)
+   {
+      palette[2][k] = c0 > c1 ? (2.0f*palette[0][k] + palette[1][k]) / 3.0f : (palette[0][k] + palette[1][k]) / 2.0f;
+      palette[3][k] = c0 > c1 ? (palette[0][k] + 2.0f*palette[1][k]) / 3.0f : 0.0f;
+   }
+   palette[2][3] = 255.0f;
+   palette[3][3] = c0 > c1 ? 255.0f : 0.0f;
+
+   u32 bits;
+   memcpy(&bits, block + 4, sizeof(bits));
+
+   for(u32 i = 0; i < 16; ++i)
+      for(u32 k = 0; k < 4; ++k)
+         out[4*i + k] = (u8)(palette[(bits >> (2*i)) & 3][k] + 0.5f);
+}
+
+static void bench_bc4_decode(u8 out[64], const u8 block[8], u32 channel)
+{
+   const f32 e0 = block[0], e1 = block[1];
+
+   f32 palette[8] = {e0, e1};
+   for(u32 k = 2; k < 8; ++k)
+      palette[k] = e0 > e1 ? ((8 - k)*e0 + (k - 1)*e1) / 7.0f : k < 6 ? ((6 - k)*e0 + (k - 1)*e1) / 5.0f : k == 6 ? 0.0f : 255.0f;
+
+   u64 bits = 0;
+   for(u32 i = 0; i < 6; ++i)
+      bits |= (u64)block[2 + i] << (8*i);
+
+   for(u32 i = 0; i < 16; ++i)
+      out[4*i + channel] = (u8)(palette[(bits >> (3*i)) & 7] + 0.5f);
+}
+
+// psnr of the decoded base level against the texels over the channels the format keeps
+static f64 bench_bc_psnr(const u8* blocks, const u8* pixels, u32 width, u32 height, texture_bc_encoding encoding)
+{
+   const u32 block_size = texture_bc_block_size(encoding.format);
+   const u32 blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+
+   u32 first = 0, last = 3;
+   if(encoding.format == texture_bc3)
+      last = 4;
+   else if(encoding.format == texture_bc4)
+      first = encoding.channel, last = encoding.channel + 1;
+   else if(encoding.format == texture_bc5)
+      first = encoding.channel, last = encoding.channel + 2;
+
+   f64 error = 0;
+   for(u32 by = 0; by < blocks_y; ++by)
+      for(u32 bx = 0; bx < blocks_x; ++bx)
+      {
+         const u8* block = blocks + ((size)by*blocks_x + bx)*block_size;
+
+         u8 decoded[64] = {0};
+         if(encoding.format == texture_bc1)
+            bench_bc1_decode(decoded, block);
+         else if(encoding.format == texture_bc3)
+         {
+            bench_bc4_decode(decoded, block, 3);
+            u8 color[64];
+            bench_bc1_decode(color, block + 8);
+            for(u32 i = 0; i < 16; ++i)
+               memcpy(decoded + 4*i, color + 4*i, 3);
+         }
+         else
+         {
+            bench_bc4_decode(decoded, block, encoding.channel);
+            if(encoding.format == texture_bc5)
+               bench_bc4_decode(decoded, block + 8, encoding.channel + 1);
+         }
+
+         for(u32 y = 0; y < 4 && 4*by + y < height; ++y)
+            for(u32 x = 0; x < 4 && 4*bx + x < width; ++x)
+               for(u32 k = first; k < last; ++k)
+               {
+                  const f64 d = (f64)decoded[4*(4*y + x) + k] - pixels[4*((size)(4*by + y)*width + 4*bx + x) + k];
+                  error += d*d;
+               }
+      }
+
+   const f64 mse = error / ((f64)width * height * (last - first));
+
+   return mse > 0 ? 10.0 * log10(255.0*255.0 / mse) : 99.0;
+}
+
+// block compression of the mip chains of a set of images - every image as a color, as bc4 of red and bc5
+// of red and green, in MPixel/s of the chain on one thread. the color textures then go through the
+// loader jobs at every thread count like the load bench
+static bool bench_bc(arena* a, arena s, hw_jobs* jobs, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const u32 image_count = (u32)argc;
+   const u32 iterations = 3;
+
+   size rgba_bytes = 0, color_bytes = 0, bc4_bytes = 0, bc5_bytes = 0;
+   f64 color_psnr = 0, bc4_psnr = 0, bc5_psnr = 0;
+   f64 color_seconds = 0, bc4_seconds = 0, bc5_seconds = 0;
+   f64 chain_mpixels = 0;
+   u32 bc1_count = 0, loaded = 0;
+
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      const char* file = argv[i];
+
+      i32 width = 0, height = 0, channels = 0;
+      u8* image = stbi_load(file, &width, &height, &channels, STBI_rgb_alpha);
+      if(!image)
+      {
+         printf("Could not load image: %s\n", file);
+         continue;
+      }
+
+      // every image starts over in the scratch
+      arena t = s;
+
+      const texture_mip_chain layout = texture_mip_chain_layout((u32)width, (u32)height);
+      u8* rgba = push(&t, u8, layout.size);
+      memcpy(rgba, image, (size)width * height * 4);
+      stbi_image_free(image);
+
+      texture_mips_generate(rgba, &layout, texture_mip_kaiser, texture_mip_srgb | texture_mip_alpha_test, t);
+
+      const bool opaque = texture_bc_opaque(rgba, (size)width * height);
+      const texture_bc_encoding encodings[3] = {{opaque ? texture_bc1 : texture_bc3}, {texture_bc4, 0}, {texture_bc5, 0}};
+
+      f64 seconds[3] = {DBL_MAX, DBL_MAX, DBL_MAX};
+      f64 psnr[3] = {0};
+      size bytes[3] = {0};
+
+      u8* chain = push(&t, u8, layout.size);
+      for(u32 k = 0; k < 3; ++k)
+      {
+         for(u32 it = 0; it < iterations; ++it)
+         {
+            texture_mip_chain blocked = layout;
+            memcpy(chain, rgba, layout.size);
+
+            i64 begin = bench_counter();
+            texture_bc_chain_compress(chain, &blocked, encodings[k]);
+            seconds[k] = min(seconds[k], bench_seconds_elapsed(begin, bench_counter()));
+
+            bytes[k] = blocked.size;
+         }
+
+         psnr[k] = bench_bc_psnr(chain, rgba, (u32)width, (u32)height, encodings[k]);
+      }
+
+      const f64 mpixels = (f64)layout.size / 4 * 1e-6;
+
+      printf("{\"bench\":\"bc\",\"file\":");
+      bench_json_string(file);
+      printf(",\"width\":%d,\"height\":%d,\"color_format\":\"%s\",\"rgba_bytes\":%zu", width, height,
+             texture_bc_format_names[encodings[0].format], layout.size);
+      printf(",\"color_bytes\":%zu,\"color_psnr\":%.2f,\"color_mpixel_s\":%.1f", bytes[0], psnr[0], mpixels / seconds[0]);
+      printf(",\"bc4_psnr\":%.2f,\"bc4_mpixel_s\":%.1f,\"bc5_psnr\":%.2f,\"bc5_mpixel_s\":%.1f}\n",
+             psnr[1], mpixels / seconds[1], psnr[2], mpixels / seconds[2]);
+
+      rgba_bytes += layout.size;
+      color_bytes += bytes[0];
+      bc4_bytes += bytes[1];
+      bc5_bytes += bytes[2];
+      color_psnr += psnr[0];
+      bc4_psnr += psnr[1];
+      bc5_psnr += psnr[2];
+      color_seconds += seconds[0];
+      bc4_seconds += seconds[1];
+      bc5_seconds += seconds[2];
+      chain_mpixels += mpixels;
+      bc1_count += encodings[0].format == texture_bc1;
+      loaded++;
+   }
+
+   if(loaded == 0)
+      return false;
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"bc\",\"images\":%u,\"bc1\":%u,\"bc3\":%u,\"rgba_mb\":%.1f,\"color_mb\":%.1f,\"bc4_mb\":%.1f,\"bc5_mb\":%.1f",
+          loaded, bc1_count, loaded - bc1_count, rgba_bytes * mb, color_bytes * mb, bc4_bytes * mb, bc5_bytes * mb);
+   printf(",\"color_psnr\":%.2f,\"bc4_psnr\":%.2f,\"bc5_psnr\":%.2f", color_psnr / loaded, bc4_psnr / loaded, bc5_psnr / loaded);
+   printf(",\"color_mpixel_s\":%.1f,\"bc4_mpixel_s\":%.1f,\"bc5_mpixel_s\":%.1f}\n",
+          chain_mpixels / color_seconds, chain_mpixels / bc4_seconds, chain_mpixels / bc5_seconds);
+
+   // decode, mips and compression of every image as albedo on the loader jobs
+   gltf_load_jobs load_jobs = {0};
+   load_jobs.textures = push(a, gltf_texture_job, image_count);
+   load_jobs.texture_count = image_count;
+   load_jobs.time = bench_counter;
+
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      load_jobs.textures[i].path = s8(argv[i]);
+      load_jobs.textures[i].mip_flags = texture_mip_srgb | texture_mip_alpha_test;
+      load_jobs.textures[i].roles = gltf_texture_color;
+   }
+
+   f64 serial_seconds = 0;
+
+   for(u32 thread_count = 1;; thread_count = min(thread_count*2, jobs->thread_count))
+   {
+      hw_jobs sweep_jobs = *jobs;
+      sweep_jobs.thread_count = thread_count;
+
+      f64 seconds = DBL_MAX;
+      f64 stages[3] = {0};    // decode, mips and compression of the fastest run, summed over the threads
+      size vram_bytes = 0;
+
+      for(u32 it = 0; it < iterations; ++it)
+      {
+         i64 begin = bench_counter();
+         sweep_jobs.parallel_for(&sweep_jobs, gltf_load_job, &load_jobs, load_jobs.texture_count);
+         const f64 elapsed = bench_seconds_elapsed(begin, bench_counter());
+
+         if(elapsed < seconds)
+         {
+            seconds = elapsed;
+            stages[0] = stages[1] = stages[2] = 0;
+            for(u32 i = 0; i < load_jobs.texture_count; ++i)
+            {
+               const gltf_texture_trace* t = &load_jobs.textures[i].trace;
+               stages[0] += bench_seconds_elapsed(t->begin, t->decoded);
+               stages[1] += bench_seconds_elapsed(t->decoded, t->filtered);
+               stages[2] += bench_seconds_elapsed(t->filtered, t->finished);
+            }
+         }
+
+         vram_bytes = 0;
+         for(u32 i = 0; i < load_jobs.texture_count; ++i)
+         {
+            vram_bytes += load_jobs.textures[i].pixels ? load_jobs.textures[i].mips.size : 0;
+            stbi_image_free(load_jobs.textures[i].pixels);
+            load_jobs.textures[i].pixels = 0;
+         }
+      }
+
+      if(thread_count == 1)
+         serial_seconds = seconds;
+
+      printf("{\"bench\":\"bc_load\",\"threads\":%u,\"textures\":%u,\"vram_mb\":%.1f,\"jobs_ms\":%.3f,\"speedup\":%.2f",
+             thread_count, load_jobs.texture_count, vram_bytes * mb, seconds * 1e3, serial_seconds / seconds);
+      printf(",\"decode_ms\":%.3f,\"mips_ms\":%.3f,\"compress_ms\":%.3f}\n", stages[0] * 1e3, stages[1] * 1e3, stages[2] * 1e3);
+
+      if(thread_count == jobs->thread_count)
+         break;
+   }
+
+   return true;
+}
+
+// the cooked texture path against the stb path - every image goes through the loader job as albedo and
+// is written as ktx2, then loading is either the jobs again or mapping, parsing and copying each ktx2
+// the way the upload copies it to staging
+static bool bench_ktx2(arena* a, arena s, hw_jobs* jobs, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const u32 image_count = (u32)argc;
+   const u32 iterations = 3;
+
+   gltf_load_jobs load_jobs = {0};
+   load_jobs.textures = push(a, gltf_texture_job, image_count);
+   load_jobs.texture_count = image_count;
+
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      load_jobs.textures[i].path = s8(argv[i]);
+      load_jobs.textures[i].mip_flags = texture_mip_srgb | texture_mip_alpha_test;
+      load_jobs.textures[i].roles = gltf_texture_color;
+   }
+
+   s8* paths = push(a, s8, image_count);
+   f64 stb_seconds = DBL_MAX;
+   size chain_bytes = 0, file_bytes = 0;
+   u32 written = 0;
+
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      i64 begin = bench_counter();
+      jobs->parallel_for(jobs, gltf_load_job, &load_jobs, load_jobs.texture_count);
+      stb_seconds = min(stb_seconds, bench_seconds_elapsed(begin, bench_counter()));
+
+      for(u32 i = 0; i < load_jobs.texture_count; ++i)
+      {
+         gltf_texture_job* job = load_jobs.textures + i;
+
+         if(it == 0 && job->pixels)
+         {
+            char name[64];
+            snprintf(name, sizeof(name), "bench_texture_%u.ktx2", i);
+            paths[i] = (s8){push(a, u8, strlen(name) + 1), strlen(name)};
+            memcpy(paths[i].data, name, paths[i].len);
+
+            written += ktx2_write(paths[i], job->pixels, &job->mips, job->encoding, &job->source);
+            chain_bytes += job->mips.size;
+            file_bytes += ktx2_file_size(&job->mips, job->encoding);
+         }
+
+         stbi_image_free(job->pixels);
+         job->pixels = 0;
+      }
+   }
+
+   if(written == 0)
+      return false;
+
+   // one staging buffer that fits any of the chains
+   u8* staging = push(&s, u8, chain_bytes);
+
+   f64 ktx2_seconds = DBL_MAX;
+   u32 mapped = 0;
+
+   for(u32 it = 0; it < iterations; ++it)
+   {
+      mapped = 0;
+
+      i64 begin = bench_counter();
+      for(u32 i = 0; i < image_count; ++i)
+      {
+         if(!paths[i].data)
+            continue;
+
+         win32_file_view file;
+         ktx2_texture texture;
+         if(!ktx2_map(&file, &texture, paths[i]))
+            continue;
+
+         memcpy(staging, texture.pixels, texture.mips.size);
+         win32_file_unmap(&file);
+         mapped++;
+      }
+      ktx2_seconds = min(ktx2_seconds, bench_seconds_elapsed(begin, bench_counter()));
+   }
+
+   for(u32 i = 0; i < image_count; ++i)
+      if(paths[i].data)
+         DeleteFileA(s8_data(paths[i]));
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"ktx2\",\"images\":%u,\"written\":%u,\"mapped\":%u,\"threads\":%u,\"chain_mb\":%.1f,\"file_mb\":%.1f",
+          image_count, written, mapped, jobs->thread_count, chain_bytes * mb, file_bytes * mb);
+   printf(",\"stb_ms\":%.3f,\"ktx2_ms\":%.3f,\"speedup\":%.1f}\n", stb_seconds * 1e3, ktx2_seconds * 1e3, stb_seconds / ktx2_seconds);
+
+   return mapped == written;
+}
+
+// hashes the encoded images like the loader does and decodes all of them against the distinct ones
+static bool bench_dedupe(arena* a, arena s, hw_jobs* jobs, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const u32 image_count = (u32)argc;
+
+   u64* hashes = push(a, u64, image_count);
+   size* sizes = push(a, size, image_count);
+   size hashed_bytes = 0;
+
+   i64 begin = bench_counter();
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      win32_file_view file;
+      if(!win32_file_map(&file, argv[i]))
+         return false;
+
+      hashes[i] = hash64(file.data, file.size);
+      sizes[i] = file.size;
+      hashed_bytes += file.size;
+
+      win32_file_unmap(&file);
+   }
+   const f64 hash_seconds = bench_seconds_elapsed(begin, bench_counter());
+
+   // the first image of every distinct hash and size decodes
+   gltf_load_jobs all = {0}, distinct = {0};
+   all.textures = push(a, gltf_texture_job, image_count);
+   distinct.textures = push(a, gltf_texture_job, image_count);
+
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      const gltf_texture_job job = {.path = s8(argv[i]), .mip_flags = texture_mip_srgb | texture_mip_alpha_test, .roles = gltf_texture_color};
+      all.textures[all.texture_count++] = job;
+
+      u32 first = 0;
+      while(hashes[first] != hashes[i] || sizes[first] != sizes[i])
+         first++;
+
+      if(first == i)
+         distinct.textures[distinct.texture_count++] = job;
+   }
+
+   gltf_load_jobs* runs[] = {&all, &distinct};
+   f64 seconds[2] = {0};
+   size chain_bytes[2] = {0};
+
+   for(u32 r = 0; r < array_count(runs); ++r)
+   {
+      begin = bench_counter();
+      jobs->parallel_for(jobs, gltf_load_job, runs[r], runs[r]->texture_count);
+      seconds[r] = bench_seconds_elapsed(begin, bench_counter());
+
+      for(u32 i = 0; i < runs[r]->texture_count; ++i)
+      {
+         gltf_texture_job* job = runs[r]->textures + i;
+         if(job->pixels)
+            chain_bytes[r] += job->mips.size;
+
+         stbi_image_free(job->pixels);
+         job->pixels = 0;
+      }
+   }
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"dedupe\",\"images\":%u,\"distinct\":%u,\"threads\":%u,\"hashed_mb\":%.1f,\"hash_ms\":%.3f",
+          image_count, distinct.texture_count, jobs->thread_count, hashed_bytes * mb, hash_seconds * 1e3);
+   printf(",\"all_ms\":%.1f,\"distinct_ms\":%.1f,\"all_chain_mb\":%.1f,\"distinct_chain_mb\":%.1f}\n",
+          seconds[0] * 1e3, seconds[1] * 1e3, chain_bytes[0] * mb, chain_bytes[1] * mb);
+
+   return true;
+}
+
+// textured objects along a corridor the camera flies down and back, only the residency is simulated -
+// no pixels are read and nothing is uploaded. a full image is swapped in the frame after its last part
+static bool bench_texture_stream(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const u32 texture_count = (u32)atoi(argv[0]);
+   const u32 frame_count = argc > 1 ? (u32)atoi(argv[1]) : 2000;
+   const size budget = MB(argc > 2 ? atoi(argv[2]) : 256);
+
+   if(texture_count == 0 || frame_count == 0)
+      return false;
+
+   const f32 corridor_length = 4.0f * texture_count;
+   const f32 object_radius = 2.0f;
+   const f32 pixels_per_unit = 1080.0f / (2.0f * tanf(deg2rad(75.0f * 0.5f)));
+
+   texture_stream stream;
+   texture_stream_init(&stream, a, texture_count, budget);
+
+   f32* positions = push(a, f32, 2 * texture_count);
+   u32 state = 1;
+
+   for(u32 i = 0; i < texture_count; ++i)
+   {
+      // 512 to 4096 texels on a side
+      const u32 texels = 512u << (bench_random(&state) % 4);
+      const texture_mip_chain mips = texture_mip_chain_layout(texels, texels);
+      texture_stream_add(&stream, 0, &mips, (texture_bc_encoding){texture_bc_none});
+
+      positions[2*i + 0] = bench_random_unit(&state) * corridor_length;
+      positions[2*i + 1] = 2.0f + bench_random_unit(&state) * 8.0f;   // off the path of the camera
+   }
+
+   const size tail_bytes = stream.resident_bytes;
+   texture_stream_change* changes = push(a, texture_stream_change, 2 * texture_count);
+
+   size peak_bytes = 0, peak_frame_bytes = 0;
+   f64 resident_sum = 0.0, plan_seconds = 0.0;
+   u32 change_count = 0;
+
+   for(u32 frame = 0; frame < frame_count; ++frame)
+   {
+      // there and back once over all the frames
+      const f32 t = 2.0f * frame / frame_count;
+      const f32 eye = (t < 1.0f ? t : 2.0f - t) * corridor_length;
+
+      for(u32 i = 0; i < texture_count; ++i)
+         if(stream.textures[i].upload_offset == stream.textures[i].mips.size)
+            texture_stream_swapped(&stream, i);
+
+      i64 begin = bench_counter();
+
+      texture_stream_frame_begin(&stream);
+      for(u32 i = 0; i < texture_count; ++i)
+      {
+         const f32 dx = positions[2*i] - eye, dy = positions[2*i + 1];
+         const f32 distance = max(sqrtf(dx*dx + dy*dy) - object_radius, 0.01f);
+
+         texture_stream_want(&stream, i, texture_stream_level_for(&stream.textures[i].mips, 2.0f * object_radius * pixels_per_unit / distance));
+      }
+
+      const u32 count = texture_stream_plan(&stream, s, changes, 2 * texture_count);
+      plan_seconds += bench_seconds_elapsed(begin, bench_counter());
+
+      size frame_bytes = 0;
+      for(u32 i = 0; i < count; ++i)
+         frame_bytes += changes[i].end - changes[i].begin;
+
+      change_count += count;
+      peak_frame_bytes = max(peak_frame_bytes, frame_bytes);
+      peak_bytes = max(peak_bytes, stream.resident_bytes);
+      resident_sum += (f64)stream.resident_bytes;
+   }
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"texture_stream\",\"textures\":%u,\"frames\":%u,\"budget_mb\":%.1f,\"full_mb\":%.1f,\"tail_mb\":%.1f",
+          texture_count, frame_count, budget * mb, stream.full_bytes * mb, tail_bytes * mb);
+   printf(",\"peak_mb\":%.1f,\"mean_mb\":%.1f,\"loads\":%u,\"evictions\":%u,\"changes\":%u,\"peak_frame_upload_mb\":%.1f,\"plan_us\":%.2f}\n",
+          peak_bytes * mb, resident_sum / frame_count * mb, stream.load_count, stream.eviction_count, change_count,
+          peak_frame_bytes * mb, plan_seconds * 1e6 / frame_count);
+
+   return peak_bytes <= max(budget, tail_bytes);
+}
+
+align_struct bench_placement
+{
+   u32 node;
+   u64 offset;
+   u64 size;
+   u64 alignment;
+} bench_placement;
+
+static int bench_placement_offset_compare(const void* a, const void* b)
+{
+   const u64 oa = ((const bench_placement*)a)->offset, ob = ((const bench_placement*)b)->offset;
+   return (oa > ob) - (oa < ob);
+}
+
+// resources placed in one range the way a scene fills device memory - many small buffers and fewer large
+// mip chains. the range is filled until 32 placements in a row fail and drained back to 60% at random,
+// the way texture streaming churns it, so the utilization when it is full shows the fragmentation
+static bool bench_tlsf(arena* a, arena s, int argc, char** argv)
+{
+   if(argc < 1)
+      return false;
+
+   const u32 operation_count = (u32)atoi(argv[0]);
+   const u64 range_size = MB(argc > 1 ? atoi(argv[1]) : 64);
+
+   if(operation_count == 0 || range_size == 0)
+      return false;
+
+   const u32 node_count = 1u << 16;
+
+   tlsf t;
+   tlsf_init(&t, a, range_size, node_count);
+
+   bench_placement* live = push(a, bench_placement, node_count);
+   u32 live_count = 0;
+   u32 state = 1;
+
+   // buffers of 256 bytes to 1 MB, mip chains of 64 KB to 16 MB at 4 KB or 64 KB
+   const u32 request_count = 1u << 12;
+   bench_placement* requests = push(&s, bench_placement, request_count);
+
+   for(u32 i = 0; i < request_count; ++i)
+   {
+      const bool image = bench_random(&state) % 10 < 3;
+      const f32 r = bench_random_unit(&state);
+
+      requests[i].size = image ? (u64)(KB(64) * powf(256.0f, r)) : (u64)(256.0f * powf(4096.0f, r));
+      requests[i].alignment = image ? (bench_random(&state) & 1 ? KB(64) : KB(4)) : 256;
+   }
+
+   u32 request = 0;
+   u32 alloc_count = 0, attempt_count = 0, free_count = 0, fill_count = 0;
+   f64 alloc_seconds = 0.0, free_seconds = 0.0, fill_used_sum = 0.0;
+   bool valid = true;
+
+   while(alloc_count + free_count < operation_count)
+   {
+      i64 begin = bench_counter();
+
+      for(u32 failures = 0; failures < 32; )
+      {
+         const bench_placement* next = requests + request++ % request_count;
+         attempt_count++;
+
+         u64 offset = 0;
+         const u32 node = tlsf_alloc(&t, next->size, next->alignment, &offset);
+         if(node == TLSF_NONE)
+         {
+            failures++;
+            continue;
+         }
+
+         live[live_count++] = (bench_placement){node, offset, next->size, next->alignment};
+         alloc_count++;
+         failures = 0;
+      }
+
+      alloc_seconds += bench_seconds_elapsed(begin, bench_counter());
+      fill_used_sum += (f64)t.used / (f64)t.size;
+      fill_count++;
+
+      valid = valid && tlsf_check(&t);
+
+      begin = bench_counter();
+
+      while(live_count > 0 && t.used > t.size * 6 / 10)
+      {
+         const u32 i = bench_random(&state) % live_count;
+         tlsf_free(&t, live[i].node);
+         live[i] = live[--live_count];
+         free_count++;
+      }
+
+      free_seconds += bench_seconds_elapsed(begin, bench_counter());
+
+      valid = valid && tlsf_check(&t);
+   }
+
+   // what is still placed is aligned, inside the range and overlaps nothing
+   qsort(live, live_count, sizeof(*live), bench_placement_offset_compare);
+   for(u32 i = 0; i < live_count; ++i)
+   {
+      const bench_placement* p = live + i;
+      const u64 end = i + 1 < live_count ? live[i + 1].offset : t.size;
+
+      valid = valid && p->offset % p->alignment == 0 && p->offset + p->size <= end;
+   }
+
+   u32 fragment_count = 0;
+   for(u32 i = 0; i < t.node_count; ++i)
+      fragment_count += t.nodes[i].size > 0 && t.nodes[i].free;
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("{\"bench\":\"tlsf\",\"range_mb\":%.0f,\"allocations\":%u,\"frees\":%u,\"fills\":%u",
+          range_size * mb, alloc_count, free_count, fill_count);
+   printf(",\"alloc_ns\":%.1f,\"free_ns\":%.1f,\"used_when_full_pct\":%.1f,\"live\":%u,\"free_ranges\":%u,\"largest_free_mb\":%.2f,\"valid\":%s}\n",
+          alloc_seconds * 1e9 / max(attempt_count, 1u), free_seconds * 1e9 / max(free_count, 1u), fill_used_sum * 100.0 / fill_count,
+          live_count, fragment_count, tlsf_largest_free(&t) * mb, valid ? "true" : "false");
+
+   return valid;
+}
+
+static void bench_usage(const char* program)
+{
+   printf("usage: %s meshlet <file.gltf|file.obj> [iterations]\n", program);
+   printf("       %s sweep <file.gltf|file.obj> [iterations] [max_vertices max_triangles]\n", program);
+   printf("       %s gltf <file.gltf> [iterations]\n", program);
+   printf("       %s load <file.gltf> [iterations] [max_threads]\n", program);
+   printf("       %s stream <gigabytes> [budget_mb] [scratch_file]\n", program);
+   printf("       %s glb <file.gltf> [file.glb] [iterations]\n", program);
+   printf("       %s quantize <file.gltf|file.obj>\n", program);
+   printf("       %s scene <node_count> [iterations] [dirty_percent]\n", program);
+   printf("       %s instances <instance_count> [mesh_count] [file.gltf]\n", program);
+   printf("       %s meshopt <file.gltf|file.obj> [iterations]\n", program);
+   printf("       %s mips <image> [iterations]\n", program);
+   printf("       %s bc <image> [image...]\n", program);
+   printf("       %s ktx2 <image> [image...]\n", program);
+   printf("       %s dedupe <image> [image...]\n", program);
+   printf("       %s texstream <texture_count> [frames] [budget_mb]\n", program);
+   printf("       %s tlsf <operations> [range_mb]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+   if(argc < 3)
+   {
+      bench_usage(argv[0]);
+      return 1;
+   }
+
+   const size bench_memory_size = 1ull << 40;
+
+   void* bench_memory = VirtualAlloc(0, bench_memory_size, MEM_RESERVE, PAGE_READWRITE);
+   assert(bench_memory);
+
+   arena persistent_arena = {0};
+   persistent_arena.end = bench_memory;
+   persistent_arena.kind = arena_persistent_kind;
+
+   arena scratch_arena = {0};
+   scratch_arena.end = (byte*)bench_memory + bench_memory_size/4;
+   scratch_arena.kind = arena_scratch_kind;
+
+   arena persistent = arena_new(&persistent_arena, PAGE_SIZE);
+   arena scratch = arena_new(&scratch_arena, PAGE_SIZE);
+
+   // the upper half is split between the job threads
+   hw_jobs jobs = {0};
+   win32_jobs_init(&jobs, (byte*)bench_memory + bench_memory_size/2, bench_memory_size/2, 0);
+
+   bool result = false;
+
+   if(strcmp(argv[1], "meshlet") == 0)
+      result = bench_meshlet(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "sweep") == 0)
+      result = bench_meshlet_sweep(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "gltf") == 0)
+      result = bench_gltf(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "load") == 0)
+      result = bench_load(&persistent, scratch, &jobs, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "stream") == 0)
+      result = bench_stream(&persistent, scratch, &jobs, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "glb") == 0)
+      result = bench_glb(scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "quantize") == 0)
+      result = bench_quantize(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "scene") == 0)
+      result = bench_scene(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "instances") == 0)
+      result = bench_instances(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "meshopt") == 0)
+      result = bench_meshopt(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "mips") == 0)
+      result = bench_mips(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "bc") == 0)
+      result = bench_bc(&persistent, scratch, &jobs, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "ktx2") == 0)
+      result = bench_ktx2(&persistent, scratch, &jobs, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "dedupe") == 0)
+      result = bench_dedupe(&persistent, scratch, &jobs, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "texstream") == 0)
+      result = bench_texture_stream(&persistent, scratch, argc - 2, argv + 2);
+   else if(strcmp(argv[1], "tlsf") == 0)
+      result = bench_tlsf(&persistent, scratch, argc - 2, argv + 2);
+   else
+      bench_usage(argv[0]);
+
+   VirtualFree(bench_memory, 0, MEM_RELEASE);
+
+   return result ? 0 : 1;
+}
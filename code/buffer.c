@@ -1,4 +1,5 @@
 #include "vulkan_ng.h"
+#include "fixed_point.h"
 
 // buffer hash table entry names
 static const char* vb_buffer_name = "vb";
@@ -10,6 +11,8 @@ static const char* tlas_buffer_name = "tlas";
 static const char* indirect_buffer_name = "indirect";
 static const char* indirect_rtx_buffer_name = "indirect_rtx";
 static const char* mesh_draw_buffer_name = "mesh_draw";
+static const char* mesh_instance_buffer_name = "mesh_instance";
+static const char* material_buffer_name = "material";
 static const char* rt_buffer_name = "rt";
 
 // graphics pipeline module names
@@ -18,262 +21,297 @@ static const char* rt_buffer_name = "rt";
 #define frustum_module_name "frustum"
 #define axis_module_name "axis"
 
-static bool vk_buffer_allocate(vk_buffer* buffer, VkDevice device, VkPhysicalDevice physical, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_flags)
+// the memory is placed in a block of the device memory, host visible buffers stay mapped
+static bool vk_buffer_create_and_bind(vk_buffer* buffer, vk_device* device, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_flags)
 {
    VkBufferCreateInfo create_info = {vk_info(BUFFER)};
    create_info.size = buffer->size;
    create_info.usage = usage;
 
-   if (!vk_valid(vkCreateBuffer(device, &create_info, &global_allocator.handle, &buffer->handle)))
+   if (!vk_valid(vkCreateBuffer(device->logical, &create_info, &global_allocator.handle, &buffer->handle)))
       return false;
 
-   VkMemoryRequirements memory_reqs;
-   vkGetBufferMemoryRequirements(device, buffer->handle, &memory_reqs);
+   if(!vk_memory_buffer_bind(device, buffer->handle, memory_flags, &buffer->allocation))
+      return false;
 
-   VkPhysicalDeviceMemoryProperties memory_properties;
-   vkGetPhysicalDeviceMemoryProperties(physical, &memory_properties);
+   if(memory_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+      buffer->data = buffer->allocation.data;
 
-   u32 memory_index = memory_properties.memoryTypeCount;
-   u32 i = 0;
+   return true;
+}
+
+static void vk_buffer_destroy(vk_device* device, vk_buffer* buffer)
+{
+   vk_memory_free(device, &buffer->allocation);
+   vkDestroyBuffer(device->logical, buffer->handle, &global_allocator.handle);
+}
+
+// layout transition of every level of an image, recorded into the upload batch
+static void vk_buffer_image_barrier(VkCommandBuffer buffer, VkImage image, u32 level_count, VkImageLayout old_layout, VkImageLayout new_layout,
+                                    VkAccessFlags src_access, VkAccessFlags dst_access, VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage)
+{
+   VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+   barrier.srcAccessMask = src_access;
+   barrier.dstAccessMask = dst_access;
+   barrier.oldLayout = old_layout;
+   barrier.newLayout = new_layout;
+   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   barrier.image = image;
+   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+   barrier.subresourceRange.baseMipLevel = 0;
+   barrier.subresourceRange.levelCount = level_count;
+   barrier.subresourceRange.baseArrayLayer = 0;
+   barrier.subresourceRange.layerCount = 1;
+
+   vkCmdPipelineBarrier(buffer, src_stage, dst_stage, 0, 0, 0, 0, 0, 1, &barrier);
+}
 
-   while(i < memory_index)
+// regions are parts of the levels of an image in order, all inside the data. each region goes through the
+// staging ring on its own, the copies are submitted with the next flush of the uploads. an image filled
+// in several parts takes transfer writes with the first and goes to shader reads with the last
+static void vk_buffer_to_image_upload_part(vk_context* context, VkImage image, u32 level_count, const VkBufferImageCopy* regions, u32 region_count,
+                                           const void* data, VkDeviceSize dev_size, bool first, bool last)
+{
+   assert(data);
+   assert(dev_size > 0);
+   assert(regions && region_count > 0);
+   assert(vk_valid_handle(image));
+
+   const u8* bytes = data;
+
+   if(first)
+      vk_buffer_image_barrier(vk_upload_cmd(context), image, level_count, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                              0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+   for(u32 i = 0; i < region_count; ++i)
    {
-      VkMemoryType mem_type = memory_properties.memoryTypes[i];
+      const VkDeviceSize offset = regions[i].bufferOffset;
+      const VkDeviceSize end = i + 1 < region_count ? regions[i + 1].bufferOffset : dev_size;
+      assert(offset < end && end <= dev_size);
+
+      VkBufferImageCopy region = regions[i];
 
-      if((memory_reqs.memoryTypeBits & (1 << i)) &&
-         (mem_type.propertyFlags & memory_flags) == memory_flags)
+      // a region larger than the ring gets a staging buffer of its own
+      if(end - offset > (VkDeviceSize)context->upload.ring.size)
       {
-         memory_index = i;
-         break;
-      }
+         vk_buffer scratch = {.size = (size)(end - offset)};
+         if(!vk_buffer_create_and_bind(&scratch, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+         {
+            printf("Could not create the staging buffer of a %zu byte level\n", scratch.size);
+            continue;
+         }
 
-      ++i;
-   }
+         memcpy(scratch.data, bytes + offset, scratch.size);
 
-   assert(i != memory_properties.memoryTypeCount);
+         region.bufferOffset = 0;
+         vkCmdCopyBufferToImage(vk_upload_cmd(context), scratch.handle, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-   VkMemoryAllocateFlagsInfo allocate_flags_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
-   allocate_flags_info.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+         vk_upload_finish(context);
+         vk_buffer_destroy(&context->devices, &scratch);
+         continue;
+      }
 
-   VkMemoryAllocateInfo allocate_info = {vk_info_allocate(MEMORY)};
-   allocate_info.allocationSize = memory_reqs.size;
-   allocate_info.memoryTypeIndex = memory_index;
-   allocate_info.pNext = &allocate_flags_info;
+      region.bufferOffset = vk_upload_stage(context, bytes + offset, (size)(end - offset));
+      vkCmdCopyBufferToImage(vk_upload_cmd(context), context->upload.ring.handle, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+   }
 
-   vkAllocateMemory(device, &allocate_info, &global_allocator.handle, &buffer->memory);
+   if(last)
+      vk_upload_release_image(context, image, level_count);
 
-   return true;
+   vk_upload_commit(context);
 }
 
-static bool vk_buffer_create_and_bind(vk_buffer* buffer, vk_device* device, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_flags)
+// regions are the mip levels of the image in order, all inside the data
+static void vk_buffer_to_image_upload(vk_context* context, VkImage image, const VkBufferImageCopy* regions, u32 region_count,
+                                      const void* data, VkDeviceSize dev_size)
 {
-   if (!vk_buffer_allocate(buffer, device->logical, device->physical, usage, memory_flags))
-      return false;
+   vk_buffer_to_image_upload_part(context, image, region_count, regions, region_count, data, dev_size, true, true);
+}
 
-   if(!vk_valid((vkBindBufferMemory(device->logical, buffer->handle, buffer->memory, 0))))
-      return false;
+// copies between device buffers and waits for the copy, the source can be destroyed after. the copy
+// runs on the graphics queue, which owns the source once its uploads were submitted
+static void vk_buffer_copy(vk_context* context, VkBuffer from, VkBuffer to, VkDeviceSize from_offset, VkDeviceSize to_offset, VkDeviceSize copy_size)
+{
+   assert(copy_size > 0);
+   assert(vk_valid_handle(from) && vk_valid_handle(to));
 
-   if(memory_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
-      if(!vk_valid((vkMapMemory(device->logical, buffer->memory, 0, buffer->size, 0, &buffer->data))))
-         return false;
+   VkCommandBuffer buffer = vk_upload_graphics_cmd(context);
 
-   return true;
-}
+   // the source may still be written by a copy earlier in the batch
+   VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+   barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
 
-static void vk_buffer_destroy(vk_device* device, vk_buffer* buffer)
-{
-   vkFreeMemory(device->logical, buffer->memory, &global_allocator.handle);
-   vkDestroyBuffer(device->logical, buffer->handle, &global_allocator.handle);
+   vkCmdPipelineBarrier(buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+   VkBufferCopy buffer_region = {from_offset, to_offset, copy_size};
+   vkCmdCopyBuffer(buffer, from, to, 1, &buffer_region);
+
+   context->upload.copy_count++;
+   vk_upload_finish(context);
 }
 
-static void vk_buffer_to_image_upload(vk_context* context, vk_buffer scratch, VkImage image, VkExtent3D image_extent, const void* data, VkDeviceSize dev_size)
+// uploads data_size bytes to offset of the device buffer through the staging ring, in pieces of at most
+// a batch so a large buffer keeps the ring moving
+static void vk_buffer_upload_range(vk_context* context, vk_buffer* to, size offset, const void* data, size data_size)
 {
+   assert(to->size > 0);
+   assert(to->handle > 0);
+   assert(to->allocation.handle > 0);
    assert(data);
-   assert(dev_size > 0);
-   assert(scratch.data && scratch.size >= (size)dev_size);
-   assert(image_extent.width && image_extent.height && image_extent.depth);
-   assert(vk_valid_handle(image));
+   assert(data_size > 0 && offset + data_size <= to->size);
+
+   const size piece_size = context->upload.ring.size / VK_UPLOAD_BATCH_COUNT;
+   const u8* bytes = data;
+
+   for(size done = 0; done < data_size; done += piece_size)
+   {
+      const size piece = min(piece_size, data_size - done);
+
+      VkBufferCopy region = {0};
+      region.srcOffset = vk_upload_stage(context, bytes + done, piece);
+      region.dstOffset = offset + done;
+      region.size = piece;
 
-   memcpy(scratch.data, data, dev_size);
-
-   vk_assert(vkResetCommandPool(context->devices.logical, context->cmd.pool, 0));
-
-   VkCommandBufferBeginInfo begin_info = {0};
-   begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-   begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-   vk_assert(vkBeginCommandBuffer(context->cmd.buffer, &begin_info));
-
-   VkImageMemoryBarrier img_barrier_to_transfer = {0};
-   img_barrier_to_transfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-   img_barrier_to_transfer.srcAccessMask = 0;
-   img_barrier_to_transfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-   img_barrier_to_transfer.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-   img_barrier_to_transfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-   img_barrier_to_transfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   img_barrier_to_transfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   img_barrier_to_transfer.image = image;
-   img_barrier_to_transfer.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-   img_barrier_to_transfer.subresourceRange.baseMipLevel = 0;
-   img_barrier_to_transfer.subresourceRange.levelCount = 1;
-   img_barrier_to_transfer.subresourceRange.baseArrayLayer = 0;
-   img_barrier_to_transfer.subresourceRange.layerCount = 1;
-
-   vkCmdPipelineBarrier(
-      context->cmd.buffer,
-      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      0,
-      0, NULL,
-      0, NULL,
-      1, &img_barrier_to_transfer
-   );
-
-   VkBufferImageCopy region = {0};
-   region.bufferOffset = 0;
-   region.bufferRowLength = 0;
-   region.bufferImageHeight = 0;
-   region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-   region.imageSubresource.mipLevel = 0;
-   region.imageSubresource.baseArrayLayer = 0;
-   region.imageSubresource.layerCount = 1;
-   region.imageOffset.x = 0;
-   region.imageOffset.y = 0;
-   region.imageOffset.z = 0;
-   region.imageExtent = image_extent;
-
-   vkCmdCopyBufferToImage(
-      context->cmd.buffer,
-      scratch.handle,
-      image,
-      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-      1,
-      &region
-   );
-
-   VkImageMemoryBarrier img_barrier_to_shader = {0};
-   img_barrier_to_shader.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-   img_barrier_to_shader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-   img_barrier_to_shader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-   img_barrier_to_shader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-   img_barrier_to_shader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-   img_barrier_to_shader.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   img_barrier_to_shader.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   img_barrier_to_shader.image = image;
-   img_barrier_to_shader.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-   img_barrier_to_shader.subresourceRange.baseMipLevel = 0;
-   img_barrier_to_shader.subresourceRange.levelCount = 1;
-   img_barrier_to_shader.subresourceRange.baseArrayLayer = 0;
-   img_barrier_to_shader.subresourceRange.layerCount = 1;
-
-   vkCmdPipelineBarrier(
-      context->cmd.buffer,
-      VK_PIPELINE_STAGE_TRANSFER_BIT,
-      VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-      0,
-      0, NULL,
-      0, NULL,
-      1, &img_barrier_to_shader
-   );
-
-   vk_assert(vkEndCommandBuffer(context->cmd.buffer));
-
-   VkSubmitInfo submit_info = {0};
-   submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-   submit_info.waitSemaphoreCount = 0;
-   submit_info.commandBufferCount = 1;
-   submit_info.pCommandBuffers = &context->cmd.buffer;
-   submit_info.signalSemaphoreCount = 0;
-
-   vk_assert(vkQueueSubmit(context->graphics_queue, 1, &submit_info, VK_NULL_HANDLE));
-   // instead of explicit memory sync between queue submissions with fences etc we wait for all gpu jobs to complete before moving on
-   // TODO: bad for perf
-   vk_assert(vkDeviceWaitIdle(context->devices.logical));
+      vkCmdCopyBuffer(vk_upload_cmd(context), context->upload.ring.handle, to->handle, 1, &region);
+      vk_upload_release_buffer(context, to->handle, region.dstOffset, region.size);
+      vk_upload_commit(context);
+   }
 }
 
 // TODO: wide
 static void vk_buffer_upload(vk_context* context, vk_buffer* to, const void* data)
 {
-   assert(to->size > 0);
-   assert(to->handle > 0);
-   assert(to->memory > 0);
-   assert(data);
+   vk_buffer_upload_range(context, to, 0, data, to->size);
+}
+
+// sorts the instances by mesh so every mesh is drawn by one instanced indirect command
+static void buffer_draw_batches_build(vk_context* context, arena scratch)
+{
+   vk_geometry* geometry = &context->geometry;
+   const u32 instance_count = (u32)geometry->mesh_instances.count;
+
+   geometry->draw_batches = (array_draw_batch){context->app_storage};
+   if(instance_count == 0)
+      return;
+
+   u32* mesh_indices = push(&scratch, u32, instance_count);
+   u32* order = push(&scratch, u32, instance_count);
+   vk_mesh_instance* sorted = push(&scratch, vk_mesh_instance, instance_count);
+
+   for(u32 i = 0; i < instance_count; ++i)
+      mesh_indices[i] = geometry->mesh_instances.data[i].mesh_index;
+
+   draw_batches_build(&geometry->draw_batches, order, scratch, mesh_indices, instance_count,
+                      context->meshlet_counts.data, (u32)geometry->mesh_draws.count);
 
-   vk_buffer scratch_buffer = {.size = to->size};
-   vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+   for(u32 i = 0; i < instance_count; ++i)
+      sorted[i] = geometry->mesh_instances.data[order[i]];
 
-   memcpy(scratch_buffer.data, data, to->size);
+   memcpy(geometry->mesh_instances.data, sorted, instance_count * sizeof(vk_mesh_instance));
+}
 
-   vk_assert(vkResetCommandPool(context->devices.logical, context->cmd.pool, 0));
+static bool buffer_draws_create(vk_buffer* transform_buffer, vk_context* context, arena scratch)
+{
+   const array_draw_batch* batches = &context->geometry.draw_batches;
+   if(batches->count == 0)
+      return true;
 
-   VkCommandBufferBeginInfo buffer_begin_info = {vk_info_begin(COMMAND_BUFFER)};
-   buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+   struct mesh_draw* draws = push(&scratch, struct mesh_draw, batches->count);
 
-   vk_assert(vkBeginCommandBuffer(context->cmd.buffer, &buffer_begin_info));
+   for(u32 i = 0; i < batches->count; ++i)
+   {
+      const draw_batch* batch = batches->data + i;
+      const vk_mesh_draw* md = context->geometry.mesh_draws.data + batch->mesh_index;
 
-   VkBufferCopy buffer_region = {0, 0, scratch_buffer.size};
-   vkCmdCopyBuffer(context->cmd.buffer, scratch_buffer.handle, to->handle, 1, &buffer_region);
+      // the instances of a batch share the material of their primitive
+      const vk_mesh_instance* mi = context->geometry.mesh_instances.data + batch->instance_offset;
 
-   VkBufferMemoryBarrier copy_barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-   copy_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-   copy_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-   copy_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   copy_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-   copy_barrier.buffer = to->handle;
-   copy_barrier.size = to->size;
-   copy_barrier.offset = 0;
+      draws[i].mesh_offset = (u32)context->meshlet_offsets.data[batch->mesh_index];
+      draws[i].vertex_offset = (u32)context->vertex_offsets.data[batch->mesh_index];
+      draws[i].instance_offset = batch->instance_offset;
+      memcpy(draws[i].position_center, md->position_center, sizeof(draws[i].position_center));
+      memcpy(draws[i].position_extent, md->position_extent, sizeof(draws[i].position_extent));
 
-   vkCmdPipelineBarrier(context->cmd.buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT|VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-                        VK_DEPENDENCY_BY_REGION_BIT, 0, 0, 1, &copy_barrier, 0, 0);
+      draws[i].material = mi->material;
+   }
 
-   vk_assert(vkEndCommandBuffer(context->cmd.buffer));
+   transform_buffer->size = batches->count * sizeof(struct mesh_draw);
 
-   VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
-   submit_info.commandBufferCount = 1;
-   submit_info.pCommandBuffers = &context->cmd.buffer;
+   if(!vk_buffer_create_and_bind(transform_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+      return false;
 
-   vk_assert(vkQueueSubmit(context->graphics_queue, 1, &submit_info, VK_NULL_HANDLE));
-   // instead of explicit memory sync between queue submissions with fences etc we wait for all gpu jobs to complete before moving on
-   // TODO: bad for perf
-   vk_assert(vkDeviceWaitIdle(context->devices.logical));
+   vk_buffer_upload(context, transform_buffer, draws);
 
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
+   return true;
 }
 
-static bool buffer_draws_create(vk_buffer* transform_buffer, vk_context* context, arena scratch)
+// world transforms in batch order, read by gl_InstanceIndex or the work group of the batch
+static bool buffer_instances_create(vk_buffer* instance_buffer, vk_context* context, arena scratch)
 {
-   struct mesh_draw* draws = push(&scratch, struct mesh_draw, context->geometry.mesh_instances.count);
+   const size instance_count = context->geometry.mesh_instances.count;
+   if(instance_count == 0)
+      return true;
+
+   struct mesh_instance* instances = push(&scratch, struct mesh_instance, instance_count);
 
-   for(u32 i = 0; i < context->geometry.mesh_instances.count; ++i)
+   // shear does not survive the decompose, gltf node transforms have none
+   for(size i = 0; i < instance_count; ++i)
    {
-      draws[i].mesh_offset = (u32)context->meshlet_offsets.data[i];
-      draws[i].vertex_offset = (u32)context->vertex_offsets.data[i];
-
-      draws[i].world = context->geometry.mesh_instances.data[i].world;
-      draws[i].normal = (u32)context->geometry.mesh_instances.data[i].normal;
-      draws[i].albedo = (u32)context->geometry.mesh_instances.data[i].albedo;
-      draws[i].metal = (u32)context->geometry.mesh_instances.data[i].metal;
-      draws[i].ao = (u32)context->geometry.mesh_instances.data[i].ao;
-      draws[i].emissive = (u32)context->geometry.mesh_instances.data[i].emissive;
+      f32 rotation[4];
+      transform_decompose(instances[i].position, rotation, instances[i].scale, context->geometry.mesh_instances.data[i].world.data);
+
+      instances[i].rotation[0] = (u32)(u16)FP_snorm16(rotation[0]) | ((u32)(u16)FP_snorm16(rotation[1]) << 16);
+      instances[i].rotation[1] = (u32)(u16)FP_snorm16(rotation[2]) | ((u32)(u16)FP_snorm16(rotation[3]) << 16);
    }
 
-   size scratch_buffer_size = context->geometry.mesh_instances.count * sizeof(struct mesh_draw);
-   vk_buffer scratch_buffer = {.size = scratch_buffer_size};
+   instance_buffer->size = instance_count * sizeof(struct mesh_instance);
 
-   if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+   if(!vk_buffer_create_and_bind(instance_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
       return false;
 
-   transform_buffer->size = scratch_buffer_size;
+   vk_buffer_upload(context, instance_buffer, instances);
 
-   if(!vk_buffer_create_and_bind(transform_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+   return true;
+}
+
+// deduplicated texture indices, the draws index them with their material
+static bool buffer_materials_create(vk_buffer* material_buffer, vk_context* context)
+{
+   const size material_count = context->geometry.materials.count;
+   if(material_count == 0)
+      return true;
+
+   material_buffer->size = material_count * sizeof(struct material);
+
+   if(!vk_buffer_create_and_bind(material_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
       return false;
 
-   vk_buffer_upload(context, transform_buffer, draws);
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
+   vk_buffer_upload(context, material_buffer, context->geometry.materials.data);
 
    return true;
 }
 
+// sizes of the draw tables against textures inline in every draw and a mat4 per instance
+static void buffer_tables_report(const vk_context* context)
+{
+   const size draw_count = context->geometry.draw_batches.count;
+   const size instance_count = context->geometry.mesh_instances.count;
+   const size material_count = context->geometry.materials.count;
+
+   const size inline_draw_bytes = sizeof(struct mesh_draw) - sizeof(u32) + sizeof(struct material);
+   const size matrix_instance_bytes = sizeof(mat4);
+
+   const size bytes = draw_count * sizeof(struct mesh_draw) + instance_count * sizeof(struct mesh_instance) + material_count * sizeof(struct material);
+   const size inline_bytes = draw_count * inline_draw_bytes + instance_count * matrix_instance_bytes;
+
+   printf("Draw tables: %zu draws at %zu bytes (%zu with inline textures), %zu instances at %zu bytes (%zu as a matrix), "
+          "%zu materials for %zu instances, %zu bytes instead of %zu\n",
+          draw_count, sizeof(struct mesh_draw), inline_draw_bytes, instance_count, sizeof(struct mesh_instance),
+          matrix_instance_bytes, material_count, instance_count, bytes, inline_bytes);
+}
+
 static bool buffer_rt_create(vk_buffer* rt_buffer, vk_context* context)
 {
    VkAccelerationStructureDeviceAddressInfoKHR acceleration_info =
@@ -285,18 +323,11 @@ static bool buffer_rt_create(vk_buffer* rt_buffer, vk_context* context)
 
    VkDeviceSize tlas_address_buffer_size = sizeof(VkDeviceAddress);
 
-   size scratch_buffer_size = tlas_address_buffer_size;
-   vk_buffer scratch_buffer = {.size = scratch_buffer_size};
-
-   if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-      return false;
-
-   rt_buffer->size = scratch_buffer_size;
+   rt_buffer->size = tlas_address_buffer_size;
    if(!vk_buffer_create_and_bind(rt_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
       return false;
 
    vk_buffer_upload(context, rt_buffer, &tlas_address);
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
 
    return true;
 }
@@ -305,63 +336,55 @@ static bool buffer_rt_create(vk_buffer* rt_buffer, vk_context* context)
 // TODO: pass the devices struct
 static bool buffer_indirect_create(vk_buffer* indirect_buffer, vk_context* context, arena scratch, bool mesh_shading_supported)
 {
+   const array_draw_batch* batches = &context->geometry.draw_batches;
+   if(batches->count == 0)
+      return true;
+
    if(!mesh_shading_supported)
    {
-      VkDrawIndexedIndirectCommand* draw_commands = push(&scratch, VkDrawIndexedIndirectCommand, context->geometry.mesh_instances.count);
+      VkDrawIndexedIndirectCommand* draw_commands = push(&scratch, VkDrawIndexedIndirectCommand, batches->count);
 
-      for(u32 i = 0; i < context->geometry.mesh_instances.count; ++i)
+      for(u32 i = 0; i < batches->count; ++i)
       {
-         vk_mesh_instance mi = context->geometry.mesh_instances.data[i];
-         vk_mesh_draw md = context->geometry.mesh_draws.data[mi.mesh_index];
+         const draw_batch* batch = batches->data + i;
+         vk_mesh_draw md = context->geometry.mesh_draws.data[batch->mesh_index];
 
          VkDrawIndexedIndirectCommand cmd =
          {
              .indexCount = (u32)md.index_count,
-             .instanceCount = 1,               // one instance per mesh_instance
+             .instanceCount = batch->instance_count,
              .firstIndex = (u32)md.index_offset,
              .vertexOffset = (i32)md.vertex_offset,
-             .firstInstance = i                // important: matches instance ID
+             .firstInstance = batch->instance_offset   // important: gl_InstanceIndex indexes the instance buffer
          };
 
          draw_commands[i] = cmd;
       }
 
-      size scratch_buffer_size = context->geometry.mesh_instances.count * sizeof(VkDrawIndexedIndirectCommand);
-      vk_buffer scratch_buffer = {.size = scratch_buffer_size};
-
-      if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-         return false;
-
-      indirect_buffer->size = scratch_buffer_size;
+      indirect_buffer->size = batches->count * sizeof(VkDrawIndexedIndirectCommand);
       if(!vk_buffer_create_and_bind(indirect_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
          return false;
 
       vk_buffer_upload(context, indirect_buffer, draw_commands);
-      vk_buffer_destroy(&context->devices, &scratch_buffer);
    }
    else
    {
-      VkDrawMeshTasksIndirectCommandEXT* draw_commands = push(&scratch, VkDrawMeshTasksIndirectCommandEXT, context->geometry.mesh_instances.count);
+      VkDrawMeshTasksIndirectCommandEXT* draw_commands = push(&scratch, VkDrawMeshTasksIndirectCommandEXT, batches->count);
 
-      for(u32 i = 0; i < context->geometry.mesh_instances.count; ++i)
+      for(u32 i = 0; i < batches->count; ++i)
       {
-         VkDrawMeshTasksIndirectCommandEXT cmd = {(u32)context->meshlet_counts.data[i],1,1}; // how many meshlets per draw
+         // how many meshlets per draw times the instances of the batch
+         const draw_batch* batch = batches->data + i;
+         VkDrawMeshTasksIndirectCommandEXT cmd = {(u32)context->meshlet_counts.data[batch->mesh_index], batch->instance_count, 1};
 
          draw_commands[i] = cmd;
       }
 
-      size scratch_buffer_size = context->geometry.mesh_instances.count * sizeof(VkDrawMeshTasksIndirectCommandEXT);
-      vk_buffer scratch_buffer = {.size = scratch_buffer_size};
-
-      if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
-         return false;
-
-      indirect_buffer->size = scratch_buffer_size;
+      indirect_buffer->size = batches->count * sizeof(VkDrawMeshTasksIndirectCommandEXT);
       if(!vk_buffer_create_and_bind(indirect_buffer, &context->devices, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
          return false;
        
       vk_buffer_upload(context, indirect_buffer, draw_commands);
-      vk_buffer_destroy(&context->devices, &scratch_buffer);
    }
 
    return true;
@@ -1,7 +1,7 @@
 @echo off
 
 IF "%1"=="" (
-    echo "Usage: %0 d|r|a"
+    echo "Usage: %0 d|r|a|b"
     exit /b 1
 )
 
@@ -13,13 +13,16 @@ set VULKAN_INC=%VULKAN_SDK%\Include
 set EXTERNAL_INC=%ROOT%..\extern\volk
 set VULKAN_LIBPATH=%VULKAN_SDK%\Lib
 set IGNORE_WARNINGS=-wd4127 -wd4706 -wd4100 -wd4996 -wd4505 -wd4201
+REM optional meshlet limits, e.g. set MESHLET_LIMITS=-DMESHLET_MAX_VERTICES=64 -DMESHLET_MAX_TRIANGLES=84
+REM must match the ones given to shader_build.bat
+REM optional 16 byte vertices, set VERTEX_FORMAT=-DVERTEX_QUANTIZED=1 for both builds as well
 
 IF NOT EXIST %ROOT%..\build mkdir %ROOT%..\build
 pushd %ROOT%..\build
 
 IF /I "%1"=="d" (
     echo Building DEBUG version...
-    cl -MT -nologo -Od -Oi -Zi -FC -W3 /std:clatest /D_DEBUG %IGNORE_WARNINGS% ^
+    cl -MT -nologo -Od -Oi -Zi -FC -W3 /std:clatest /D_DEBUG %IGNORE_WARNINGS% %MESHLET_LIMITS% %VERTEX_FORMAT% ^
         -I "%VULKAN_INC%" -I "%EXTERNAL_INC%" "%ROOT%\app.c" "%ROOT%\win32.c" ^
         /link %WIN32_LIBS% /DEBUG -incremental:no /LIBPATH:"%VULKAN_LIBPATH%" /out:vulkan_3d_debug.exe
 
@@ -28,7 +31,7 @@ IF /I "%1"=="d" (
 
 IF /I "%1"=="r" (
     echo Building RELEASE version...
-    cl -MT -nologo -O2 -Oi -Zi -FC -W3 /std:clatest %IGNORE_WARNINGS% ^
+    cl -MT -nologo -O2 -Oi -Zi -FC -W3 /std:clatest %IGNORE_WARNINGS% %MESHLET_LIMITS% %VERTEX_FORMAT% ^
         -I "%VULKAN_INC%" -I "%EXTERNAL_INC%" "%ROOT%\app.c" "%ROOT%\win32.c" ^
         /link %WIN32_LIBS% -incremental:no /LIBPATH:"%VULKAN_LIBPATH%" /out:vulkan_3d_release.exe
 
@@ -38,17 +41,26 @@ IF /I "%1"=="r" (
 IF /I "%1"=="a" (
    echo Building DEBUG and RELEASE version...
 
-   cl -MT -nologo -Od -Oi -Zi -FC -W3 /std:clatest /D_DEBUG %IGNORE_WARNINGS% ^
+   cl -MT -nologo -Od -Oi -Zi -FC -W3 /std:clatest /D_DEBUG %IGNORE_WARNINGS% %MESHLET_LIMITS% %VERTEX_FORMAT% ^
    -I "%VULKAN_INC%" -I "%EXTERNAL_INC%" "%ROOT%\app.c" "%ROOT%\win32.c" ^
    /link %WIN32_LIBS% /DEBUG -incremental:no /LIBPATH:"%VULKAN_LIBPATH%" /out:vulkan_3d_debug.exe
 
-   cl -MT -nologo -O2 -Oi -Zi -FC -W3 /std:clatest %IGNORE_WARNINGS% ^
+   cl -MT -nologo -O2 -Oi -Zi -FC -W3 /std:clatest %IGNORE_WARNINGS% %MESHLET_LIMITS% %VERTEX_FORMAT% ^
    -I "%VULKAN_INC%" -I "%EXTERNAL_INC%" "%ROOT%\app.c" "%ROOT%\win32.c" ^
    /link %WIN32_LIBS% -incremental:no /LIBPATH:"%VULKAN_LIBPATH%" /out:vulkan_3d_release.exe
 
    popd
 )
 
+IF /I "%1"=="b" (
+    echo Building BENCHMARK version...
+    cl -MT -nologo -O2 -Oi -Zi -FC -W3 /std:clatest %IGNORE_WARNINGS% %VERTEX_FORMAT% ^
+        -I "%VULKAN_INC%" -I "%EXTERNAL_INC%" "%ROOT%\bench.c" ^
+        /link %WIN32_LIBS% -incremental:no /out:bench_release.exe
+
+    popd
+)
+
 IF %ERRORLEVEL% EQU 0 (
     echo Build succeeded!
 
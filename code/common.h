@@ -9,6 +9,8 @@
 
 typedef uint8_t         u8;
 typedef uint16_t        u16;
+typedef int8_t          i8;
+typedef int16_t         i16;
 typedef int32_t         i32;
 typedef uint32_t        u32;
 typedef uint64_t        u64;
@@ -0,0 +1,41 @@
+#include "draw_batch.h"
+
+// automatic instancing - the instances are sorted by the mesh they draw and every mesh becomes one batch,
+// instances of a primitive share its material so the mesh index is the whole key
+
+// order gets the instance indices sorted by mesh, stable so the instances of a mesh keep their order.
+// meshlet_counts per mesh splits the batches that would launch more mesh shader work groups than
+// every device supports, null when only the vertex path draws them
+static void draw_batches_build(array_draw_batch* batches, u32* order, arena s, const u32* mesh_indices, u32 instance_count,
+                               const size* meshlet_counts, u32 mesh_count)
+{
+   if(instance_count == 0 || mesh_count == 0)
+      return;
+
+   u32* mesh_first = push(&s, u32, mesh_count + 1);
+   u32* mesh_fill = push(&s, u32, mesh_count);
+
+   for(u32 i = 0; i < instance_count; ++i)
+   {
+      assert(mesh_indices[i] < mesh_count);
+      mesh_first[mesh_indices[i] + 1]++;
+   }
+
+   for(u32 m = 0; m < mesh_count; ++m)
+      mesh_first[m + 1] += mesh_first[m];
+
+   memcpy(mesh_fill, mesh_first, mesh_count * sizeof(u32));
+
+   for(u32 i = 0; i < instance_count; ++i)
+      order[mesh_fill[mesh_indices[i]]++] = i;
+
+   for(u32 m = 0; m < mesh_count; ++m)
+   {
+      u32 limit = DRAW_BATCH_MAX_INSTANCES;
+      if(meshlet_counts && meshlet_counts[m] > 0)
+         limit = (u32)min((size)limit, max(DRAW_BATCH_MAX_WORK_GROUPS / meshlet_counts[m], 1));
+
+      for(u32 first = mesh_first[m]; first < mesh_first[m + 1]; first += limit)
+         arrayp_push(batches) = (draw_batch){m, first, min(limit, mesh_first[m + 1] - first)};
+   }
+}
@@ -0,0 +1,22 @@
+#if !defined(_DRAW_BATCH_H)
+#define _DRAW_BATCH_H
+
+#include "common.h"
+#include "arena.h"
+
+// instances of one mesh drawn by a single indirect command
+align_struct draw_batch
+{
+   u32 mesh_index;         // which vk_mesh_draw the batch draws
+   u32 instance_offset;    // first instance of the batch once the instances are sorted by mesh
+   u32 instance_count;
+} draw_batch;
+
+typedef array(draw_batch) array_draw_batch;
+
+// spec minimums of maxMeshWorkGroupCount[1] and maxMeshWorkGroupTotalCount - a mesh shading batch
+// launches meshlet count times instance count work groups
+#define DRAW_BATCH_MAX_INSTANCES 65535u
+#define DRAW_BATCH_MAX_WORK_GROUPS (1u << 22)
+
+#endif
@@ -1,7 +1,10 @@
-#if !defined(_FIXED_point_H)
+#if !defined(_FIXED_POINT_H)
 #define _FIXED_POINT_H
 
 #include "common.h"
+#include "math.h"
+
+typedef i32 fp;
 
 static fp FP_to_fixed_point(f32 f, i32 scale) { return (fp)f << scale; }
 
@@ -11,4 +14,104 @@ static fp FP_fixed_sub(fp a, fp b) { return a - b; }
 
 static fp FP_fixed_mul(fp a, fp b, i32 scale) { return (a * b) / scale; }
 
+// quantization helpers shared by the vertex encoder and its error report - the shaders decode
+// with unpackSnorm2x16 and unpackHalf2x16 which follow the same rules
+
+// [-1, 1] to 16 bits, rounded to nearest
+static i16 FP_snorm16(f32 f)
+{
+   f = clamp(f, -1.0f, 1.0f);
+
+   return (i16)(f >= 0.0f ? f*32767.0f + 0.5f : f*32767.0f - 0.5f);
+}
+
+static f32 FP_from_snorm16(i16 v)
+{
+   return max((f32)v / 32767.0f, -1.0f);
+}
+
+// ieee half, round to nearest even, overflow to infinity and denormals flushed to zero
+static u16 FP_half(f32 f)
+{
+   u32 bits;
+   memcpy(&bits, &f, sizeof(bits));
+
+   const u32 sign = (bits >> 16) & 0x8000;
+   const i32 exponent = (i32)((bits >> 23) & 0xff) - 127 + 15;
+   u32 mantissa = bits & 0x7fffff;
+
+   if(((bits >> 23) & 0xff) == 0xff)
+      return (u16)(sign | 0x7c00 | (mantissa ? 0x200 : 0));   // inf and nan
+   if(exponent >= 31)
+      return (u16)(sign | 0x7c00);
+   if(exponent <= 0)
+      return (u16)sign;
+
+   u32 result = sign | ((u32)exponent << 10) | (mantissa >> 13);
+
+   // the carry of the rounding may bump the exponent, which is still the right result
+   const u32 rest = mantissa & 0x1fff;
+   if(rest > 0x1000 || (rest == 0x1000 && (result & 1)))
+      result++;
+
+   return (u16)result;
+}
+
+static f32 FP_from_half(u16 h)
+{
+   const u32 sign = (u32)(h & 0x8000) << 16;
+   const u32 exponent = (h >> 10) & 0x1f;
+   const u32 mantissa = h & 0x3ff;
+
+   u32 bits = sign;
+   if(exponent == 31)
+      bits |= 0x7f800000 | (mantissa << 13);
+   else if(exponent != 0)
+      bits |= ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+   f32 result;
+   memcpy(&result, &bits, sizeof(result));
+
+   return result;
+}
+
+// unit vector to the octahedron unfolded onto [-1, 1]^2
+static void FP_octahedral_encode(f32 out[2], const f32 n[3])
+{
+   const f32 l1 = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+   f32 x = l1 > 0.0f ? n[0] / l1 : 0.0f;
+   f32 y = l1 > 0.0f ? n[1] / l1 : 0.0f;
+
+   // the lower hemisphere folds over the diagonals
+   if(n[2] < 0.0f)
+   {
+      const f32 fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+      const f32 fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+      x = fx;
+      y = fy;
+   }
+
+   out[0] = x;
+   out[1] = y;
+}
+
+static void FP_octahedral_decode(f32 n[3], const f32 e[2])
+{
+   n[0] = e[0];
+   n[1] = e[1];
+   n[2] = 1.0f - fabsf(e[0]) - fabsf(e[1]);
+
+   const f32 t = max(-n[2], 0.0f);
+   n[0] += n[0] >= 0.0f ? -t : t;
+   n[1] += n[1] >= 0.0f ? -t : t;
+
+   const f32 l = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+   if(l > 0.0f)
+   {
+      n[0] /= l;
+      n[1] /= l;
+      n[2] /= l;
+   }
+}
+
 #endif
@@ -5,92 +5,23 @@
 #include "../assets/shaders/mesh.h"
 
 #include "vulkan_ng.h"
+#include "gltf_accessor.c"
+#include "gltf_jobs.c"
+#include "meshopt_decode.c"
+#include "gltf_source.c"
+#include "gltf_cook.c"
+#include "gltf_stream.c"
+#include "vertex_quantize.c"
+#include "scene_graph.c"
+
+static bool vk_texture_create(vk_context* context, vk_texture* tex, const u8* pixels, const texture_mip_chain* mips, texture_bc_encoding encoding,
+                              u32 first_level);
 
-static bool vk_texture_load(vk_context* context, arena s, s8 img_uri, s8 gltf_path);
-
-typedef struct vertex vertex;
 typedef struct 
 {
    arena scratch;
 } gltf_user_ctx;
 
-static void meshlet_add_new_vertex_index(u32 index, u8* meshlet_vertices, struct meshlet* ml)
-{
-   if(meshlet_vertices[index] == 0xff)
-   {
-      meshlet_vertices[index] = ml->vertex_count;
-
-      assert(meshlet_vertices[index] < array_count(ml->vertex_index_buffer));
-      // store index into the main vertex buffer
-      ml->vertex_index_buffer[meshlet_vertices[index]] = index;
-      ml->vertex_count++;
-   }
-}
-
-static void meshlet_build(array_meshlet* result, u8* meshlet_vertices, u32* index_buffer, size index_count, u32 index_offset)
-{
-   struct meshlet ml = {0};
-
-   usize max_index_count = array_count(ml.primitive_indices);
-   usize max_vertex_count = array_count(ml.vertex_index_buffer);
-   usize max_triangle_count = max_index_count/3;
-
-   for(size i = 0; i < index_count; i += 3)
-   {
-      // original per primitive (triangle indices)
-      u32 i0 = index_buffer[index_offset + i + 0];
-      u32 i1 = index_buffer[index_offset + i + 1];
-      u32 i2 = index_buffer[index_offset + i + 2];
-
-      // are the mesh vertex indices not used yet
-      bool mi0 = meshlet_vertices[i0] == 0xff;
-      bool mi1 = meshlet_vertices[i1] == 0xff;
-      bool mi2 = meshlet_vertices[i2] == 0xff;
-
-      // flush meshlet if vertexes or primitives overflow
-      if((ml.vertex_count + (mi0 + mi1 + mi2) > max_vertex_count) || 
-         (ml.triangle_count + 1 > max_triangle_count))
-      {
-         arrayp_push(result) = ml;
-
-         // clear the vertex indices used for this meshlet so that they can be used for the next one
-         for(u32 j = 0; j < ml.vertex_count; ++j)
-            meshlet_vertices[ml.vertex_index_buffer[j]] = 0xff;
-
-         // begin another meshlet
-         struct_clear(&ml);
-      }
-
-      meshlet_add_new_vertex_index(i0, meshlet_vertices, &ml);
-      meshlet_add_new_vertex_index(i1, meshlet_vertices, &ml);
-      meshlet_add_new_vertex_index(i2, meshlet_vertices, &ml);
-
-      assert(ml.triangle_count*3 + 2 < array_count(ml.primitive_indices));
-
-      assert(meshlet_vertices[i0] >= 0);
-      assert(meshlet_vertices[i1] >= 0);
-      assert(meshlet_vertices[i2] >= 0);
-
-      assert(meshlet_vertices[i0] <= ml.vertex_count);
-      assert(meshlet_vertices[i1] <= ml.vertex_count);
-      assert(meshlet_vertices[i2] <= ml.vertex_count);
-
-      ml.primitive_indices[ml.triangle_count * 3 + 0] = meshlet_vertices[i0];
-      ml.primitive_indices[ml.triangle_count * 3 + 1] = meshlet_vertices[i1];
-      ml.primitive_indices[ml.triangle_count * 3 + 2] = meshlet_vertices[i2];
-
-      ml.triangle_count++;   // primitive index triplet done
-
-      // within max bounds
-      assert(ml.vertex_count <= max_vertex_count);
-      assert(ml.triangle_count <= max_triangle_count);
-   }
-
-   // add any left over meshlets
-   if(ml.vertex_count > 0)
-      arrayp_push(result) = ml;
-}
-
 #if 0
 // TODO: extract the non-obj parts out of this and reuse for vertex de-duplication
 static vk_buffer_objects obj_load(vk_context* context, arena scratch, tinyobj_attrib_t* attrib)
@@ -274,18 +205,18 @@ static bool texture_descriptor_create(vk_context* context, u32 max_descriptor_co
 {
    arena scratch = context->scratch;
 
-   // descriptor_count image samplers
+   // descriptor_count image samplers per frame
    VkDescriptorPoolSize pool_size =
    {
       .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-      .descriptorCount = max_descriptor_count
+      .descriptorCount = max_descriptor_count * VK_FRAME_MAX
    };
 
-   // one set of image samplers
+   // one set of image samplers per frame, the stream points them at new views as their frames come round
    VkDescriptorPoolCreateInfo pool_info =
    {
        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-       .maxSets = 1,
+       .maxSets = VK_FRAME_MAX,
        .poolSizeCount = 1,
        .pPoolSizes = &pool_size
    };
@@ -353,11 +284,19 @@ static bool texture_descriptor_create(vk_context* context, u32 max_descriptor_co
 
 	if(context->textures.count > 0)
    {
+      u32 descriptor_counts[VK_FRAME_MAX];
+      VkDescriptorSetLayout set_layouts[VK_FRAME_MAX];
+      for(u32 i = 0; i < context->frame_count; ++i)
+      {
+         descriptor_counts[i] = (u32)context->textures.count;  // actual allocate count
+         set_layouts[i] = descriptor_set_layout;
+      }
+
 		VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info =
 		{
 			 .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
-			 .descriptorSetCount = 1,
-			 .pDescriptorCounts = &(u32)context->textures.count, // actual allocate count
+			 .descriptorSetCount = context->frame_count,
+			 .pDescriptorCounts = descriptor_counts,
 		};
 
 		VkDescriptorSetAllocateInfo alloc_info =
@@ -365,12 +304,12 @@ static bool texture_descriptor_create(vk_context* context, u32 max_descriptor_co
 			 .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 			 .pNext = &variable_count_info,
 			 .descriptorPool = descriptor_pool,
-			 .descriptorSetCount = 1,
-			 .pSetLayouts = &descriptor_set_layout,
+			 .descriptorSetCount = context->frame_count,
+			 .pSetLayouts = set_layouts,
 		};
 
-		VkDescriptorSet descriptor_set;
-      if(!vk_valid(vkAllocateDescriptorSets(context->devices.logical, &alloc_info, &descriptor_set)))
+		VkDescriptorSet descriptor_sets[VK_FRAME_MAX];
+      if(!vk_valid(vkAllocateDescriptorSets(context->devices.logical, &alloc_info, descriptor_sets)))
          return false;
 
 		array(VkDescriptorImageInfo) image_infos = {&scratch};
@@ -383,172 +322,374 @@ static bool texture_descriptor_create(vk_context* context, u32 max_descriptor_co
 			image_infos.data[i].sampler = immutable_sampler;
 		}
 
-		VkWriteDescriptorSet write =
-		{
-			 .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			 .dstSet = descriptor_set,
-			 .dstBinding = 0,
-			 .dstArrayElement = 0,
-			 .descriptorCount = (u32)context->textures.count,
-			 .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-			 .pImageInfo = image_infos.data,
-		};
+		VkWriteDescriptorSet writes[VK_FRAME_MAX] = {0};
+      for(u32 i = 0; i < context->frame_count; ++i)
+      {
+         writes[i] = (VkWriteDescriptorSet)
+         {
+             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+             .dstSet = descriptor_sets[i],
+             .dstBinding = 0,
+             .dstArrayElement = 0,
+             .descriptorCount = (u32)context->textures.count,
+             .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+             .pImageInfo = image_infos.data,
+         };
+
+         context->frames[i].texture_set = descriptor_sets[i];
+      }
 
-		context->texture_descriptor.set = descriptor_set;
 		context->texture_descriptor.layout = descriptor_set_layout;
 		context->texture_descriptor.descriptor_pool = descriptor_pool;
+		context->texture_descriptor.sampler = immutable_sampler;
 
-      vkUpdateDescriptorSets(context->devices.logical, 1, &write, 0, 0);
-      vkDestroySampler(context->devices.logical, immutable_sampler, &global_allocator.handle);
+      vkUpdateDescriptorSets(context->devices.logical, context->frame_count, writes, 0, 0);
 	}
+   else
+      vkDestroySampler(context->devices.logical, immutable_sampler, &global_allocator.handle);
 
    return true;
 }
 
-static bool gltf_load_data(cgltf_data** data, s8 gltf_path)
+align_struct gltf_load_options
+{
+   bool recook;         // ignore the cooked scene and write a new one
+   size stream_budget;  // non zero streams the geometry in chunks of at most this many bytes
+   bool texture_trace;  // print the stage timings of every texture job
+   size texture_budget; // non zero uploads only the mip tails and streams the rest within this many bytes
+} gltf_load_options;
+
+// wall clock of the load stages in seconds
+align_struct gltf_load_timings
 {
-   cgltf_options options = {0};
-   cgltf_result gltf_result = cgltf_parse_file(&options, s8_data(gltf_path), data);
+   f64 parse;
+   f64 buffers;
+   f64 validate;
+   f64 jobs;                    // texture decodes, vertex conversion and meshlet builds on all threads, with the texture uploads
+   f64 cook;                    // writing the cooked scene or mapping and checking it
+   f64 texture_finish;          // the stream takes its chains, the rest are freed
+   f64 upload;
+   usize primitive_count;
+   usize bulk_primitive_count;  // primitives converted by the simd path
+   u32 thread_count;
+   u32 ktx2_count;              // cooked textures mapped instead of decoded
+   bool cooked;                 // loaded from the cooked scene
+   bool glb;                    // accessors read the mapped bin chunk in place
+} gltf_load_timings;
+
+static f64 gltf_stage_end(hw_timer* timer, i64* begin)
+{
+   i64 end = timer->time();
+   f64 result = timer->seconds_elapsed(*begin, end);
+   *begin = end;
+
+   return result;
+}
+
+// the source stays open on failure, gltf_source_close cleans up either way
+static bool gltf_load_data(gltf_source* source, arena* s, s8 gltf_path, hw_timer* timer, gltf_load_timings* timings)
+{
+   i64 begin = timer->time();
 
-   if (gltf_result != cgltf_result_success)
+   if(!gltf_source_parse(source))
       return false;
 
-   gltf_result = cgltf_load_buffers(&options, *data, s8_data(gltf_path));
-   if(gltf_result != cgltf_result_success)
-   {
-      cgltf_free(*data);
+   timings->parse = gltf_stage_end(timer, &begin);
+
+   // external buffers of a gltf are read, the bin chunk of a glb is used in place
+   if(!gltf_source_buffers_load(source, s, gltf_path, false))
       return false;
-   }
 
-   gltf_result = cgltf_validate(*data);
-   if(gltf_result != cgltf_result_success)
-   {
-      cgltf_free(*data);
+   timings->buffers = gltf_stage_end(timer, &begin);
+
+   if(cgltf_validate(source->data) != cgltf_result_success)
       return false;
-   }
+
+   timings->validate = gltf_stage_end(timer, &begin);
 
    return true;
 }
 
-static bool gltf_load_mesh(vk_context* context, const cgltf_data* data, s8 gltf_path)
+// maps one image like the hash jobs, embedded images point into the source
+static const u8* gltf_image_map(arena* s, const win32_file_view* source, s8 uri, s8 gltf_path, win32_file_view* file, size* byte_count)
 {
-   arena* a = context->app_storage;
-   arena s = context->scratch;
+   const u8* bytes = gltf_source_image_bytes(source, uri, byte_count);
+   if(!bytes && uri.len > 0 && win32_file_map(file, s8_data(gltf_uri_path(s, uri, gltf_path))))
+   {
+      bytes = file->data;
+      *byte_count = file->size;
+   }
 
-   // preallocate vertices
-   array(vertex) vertices = {&s};
-   array_resize(vertices, gltf_vertex_count(data));
+   return bytes;
+}
 
-   // preallocate indices
-   array(u32) indices = {&s};
-   array_resize(indices, gltf_index_count(data));
+// the hash only picks the candidates, two images are one texture when all of their bytes match
+static bool gltf_image_bytes_equal(arena s, const win32_file_view* source, s8 uri_a, s8 uri_b, s8 gltf_path)
+{
+   win32_file_view file_a = {0}, file_b = {0};
+   size size_a = 0, size_b = 0;
 
-   size index_offset = 0;
-   size vertex_offset = 0;
+   const u8* a = gltf_image_map(&s, source, uri_a, gltf_path, &file_a, &size_a);
+   const u8* b = gltf_image_map(&s, source, uri_b, gltf_path, &file_b, &size_b);
 
-   vk_geometry* geometry = &context->geometry;
-   geometry->mesh_draws.arena = a;
+   const bool result = a && b && size_a == size_b && memcmp(a, b, size_a) == 0;
 
-   for(usize i = 0; i < data->meshes_count; ++i)
+   win32_file_unmap(&file_a);
+   win32_file_unmap(&file_b);
+
+   return result;
+}
+
+// encoded bytes of the images, hashed on the worker threads before anything is decoded
+align_struct gltf_image_hash_jobs
+{
+   const s8* uris;
+   s8 gltf_path;
+   const win32_file_view* source;   // glb the "#offset:size" uris point into
+   u64* hashes;
+   size* sizes;                     // 0 for images that could not be read
+} gltf_image_hash_jobs;
+
+static void gltf_image_hash_job(void* data, u32 job_index, arena* storage)
+{
+   gltf_image_hash_jobs* jobs = data;
+   arena s = *storage;
+
+   size byte_count = 0;
+   win32_file_view file = {0};
+   const u8* bytes = gltf_image_map(&s, jobs->source, jobs->uris[job_index], jobs->gltf_path, &file, &byte_count);
+
+   jobs->hashes[job_index] = bytes ? hash64(bytes, byte_count) : 0;
+   jobs->sizes[job_index] = bytes ? byte_count : 0;
+
+   win32_file_unmap(&file);
+}
+
+// one texture uri per distinct image, copied so they outlive the cgltf data - textures that share an
+// image, and images with the same bytes under different names, are decoded and uploaded once.
+// scene->texture_slots takes the materials from gltf textures to the uris
+static void gltf_texture_uris_build(arena* s, hw_jobs* jobs, hw_timer* timer, const gltf_source* source, gltf_scene* scene, s8 gltf_path)
+{
+   const cgltf_data* data = source->data;
+   const u32 image_count = (u32)data->images_count;
+
+   i64 begin = timer->time();
+
+   scene->texture_uris.arena = s;
+   scene->texture_slots = data->textures_count ? push(s, u32, data->textures_count) : 0;
+
+   if(image_count == 0)
    {
-      cgltf_mesh* gltf_mesh = data->meshes + i;
-      for(usize p = 0; p < gltf_mesh->primitives_count; ++p)
+      for(usize i = 0; i < data->textures_count; ++i)
+         scene->texture_slots[i] = (u32)-1;
+      return;
+   }
+
+   s8* uris = push(s, s8, image_count);
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      cgltf_image* img = data->images + i;
+
+      if(!img->uri)
       {
-         cgltf_primitive* prim = gltf_mesh->primitives + p;
-         assert(prim->type == cgltf_primitive_type_triangles);
+         // images inside a glb are referenced by their byte range
+         uris[i] = gltf_source_image_uri(s, source, img);
+         if(uris[i].len == 0)
+            printf("Unsupported embedded image %u\n", i);
 
-         usize vertex_count = 0;
-         cgltf_accessor* position_accessor = 0;
-         cgltf_accessor* normal_accessor = 0;
-         cgltf_accessor* texcoord_accessor = 0;
+         continue;
+      }
 
-         // parse attribute types
-         for(usize j = 0; j < prim->attributes_count; ++j)
-         {
-            cgltf_attribute* attr = prim->attributes + j;
+      cgltf_decode_uri(img->uri);
 
-            cgltf_attribute_type attr_type;
-            i32 attr_index;
-            cgltf_parse_attribute_type(attr->name, &attr_type, &attr_index);
+      s8 uri = s8(img->uri);
+      uris[i] = (s8){push(s, u8, uri.len + 1), uri.len};
+      memcpy(uris[i].data, uri.data, uri.len);
+   }
 
-            switch(attr_type)
-            {
-               case cgltf_attribute_type_position:
-               position_accessor = attr->data;
-               vertex_count = position_accessor->count;
-               break;
+   gltf_image_hash_jobs hash_jobs = {uris, gltf_path, &source->file, push(s, u64, image_count), push(s, size, image_count)};
+   jobs->parallel_for(jobs, gltf_image_hash_job, &hash_jobs, image_count);
 
-               case cgltf_attribute_type_normal:
-               normal_accessor = attr->data;
-               break;
+   // image to uri, images that could not be read keep their own uri and fail at the decode. a hash
+   // collision keeps its own uri as well
+   u32* image_slots = push(s, u32, image_count);
+   u32* slot_images = push(s, u32, image_count);   // first image of every uri
+   array_resize(scene->texture_uris, image_count);
 
-               case cgltf_attribute_type_texcoord:
-               if(attr_index == 0) // first uv set only
-                  texcoord_accessor = attr->data;
-               break;
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      const u64 hash = hash_jobs.hashes[i];
+      const size byte_count = hash_jobs.sizes[i];
 
-               default:
-               // ignore other attributes (e.g., color, joints, etc.)
+      u32 slot = 0;
+      if(byte_count > 0)
+      {
+         for(; slot < scene->texture_uris.count; ++slot)
+         {
+            const u32 first = slot_images[slot];
+            if(hash_jobs.hashes[first] == hash && hash_jobs.sizes[first] == byte_count &&
+               gltf_image_bytes_equal(*s, &source->file, uris[first], uris[i], gltf_path))
                break;
-            }
          }
+      }
+      else
+         slot = (u32)scene->texture_uris.count;
 
-         // load vertices
-         for(usize k = 0; k < vertex_count; ++k)
-         {
-            vertex vert = {0};
+      if(slot == scene->texture_uris.count)
+      {
+         slot_images[slot] = i;
+         array_add(scene->texture_uris, uris[i]);
+      }
 
-            if(position_accessor)
-            {
-               f32 pos[3] = {0};
-               cgltf_accessor_read_float(position_accessor, k, pos, 3);
-               vert.vx = pos[0];
-               vert.vy = pos[1];
-               vert.vz = pos[2];
-            }
-            if(normal_accessor)
-            {
-               f32 norm[3] = {0};
-               cgltf_accessor_read_float(normal_accessor, k, norm, 3);
-               // pack normals
-               vert.nx = (uint8_t)((norm[0] * 0.5f + 0.5f) * 255.0f);
-               vert.ny = (uint8_t)((norm[1] * 0.5f + 0.5f) * 255.0f);
-               vert.nz = (uint8_t)((norm[2] * 0.5f + 0.5f) * 255.0f);
-            }
-            if(texcoord_accessor)
-            {
-               f32 uv[2] = {0};
-               cgltf_accessor_read_float(texcoord_accessor, k, uv, 2);
-               vert.tu = uv[0];
-               vert.tv = uv[1];
-            }
+      image_slots[i] = slot;
+   }
 
-            array_add(vertices, vert);
-         }
+   for(usize i = 0; i < data->textures_count; ++i)
+   {
+      const cgltf_texture* texture = data->textures + i;
+      scene->texture_slots[i] = texture->image ? image_slots[cgltf_image_index(data, texture->image)] : (u32)-1;
+   }
+
+   size hashed_bytes = 0;
+   for(u32 i = 0; i < image_count; ++i)
+      hashed_bytes += hash_jobs.sizes[i];
 
-         // load indices
-         usize index_count = cgltf_accessor_unpack_indices(prim->indices, indices.data + indices.count, 4, prim->indices->count);
-         indices.count += index_count;
+   printf("Texture images: %zu textures, %u images, %zu distinct by content, hashed %.1f MB in %.2f ms\n",
+          data->textures_count, image_count, scene->texture_uris.count, hashed_bytes / (f64)MB(1), gltf_stage_end(timer, &begin) * 1e3);
+}
 
-         // add this mesh geometry
-         vk_mesh_draw md = {0};
-         md.index_count = index_count;
-         md.index_offset = index_offset;
-         md.vertex_offset = vertex_offset;
-         md.vertex_count = vertex_count;
+// mip flags and roles of a texture from the materials that use it - albedo and emissive are srgb, and
+// the albedo alpha is always alpha tested by the fragment shaders
+static void gltf_texture_use(gltf_load_jobs* load_jobs, u32 texture, u32 mip_flags, u32 role)
+{
+   if(texture < load_jobs->texture_count)
+   {
+      load_jobs->textures[texture].mip_flags |= mip_flags;
+      load_jobs->textures[texture].roles |= role;
+   }
+}
 
-         //array_add(geometry->mesh_draws, md);
-         array_push(geometry->mesh_draws) = md;
+// decode jobs for the texture uris of the scene, embedded images decode from the mapped source. without
+// block compression the roles stay empty and every texture is uploaded as rgba8
+static void gltf_texture_jobs_create(arena* s, gltf_load_jobs* load_jobs, const gltf_scene* scene, s8 gltf_path, const win32_file_view* source,
+                                     bool block_compression, const hw_timer* timer)
+{
+   load_jobs->time = timer->time;
+   load_jobs->texture_count = 0;
+   load_jobs->textures = scene->texture_uris.count ? push(s, gltf_texture_job, scene->texture_uris.count) : 0;
+   load_jobs->ready = scene->texture_uris.count ? push(s, LONG, scene->texture_uris.count) : 0;
 
-         index_offset += index_count;
-         vertex_offset += vertex_count;
+   for(usize i = 0; i < scene->texture_uris.count; ++i)
+   {
+      gltf_texture_job* job = load_jobs->textures + load_jobs->texture_count++;
+      job->encoded = gltf_source_image_bytes(source, scene->texture_uris.data[i], &job->encoded_size);
+      job->path = job->encoded ? gltf_path : gltf_uri_path(s, scene->texture_uris.data[i], gltf_path);
+   }
+
+   for(usize i = 0; i < scene->materials.count; ++i)
+   {
+      const struct material* m = scene->materials.data + i;
+
+      const u32 roles = block_compression ? ~0u : 0;
+
+      gltf_texture_use(load_jobs, m->albedo, texture_mip_srgb | texture_mip_alpha_test, roles & gltf_texture_color);
+      gltf_texture_use(load_jobs, m->emissive, texture_mip_srgb, roles & gltf_texture_color);
+      gltf_texture_use(load_jobs, m->normal, 0, roles & gltf_texture_normal);
+      gltf_texture_use(load_jobs, m->metal, 0, roles & gltf_texture_metal_roughness);
+      gltf_texture_use(load_jobs, m->ao, 0, roles & gltf_texture_occlusion);
+   }
+}
+
+// world matrices of all the nodes from one pass over the sorted hierarchy
+static bool gltf_scene_graph_build(scene_graph* graph, arena* s, const cgltf_data* data)
+{
+   const u32 node_count = (u32)data->nodes_count;
+   u32* parents = node_count ? push(s, u32, node_count) : 0;
+
+   for(u32 i = 0; i < node_count; ++i)
+      parents[i] = data->nodes[i].parent ? (u32)cgltf_node_index(data, data->nodes[i].parent) : SCENE_GRAPH_ROOT;
+
+   if(!scene_graph_build(graph, s, parents, node_count))
+      return false;
+
+   for(u32 i = 0; i < node_count; ++i)
+   {
+      const cgltf_node* node = data->nodes + i;
+
+      // gltf requires matrices to be decomposable to trs
+      if(node->has_matrix)
+      {
+         f32 translation[3], rotation[4], scale[3];
+         transform_decompose(translation, rotation, scale, node->matrix);
+         scene_graph_local_set(graph, graph->sorted[i], translation, rotation, scale);
       }
+      else
+         scene_graph_local_set(graph, graph->sorted[i], node->has_translation ? node->translation : 0,
+                               node->has_rotation ? node->rotation : 0, node->has_scale ? node->scale : 0);
    }
 
-   if(data->cameras_count == 0)
-      printf("No camera in the scene: %s\n", s8_data(gltf_path));
+   scene_graph_update(graph);
 
-   geometry->mesh_instances.arena = a;
+   return true;
+}
+
+// texture index of a gltf texture view, -1 without one
+static u32 gltf_material_texture(const cgltf_data* data, const gltf_scene* scene, const cgltf_texture* texture)
+{
+   return texture ? scene->texture_slots[cgltf_texture_index(data, texture)] : (u32)-1;
+}
+
+// materials with the same textures collapse to one entry, primitives without a material share
+// an untextured one. returns the scene material of every gltf material, the last for none
+static u32* gltf_materials_build(arena* s, const cgltf_data* data, gltf_scene* scene)
+{
+   scene->materials.arena = s;
+
+   const usize count = data->materials_count;
+   u32* remap = push(s, u32, count + 1);
+
+   // materials_count is small, a linear search over the unique ones is enough
+   for(usize i = 0; i <= count; ++i)
+   {
+      struct material m = {(u32)-1, (u32)-1, (u32)-1, (u32)-1, (u32)-1};
+
+      if(i < count)
+      {
+         const cgltf_material* material = data->materials + i;
+
+         m.albedo = gltf_material_texture(data, scene, material->pbr_metallic_roughness.base_color_texture.texture);
+         m.normal = gltf_material_texture(data, scene, material->normal_texture.texture);
+         m.metal = gltf_material_texture(data, scene, material->pbr_metallic_roughness.metallic_roughness_texture.texture);
+         m.emissive = gltf_material_texture(data, scene, material->emissive_texture.texture);
+         m.ao = gltf_material_texture(data, scene, material->occlusion_texture.texture);
+      }
+
+      usize unique = 0;
+      while(unique < scene->materials.count && memcmp(scene->materials.data + unique, &m, sizeof(m)) != 0)
+         unique++;
+
+      if(unique == scene->materials.count)
+         array_push(scene->materials) = m;
+
+      remap[i] = (u32)unique;
+   }
+
+   return remap;
+}
+
+// one instance per primitive of every node with a mesh
+static bool gltf_mesh_instances_build(arena* s, const cgltf_data* data, gltf_scene* scene)
+{
+   u32* material_remap = gltf_materials_build(s, data, scene);
+
+   scene->mesh_instances.arena = s;
+
+   scene_graph graph = {0};
+   if(!gltf_scene_graph_build(&graph, s, data))
+   {
+      printf("Could not build the mesh instances of the gltf nodes\n");
+      return false;
+   }
 
    for(usize i = 0; i < data->nodes_count; ++i)
    {
@@ -564,198 +705,754 @@ static bool gltf_load_mesh(vk_context* context, const cgltf_data* data, s8 gltf_
       if(node->mesh)
       {
          cgltf_mesh* mesh = node->mesh;
+         const mat4 wm = graph.world[graph.sorted[i]];
 
          for(cgltf_size pi = 0; pi < mesh->primitives_count; ++pi)
          {
             cgltf_primitive* prim = mesh->primitives + pi;
             cgltf_material* material = prim->material;
 
-            mat4 wm = {0};
-            cgltf_node_transform_world(node, wm.data);
-
             vk_mesh_instance mi = {0};
             u32 mesh_index = (u32)cgltf_mesh_index(data, mesh);
             // index into the mesh to draw
             mi.mesh_index = mesh_index + (u32)pi;
             mi.world = wm;
+            mi.material = material_remap[material ? cgltf_material_index(data, material) : data->materials_count];
+
+            //array_add(scene->mesh_instances, mi);
+            array_push(scene->mesh_instances) = mi;
+         }
+      }
+   }
 
-            cgltf_size albedo_index = material && material->pbr_metallic_roughness.base_color_texture.texture
-               ? cgltf_texture_index(data, material->pbr_metallic_roughness.base_color_texture.texture)
-               : -1;
+   return true;
+}
 
-            cgltf_size normal_index = material && material->normal_texture.texture
-               ? cgltf_texture_index(data, material->normal_texture.texture)
-               : -1;
+// time the texture jobs spent in each stage summed over the threads, and with per_texture every job in
+// the order the jobs finished
+static void gltf_texture_trace_report(const hw_timer* timer, const gltf_load_jobs* load_jobs, bool per_texture)
+{
+   if(!load_jobs->time || !load_jobs->ready || load_jobs->texture_count == 0)
+      return;
 
-            cgltf_size ao_index = material && material->occlusion_texture.texture
-               ? cgltf_texture_index(data, material->occlusion_texture.texture)
-               : -1;
+   const f64 ms = 1e3;
 
-            cgltf_size metal_index = material && material->pbr_metallic_roughness.metallic_roughness_texture.texture
-               ? cgltf_texture_index(data, material->pbr_metallic_roughness.metallic_roughness_texture.texture)
-               : -1;
+   f64 decode = 0, mips = 0, compress = 0;
+   i64 first = load_jobs->textures[0].trace.begin, last = load_jobs->textures[0].trace.finished;
 
-            cgltf_size emissive_index = material && material->emissive_texture.texture
-               ? cgltf_texture_index(data, material->emissive_texture.texture)
-               : -1;
+   for(u32 i = 0; i < load_jobs->texture_count; ++i)
+   {
+      const gltf_texture_trace* t = &load_jobs->textures[i].trace;
 
-            mi.albedo = (u32)albedo_index;
-            mi.normal = (u32)normal_index;
-            mi.metal = (u32)metal_index;
-            mi.ao = (u32)ao_index;
-            mi.emissive = (u32)emissive_index;
+      decode += timer->seconds_elapsed(t->begin, t->decoded);
+      mips += timer->seconds_elapsed(t->decoded, t->filtered);
+      compress += timer->seconds_elapsed(t->filtered, t->finished);
+      first = min(first, t->begin);
+      last = max(last, t->finished);
+   }
 
-            //array_add(geometry->mesh_instances, mi);
-            array_push(geometry->mesh_instances) = mi;
-         }
+   if(per_texture)
+      for(u32 i = 0; i < load_jobs->texture_count; ++i)
+      {
+         const u32 index = (u32)load_jobs->ready[i] - 1;
+         const gltf_texture_job* job = load_jobs->textures + index;
+         const gltf_texture_trace* t = &job->trace;
+
+         printf("Texture %u %s: %dx%d %s, decode %.2f ms, mips %.2f ms, compress %.2f ms, finished at %.2f ms\n",
+                index, s8_data(job->path), job->width, job->height, texture_bc_format_names[job->encoding.format],
+                timer->seconds_elapsed(t->begin, t->decoded) * ms, timer->seconds_elapsed(t->decoded, t->filtered) * ms,
+                timer->seconds_elapsed(t->filtered, t->finished) * ms, timer->seconds_elapsed(first, t->finished) * ms);
       }
+
+   printf("Texture jobs: decode %.2f ms, mips %.2f ms, compress %.2f ms summed over the threads, %.2f ms from the first start to the last finish\n",
+          decode * ms, mips * ms, compress * ms, timer->seconds_elapsed(first, last) * ms);
+}
+
+// slots for the textures of the load jobs and the stream, before the jobs that fill them run. the slots of
+// textures that fail to upload stay empty
+static void gltf_textures_prepare(vk_context* context, const gltf_load_jobs* load_jobs, size texture_budget)
+{
+   context->textures.arena = context->app_storage;
+   if(load_jobs->texture_count > 0)
+      array_resize(context->textures, load_jobs->texture_count);
+   context->textures.count = load_jobs->texture_count;
+
+   // streamed textures upload their tails and keep the chains for the finer levels
+   if(texture_budget > 0 && load_jobs->texture_count > 0)
+   {
+      texture_stream* stream = push(context->app_storage, texture_stream, 1);
+      texture_stream_init(stream, context->app_storage, load_jobs->texture_count, texture_budget);
+      context->texture_stream = stream;
+      context->streamed_textures = push(context->app_storage, vk_streamed_texture, load_jobs->texture_count);
+
+      // a texture is swapped once per frame at most
+      for(u32 i = 0; i < VK_FRAME_MAX; ++i)
+         context->frames[i].retired = push(context->app_storage, vk_texture, load_jobs->texture_count);
    }
+}
 
-   // preallocate textures
-   context->textures.arena = a;
-   array_resize(context->textures, data->textures_count);
+// runs the load jobs on all threads while the caller uploads every texture as soon as its job publishes it,
+// and runs jobs itself when none is ready. the pixels stay for the cook and gltf_textures_finish
+static void gltf_load_jobs_run(vk_context* context, gltf_load_jobs* load_jobs, u32 job_count)
+{
+   hw_jobs* jobs = context->jobs;
 
-   for(usize i = 0; i < data->textures_count; ++i)
+   gltf_load_jobs_rewind(load_jobs);
+   jobs->parallel_begin(jobs, gltf_load_job, load_jobs, job_count);
+
+   bool uploaded = true;
+   for(u32 next = 0; uploaded && next < load_jobs->texture_count;)
    {
-      cgltf_texture* cgltf_tex = data->textures + i;
-      assert(cgltf_tex->image);
+      const LONG ready = load_jobs->ready[next];
+      if(ready == 0)
+      {
+         // the jobs left are running on the workers
+         if(!jobs->parallel_help(jobs))
+            SwitchToThread();
 
-      cgltf_image* img = cgltf_tex->image;
-      assert(img->uri);
+         continue;
+      }
 
-      cgltf_decode_uri(img->uri);
+      const u32 index = (u32)ready - 1;
+      const gltf_texture_job* job = load_jobs->textures + index;
+      const u32 first_level = context->texture_stream && job->pixels ? texture_stream_tail_level(&job->mips) : 0;
 
       // TODO: pass just textures, devices instead of entire context
-      if(!vk_texture_load(context, s, s8(img->uri), gltf_path))
-         return false;
+      if(!vk_texture_create(context, context->textures.data + index, job->pixels, &job->mips, job->encoding, first_level))
+      {
+         printf("Bad or missing texture: %s\n", s8_data(job->path));
+         uploaded = false;
+      }
+
+      next++;
    }
 
-   size max_vertex_count = 0;
-   const size mesh_draws_count = geometry->mesh_draws.count;
-   for(size i = 0; i < mesh_draws_count; ++i)
+   jobs->parallel_wait(jobs);
+}
+
+// after the jobs and the cook, the stream takes the chains of its textures and the rest are freed
+static bool gltf_textures_finish(vk_context* context, const gltf_load_jobs* load_jobs, bool trace)
+{
+   gltf_texture_trace_report(context->timer, load_jobs, trace);
+
+   texture_stream* stream = context->texture_stream;
+
+   bool textures_uploaded = true;
+   for(u32 i = 0; i < load_jobs->texture_count; ++i)
+      textures_uploaded = textures_uploaded && vk_valid_handle(context->textures.data[i].image.handle);
+
+   size texture_bytes = 0, rgba_bytes = 0;
+   u32 format_counts[texture_bc_format_count] = {0};
+
+   // the stream indexes its textures like the slots
+   for(u32 i = 0; i < load_jobs->texture_count; ++i)
    {
-      size vertex_count = geometry->mesh_draws.data[i].vertex_count;
-      if(vertex_count > max_vertex_count)
-         max_vertex_count = vertex_count;
+      gltf_texture_job* job = load_jobs->textures + i;
+
+      if(job->pixels)
+      {
+         texture_bytes += job->mips.size;
+         rgba_bytes += vk_texture_size(job->mips.levels[0].width, job->mips.levels[0].height, job->mips.level_count);
+         format_counts[job->encoding.format]++;
+      }
+
+      // keep freeing the decoded pixels after a failure
+      if(!stream || !textures_uploaded)
+      {
+         gltf_texture_job_release(job);
+         continue;
+      }
+
+      texture_stream_add(stream, job->pixels, &job->mips, job->encoding)->ktx2 = job->ktx2;
+      job->ktx2 = (win32_file_view){0};
+      job->pixels = 0;
    }
 
-   u8* meshlet_vertices = push(&s, u8, max_vertex_count);
+   printf("Textures: %.1f MB (%.1f MB as rgba8) - %u rgba8, %u bc1, %u bc3, %u bc4, %u bc5\n",
+          texture_bytes / (f64)MB(1), rgba_bytes / (f64)MB(1), format_counts[texture_bc_none], format_counts[texture_bc1],
+          format_counts[texture_bc3], format_counts[texture_bc4], format_counts[texture_bc5]);
+
+   if(stream)
+      printf("Texture streaming: %.1f MB of mip tails resident, %.1f MB budget\n", stream->resident_bytes / (f64)MB(1), stream->budget / (f64)MB(1));
+
+   return textures_uploaded;
+}
+
+// everything but the buffer uploads, the scene and the decoded textures live in the scratch arena. the
+// textures upload while the jobs run
+static bool gltf_scene_build(arena* s, vk_context* context, const gltf_source* source, s8 gltf_path, gltf_scene* scene,
+                             gltf_load_jobs* load_jobs, gltf_load_timings* timings, size texture_budget)
+{
+   const cgltf_data* data = source->data;
+   hw_jobs* jobs = context->jobs;
+   hw_timer* timer = context->timer;
+
+   // preallocate vertices
+   scene->vertices.arena = s;
+   array_resize(scene->vertices, gltf_vertex_count(data));
+
+   // preallocate indices
+   scene->indices.arena = s;
+   array_resize(scene->indices, gltf_index_count(data));
+
+   size index_offset = 0;
+   size vertex_offset = 0;
+
+   scene->mesh_draws.arena = s;
+
+   gltf_primitive_jobs_create(s, data, load_jobs);
+
+   for(u32 i = 0; i < load_jobs->primitive_count; ++i)
+   {
+      // vertices, indices and meshlets of this primitive are built by a job
+      gltf_primitive_job* job = load_jobs->primitives + i;
+      job->vertices = scene->vertices.data + scene->vertices.count;
+      job->indices = scene->indices.data + scene->indices.count;
 
-   context->meshlet_counts.arena = a;
-   array_resize(context->meshlet_counts, mesh_draws_count);
+      usize index_count = job->index_accessor->count;
 
-   context->meshlet_offsets.arena = a;
-   array_resize(context->meshlet_offsets, mesh_draws_count);
+      scene->vertices.count += job->vertex_count;
+      scene->indices.count += index_count;
 
-   context->vertex_offsets.arena = a;
-   array_resize(context->vertex_offsets, mesh_draws_count);
+      // add this mesh geometry
+      vk_mesh_draw md = {0};
+      md.index_count = index_count;
+      md.index_offset = index_offset;
+      md.vertex_offset = vertex_offset;
+      md.vertex_count = job->vertex_count;
+      gltf_position_grid(job->position, md.position_center, md.position_extent);
 
-   context->meshlets.arena = a;
-   array_resize(context->meshlets, max_vertex_count);
+      //array_add(scene->mesh_draws, md);
+      array_push(scene->mesh_draws) = md;
+
+      index_offset += index_count;
+      vertex_offset += job->vertex_count;
+   }
+
+   if(data->cameras_count == 0)
+      printf("No camera in the scene: %s\n", s8_data(gltf_path));
+
+   // the materials index the distinct textures
+   gltf_texture_uris_build(s, jobs, timer, source, scene, gltf_path);
+
+   if(!gltf_mesh_instances_build(s, data, scene))
+      return false;
+
+   gltf_texture_jobs_create(s, load_jobs, scene, gltf_path, &source->file, context->features.block_compression_supported, timer);
+   gltf_textures_prepare(context, load_jobs, texture_budget);
+
+   i64 begin = timer->time();
+
+   // everything up to the buffer uploads runs on the worker threads
+   gltf_load_jobs_run(context, load_jobs, load_jobs->texture_count + load_jobs->primitive_count);
+
+   timings->jobs = gltf_stage_end(timer, &begin);
+
+   const size mesh_draws_count = scene->mesh_draws.count;
+   assert(mesh_draws_count == load_jobs->primitive_count);
+
+   size meshlet_count = 0;
+   for(u32 i = 0; i < load_jobs->primitive_count; ++i)
+   {
+      meshlet_count += load_jobs->primitives[i].meshlets.count;
+
+      timings->primitive_count++;
+      timings->bulk_primitive_count += load_jobs->primitives[i].bulk;
+   }
+
+   scene->meshlet_counts.arena = s;
+   array_resize(scene->meshlet_counts, mesh_draws_count);
+
+   scene->meshlet_offsets.arena = s;
+   array_resize(scene->meshlet_offsets, mesh_draws_count);
+
+   scene->vertex_offsets.arena = s;
+   array_resize(scene->vertex_offsets, mesh_draws_count);
+
+   scene->meshlets.arena = s;
+   array_resize(scene->meshlets, meshlet_count);
 
    size meshlet_offset = 0;
    vertex_offset = 0;
 
+   // gather the meshlets from the worker storage in draw order
    for(size i = 0; i < mesh_draws_count; ++i)
    {
-      // 0xff means the vertex index is not in use yet
-      pointer_clear_to(meshlet_vertices, 0xff, max_vertex_count);
+      const array_meshlet* meshlets = &load_jobs->primitives[i].meshlets;
 
-      size vertex_count = geometry->mesh_draws.data[i].vertex_count;
-      size index_count = geometry->mesh_draws.data[i].index_count;
+      if(meshlets->count > 0)
+         memcpy(scene->meshlets.data + scene->meshlets.count, meshlets->data, meshlets->count * sizeof(meshlet));
+      scene->meshlets.count += meshlets->count;
 
-      array_meshlet meshlets = {a};
-      meshlet_build(&meshlets, meshlet_vertices, indices.data, index_count,
-                    (u32)geometry->mesh_draws.data[i].index_offset);
+      array_add(scene->meshlet_counts, meshlets->count);
+      array_add(scene->meshlet_offsets, meshlet_offset);
+      array_add(scene->vertex_offsets, vertex_offset);
 
-      for(size j = 0; j < meshlets.count; ++j)
-         array_add(context->meshlets, meshlets.data[j]);
+      meshlet_offset += meshlets->count;
+      vertex_offset += scene->mesh_draws.data[i].vertex_count;
+   }
 
-      array_add(context->meshlet_counts, meshlets.count);
-      array_add(context->meshlet_offsets, meshlet_offset);
-      array_add(context->vertex_offsets, vertex_offset);
+   return true;
+}
 
-      meshlet_offset += meshlets.count;
-      vertex_offset += vertex_count;
-   }
+// copies a scene array into persistent storage, the scene may view a mapped file
+static void gltf_array_copy(array* to, const array* from, size stride, arena* a)
+{
+   to->arena = a;
+   to->count = from->count;
+   to->data = from->count > 0 ? alloc(a, stride, custom_alignment, from->count, 0) : 0;
 
-   usize mb_size = context->meshlets.count * sizeof(meshlet);
-   usize vb_size = vertices.count * sizeof(vertex);
-   usize ib_size = indices.count * sizeof(u32);
+   if(from->count > 0)
+      memcpy(to->data, from->data, from->count * stride);
+}
 
-   vk_buffer scratch_buffer = {0};
-   vk_buffer mb = {.size = mb_size};
-   vk_buffer vb = {.size = vb_size};
-   vk_buffer ib = {.size = ib_size};
+// per draw and per instance tables of the renderer
+static void gltf_scene_tables_copy(vk_context* context, const gltf_scene* scene)
+{
+   arena* a = context->app_storage;
+   vk_geometry* geometry = &context->geometry;
 
-   VkBufferUsageFlagBits buffer_usage_flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+   gltf_array_copy((array*)&geometry->mesh_draws, (const array*)&scene->mesh_draws, sizeof(vk_mesh_draw), a);
+   gltf_array_copy((array*)&geometry->mesh_instances, (const array*)&scene->mesh_instances, sizeof(vk_mesh_instance), a);
+   gltf_array_copy((array*)&geometry->materials, (const array*)&scene->materials, sizeof(struct material), a);
+   gltf_array_copy((array*)&context->meshlet_counts, (const array*)&scene->meshlet_counts, sizeof(size), a);
+   gltf_array_copy((array*)&context->meshlet_offsets, (const array*)&scene->meshlet_offsets, sizeof(size), a);
+   gltf_array_copy((array*)&context->vertex_offsets, (const array*)&scene->vertex_offsets, sizeof(size), a);
+}
+
+// storage buffers the mesh, vertex and ray tracing passes read
+static bool gltf_geometry_buffer_create(vk_context* context, vk_buffer* buffer, VkBufferUsageFlags usage)
+{
+   usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
 
    if(context->features.raytracing_supported)
-      buffer_usage_flags |= (VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR);
+      usage |= (VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR);
+
+   return vk_buffer_create_and_bind(buffer, &context->devices, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+// the vertices the gpu reads - with VERTEX_QUANTIZED they are encoded per mesh draw into s and the
+// bounds go to the draws, otherwise the float vertices are used as they are. draws that already have
+// bounds keep them, those are the integer grids of quantized positions.
+// draw vertex offsets are relative to first_vertex
+static const void* gltf_vertices_encode(arena* s, const vertex* vertices, usize vertex_count, vk_mesh_draw* draws, usize draw_count,
+                                        usize first_vertex, vertex_quantize_error* error)
+{
+   const void* result = vertices;
+   vertex_quantized* quantized = VERTEX_QUANTIZED && vertex_count > 0 ? push(s, vertex_quantized, vertex_count) : 0;
+
+   for(usize i = 0; i < draw_count; ++i)
+   {
+      vk_mesh_draw* draw = draws + i;
+      const vertex* in = vertices + (draw->vertex_offset - first_vertex);
+
+      vertex_quantize_bounds bounds = {.extent = {1.0f, 1.0f, 1.0f}};
+      if(quantized)
+      {
+         vertex_quantized* out = quantized + (draw->vertex_offset - first_vertex);
+
+         if(draw->position_extent[0] > 0.0f)
+         {
+            memcpy(bounds.center, draw->position_center, sizeof(bounds.center));
+            memcpy(bounds.extent, draw->position_extent, sizeof(bounds.extent));
+         }
+         else
+            bounds = vertex_quantize_bounds_compute(in, draw->vertex_count);
+
+         vertex_quantize(out, in, draw->vertex_count, bounds);
+         vertex_quantize_error_measure(error, out, in, draw->vertex_count, bounds);
+      }
+
+      memcpy(draw->position_center, bounds.center, sizeof(bounds.center));
+      memcpy(draw->position_extent, bounds.extent, sizeof(bounds.extent));
+   }
+
+   return quantized ? quantized : result;
+}
+
+static void gltf_vertices_report(const vertex_quantize_error* error)
+{
+   if(!VERTEX_QUANTIZED || error->vertex_count == 0)
+      return;
+
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("Quantized %zu vertices to %zu bytes each: %.2f MB instead of %.2f MB, max error position %g (%.2e of the mesh extent), "
+          "normal %.3f degrees, uv %g\n",
+          error->vertex_count, sizeof(vertex_quantized), error->vertex_count*sizeof(vertex_quantized) * mb,
+          error->vertex_count*sizeof(vertex) * mb, error->position_max, error->position_max_relative,
+          error->normal_max_degrees, error->uv_max);
+}
+
+// s is what is left of the scratch after the scene
+static bool gltf_scene_upload(vk_context* context, arena s, const gltf_scene* scene)
+{
+   gltf_scene_tables_copy(context, scene);
+   gltf_array_copy((array*)&context->meshlets, (const array*)&scene->meshlets, sizeof(meshlet), context->app_storage);
+
+   vertex_quantize_error quantize_error = {0};
+   const void* vertices = gltf_vertices_encode(&s, scene->vertices.data, scene->vertices.count, context->geometry.mesh_draws.data,
+                                               context->geometry.mesh_draws.count, 0, &quantize_error);
+   gltf_vertices_report(&quantize_error);
+
+   vk_buffer vb = {.size = scene->vertices.count * sizeof(vertex_gpu)};
+   vk_buffer mb = {.size = scene->meshlets.count * sizeof(meshlet)};
+   vk_buffer ib = {.size = scene->indices.count * sizeof(u32)};
 
    // vertex data
-   if(!vk_buffer_create_and_bind(&vb, &context->devices, buffer_usage_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+   if(!gltf_geometry_buffer_create(context, &vb, 0))
       return false;
 
-   scratch_buffer.size = vb.size;
-   if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+   vk_buffer_upload(context, &vb, vertices);
+   buffer_hash_insert(&context->buffer_table, vb_buffer_name, vb);
+
+   // meshlet data
+   if(!gltf_geometry_buffer_create(context, &mb, 0))
       return false;
 
-   vk_buffer_upload(context, &vb, vertices.data);
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
+   vk_buffer_upload(context, &mb, scene->meshlets.data);
+   buffer_hash_insert(&context->buffer_table, mb_buffer_name, mb);
 
-   buffer_hash_insert(&context->buffer_table, vb_buffer_name, vb);
+   // index data
+   if(!gltf_geometry_buffer_create(context, &ib, VK_BUFFER_USAGE_INDEX_BUFFER_BIT))
+      return false;
 
-   // meshlet data
-   if (!vk_buffer_create_and_bind(&mb, &context->devices, buffer_usage_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+   vk_buffer_upload(context, &ib, scene->indices.data);
+   buffer_hash_insert(&context->buffer_table, ib_buffer_name, ib);
+
+   return true;
+}
+
+// cold load - parse the gltf, build the scene on all threads and cook it for the next launch
+static bool gltf_scene_cook(arena* s, vk_context* context, gltf_source* source, gltf_scene* scene, gltf_load_jobs* load_jobs,
+                            s8 gltf_path, s8 cook_path, u64 source_hash, gltf_load_timings* timings, size texture_budget)
+{
+   if(!gltf_load_data(source, s, gltf_path, context->timer, timings))
+   {
+      printf("Could not load gltf: %s\n", s8_data(gltf_path));
       return false;
+   }
 
-   scratch_buffer.size = mb.size;
-   if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+   if(!gltf_scene_build(s, context, source, gltf_path, scene, load_jobs, timings, texture_budget))
+   {
+      printf("Could not load mesh in gltf: %s\n", s8_data(gltf_path));
       return false;
+   }
 
-   vk_buffer_upload(context, &mb, context->meshlets.data);
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
+   // the textures are decoded, nothing reads the source past the build
+   gltf_source_close(source);
 
-   buffer_hash_insert(&context->buffer_table, mb_buffer_name, mb);
+   i64 begin = context->timer->time();
 
-   // index data
-   buffer_usage_flags |= VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-   if (!vk_buffer_create_and_bind(&ib, &context->devices, buffer_usage_flags, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+   // a failed cook only costs the next launch another cold load
+   gltf_cook_write(*s, scene, cook_path, source_hash);
+   gltf_cook_textures_write(*s, load_jobs, cook_path);
+
+   timings->cook = gltf_stage_end(context->timer, &begin);
+
+   return true;
+}
+
+align_struct gltf_stream_upload
+{
+   vk_context* context;
+   gltf_scene* scene;      // draw tables, preallocated for every primitive
+   const gltf_primitive_job* primitives;
+   vk_buffer vb;
+   vk_buffer ib;
+   vk_buffer mb;           // grows with the chunks, trimmed at the end
+   vertex_quantize_error quantize_error;
+} gltf_stream_upload;
+
+// keeps the uploaded meshlets and doubles the capacity
+static bool gltf_stream_meshlets_reserve(gltf_stream_upload* upload, usize meshlet_count)
+{
+   const size needed = meshlet_count * sizeof(meshlet);
+   if(needed <= upload->mb.size)
+      return true;
+
+   vk_context* context = upload->context;
+   vk_buffer grown = {.size = max(needed, 2*upload->mb.size)};
+
+   if(!gltf_geometry_buffer_create(context, &grown, 0))
       return false;
 
-   scratch_buffer.size = ib.size;
-   if(!vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+   if(upload->mb.handle)
+   {
+      vk_buffer_copy(context, upload->mb.handle, grown.handle, 0, 0, upload->mb.size);
+      vk_buffer_destroy(&context->devices, &upload->mb);
+   }
+
+   upload->mb = grown;
+
+   return true;
+}
+
+static bool gltf_stream_chunk_upload(void* user, const gltf_stream_chunk* chunk)
+{
+   gltf_stream_upload* upload = user;
+   vk_context* context = upload->context;
+   gltf_scene* scene = upload->scene;
+
+   if(!gltf_stream_meshlets_reserve(upload, chunk->meshlet_offset + chunk->meshlet_count))
       return false;
 
-   vk_buffer_upload(context, &ib, indices.data);
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
+   if(chunk->index_count > 0)
+      vk_buffer_upload_range(context, &upload->ib, chunk->index_offset*sizeof(u32), chunk->indices, chunk->index_count*sizeof(u32));
+   if(chunk->meshlet_count > 0)
+      vk_buffer_upload_range(context, &upload->mb, chunk->meshlet_offset*sizeof(meshlet), chunk->meshlets, chunk->meshlet_count*sizeof(meshlet));
 
-   buffer_hash_insert(&context->buffer_table, ib_buffer_name, ib);
+   for(u32 i = 0; i < chunk->draw_count; ++i)
+   {
+      const gltf_stream_draw* draw = chunk->draws + i;
+
+      vk_mesh_draw md = {0};
+      md.index_count = draw->index_count;
+      md.index_offset = draw->index_offset;
+      md.vertex_offset = draw->vertex_offset;
+      md.vertex_count = draw->vertex_count;
+      gltf_position_grid(upload->primitives[chunk->first_draw + i].position, md.position_center, md.position_extent);
+
+      array_add(scene->mesh_draws, md);
+      array_add(scene->meshlet_counts, draw->meshlet_count);
+      array_add(scene->meshlet_offsets, draw->meshlet_offset);
+      array_add(scene->vertex_offsets, draw->vertex_offset);
+   }
+
+   const void* vertices = gltf_vertices_encode(chunk->scratch, chunk->vertices, chunk->vertex_count, scene->mesh_draws.data + chunk->first_draw,
+                                               chunk->draw_count, chunk->vertex_offset, &upload->quantize_error);
+   if(chunk->vertex_count > 0)
+      vk_buffer_upload_range(context, &upload->vb, chunk->vertex_offset*sizeof(vertex_gpu), vertices, chunk->vertex_count*sizeof(vertex_gpu));
 
    return true;
 }
 
-static bool gltf_load(vk_context* context, s8 gltf_path)
+// converts, meshletizes and uploads the primitives in chunks that fit the stream budget of scratch
+static bool gltf_load_streamed(vk_context* context, s8 gltf_path, gltf_load_options options)
 {
-   cgltf_data* data = 0;
+   arena s = context->scratch;
+   hw_timer* timer = context->timer;
+   hw_jobs* jobs = context->jobs;
+
+   i64 begin = timer->time();
+   i64 load_begin = begin;
+
+   // the source buffers are mapped instead of read so the os pages them in and out
+   gltf_source source = {0};
+   bool result = gltf_source_open(&source, gltf_path) &&
+                 gltf_source_parse(&source) &&
+                 gltf_source_buffers_load(&source, &s, gltf_path, true) &&
+                 cgltf_validate(source.data) == cgltf_result_success;
+
+   const cgltf_data* data = source.data;
+
+   f64 parse_seconds = gltf_stage_end(timer, &begin);
 
-   if(!gltf_load_data(&data, gltf_path))
+   gltf_scene scene = {0};
+   gltf_load_jobs load_jobs = {0};
+   gltf_stream_stats stats = {0};
+   f64 texture_seconds = 0;
+
+   if(result)
+   {
+      // textures are not budgeted, they are decoded and uploaded up front. the materials tell
+      // which ones are colors
+      gltf_texture_uris_build(&s, jobs, timer, &source, &scene, gltf_path);
+      result = gltf_mesh_instances_build(&s, data, &scene);
+   }
+
+   if(result)
+   {
+      gltf_texture_jobs_create(&s, &load_jobs, &scene, gltf_path, &source.file, context->features.block_compression_supported,
+                               context->timer);
+      gltf_textures_prepare(context, &load_jobs, options.texture_budget);
+      gltf_load_jobs_run(context, &load_jobs, load_jobs.texture_count);
+
+      result = gltf_textures_finish(context, &load_jobs, options.texture_trace);
+      texture_seconds = gltf_stage_end(timer, &begin);
+   }
+
+   if(result)
+   {
+      gltf_primitive_jobs_create(&s, data, &load_jobs);
+
+      const u32 primitive_count = load_jobs.primitive_count;
+
+      scene.mesh_draws.arena = &s;
+      scene.meshlet_counts.arena = &s;
+      scene.meshlet_offsets.arena = &s;
+      scene.vertex_offsets.arena = &s;
+
+      if(primitive_count > 0)
+      {
+         array_resize(scene.mesh_draws, primitive_count);
+         array_resize(scene.meshlet_counts, primitive_count);
+         array_resize(scene.meshlet_offsets, primitive_count);
+         array_resize(scene.vertex_offsets, primitive_count);
+      }
+
+      gltf_stream_upload upload = {.context = context, .scene = &scene, .primitives = load_jobs.primitives};
+      upload.vb.size = gltf_vertex_count(data) * sizeof(vertex_gpu);
+      upload.ib.size = gltf_index_count(data) * sizeof(u32);
+
+      result = gltf_geometry_buffer_create(context, &upload.vb, 0) &&
+               gltf_geometry_buffer_create(context, &upload.ib, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+
+      // the chunks reuse whatever scratch is left
+      result = result && gltf_stream_primitives(s, jobs, load_jobs.primitives, primitive_count, options.stream_budget,
+                                                load_jobs.limits, gltf_stream_chunk_upload, &upload, &stats);
+
+      // trim the meshlet buffer to what was built
+      if(result && upload.mb.size > stats.meshlet_count*sizeof(meshlet))
+      {
+         vk_buffer mb = {.size = stats.meshlet_count*sizeof(meshlet)};
+         result = gltf_geometry_buffer_create(context, &mb, 0);
+
+         if(result)
+         {
+            vk_buffer_copy(context, upload.mb.handle, mb.handle, 0, 0, mb.size);
+            vk_buffer_destroy(&context->devices, &upload.mb);
+            upload.mb = mb;
+         }
+      }
+
+      if(result)
+      {
+         buffer_hash_insert(&context->buffer_table, vb_buffer_name, upload.vb);
+         buffer_hash_insert(&context->buffer_table, ib_buffer_name, upload.ib);
+         buffer_hash_insert(&context->buffer_table, mb_buffer_name, upload.mb);
+
+         gltf_scene_tables_copy(context, &scene);
+
+         // the meshlets only live on the gpu
+         context->meshlets = (typeof(context->meshlets)){context->app_storage, stats.meshlet_count, 0};
+
+         gltf_vertices_report(&upload.quantize_error);
+      }
+   }
+
+   // the geometry time includes the copies still in flight
+   vk_upload_finish(context);
+   gltf_source_close(&source);
+
+   if(!result)
+   {
+      printf("Could not stream gltf: %s\n", s8_data(gltf_path));
+      return false;
+   }
+
+   const f64 ms = 1e3;
+   const f64 mb = 1.0 / (MB(1));
+
+   printf("Streamed gltf %s in %.2f ms on %u threads: parse %.2f ms, textures %.2f ms, geometry %.2f ms "
+          "in %zu chunks, peak %.1f MB of a %.1f MB budget (%u primitives over budget)\n",
+          s8_data(gltf_path), timer->seconds_elapsed(load_begin, timer->time()) * ms, jobs->thread_count,
+          parse_seconds * ms, texture_seconds * ms, gltf_stage_end(timer, &begin) * ms,
+          stats.chunk_count, stats.peak_bytes * mb, stats.budget * mb, stats.oversized_count);
+   vk_upload_report(context);
+
+   return true;
+}
+
+static bool gltf_load(vk_context* context, s8 gltf_path, gltf_load_options options)
+{
+   if(options.stream_budget > 0)
+      return gltf_load_streamed(context, gltf_path, options);
+
+   arena s = context->scratch;
+   hw_timer* timer = context->timer;
+   hw_jobs* jobs = context->jobs;
+
+   gltf_load_timings timings = {0};
+   gltf_load_jobs load_jobs = {0};
+   gltf_scene scene = {0};
+   gltf_source source = {0};
+   win32_file_view cooked = {0};
+
+   i64 begin = timer->time();
+   i64 load_begin = begin;
+
+   s8 cook_path = gltf_cook_path(&s, gltf_path);
+
+   if(!gltf_source_open(&source, gltf_path))
    {
       printf("Could not load gltf: %s\n", s8_data(gltf_path));
       return false;
    }
 
-   assert(data);
+   const u64 source_hash = gltf_cook_source_hash(s, &source.file, gltf_path);
+   timings.glb = gltf_source_is_glb(&source.file);
+
+   timings.cooked = !options.recook && gltf_cook_map(&cooked, &scene, &s, cook_path, source_hash);
 
-   if(!gltf_load_mesh(context, data, gltf_path))
+   if(timings.cooked)
    {
-      printf("Could not load mesh in gltf: %s\n", s8_data(gltf_path));
-      cgltf_free(data);
+      timings.cook = gltf_stage_end(timer, &begin);
+
+      // only the textures are left, the ones without a usable ktx2 are decoded
+      gltf_texture_jobs_create(&s, &load_jobs, &scene, gltf_path, &source.file, context->features.block_compression_supported,
+                               context->timer);
+      gltf_cook_textures_map(s, &load_jobs, cook_path, context->features.block_compression_supported);
+      gltf_textures_prepare(context, &load_jobs, options.texture_budget);
+      gltf_load_jobs_run(context, &load_jobs, load_jobs.texture_count);
+
+      // chains of images that changed since the cook were decoded again and replace the old files
+      for(u32 i = 0; i < load_jobs.texture_count; ++i)
+         timings.ktx2_count += load_jobs.textures[i].ktx2.data != 0;
+
+      if(timings.ktx2_count < load_jobs.texture_count)
+         gltf_cook_textures_write(s, &load_jobs, cook_path);
+
+      timings.jobs = gltf_stage_end(timer, &begin);
+   }
+   else if(!gltf_scene_cook(&s, context, &source, &scene, &load_jobs, gltf_path, cook_path, source_hash, &timings,
+                            options.texture_budget))
+   {
+      gltf_source_close(&source);
+      return false;
+   }
+
+   gltf_source_close(&source);
+
+   timings.thread_count = jobs->thread_count;
+
+   begin = timer->time();
+
+   bool uploaded = gltf_textures_finish(context, &load_jobs, options.texture_trace);
+
+   timings.texture_finish = gltf_stage_end(timer, &begin);
+
+   uploaded = uploaded && gltf_scene_upload(context, s, &scene);
+
+   // the buffer upload time includes the copies still in flight
+   vk_upload_finish(context);
+   timings.upload = gltf_stage_end(timer, &begin);
+
+   win32_file_unmap(&cooked);
+
+   if(!uploaded)
+   {
+      printf("Could not upload gltf: %s\n", s8_data(gltf_path));
       return false;
    }
 
-   cgltf_free(data);
+   const f64 ms = 1e3;
+   // the whole load, not just the timed stages
+   const f64 total = timer->seconds_elapsed(load_begin, timer->time());
+
+   if(timings.cooked)
+      printf("Loaded cooked gltf %s in %.2f ms on %u threads: map %.2f ms, texture map, decode and upload %.2f ms (%u/%u ktx2), "
+             "texture finish %.2f ms, buffer upload %.2f ms\n",
+             s8_data(cook_path), total * ms, timings.thread_count, timings.cook * ms, timings.jobs * ms,
+             timings.ktx2_count, load_jobs.texture_count, timings.texture_finish * ms, timings.upload * ms);
+   else
+      printf("Loaded %s %s in %.2f ms on %u threads: parse %.2f ms, buffers %.2f ms, validate %.2f ms, "
+             "decode, meshlet and texture upload jobs %.2f ms, cook %.2f ms, texture finish %.2f ms, buffer upload %.2f ms (%zu/%zu primitives on the bulk path)\n",
+             timings.glb ? "zero copy glb" : "gltf", s8_data(gltf_path), total * ms, timings.thread_count,
+             timings.parse * ms, timings.buffers * ms, timings.validate * ms,
+             timings.jobs * ms, timings.cook * ms, timings.texture_finish * ms, timings.upload * ms,
+             timings.bulk_primitive_count, timings.primitive_count);
+   vk_upload_report(context);
 
    return true;
 }
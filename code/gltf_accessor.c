@@ -0,0 +1,199 @@
+#include "meshlet.h"
+
+#include <immintrin.h>
+
+// bulk conversion of the common gltf accessor layouts straight into struct vertex
+// anything else (sparse, quantized, normalized ints) goes through cgltf_accessor_read_float
+
+static_assert(offsetof(struct vertex, vx) == 0 && offsetof(struct vertex, nx) == 12);
+static_assert(offsetof(struct vertex, tu) == 16 && sizeof(struct vertex) == 24);
+
+static const u8* gltf_accessor_data(const cgltf_accessor* accessor)
+{
+   if(!accessor || accessor->is_sparse || !accessor->buffer_view)
+      return 0;
+
+   const u8* data = cgltf_buffer_view_data(accessor->buffer_view);
+
+   return data ? data + accessor->offset : 0;
+}
+
+static bool gltf_accessor_is_float(const cgltf_accessor* accessor, cgltf_type type, usize count)
+{
+   return accessor->component_type == cgltf_component_type_r_32f &&
+          accessor->type == type &&
+          !accessor->normalized &&
+          accessor->count >= count &&
+          accessor->stride >= cgltf_calc_size(type, cgltf_component_type_r_32f) &&
+          gltf_accessor_data(accessor);
+}
+
+static void gltf_vertices_read_generic(vertex* vertices, usize first, usize count, const cgltf_accessor* position, const cgltf_accessor* normal, const cgltf_accessor* texcoord)
+{
+   for(usize k = first; k < first + count; ++k)
+   {
+      vertex vert = {0};
+
+      if(position)
+      {
+         f32 pos[3] = {0};
+         cgltf_accessor_read_float(position, k, pos, 3);
+         vert.vx = pos[0];
+         vert.vy = pos[1];
+         vert.vz = pos[2];
+      }
+      if(normal)
+      {
+         f32 norm[3] = {0};
+         cgltf_accessor_read_float(normal, k, norm, 3);
+         // pack normals
+         vert.nx = (u8)((norm[0] * 0.5f + 0.5f) * 255.0f);
+         vert.ny = (u8)((norm[1] * 0.5f + 0.5f) * 255.0f);
+         vert.nz = (u8)((norm[2] * 0.5f + 0.5f) * 255.0f);
+      }
+      if(texcoord)
+      {
+         f32 uv[2] = {0};
+         cgltf_accessor_read_float(texcoord, k, uv, 2);
+         vert.tu = uv[0];
+         vert.tv = uv[1];
+      }
+
+      vertices[k] = vert;
+   }
+}
+
+// float3 positions, optional float3 normals and float2 uvs, tightly packed or strided
+static bool gltf_vertices_read_bulk(vertex* vertices, usize count, const cgltf_accessor* position, const cgltf_accessor* normal, const cgltf_accessor* texcoord)
+{
+   if(!position || !gltf_accessor_is_float(position, cgltf_type_vec3, count))
+      return false;
+   if(normal && !gltf_accessor_is_float(normal, cgltf_type_vec3, count))
+      return false;
+   if(texcoord && !gltf_accessor_is_float(texcoord, cgltf_type_vec2, count))
+      return false;
+
+   if(count == 0)
+      return true;
+
+   const u8* positions = gltf_accessor_data(position);
+   const u8* normals = normal ? gltf_accessor_data(normal) : 0;
+   const u8* texcoords = texcoord ? gltf_accessor_data(texcoord) : 0;
+
+   const usize position_stride = position->stride;
+   const usize normal_stride = normal ? normal->stride : 0;
+   const usize texcoord_stride = texcoord ? texcoord->stride : 0;
+
+   const __m128 xyz_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+   const __m128i normal_mask = _mm_setr_epi32(0x00ffffff, 0, 0, 0);
+   const __m128 half = _mm_set1_ps(0.5f);
+   const __m128 unorm = _mm_set1_ps(255.0f);
+
+   // the 16 byte loads read one float past the vec3, so the last vertex takes the generic path
+   const usize bulk_count = count - 1;
+
+   for(usize k = 0; k < bulk_count; ++k)
+   {
+      __m128 pos = _mm_and_ps(_mm_loadu_ps((const f32*)(positions + k*position_stride)), xyz_mask);
+
+      // normal bytes go to the fourth lane next to the position
+      __m128i packed = _mm_setzero_si128();
+      if(normals)
+      {
+         __m128 n = _mm_loadu_ps((const f32*)(normals + k*normal_stride));
+         __m128i q = _mm_cvttps_epi32(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(n, half), half), unorm));
+         q = _mm_packs_epi32(q, q);
+         q = _mm_packus_epi16(q, q);
+         packed = _mm_slli_si128(_mm_and_si128(q, normal_mask), 12);
+      }
+
+      _mm_storeu_ps(&vertices[k].vx, _mm_or_ps(pos, _mm_castsi128_ps(packed)));
+
+      __m128i uv = texcoords ? _mm_loadl_epi64((const __m128i*)(texcoords + k*texcoord_stride)) : _mm_setzero_si128();
+      _mm_storel_epi64((__m128i*)&vertices[k].tu, uv);
+   }
+
+   gltf_vertices_read_generic(vertices, bulk_count, 1, position, normal, texcoord);
+
+   return true;
+}
+
+// returns true when the bulk path was taken
+static bool gltf_vertices_read(vertex* vertices, usize count, const cgltf_accessor* position, const cgltf_accessor* normal, const cgltf_accessor* texcoord)
+{
+   if(gltf_vertices_read_bulk(vertices, count, position, normal, texcoord))
+      return true;
+
+   gltf_vertices_read_generic(vertices, 0, count, position, normal, texcoord);
+
+   return false;
+}
+
+// KHR_mesh_quantization positions keep their integer grid - the bounds map the grid onto the snorm16
+// positions of the quantized vertices instead of the min and max of the mesh, so i16 positions come out
+// as they went in and i8 and u8 ones land on a finer grid. false for floats and u16, which do not fit
+static bool gltf_position_grid(const cgltf_accessor* position, f32 center[3], f32 extent[3])
+{
+   if(!position || position->type != cgltf_type_vec3)
+      return false;
+
+   f32 range = 0.0f;
+   bool is_unsigned = false;
+
+   switch(position->component_type)
+   {
+      case cgltf_component_type_r_8: range = 127.0f; break;
+      case cgltf_component_type_r_8u: range = 255.0f; is_unsigned = true; break;
+      case cgltf_component_type_r_16: range = 32767.0f; break;
+      default: return false;
+   }
+
+   // normalized values are read as [-1, 1] or [0, 1]
+   const f32 scale = position->normalized ? 1.0f : range;
+
+   for(u32 k = 0; k < 3; ++k)
+   {
+      center[k] = is_unsigned ? 0.5f*scale : 0.0f;
+      extent[k] = is_unsigned ? 0.5f*scale : scale;
+   }
+
+   return true;
+}
+
+static usize gltf_indices_read_generic(u32* indices, const cgltf_accessor* accessor)
+{
+   return cgltf_accessor_unpack_indices(accessor, indices, sizeof(u32), accessor->count);
+}
+
+// u32 indices are copied and u16 indices widened eight at a time
+static usize gltf_indices_read(u32* indices, const cgltf_accessor* accessor)
+{
+   const u8* data = gltf_accessor_data(accessor);
+   const usize count = accessor->count;
+
+   if(data && accessor->component_type == cgltf_component_type_r_32u && accessor->stride == sizeof(u32))
+   {
+      memcpy(indices, data, count*sizeof(u32));
+      return count;
+   }
+
+   if(data && accessor->component_type == cgltf_component_type_r_16u && accessor->stride == sizeof(u16))
+   {
+      const __m128i zero = _mm_setzero_si128();
+
+      usize i = 0;
+      for(; i + 8 <= count; i += 8)
+      {
+         __m128i v = _mm_loadu_si128((const __m128i*)(data + i*sizeof(u16)));
+         _mm_storeu_si128((__m128i*)(indices + i), _mm_unpacklo_epi16(v, zero));
+         _mm_storeu_si128((__m128i*)(indices + i + 4), _mm_unpackhi_epi16(v, zero));
+      }
+
+      for(; i < count; ++i)
+         indices[i] = ((const u16*)data)[i];
+
+      return count;
+   }
+
+   return gltf_indices_read_generic(indices, accessor);
+}
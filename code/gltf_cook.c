@@ -0,0 +1,367 @@
+#include "meshlet.h"
+#include "vulkan_ng.h"
+
+// a cooked scene is the cpu side of a gltf load written as one file next to the gltf.
+// every section is an array in its in-memory layout, so loading is a mapping, a header check
+// and the gpu uploads straight from the mapped file
+
+#define GLTF_COOK_MAGIC 0x4b4f4f43u   // "COOK"
+#define GLTF_COOK_VERSION 4
+#define GLTF_COOK_ALIGNMENT 64
+
+// cpu side of a scene, built from the gltf or viewing a mapped cooked file
+align_struct gltf_scene
+{
+   array(vertex) vertices;
+   array(u32) indices;
+   array(meshlet) meshlets;
+   array(size) meshlet_counts;      // per mesh draw
+   array(size) meshlet_offsets;
+   array(size) vertex_offsets;
+   array(vk_mesh_draw) mesh_draws;
+   array(vk_mesh_instance) mesh_instances;
+   array(struct material) materials;
+   array(s8) texture_uris;          // relative to the gltf directory, "#offset:size" for images inside a glb
+   u32* texture_slots;              // gltf texture to texture uri, only while building from the gltf
+} gltf_scene;
+
+typedef enum gltf_cook_section_kind
+{
+   gltf_cook_vertices = 0,
+   gltf_cook_indices,
+   gltf_cook_meshlets,
+   gltf_cook_meshlet_counts,
+   gltf_cook_meshlet_offsets,
+   gltf_cook_vertex_offsets,
+   gltf_cook_mesh_draws,
+   gltf_cook_mesh_instances,
+   gltf_cook_materials,
+   gltf_cook_texture_uris,
+   gltf_cook_strings,
+   gltf_cook_section_count,
+} gltf_cook_section_kind;
+
+align_struct gltf_cook_section
+{
+   u64 offset;    // from the start of the file
+   u64 count;
+   u64 stride;    // catches layout changes that did not bump the version
+} gltf_cook_section;
+
+// texture uri inside the strings section
+align_struct gltf_cook_string
+{
+   u64 offset;
+   u64 len;
+} gltf_cook_string;
+
+align_struct gltf_cook_header
+{
+   u32 magic;
+   u32 version;
+   u64 source_hash;
+   u64 file_size;
+   meshlet_limits limits;     // the meshlets are only valid for the limits they were built with
+   gltf_cook_section sections[gltf_cook_section_count];
+} gltf_cook_header;
+
+static const u64 gltf_cook_strides[gltf_cook_section_count] =
+{
+   [gltf_cook_vertices]        = sizeof(vertex),
+   [gltf_cook_indices]         = sizeof(u32),
+   [gltf_cook_meshlets]        = sizeof(meshlet),
+   [gltf_cook_meshlet_counts]  = sizeof(size),
+   [gltf_cook_meshlet_offsets] = sizeof(size),
+   [gltf_cook_vertex_offsets]  = sizeof(size),
+   [gltf_cook_mesh_draws]      = sizeof(vk_mesh_draw),
+   [gltf_cook_mesh_instances]  = sizeof(vk_mesh_instance),
+   [gltf_cook_materials]       = sizeof(struct material),
+   [gltf_cook_texture_uris]    = sizeof(gltf_cook_string),
+   [gltf_cook_strings]         = sizeof(u8),
+};
+
+// key of the cache - the gltf json or the whole glb with its bin chunk, the size and last write time of
+// every external buffer, and the format version
+static u64 gltf_cook_source_hash(arena s, const win32_file_view* source, s8 gltf_path)
+{
+   const u32 version = GLTF_COOK_VERSION;
+   u64 hash = hash64(source->data, source->size) ^ hash64(&version, sizeof(version));
+
+   // the json is parsed only for the buffer uris, a source that does not parse fails the cold load anyway
+   cgltf_options options = {0};
+   cgltf_data* data = 0;
+   if(cgltf_parse(&options, source->data, source->size, &data) != cgltf_result_success)
+      return hash;
+
+   // a missing buffer keeps a zero stamp
+   u64* stamps = data->buffers_count ? push(&s, u64, 2 * data->buffers_count) : 0;
+   for(usize i = 0; i < data->buffers_count; ++i)
+   {
+      cgltf_buffer* buffer = data->buffers + i;
+
+      // the glb bin chunk and embedded buffers are in the hashed bytes
+      if(!buffer->uri || strncmp(buffer->uri, "data:", 5) == 0)
+         continue;
+
+      cgltf_decode_uri(buffer->uri);
+      win32_file_stamp(s8_data(gltf_uri_path(&s, s8(buffer->uri), gltf_path)), stamps + 2 * i, stamps + 2 * i + 1);
+   }
+
+   if(stamps)
+      hash ^= hash64(stamps, 2 * data->buffers_count * sizeof(u64));
+
+   cgltf_free(data);
+
+   return hash;
+}
+
+// sponza.gltf -> sponza.gltf.cooked, sponza.glb -> sponza.glb.cooked
+static s8 gltf_cook_path(arena* a, s8 gltf_path)
+{
+   const s8 extension = s8(".cooked");
+
+   s8 result = {0};
+   result.len = gltf_path.len + extension.len;
+   result.data = push(a, u8, result.len + 1);  // null terminated
+
+   memcpy(result.data, gltf_path.data, gltf_path.len);
+   memcpy(result.data + gltf_path.len, extension.data, extension.len);
+
+   return result;
+}
+
+// sponza.gltf.cooked -> sponza.gltf.cooked.3.ktx2 for texture 3
+static s8 gltf_cook_texture_path(arena* a, s8 cook_path, u32 texture)
+{
+   char suffix[32];
+   const i32 suffix_len = snprintf(suffix, sizeof(suffix), ".%u.ktx2", texture);
+
+   s8 result = {0};
+   result.len = cook_path.len + suffix_len;
+   result.data = push(a, u8, result.len + 1);  // null terminated
+
+   memcpy(result.data, cook_path.data, cook_path.len);
+   memcpy(result.data + cook_path.len, suffix, suffix_len);
+
+   return result;
+}
+
+// the chains the texture jobs decoded, each with the image it was made from. a texture that failed to
+// write is decoded again next launch
+static void gltf_cook_textures_write(arena s, const gltf_load_jobs* load_jobs, s8 cook_path)
+{
+   for(u32 i = 0; i < load_jobs->texture_count; ++i)
+   {
+      const gltf_texture_job* job = load_jobs->textures + i;
+      if(!job->pixels || job->ktx2.data)
+         continue;
+
+      arena t = s;
+      ktx2_write(gltf_cook_texture_path(&t, cook_path, i), job->pixels, &job->mips, job->encoding, &job->source);
+   }
+}
+
+// maps the cooked chain of every texture the device can sample. the texture jobs check each against
+// its image and decode the ones that changed, returns how many were mapped
+static u32 gltf_cook_textures_map(arena s, gltf_load_jobs* load_jobs, s8 cook_path, bool block_compression)
+{
+   u32 result = 0;
+
+   for(u32 i = 0; i < load_jobs->texture_count; ++i)
+   {
+      gltf_texture_job* job = load_jobs->textures + i;
+
+      arena t = s;
+      ktx2_texture texture;
+      if(!ktx2_map(&job->ktx2, &texture, gltf_cook_texture_path(&t, cook_path, i)))
+         continue;
+
+      if(texture.encoding.format != texture_bc_none && !block_compression)
+      {
+         win32_file_unmap(&job->ktx2);
+         continue;
+      }
+
+      job->pixels = (u8*)texture.pixels;
+      job->mips = texture.mips;
+      job->encoding = texture.encoding;
+      job->ktx2_source = texture.source;
+      job->width = (i32)texture.mips.levels[0].width;
+      job->height = (i32)texture.mips.levels[0].height;
+      result++;
+   }
+
+   return result;
+}
+
+static u64 gltf_cook_align(u64 offset)
+{
+   return (offset + GLTF_COOK_ALIGNMENT - 1) & ~(u64)(GLTF_COOK_ALIGNMENT - 1);
+}
+
+static bool gltf_cook_write(arena s, const gltf_scene* scene, s8 cook_path, u64 source_hash)
+{
+   // uris go to one strings section
+   usize uri_count = scene->texture_uris.count;
+   gltf_cook_string* uris = uri_count ? push(&s, gltf_cook_string, uri_count) : 0;
+
+   u64 strings_len = 0;
+   for(usize i = 0; i < uri_count; ++i)
+   {
+      uris[i] = (gltf_cook_string){strings_len, scene->texture_uris.data[i].len};
+      strings_len += scene->texture_uris.data[i].len;
+   }
+
+   const void* sources[gltf_cook_section_count] =
+   {
+      [gltf_cook_vertices]        = scene->vertices.data,
+      [gltf_cook_indices]         = scene->indices.data,
+      [gltf_cook_meshlets]        = scene->meshlets.data,
+      [gltf_cook_meshlet_counts]  = scene->meshlet_counts.data,
+      [gltf_cook_meshlet_offsets] = scene->meshlet_offsets.data,
+      [gltf_cook_vertex_offsets]  = scene->vertex_offsets.data,
+      [gltf_cook_mesh_draws]      = scene->mesh_draws.data,
+      [gltf_cook_mesh_instances]  = scene->mesh_instances.data,
+      [gltf_cook_materials]       = scene->materials.data,
+      [gltf_cook_texture_uris]    = uris,
+   };
+
+   const u64 counts[gltf_cook_section_count] =
+   {
+      [gltf_cook_vertices]        = scene->vertices.count,
+      [gltf_cook_indices]         = scene->indices.count,
+      [gltf_cook_meshlets]        = scene->meshlets.count,
+      [gltf_cook_meshlet_counts]  = scene->meshlet_counts.count,
+      [gltf_cook_meshlet_offsets] = scene->meshlet_offsets.count,
+      [gltf_cook_vertex_offsets]  = scene->vertex_offsets.count,
+      [gltf_cook_mesh_draws]      = scene->mesh_draws.count,
+      [gltf_cook_mesh_instances]  = scene->mesh_instances.count,
+      [gltf_cook_materials]       = scene->materials.count,
+      [gltf_cook_texture_uris]    = uri_count,
+      [gltf_cook_strings]         = strings_len,
+   };
+
+   gltf_cook_header header = {0};
+   header.magic = GLTF_COOK_MAGIC;
+   header.version = GLTF_COOK_VERSION;
+   header.source_hash = source_hash;
+   header.limits = meshlet_default_limits;
+
+   u64 offset = gltf_cook_align(sizeof(header));
+   for(u32 i = 0; i < gltf_cook_section_count; ++i)
+   {
+      header.sections[i] = (gltf_cook_section){offset, counts[i], gltf_cook_strides[i]};
+      offset = gltf_cook_align(offset + counts[i]*gltf_cook_strides[i]);
+   }
+
+   header.file_size = offset;
+
+   win32_file_view file = {0};
+   if(!win32_file_map_write(&file, s8_data(cook_path), (size)header.file_size))
+   {
+      printf("Could not write cooked scene: %s\n", s8_data(cook_path));
+      return false;
+   }
+
+   u8* base = file.data;
+   for(u32 i = 0; i < gltf_cook_section_count; ++i)
+   {
+      const gltf_cook_section* section = header.sections + i;
+      if(section->count > 0 && sources[i])
+         memcpy(base + section->offset, sources[i], section->count*section->stride);
+   }
+
+   u8* strings = base + header.sections[gltf_cook_strings].offset;
+   for(usize i = 0; i < uri_count; ++i)
+      memcpy(strings + uris[i].offset, scene->texture_uris.data[i].data, uris[i].len);
+
+   // header last so a torn write never passes the magic check
+   memcpy(base, &header, sizeof(header));
+
+   win32_file_unmap(&file);
+
+   return true;
+}
+
+static bool gltf_cook_header_valid(const gltf_cook_header* header, size file_size, u64 source_hash)
+{
+   if(file_size < sizeof(*header) || header->magic != GLTF_COOK_MAGIC || header->version != GLTF_COOK_VERSION)
+      return false;
+
+   if(header->source_hash != source_hash || header->file_size != file_size)
+      return false;
+
+   const meshlet_limits limits = meshlet_default_limits;
+   if(header->limits.max_vertices != limits.max_vertices || header->limits.max_triangles != limits.max_triangles)
+      return false;
+
+   for(u32 i = 0; i < gltf_cook_section_count; ++i)
+   {
+      const gltf_cook_section* section = header->sections + i;
+
+      if(section->stride != gltf_cook_strides[i] || section->offset % GLTF_COOK_ALIGNMENT != 0)
+         return false;
+      if(section->offset > file_size || section->count > (file_size - section->offset) / section->stride)
+         return false;
+   }
+
+   const u64 draw_count = header->sections[gltf_cook_mesh_draws].count;
+
+   return header->sections[gltf_cook_meshlet_counts].count == draw_count &&
+          header->sections[gltf_cook_meshlet_offsets].count == draw_count &&
+          header->sections[gltf_cook_vertex_offsets].count == draw_count;
+}
+
+// the scene views the mapping, only the texture uris are allocated
+static bool gltf_cook_map(win32_file_view* file, gltf_scene* scene, arena* s, s8 cook_path, u64 source_hash)
+{
+   if(!win32_file_map(file, s8_data(cook_path)))
+      return false;
+
+   const gltf_cook_header* header = file->data;
+   if(!gltf_cook_header_valid(header, file->size, source_hash))
+   {
+      printf("Stale cooked scene, recooking: %s\n", s8_data(cook_path));
+      win32_file_unmap(file);
+      return false;
+   }
+
+   u8* base = file->data;
+
+#define gltf_cook_view(a, kind) \
+   ((a).arena = 0, (a).count = header->sections[kind].count, (a).data = (void*)(base + header->sections[kind].offset))
+
+   gltf_cook_view(scene->vertices, gltf_cook_vertices);
+   gltf_cook_view(scene->indices, gltf_cook_indices);
+   gltf_cook_view(scene->meshlets, gltf_cook_meshlets);
+   gltf_cook_view(scene->meshlet_counts, gltf_cook_meshlet_counts);
+   gltf_cook_view(scene->meshlet_offsets, gltf_cook_meshlet_offsets);
+   gltf_cook_view(scene->vertex_offsets, gltf_cook_vertex_offsets);
+   gltf_cook_view(scene->mesh_draws, gltf_cook_mesh_draws);
+   gltf_cook_view(scene->mesh_instances, gltf_cook_mesh_instances);
+   gltf_cook_view(scene->materials, gltf_cook_materials);
+
+#undef gltf_cook_view
+
+   const gltf_cook_section* uri_section = header->sections + gltf_cook_texture_uris;
+   const gltf_cook_section* string_section = header->sections + gltf_cook_strings;
+   const gltf_cook_string* uris = (const gltf_cook_string*)(base + uri_section->offset);
+
+   scene->texture_uris = (typeof(scene->texture_uris)){s};
+   if(uri_section->count > 0)
+      array_resize(scene->texture_uris, uri_section->count);
+
+   for(u64 i = 0; i < uri_section->count; ++i)
+   {
+      if(uris[i].offset > string_section->count || uris[i].len > string_section->count - uris[i].offset)
+      {
+         win32_file_unmap(file);
+         return false;
+      }
+
+      s8 uri = {base + string_section->offset + uris[i].offset, uris[i].len};
+      array_add(scene->texture_uris, uri);
+   }
+
+   return true;
+}
@@ -0,0 +1,315 @@
+#include "meshlet.h"
+#include "hw_job.h"
+
+// cpu side of the gltf load - texture decodes, vertex conversion and meshlet builds run as independent jobs
+// and join before anything touches the gpu
+
+// what the materials sample from a texture, picks its block format
+typedef enum gltf_texture_role
+{
+   gltf_texture_color = 1 << 0,              // albedo and emissive
+   gltf_texture_normal = 1 << 1,             // xy in rg
+   gltf_texture_metal_roughness = 1 << 2,    // roughness in g, metalness in b
+   gltf_texture_occlusion = 1 << 3,          // r
+} gltf_texture_role;
+
+// clock counters of one texture job, every stage that did not run ends where it began
+align_struct gltf_texture_trace
+{
+   i64 begin;
+   i64 decoded;
+   i64 filtered;     // mip chain done
+   i64 finished;     // blocks done
+} gltf_texture_trace;
+
+align_struct gltf_texture_job
+{
+   s8 path;             // null terminated
+   const u8* encoded;   // image embedded in a glb, decoded from memory instead of the path
+   size encoded_size;
+   u8* pixels;          // mip chain in the stbi allocation grown to hold every level, freed after the upload
+   win32_file_view ktx2;   // cooked chain the pixels point into instead, nothing left to decode
+   ktx2_source ktx2_source;   // what the cooked chain was made from
+   ktx2_source source;        // the encoded image and roles of this load, filled by the job
+   i32 width;
+   i32 height;
+   u32 mip_flags;       // srgb for colors, alpha test for albedo
+   u32 roles;           // gltf_texture_role, none keeps rgba8
+   texture_bc_encoding encoding;
+   texture_mip_chain mips;
+   gltf_texture_trace trace;
+} gltf_texture_job;
+
+align_struct gltf_primitive_job
+{
+   const cgltf_accessor* position;
+   const cgltf_accessor* normal;
+   const cgltf_accessor* texcoord;
+   const cgltf_accessor* index_accessor;
+
+   // disjoint ranges of the shared scene buffers
+   vertex* vertices;
+   u32* indices;
+   usize vertex_count;
+   usize index_count;
+
+   array_meshlet meshlets;    // in the storage of the worker that built it
+   bool bulk;                 // vertices took the simd path
+} gltf_primitive_job;
+
+align_struct gltf_load_jobs
+{
+   gltf_texture_job* textures;
+   gltf_primitive_job* primitives;
+   u32 texture_count;
+   u32 primitive_count;
+   meshlet_limits limits;
+   i64 (*time)(void);   // clock of the texture traces, none leaves them zero
+
+   // texture index + 1 of every finished texture job in the order they finished, zero until the job
+   // publishes it. none keeps the jobs from publishing
+   volatile LONG* ready;
+   volatile LONG ready_count;    // slots taken by the jobs
+} gltf_load_jobs;
+
+// picks the accessors the loader converts, returns the vertex count
+static usize gltf_primitive_accessors(const cgltf_primitive* prim, gltf_primitive_job* job)
+{
+   job->index_accessor = prim->indices;
+   job->vertex_count = 0;
+
+   // parse attribute types
+   for(usize j = 0; j < prim->attributes_count; ++j)
+   {
+      cgltf_attribute* attr = prim->attributes + j;
+
+      cgltf_attribute_type attr_type;
+      i32 attr_index;
+      cgltf_parse_attribute_type(attr->name, &attr_type, &attr_index);
+
+      switch(attr_type)
+      {
+         case cgltf_attribute_type_position:
+         job->position = attr->data;
+         job->vertex_count = job->position->count;
+         break;
+
+         case cgltf_attribute_type_normal:
+         job->normal = attr->data;
+         break;
+
+         case cgltf_attribute_type_texcoord:
+         if(attr_index == 0) // first uv set only
+            job->texcoord = attr->data;
+         break;
+
+         default:
+         // ignore other attributes (e.g., color, joints, etc.)
+         break;
+      }
+   }
+
+   return job->vertex_count;
+}
+
+// one job per primitive of every mesh, in draw order
+static void gltf_primitive_jobs_create(arena* s, const cgltf_data* data, gltf_load_jobs* load_jobs)
+{
+   size primitive_count = 0;
+   for(usize i = 0; i < data->meshes_count; ++i)
+      primitive_count += data->meshes[i].primitives_count;
+
+   // the texture jobs may already be set up
+   load_jobs->limits = meshlet_default_limits;
+   load_jobs->primitives = primitive_count ? push(s, gltf_primitive_job, primitive_count) : 0;
+   load_jobs->primitive_count = 0;
+
+   for(usize i = 0; i < data->meshes_count; ++i)
+   {
+      cgltf_mesh* gltf_mesh = data->meshes + i;
+      for(usize p = 0; p < gltf_mesh->primitives_count; ++p)
+      {
+         cgltf_primitive* prim = gltf_mesh->primitives + p;
+         assert(prim->type == cgltf_primitive_type_triangles);
+
+         gltf_primitive_accessors(prim, load_jobs->primitives + load_jobs->primitive_count++);
+      }
+   }
+}
+
+// uri relative to the directory of the gltf
+static s8 gltf_uri_path(arena* a, s8 img_uri, s8 gltf_path)
+{
+   size dir_len = gltf_path.len;
+   while(dir_len > 0 && gltf_path.data[dir_len - 1] != '/' && gltf_path.data[dir_len - 1] != '\\')
+      dir_len--;
+
+   assert(dir_len > 0);
+
+   s8 result = {0};
+   result.len = dir_len + img_uri.len;
+   result.data = push(a, u8, result.len + 1);  // null terminated
+
+   memcpy(result.data, gltf_path.data, dir_len);
+   memcpy(result.data + dir_len, img_uri.data, img_uri.len);
+
+   return result;
+}
+
+// colors with any alpha below one keep it in bc3, a texture that is both normal and data is read as a normal
+static texture_bc_encoding gltf_texture_encoding(u32 roles, const u8* pixels, size texel_count)
+{
+   const u32 orm = gltf_texture_metal_roughness | gltf_texture_occlusion;
+
+   if(roles & gltf_texture_color)
+      return (texture_bc_encoding){texture_bc_opaque(pixels, texel_count) ? texture_bc1 : texture_bc3};
+   if(roles & gltf_texture_normal)
+      return (texture_bc_encoding){texture_bc5, 0};
+   if((roles & orm) == orm)
+      return (texture_bc_encoding){texture_bc1};
+   if(roles & gltf_texture_metal_roughness)
+      return (texture_bc_encoding){texture_bc5, 1};
+   if(roles & gltf_texture_occlusion)
+      return (texture_bc_encoding){texture_bc4, 0};
+
+   return (texture_bc_encoding){texture_bc_none};
+}
+
+static i64 gltf_job_time(i64 (*time)(void))
+{
+   return time ? time() : 0;
+}
+
+// a cooked chain is used only when it was made from the same image bytes for the same roles, otherwise
+// it is dropped and the image decoded again
+static void gltf_texture_job_run(gltf_texture_job* job, arena scratch, i64 (*time)(void))
+{
+   i32 channels = 0;
+
+   const i64 begin = gltf_job_time(time);
+   job->trace = (gltf_texture_trace){begin, begin, begin, begin};
+
+   const u8* encoded = job->encoded;
+   size encoded_size = job->encoded_size;
+
+   win32_file_view file = {0};
+   if(!encoded && win32_file_map(&file, s8_data(job->path)))
+   {
+      encoded = file.data;
+      encoded_size = file.size;
+   }
+
+   job->source = (ktx2_source){0, 0, job->roles, job->mip_flags};
+   if(encoded)
+   {
+      job->source.hash = hash64(encoded, encoded_size);
+      job->source.size = (u64)encoded_size;
+   }
+
+   if(job->ktx2.data)
+   {
+      if(ktx2_source_equal(&job->ktx2_source, &job->source))
+      {
+         win32_file_unmap(&file);
+         return;
+      }
+
+      win32_file_unmap(&job->ktx2);
+      job->pixels = 0;
+      job->mips = (texture_mip_chain){0};
+      job->encoding = (texture_bc_encoding){0};
+   }
+
+   if(encoded)
+      job->pixels = stbi_load_from_memory(encoded, (int)encoded_size, &job->width, &job->height, &channels, STBI_rgb_alpha);
+
+   win32_file_unmap(&file);
+
+   job->trace.decoded = job->trace.filtered = gltf_job_time(time);
+
+   if(!job->pixels)
+      return;
+
+   // the levels follow the base level so the chain uploads with one copy
+   job->mips = texture_mip_chain_layout((u32)job->width, (u32)job->height);
+
+   u8* chain = STBI_REALLOC(job->pixels, job->mips.size);
+   if(!chain)
+   {
+      job->mips = texture_mip_chain_layout(1, 1);
+      job->mips.levels[0] = (texture_mip_level){0, (u32)job->width, (u32)job->height};
+      job->mips.size = (size)job->width * job->height * 4;
+      return;
+   }
+
+   job->pixels = chain;
+   texture_mips_generate(job->pixels, &job->mips, texture_mip_kaiser, job->mip_flags, scratch);
+   job->trace.filtered = gltf_job_time(time);
+
+   job->encoding = gltf_texture_encoding(job->roles, job->pixels, (size)job->width * job->height);
+   if(job->encoding.format == texture_bc_none)
+      return;
+
+   // the blocks overwrite the chain, the texels past them are given back
+   texture_bc_chain_compress(job->pixels, &job->mips, job->encoding);
+
+   u8* blocks = STBI_REALLOC(job->pixels, job->mips.size);
+   if(blocks)
+      job->pixels = blocks;
+}
+
+// the pixels of a job after the upload
+static void gltf_texture_job_release(gltf_texture_job* job)
+{
+   if(job->ktx2.data)
+      win32_file_unmap(&job->ktx2);
+   else
+      stbi_image_free(job->pixels);
+
+   job->pixels = 0;
+}
+
+static void gltf_primitive_job_run(gltf_primitive_job* job, meshlet_limits limits, arena* storage)
+{
+   job->bulk = gltf_vertices_read(job->vertices, job->vertex_count, job->position, job->normal, job->texcoord);
+   job->index_count = gltf_indices_read(job->indices, job->index_accessor);
+
+   job->meshlets = (array_meshlet){storage};
+   if(job->vertex_count == 0 || job->index_count == 0)
+      return;
+
+   // 0xff means the vertex index is not in use yet
+   u8* meshlet_vertices = push(storage, u8, job->vertex_count);
+   pointer_clear_to(meshlet_vertices, 0xff, job->vertex_count);
+
+   meshlet_build(&job->meshlets, meshlet_vertices, job->indices, job->index_count, 0, limits);
+}
+
+// the ready queue only holds one run of the jobs
+static void gltf_load_jobs_rewind(gltf_load_jobs* jobs)
+{
+   jobs->ready_count = 0;
+   for(u32 i = 0; jobs->ready && i < jobs->texture_count; ++i)
+      jobs->ready[i] = 0;
+}
+
+static void gltf_load_job(void* data, u32 job_index, arena* storage)
+{
+   gltf_load_jobs* jobs = data;
+
+   // textures are the longest jobs so they get picked first
+   if(job_index < jobs->texture_count)
+   {
+      gltf_texture_job* job = jobs->textures + job_index;
+
+      gltf_texture_job_run(job, *storage, jobs->time);
+      job->trace.finished = gltf_job_time(jobs->time);
+
+      // the slot is taken first and filled once the job is done, whoever reads it waits for non zero
+      const LONG slot = jobs->ready ? InterlockedIncrement(&jobs->ready_count) - 1 : (LONG)jobs->texture_count;
+      if(slot < (LONG)jobs->texture_count)
+         InterlockedExchange(jobs->ready + slot, (LONG)job_index + 1);
+   }
+   else
+      gltf_primitive_job_run(jobs->primitives + (job_index - jobs->texture_count), jobs->limits, storage);
+}
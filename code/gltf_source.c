@@ -0,0 +1,236 @@
+#include "common.h"
+#include "arena.h"
+
+// the gltf or glb file of a load is mapped and parsed in place. a glb bin chunk is never copied,
+// cgltf points the first buffer at the mapping and the accessors read straight from it
+
+#define GLTF_GLB_MAGIC 0x46546c67u        // "glTF"
+#define GLTF_GLB_JSON_CHUNK 0x4e4f534au   // "JSON"
+
+align_struct gltf_source
+{
+   win32_file_view file;
+   win32_file_view* buffers;     // external buffers mapped instead of read, one per cgltf buffer
+   cgltf_data* data;
+} gltf_source;
+
+static bool gltf_source_is_glb(const win32_file_view* file)
+{
+   return file->size >= 12 && *(const u32*)file->data == GLTF_GLB_MAGIC;
+}
+
+// bytes of the json - the header and the json chunk of a glb, the whole file of a gltf
+static size gltf_source_json_size(const win32_file_view* file)
+{
+   if(!gltf_source_is_glb(file))
+      return file->size;
+
+   if(file->size < 20 || ((const u32*)file->data)[4] != GLTF_GLB_JSON_CHUNK)
+      return file->size;
+
+   const size json_size = 20 + (size)((const u32*)file->data)[3];
+
+   return min(json_size, file->size);
+}
+
+static bool gltf_source_open(gltf_source* source, s8 gltf_path)
+{
+   *source = (gltf_source){0};
+
+   return win32_file_map(&source->file, s8_data(gltf_path));
+}
+
+// the json is parsed from the mapping, the parse keeps pointers into it
+static bool gltf_source_parse(gltf_source* source)
+{
+   cgltf_options options = {0};
+
+   return cgltf_parse(&options, source->file.data, source->file.size, &source->data) == cgltf_result_success;
+}
+
+// EXT_meshopt_compression views decode into s once the buffers are loaded, cgltf reads the accessors
+// of a view from view->data when it is set. the uncompressed fallback buffer is never loaded
+static bool gltf_source_meshopt_decode(arena* s, cgltf_data* data)
+{
+   for(usize i = 0; i < data->buffer_views_count; ++i)
+   {
+      cgltf_buffer_view* view = data->buffer_views + i;
+      if(!view->has_meshopt_compression)
+         continue;
+
+      const cgltf_meshopt_compression* compression = &view->meshopt_compression;
+      const usize byte_count = compression->count * compression->stride;
+      const u8* in = compression->buffer->data ? (const u8*)compression->buffer->data + compression->offset : 0;
+
+      if(!in || byte_count == 0 || byte_count < view->size || compression->offset + compression->size > compression->buffer->size)
+      {
+         printf("Could not decode meshopt compressed buffer view %zu\n", i);
+         return false;
+      }
+
+      u32* out = push(s, u32, (byte_count + 3) / 4);
+      bool decoded = false;
+
+      switch(compression->mode)
+      {
+         case cgltf_meshopt_compression_mode_attributes:
+         decoded = meshopt_vertices_decode(out, compression->count, compression->stride, in, compression->size);
+         break;
+
+         case cgltf_meshopt_compression_mode_triangles:
+         decoded = meshopt_indices_decode(out, compression->count, compression->stride, in, compression->size);
+         break;
+
+         case cgltf_meshopt_compression_mode_indices:
+         decoded = meshopt_index_sequence_decode(out, compression->count, compression->stride, in, compression->size);
+         break;
+
+         default:
+         break;
+      }
+
+      if(!decoded)
+      {
+         printf("Could not decode meshopt compressed buffer view %zu\n", i);
+         return false;
+      }
+
+      switch(compression->filter)
+      {
+         case cgltf_meshopt_compression_filter_octahedral:
+         meshopt_filter_octahedral(out, compression->count, compression->stride);
+         break;
+
+         case cgltf_meshopt_compression_filter_quaternion:
+         meshopt_filter_quaternion(out, compression->count);
+         break;
+
+         case cgltf_meshopt_compression_filter_exponential:
+         meshopt_filter_exponential(out, byte_count / 4);
+         break;
+
+         default:
+         break;
+      }
+
+      view->data = out;
+   }
+
+   return true;
+}
+
+// map_buffers maps the external buffers too, otherwise cgltf reads them to the heap
+static bool gltf_source_buffers_load(gltf_source* source, arena* s, s8 gltf_path, bool map_buffers)
+{
+   cgltf_data* data = source->data;
+
+   if(map_buffers && data->buffers_count > 0)
+   {
+      source->buffers = push(s, win32_file_view, data->buffers_count);
+
+      for(usize i = 0; i < data->buffers_count; ++i)
+      {
+         cgltf_buffer* buffer = data->buffers + i;
+
+         // the glb bin chunk and embedded buffers are left to cgltf
+         if(!buffer->uri || strncmp(buffer->uri, "data:", 5) == 0)
+            continue;
+
+         cgltf_decode_uri(buffer->uri);
+         s8 path = gltf_uri_path(s, s8(buffer->uri), gltf_path);
+
+         win32_file_view* view = source->buffers + i;
+         if(!win32_file_map(view, s8_data(path)) || view->size < buffer->size)
+         {
+            printf("Could not map gltf buffer: %s\n", s8_data(path));
+            return false;
+         }
+
+         buffer->data = view->data;
+         buffer->data_free_method = cgltf_data_free_method_none;
+      }
+   }
+
+   // cgltf skips the buffers that already have data
+   cgltf_options options = {0};
+
+   if(cgltf_load_buffers(&options, data, s8_data(gltf_path)) != cgltf_result_success)
+      return false;
+
+   return gltf_source_meshopt_decode(s, data);
+}
+
+static void gltf_source_close(gltf_source* source)
+{
+   if(source->data && source->buffers)
+   {
+      for(usize i = 0; i < source->data->buffers_count; ++i)
+      {
+         if(!source->buffers[i].data)
+            continue;
+
+         source->data->buffers[i].data = 0;
+         win32_file_unmap(source->buffers + i);
+      }
+   }
+
+   // decoded views live in the scratch arena, cgltf would free them
+   for(usize i = 0; source->data && i < source->data->buffer_views_count; ++i)
+      if(source->data->buffer_views[i].has_meshopt_compression)
+         source->data->buffer_views[i].data = 0;
+
+   if(source->data)
+      cgltf_free(source->data);
+
+   // after cgltf_free, the bin chunk is part of the mapping
+   win32_file_unmap(&source->file);
+
+   *source = (gltf_source){0};
+}
+
+// embedded image as a byte range of the glb - "#<offset>:<size>" so it survives in the cooked scene
+static s8 gltf_source_image_uri(arena* s, const gltf_source* source, const cgltf_image* image)
+{
+   const cgltf_buffer_view* view = image->buffer_view;
+   const u8* base = source->file.data;
+   const u8* bytes = view ? cgltf_buffer_view_data(view) : 0;
+
+   if(!bytes || bytes < base || bytes + view->size > base + source->file.size)
+      return (s8){0};
+
+   char uri[64];
+   int len = snprintf(uri, sizeof(uri), "#%llu:%llu", (unsigned long long)(bytes - base), (unsigned long long)view->size);
+
+   s8 result = {push(s, u8, len + 1), len};
+   memcpy(result.data, uri, len);
+
+   return result;
+}
+
+static bool gltf_source_uri_number(s8 uri, size* at, u64* value)
+{
+   size begin = *at;
+   for(*value = 0; *at < uri.len && uri.data[*at] >= '0' && uri.data[*at] <= '9'; ++*at)
+      *value = *value*10 + (uri.data[*at] - '0');
+
+   return *at > begin;
+}
+
+// bytes of an embedded image uri, 0 when the uri is a file. cooked uris are not null terminated
+static const u8* gltf_source_image_bytes(const win32_file_view* file, s8 uri, size* byte_count)
+{
+   u64 offset = 0, count = 0;
+   size at = 1;
+
+   if(uri.len == 0 || uri.data[0] != '#' || !file->data)
+      return 0;
+   if(!gltf_source_uri_number(uri, &at, &offset) || at >= uri.len || uri.data[at++] != ':' ||
+      !gltf_source_uri_number(uri, &at, &count) || at != uri.len)
+      return 0;
+   if(offset > file->size || count > file->size - offset)
+      return 0;
+
+   *byte_count = (size)count;
+
+   return (const u8*)file->data + offset;
+}
@@ -0,0 +1,201 @@
+#include "meshlet.h"
+#include "hw_job.h"
+
+// streaming load - primitives are converted and meshletized in chunks that fit a memory budget and
+// handed to a sink before the next chunk reuses the memory, so the scene size is bounded by the
+// source mapping and the gpu instead of the scratch arena
+
+#define GLTF_STREAM_DEFAULT_BUDGET MB(256)
+
+align_struct gltf_stream_draw
+{
+   usize vertex_offset;    // all offsets are into the whole scene
+   usize vertex_count;
+   usize index_offset;
+   usize index_count;
+   usize meshlet_offset;
+   usize meshlet_count;
+} gltf_stream_draw;
+
+// valid until the sink returns
+align_struct gltf_stream_chunk
+{
+   const vertex* vertices;
+   const u32* indices;
+   const meshlet* meshlets;
+   const gltf_stream_draw* draws;
+   arena* scratch;         // rest of the chunk memory, sink allocations count towards the peak
+
+   usize vertex_offset;
+   usize vertex_count;
+   usize index_offset;
+   usize index_count;
+   usize meshlet_offset;
+   usize meshlet_count;
+   u32 first_draw;
+   u32 draw_count;
+} gltf_stream_chunk;
+
+typedef bool (*gltf_stream_sink)(void* user, const gltf_stream_chunk* chunk);
+
+align_struct gltf_stream_stats
+{
+   size budget;
+   size peak_bytes;       // largest chunk including the meshlet builder storage
+   usize chunk_count;
+   usize vertex_count;
+   usize index_count;
+   usize meshlet_count;
+   u32 oversized_count;   // primitives that alone exceed the budget
+} gltf_stream_stats;
+
+// a meshlet is only flushed once it is out of triangles or can not take three more vertices
+static usize gltf_stream_meshlet_bound(usize index_count, meshlet_limits limits)
+{
+   usize min_triangles = min((usize)limits.max_triangles, (usize)limits.max_vertices / 3);
+   min_triangles = max(min_triangles, (usize)1);
+
+   return (index_count / 3) / min_triangles + 1;
+}
+
+// worst case chunk memory of one primitive
+static size gltf_stream_primitive_bytes(const gltf_primitive_job* job, meshlet_limits limits)
+{
+   const usize index_count = job->index_accessor->count;
+   const usize meshlet_bound = gltf_stream_meshlet_bound(index_count, limits);
+
+   // converted data, the meshlet vertex marks and the meshlets in the worker storage and gathered
+   size result = job->vertex_count*sizeof(vertex) + index_count*sizeof(u32) + job->vertex_count + 2*meshlet_bound*sizeof(meshlet);
+
+   // the copy the sink quantizes into
+   if(VERTEX_QUANTIZED)
+      result += job->vertex_count*sizeof(vertex_quantized);
+
+   return result;
+}
+
+static bool gltf_stream_primitives(arena s, hw_jobs* jobs, gltf_primitive_job* primitives, u32 primitive_count, size budget,
+                                   meshlet_limits limits, gltf_stream_sink sink, void* user, gltf_stream_stats* stats)
+{
+   *stats = (gltf_stream_stats){.budget = budget};
+
+   u32 first = 0;
+   while(first < primitive_count)
+   {
+      // greedy chunk, a primitive larger than the budget goes alone
+      size estimate = 0;
+      u32 last = first;
+      while(last < primitive_count)
+      {
+         size bytes = gltf_stream_primitive_bytes(primitives + last, limits);
+         if(last > first && estimate + bytes > budget)
+            break;
+
+         estimate += bytes;
+         last++;
+      }
+
+      if(last == first + 1 && estimate > budget)
+         stats->oversized_count++;
+
+      // every chunk starts from the same scratch
+      arena chunk_scratch = s;
+
+      gltf_load_jobs chunk_jobs = {0};
+      chunk_jobs.primitives = primitives + first;
+      chunk_jobs.primitive_count = last - first;
+      chunk_jobs.limits = limits;
+
+      usize vertex_count = 0;
+      usize index_count = 0;
+      for(u32 i = 0; i < chunk_jobs.primitive_count; ++i)
+      {
+         vertex_count += chunk_jobs.primitives[i].vertex_count;
+         index_count += chunk_jobs.primitives[i].index_accessor->count;
+      }
+
+      gltf_stream_chunk chunk = {0};
+      chunk.first_draw = first;
+      chunk.draw_count = chunk_jobs.primitive_count;
+      chunk.vertex_offset = stats->vertex_count;
+      chunk.index_offset = stats->index_count;
+      chunk.meshlet_offset = stats->meshlet_count;
+
+      vertex* vertices = vertex_count ? push(&chunk_scratch, vertex, vertex_count) : 0;
+      u32* indices = index_count ? push(&chunk_scratch, u32, index_count) : 0;
+      gltf_stream_draw* draws = push(&chunk_scratch, gltf_stream_draw, chunk.draw_count);
+
+      usize vertex_offset = 0;
+      usize index_offset = 0;
+      for(u32 i = 0; i < chunk_jobs.primitive_count; ++i)
+      {
+         gltf_primitive_job* job = chunk_jobs.primitives + i;
+         job->vertices = vertices + vertex_offset;
+         job->indices = indices + index_offset;
+
+         vertex_offset += job->vertex_count;
+         index_offset += job->index_accessor->count;
+      }
+
+      jobs->parallel_for(jobs, gltf_load_job, &chunk_jobs, chunk_jobs.primitive_count);
+
+      usize meshlet_count = 0;
+      size storage_bytes = 0;
+      for(u32 i = 0; i < chunk_jobs.primitive_count; ++i)
+      {
+         meshlet_count += chunk_jobs.primitives[i].meshlets.count;
+         storage_bytes += chunk_jobs.primitives[i].vertex_count + chunk_jobs.primitives[i].meshlets.count*sizeof(meshlet);
+      }
+
+      meshlet* meshlets = meshlet_count ? push(&chunk_scratch, meshlet, meshlet_count) : 0;
+
+      // gather the meshlets from the worker storage in draw order
+      vertex_offset = chunk.vertex_offset;
+      index_offset = chunk.index_offset;
+      usize meshlet_offset = 0;
+      for(u32 i = 0; i < chunk_jobs.primitive_count; ++i)
+      {
+         const gltf_primitive_job* job = chunk_jobs.primitives + i;
+
+         if(job->meshlets.count > 0)
+            memcpy(meshlets + meshlet_offset, job->meshlets.data, job->meshlets.count*sizeof(meshlet));
+
+         draws[i] = (gltf_stream_draw)
+         {
+            .vertex_offset = vertex_offset,
+            .vertex_count = job->vertex_count,
+            .index_offset = index_offset,
+            .index_count = job->index_count,
+            .meshlet_offset = chunk.meshlet_offset + meshlet_offset,
+            .meshlet_count = job->meshlets.count,
+         };
+
+         vertex_offset += job->vertex_count;
+         index_offset += job->index_count;
+         meshlet_offset += job->meshlets.count;
+      }
+
+      chunk.vertices = vertices;
+      chunk.indices = indices;
+      chunk.meshlets = meshlets;
+      chunk.draws = draws;
+      chunk.vertex_count = vertex_count;
+      chunk.index_count = index_count;
+      chunk.meshlet_count = meshlet_count;
+      chunk.scratch = &chunk_scratch;
+
+      if(!sink(user, &chunk))
+         return false;
+
+      const size chunk_bytes = (size)((byte*)chunk_scratch.beg - (byte*)s.beg) + storage_bytes;
+      stats->peak_bytes = max(stats->peak_bytes, chunk_bytes);
+      stats->chunk_count++;
+      stats->vertex_count += vertex_count;
+      stats->index_count += index_count;
+      stats->meshlet_count += meshlet_count;
+
+      first = last;
+   }
+
+   return true;
+}
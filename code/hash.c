@@ -1,4 +1,4 @@
-#include "vulkan_shader_module.h"
+#include "common.h"
 
 #include <stdio.h>
 
@@ -71,6 +71,35 @@ static u32 hash(const char* key)
    return result;
 }
 
+// multiply and rotate over 8 byte words, for file contents and cache blobs at memory speed
+static u64 hash64(const void* data, size len)
+{
+   const u8* bytes = data;
+   const u64 k0 = 0xff51afd7ed558ccdull, k1 = 0xc4ceb9fe1a85ec53ull;
+
+   u64 h = 0x9e3779b97f4a7c15ull ^ (u64)len;
+   size i = 0;
+
+   for(; i + 8 <= len; i += 8)
+   {
+      u64 w;
+      memcpy(&w, bytes + i, sizeof(w));
+
+      h ^= w * k0;
+      h = ((h << 31) | (h >> 33)) * k1;
+   }
+
+   u64 tail = 0;
+   memcpy(&tail, bytes + i, len - i);
+
+   h ^= tail * k0;
+   h ^= h >> 33;
+   h *= k1;
+   h ^= h >> 33;
+
+   return h;
+}
+
 static void hash_insert(index_hash_table* table, hash_key_obj key, hash_value value)
 {
    if(table->count == table->max_count)
@@ -118,6 +147,10 @@ static hash_value hash_lookup(index_hash_table* table, hash_key_obj key)
    return ~0u;
 }
 
+// the shader modules need the vulkan headers, the bench has none
+#if defined(VK_VERSION_1_0)
+#include "vulkan_shader_module.h"
+
 static vk_shader_module spv_hash_lookup(spv_hash_table* table, const char* key)
 {
    u32 index = hash(key) % table->max_count;
@@ -193,3 +226,4 @@ static void spv_hash_function(spv_hash_table* table, void(*p)(void* ctx, vk_shad
       index = (index + 1) % table->max_count;
    }
 }
+#endif
@@ -161,6 +161,12 @@ void hw_event_loop_start(hw* hw, void (*app_frame_function)(arena scratch, app_s
 
    f64 log_delta = clock_time_to_counter(.5f);
 
+   // benchmark runs skip the first frames so that the pipelines and caches are warm
+   const u32 bench_warmup_frames = 16;
+   u32 bench_frame = 0;
+   f64 bench_cpu_seconds = 0.0;
+   f64 bench_gpu_seconds = 0.0;
+
    i64 begin = clock_query_counter();
    i64 fps_counter = begin;
    while(!hw->quit)
@@ -181,7 +187,8 @@ void hw_event_loop_start(hw* hw, void (*app_frame_function)(arena scratch, app_s
 
       hw_frame_render(hw);
       // sync to defined frame rate
-      hw_frame_sync(hw, 0.01666666666666666666666666666667);
+      if(!hw->state.bench_frames)
+         hw_frame_sync(hw, 0.01666666666666666666666666666667);
 
       i64 end = clock_query_counter();
 
@@ -193,6 +200,22 @@ void hw_event_loop_start(hw* hw, void (*app_frame_function)(arena scratch, app_s
 
       begin = end;
 
+      if(hw->state.bench_frames)
+      {
+         // the gpu time is of the last frame that finished, the frames in flight behind this one
+         if(bench_frame >= bench_warmup_frames)
+         {
+            bench_cpu_seconds += hw->state.frame_delta_in_seconds;
+            bench_gpu_seconds += hw->renderer.gpu_time(hw);
+         }
+
+         if(++bench_frame == bench_warmup_frames + hw->state.bench_frames)
+         {
+            hw->renderer.bench_log(hw, hw->state.bench_frames, bench_cpu_seconds, bench_gpu_seconds);
+            hw->quit = true;
+         }
+      }
+
       if(fps_counter >= log_delta)
       {
          hw->renderer.gpu_log(hw);
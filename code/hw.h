@@ -16,6 +16,7 @@
 #include "app.h"
 #include "arena.h"
 #include "common.h"
+#include "hw_job.h"
 
 #include "vulkan_ng.h"
 
@@ -52,6 +53,8 @@ align_struct hw_renderer
    void(*frame_present)(struct hw_renderer* renderer, void* context);
    void(*frame_resize)(struct hw_renderer* renderer, u32 width, u32 height);
    void(*gpu_log)(hw* hw);
+   f64(*gpu_time)(hw* hw);
+   void(*bench_log)(hw* hw, u32 frame_count, f64 cpu_seconds, f64 gpu_seconds);
 
    hw_result (*window_surface_create)(struct vk_allocator* allocator, void* instance, void* window_handle);
    vec2 (*window_size)(hw_window* window);
@@ -75,6 +78,7 @@ align_struct hw
    arena* vulkan_storage;
    arena scratch;
    hw_timer timer;
+   hw_jobs jobs;
    app_state state;
    void* main_fiber;
    void* message_fiber;
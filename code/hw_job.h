@@ -0,0 +1,29 @@
+#if !defined(_HW_JOB_H)
+#define _HW_JOB_H
+
+#include "common.h"
+#include "arena.h"
+
+// max workers including the calling thread
+#define HW_MAX_THREAD_COUNT 64
+
+// storage is private to the running thread and rewound at the start of every parallel_for,
+// allocations made by the jobs stay valid until the next parallel_for
+typedef void (*hw_job_function)(void* data, u32 job_index, arena* storage);
+
+align_struct hw_jobs
+{
+   void (*parallel_for)(struct hw_jobs* jobs, hw_job_function function, void* data, u32 job_count);
+
+   // parallel_for in steps, one batch at a time - begin wakes the workers and returns, help runs one job on
+   // the caller and is false once every job has started, wait runs what is left and joins the workers
+   void (*parallel_begin)(struct hw_jobs* jobs, hw_job_function function, void* data, u32 job_count);
+   bool (*parallel_help)(struct hw_jobs* jobs);
+   void (*parallel_wait)(struct hw_jobs* jobs);
+
+   arena thread_storage[HW_MAX_THREAD_COUNT];
+   u32 thread_count;
+   void* pool;    // platform workers, parked between the calls
+} hw_jobs;
+
+#endif
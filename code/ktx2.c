@@ -0,0 +1,385 @@
+#include "common.h"
+#include "arena.h"
+
+#include <stdio.h>
+
+// khronos ktx2 container of one 2d mip chain - rgba8 or one of the bc formats of texture_bc.c, no
+// supercompression, no arrays or faces. the writer stores the levels smallest first like the spec
+// asks and adds the data format descriptor, the KTXswizzle of bc5 channel 1 textures and the source
+// the chain was made from. the reader maps the file and hands the levels to the upload where they are
+
+#define KTX2_HEADER_SIZE 80
+#define KTX2_LEVEL_SIZE 24
+#define KTX2_SOURCE_SIZE 24
+#define KTX2_DATA_ALIGNMENT 16            // lcm of 4 and every block size we write
+
+// vkFormat values, the loader and the bench both read them without vulkan headers
+#define KTX2_FORMAT_R8G8B8A8_UNORM 37
+#define KTX2_FORMAT_BC1_RGB_UNORM 131
+#define KTX2_FORMAT_BC3_UNORM 137
+#define KTX2_FORMAT_BC4_UNORM 139
+#define KTX2_FORMAT_BC5_UNORM 141
+
+// data format descriptor, khr_df basic block
+#define KTX2_DF_MODEL_RGBSDA 1
+#define KTX2_DF_MODEL_BC1A 128
+#define KTX2_DF_MODEL_BC3 130
+#define KTX2_DF_MODEL_BC4 131
+#define KTX2_DF_MODEL_BC5 132
+#define KTX2_DF_PRIMARIES_BT709 1
+#define KTX2_DF_TRANSFER_LINEAR 1
+#define KTX2_DF_CHANNEL_ALPHA 15
+
+static const u8 ktx2_identifier[12] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+typedef struct ktx2_header
+{
+   u8 identifier[12];
+   u32 format;
+   u32 type_size;
+   u32 width;
+   u32 height;
+   u32 depth;
+   u32 layer_count;
+   u32 face_count;
+   u32 level_count;
+   u32 supercompression;
+   u32 dfd_offset;
+   u32 dfd_size;
+   u32 kvd_offset;
+   u32 kvd_size;
+   u64 sgd_offset;
+   u64 sgd_size;
+} ktx2_header;
+
+typedef struct ktx2_level
+{
+   u64 offset;
+   u64 size;
+   u64 uncompressed_size;
+} ktx2_level;
+
+static_assert(sizeof(ktx2_header) == KTX2_HEADER_SIZE && sizeof(ktx2_level) == KTX2_LEVEL_SIZE);
+
+// the encoded image and the roles a chain was made from, kept under the vulkan_ngSource key so a
+// reader can tell a chain of an older image apart. zero when the writer has no source
+typedef struct ktx2_source
+{
+   u64 hash;         // hash64 of the encoded image
+   u64 size;
+   u32 roles;        // gltf_texture_role the encoding was picked for
+   u32 mip_flags;
+} ktx2_source;
+
+static_assert(sizeof(ktx2_source) == KTX2_SOURCE_SIZE);
+
+static bool ktx2_source_equal(const ktx2_source* a, const ktx2_source* b)
+{
+   return a->hash == b->hash && a->size == b->size && a->roles == b->roles && a->mip_flags == b->mip_flags;
+}
+
+// a parsed file, the chain offsets are from pixels which points into the file
+align_struct ktx2_texture
+{
+   const u8* pixels;
+   texture_mip_chain mips;
+   texture_bc_encoding encoding;
+   ktx2_source source;
+} ktx2_texture;
+
+static const u32 ktx2_formats[texture_bc_format_count] =
+{
+   KTX2_FORMAT_R8G8B8A8_UNORM,
+   KTX2_FORMAT_BC1_RGB_UNORM,
+   KTX2_FORMAT_BC3_UNORM,
+   KTX2_FORMAT_BC4_UNORM,
+   KTX2_FORMAT_BC5_UNORM,
+};
+
+static const char ktx2_swizzle_gb[] = "0rg1";   // bc5 of green and blue read back in g and b
+static const char ktx2_writer[] = "vulkan_ng cook";
+
+static u32 ktx2_align4(u32 n)
+{
+   return (n + 3) & ~3u;
+}
+
+static u32 ktx2_dfd_sample_count(texture_bc_format format)
+{
+   return format == texture_bc_none ? 4 : format == texture_bc3 || format == texture_bc5 ? 2 : 1;
+}
+
+// one key value entry with its padding
+static u32 ktx2_kv_size(const char* key, u32 value_size)
+{
+   return 4 + ktx2_align4((u32)strlen(key) + 1 + value_size);
+}
+
+static u32 ktx2_kv_write(u8* out, const char* key, const void* value, u32 value_size)
+{
+   const u32 key_size = (u32)strlen(key) + 1;
+   const u32 length = key_size + value_size;
+
+   memcpy(out, &length, 4);
+   memcpy(out + 4, key, key_size);
+   memcpy(out + 4 + key_size, value, value_size);
+   memset(out + 4 + length, 0, ktx2_align4(length) - length);
+
+   return 4 + ktx2_align4(length);
+}
+
+static bool ktx2_swizzled(texture_bc_encoding encoding)
+{
+   return encoding.format == texture_bc5 && encoding.channel == 1;
+}
+
+static u32 ktx2_kvd_size(texture_bc_encoding encoding)
+{
+   u32 result = ktx2_kv_size("KTXwriter", sizeof(ktx2_writer)) + ktx2_kv_size("vulkan_ngSource", sizeof(ktx2_source));
+   if(ktx2_swizzled(encoding))
+      result += ktx2_kv_size("KTXswizzle", sizeof(ktx2_swizzle_gb));
+
+   return result;
+}
+
+// descriptor size word, block header and one sample per channel or per 64 bit half of a block
+static u32 ktx2_dfd_write(u8* out, texture_bc_encoding encoding)
+{
+   const texture_bc_format format = encoding.format;
+   const u32 sample_count = ktx2_dfd_sample_count(format);
+   const u32 block_size = 24 + 16*sample_count;
+
+   u32 words[4 + 6 + 4*4] = {0};
+   words[0] = 4 + block_size;
+   words[1] = 0;                                   // khronos vendor, basic descriptor
+   words[2] = 2 | (block_size << 16);              // version 2
+
+   static const u32 models[texture_bc_format_count] =
+      {KTX2_DF_MODEL_RGBSDA, KTX2_DF_MODEL_BC1A, KTX2_DF_MODEL_BC3, KTX2_DF_MODEL_BC4, KTX2_DF_MODEL_BC5};
+   words[3] = models[format] | (KTX2_DF_PRIMARIES_BT709 << 8) | (KTX2_DF_TRANSFER_LINEAR << 16);
+
+   // texel block dimensions minus one, then bytes of plane 0
+   words[4] = format == texture_bc_none ? 0 : 3 | (3 << 8);
+   words[5] = format == texture_bc_none ? 4 : texture_bc_block_size(format);
+
+   // bit offset, bit length minus one, channel, then the sample range
+   u32 channels[4] = {0, 1, 2, KTX2_DF_CHANNEL_ALPHA};
+   if(format == texture_bc3)
+      channels[0] = KTX2_DF_CHANNEL_ALPHA, channels[1] = 0;
+
+   for(u32 i = 0; i < sample_count; ++i)
+   {
+      u32* sample = words + 7 + 4*i;
+      const u32 bits = format == texture_bc_none ? 8 : 64;
+
+      sample[0] = (i*bits) | ((bits - 1) << 16) | (channels[i] << 24);
+      sample[2] = 0;
+      sample[3] = format == texture_bc_none ? 255 : 0xffffffff;
+   }
+
+   memcpy(out, words, words[0]);
+
+   return words[0];
+}
+
+static size ktx2_data_offset(const texture_mip_chain* mips, texture_bc_encoding encoding)
+{
+   const u32 header_size = KTX2_HEADER_SIZE + KTX2_LEVEL_SIZE*mips->level_count;
+   const u32 dfd_size = 4 + 24 + 16*ktx2_dfd_sample_count(encoding.format);
+
+   return (header_size + dfd_size + ktx2_kvd_size(encoding) + KTX2_DATA_ALIGNMENT - 1) & ~(size)(KTX2_DATA_ALIGNMENT - 1);
+}
+
+static size ktx2_file_size(const texture_mip_chain* mips, texture_bc_encoding encoding)
+{
+   return ktx2_data_offset(mips, encoding) + mips->size;
+}
+
+// out holds ktx2_file_size bytes, source may be null
+static void ktx2_write_to(u8* out, const u8* pixels, const texture_mip_chain* mips, texture_bc_encoding encoding, const ktx2_source* source)
+{
+   const ktx2_source no_source = {0};
+
+   const u32 level_count = mips->level_count;
+
+   ktx2_header header = {0};
+   memcpy(header.identifier, ktx2_identifier, sizeof(ktx2_identifier));
+   header.format = ktx2_formats[encoding.format];
+   header.type_size = 1;
+   header.width = mips->levels[0].width;
+   header.height = mips->levels[0].height;
+   header.face_count = 1;
+   header.level_count = level_count;
+
+   u32 offset = KTX2_HEADER_SIZE + KTX2_LEVEL_SIZE*level_count;
+
+   header.dfd_offset = offset;
+   header.dfd_size = ktx2_dfd_write(out + offset, encoding);
+   offset += header.dfd_size;
+
+   // keys in byte order
+   header.kvd_offset = offset;
+   if(ktx2_swizzled(encoding))
+      offset += ktx2_kv_write(out + offset, "KTXswizzle", ktx2_swizzle_gb, sizeof(ktx2_swizzle_gb));
+   offset += ktx2_kv_write(out + offset, "KTXwriter", ktx2_writer, sizeof(ktx2_writer));
+   offset += ktx2_kv_write(out + offset, "vulkan_ngSource", source ? source : &no_source, sizeof(ktx2_source));
+   header.kvd_size = offset - header.kvd_offset;
+
+   size data = ktx2_data_offset(mips, encoding);
+   memset(out + offset, 0, data - offset);
+
+   // smallest level first
+   for(u32 i = level_count; i-- > 0;)
+   {
+      const texture_mip_level* level = mips->levels + i;
+      const size level_size = texture_bc_level_size(level->width, level->height, encoding.format);
+
+      const ktx2_level entry = {data, level_size, level_size};
+      memcpy(out + KTX2_HEADER_SIZE + KTX2_LEVEL_SIZE*i, &entry, sizeof(entry));
+      memcpy(out + data, pixels + level->offset, level_size);
+
+      data += level_size;
+   }
+
+   memcpy(out, &header, sizeof(header));
+}
+
+static bool ktx2_write(s8 path, const u8* pixels, const texture_mip_chain* mips, texture_bc_encoding encoding, const ktx2_source* source)
+{
+   win32_file_view file = {0};
+   if(!win32_file_map_write(&file, s8_data(path), ktx2_file_size(mips, encoding)))
+   {
+      printf("Could not write ktx2 texture: %s\n", s8_data(path));
+      return false;
+   }
+
+   ktx2_write_to(file.data, pixels, mips, encoding, source);
+
+   win32_file_unmap(&file);
+
+   return true;
+}
+
+// the value of a key when there is one
+static const u8* ktx2_kv_find(const u8* data, const ktx2_header* header, const char* key, u32* value_size)
+{
+   const u8* kvd = data + header->kvd_offset;
+   u32 at = 0;
+
+   while(at + 4 <= header->kvd_size)
+   {
+      u32 length;
+      memcpy(&length, kvd + at, 4);
+      if(length > header->kvd_size - at - 4)
+         break;
+
+      const u8* entry = kvd + at + 4;
+      const u32 key_size = (u32)strlen(key) + 1;
+      if(length >= key_size && memcmp(entry, key, key_size) == 0)
+      {
+         *value_size = length - key_size;
+         return entry + key_size;
+      }
+
+      at += 4 + ktx2_align4(length);
+   }
+
+   return 0;
+}
+
+// checks everything the upload relies on - a known format, level sizes that match the extent and
+// level data inside the file
+static bool ktx2_parse(ktx2_texture* texture, const u8* data, size file_size)
+{
+   *texture = (ktx2_texture){0};
+
+   if(file_size < KTX2_HEADER_SIZE)
+      return false;
+
+   ktx2_header header;
+   memcpy(&header, data, sizeof(header));
+
+   if(memcmp(header.identifier, ktx2_identifier, sizeof(ktx2_identifier)) != 0)
+      return false;
+   if(header.supercompression != 0 || header.depth != 0 || header.layer_count > 1 || header.face_count != 1)
+      return false;
+   if(header.width == 0 || header.height == 0 || header.level_count == 0 || header.level_count > TEXTURE_MIP_MAX_LEVELS)
+      return false;
+   if(header.level_count > texture_mip_level_count(header.width, header.height))
+      return false;
+   if((u64)header.kvd_offset + header.kvd_size > (u64)file_size)
+      return false;
+   if(KTX2_HEADER_SIZE + KTX2_LEVEL_SIZE*(size)header.level_count > file_size)
+      return false;
+
+   texture_bc_encoding encoding = {texture_bc_format_count};
+   for(u32 i = 0; i < texture_bc_format_count; ++i)
+      if(ktx2_formats[i] == header.format)
+         encoding.format = (texture_bc_format)i;
+
+   if(encoding.format == texture_bc_format_count)
+      return false;
+
+   u32 swizzle_size = 0;
+   const u8* swizzle = ktx2_kv_find(data, &header, "KTXswizzle", &swizzle_size);
+   if(swizzle && swizzle_size >= 4 && memcmp(swizzle, ktx2_swizzle_gb, 4) == 0)
+   {
+      if(encoding.format != texture_bc5)
+         return false;
+      encoding.channel = 1;
+   }
+
+   const texture_mip_chain layout = texture_mip_chain_layout(header.width, header.height);
+
+   ktx2_level levels[TEXTURE_MIP_MAX_LEVELS];
+   memcpy(levels, data + KTX2_HEADER_SIZE, KTX2_LEVEL_SIZE*header.level_count);
+
+   u64 first = file_size, last = 0;
+   for(u32 i = 0; i < header.level_count; ++i)
+   {
+      const texture_mip_level* level = layout.levels + i;
+      if(levels[i].size != texture_bc_level_size(level->width, level->height, encoding.format))
+         return false;
+      if(levels[i].offset > file_size || levels[i].size > file_size - levels[i].offset)
+         return false;
+
+      first = min(first, levels[i].offset);
+      last = max(last, levels[i].offset + levels[i].size);
+   }
+
+   // the upload copies the span of all levels, the offsets stay block aligned inside it
+   const u32 alignment = encoding.format == texture_bc_none ? 4 : texture_bc_block_size(encoding.format);
+   if(first % alignment != 0)
+      return false;
+
+   u32 source_size = 0;
+   const u8* source = ktx2_kv_find(data, &header, "vulkan_ngSource", &source_size);
+   if(source && source_size == sizeof(ktx2_source))
+      memcpy(&texture->source, source, sizeof(ktx2_source));
+
+   texture->pixels = data + first;
+   texture->encoding = encoding;
+   texture->mips.level_count = header.level_count;
+   texture->mips.size = (size)(last - first);
+
+   for(u32 i = 0; i < header.level_count; ++i)
+      texture->mips.levels[i] = (texture_mip_level){(size)(levels[i].offset - first), layout.levels[i].width, layout.levels[i].height};
+
+   return true;
+}
+
+// the texture views the mapping until win32_file_unmap
+static bool ktx2_map(win32_file_view* file, ktx2_texture* texture, s8 path)
+{
+   if(!win32_file_map(file, s8_data(path)))
+      return false;
+
+   if(!ktx2_parse(texture, file->data, file->size))
+   {
+      printf("Bad ktx2 texture: %s\n", s8_data(path));
+      win32_file_unmap(file);
+      return false;
+   }
+
+   return true;
+}
@@ -479,6 +479,7 @@ typedef struct mvp_transform
     f32 n;
     f32 f;
     f32 ar;
+    u32 draw_offset;        // added to gl_DrawID, the first batch of a draw range
     bool draw_ground_plane; // TODO: Change to enum for different states
 } mvp_transform;
 #pragma pack(pop)
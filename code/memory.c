@@ -0,0 +1,230 @@
+#include "vulkan_ng.h"
+
+// device memory of the buffers and images - every memory type gets large blocks that the resources are
+// placed in by tlsf, so a scene makes a few device memory objects instead of one per resource. the
+// memory properties are read once. resources of half a block or more and the ones the driver prefers on
+// their own, like render targets, get a dedicated allocation
+
+static void vk_memory_init(vk_device* devices, arena* a)
+{
+   vk_memory* memory = &devices->memory;
+   *memory = (vk_memory){0};
+   memory->a = a;
+
+   vkGetPhysicalDeviceMemoryProperties(devices->physical, &memory->properties);
+
+   for(u32 i = 0; i < memory->properties.memoryHeapCount; ++i)
+   {
+      const VkDeviceSize heap_size = memory->properties.memoryHeaps[i].size;
+      memory->block_sizes[i] = heap_size >= MB(512) ? VK_MEMORY_BLOCK_SIZE : (heap_size / 8) & ~(TLSF_GRANULE - 1);
+   }
+}
+
+// first type of the requirements with every flag
+static u32 vk_memory_type(const vk_memory* memory, u32 type_bits, VkMemoryPropertyFlags flags)
+{
+   for(u32 i = 0; i < memory->properties.memoryTypeCount; ++i)
+      if((type_bits & (1u << i)) && (memory->properties.memoryTypes[i].propertyFlags & flags) == flags)
+         return i;
+
+   return VK_MAX_MEMORY_TYPES;
+}
+
+static bool vk_memory_host_visible(const vk_memory* memory, u32 type)
+{
+   return (memory->properties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+// device memory object of its own, mapped whole when host visible. dedicated_info names the resource or
+// is null
+static bool vk_memory_object_allocate(vk_device* devices, u32 type, VkDeviceSize bytes, const void* dedicated_info,
+                                      VkDeviceMemory* handle, void** data)
+{
+   VkMemoryAllocateFlagsInfo allocate_flags_info = {VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO};
+   allocate_flags_info.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+   allocate_flags_info.pNext = dedicated_info;
+
+   VkMemoryAllocateInfo allocate_info = {vk_info_allocate(MEMORY)};
+   allocate_info.allocationSize = bytes;
+   allocate_info.memoryTypeIndex = type;
+   allocate_info.pNext = &allocate_flags_info;
+
+   if(!vk_valid(vkAllocateMemory(devices->logical, &allocate_info, &global_allocator.handle, handle)))
+      return false;
+
+   *data = 0;
+   if(vk_memory_host_visible(&devices->memory, type))
+      if(!vk_valid(vkMapMemory(devices->logical, *handle, 0, VK_WHOLE_SIZE, 0, data)))
+      {
+         vkFreeMemory(devices->logical, *handle, &global_allocator.handle);
+         return false;
+      }
+
+   return true;
+}
+
+static bool vk_memory_block_create(vk_device* devices, u32 type, bool optimal, u32* block_index)
+{
+   vk_memory* memory = &devices->memory;
+
+   if(memory->block_count == VK_MEMORY_BLOCK_MAX)
+      return false;
+
+   const VkDeviceSize block_size = memory->block_sizes[memory->properties.memoryTypes[type].heapIndex];
+
+   vk_memory_block* block = memory->blocks + memory->block_count;
+   if(!vk_memory_object_allocate(devices, type, block_size, 0, &block->handle, &block->data))
+      return false;
+
+   tlsf_init(&block->placement, memory->a, block_size, VK_MEMORY_BLOCK_NODES);
+   block->type = type;
+   block->optimal = optimal;
+
+   *block_index = memory->block_count++;
+
+   return true;
+}
+
+// places the requirements in a block of their type and kind, a new block when none has room. large
+// requirements and the ones past the last block get device memory of their own
+static bool vk_memory_allocate(vk_device* devices, const VkMemoryRequirements* requirements, VkMemoryPropertyFlags flags, bool optimal,
+                               const void* dedicated_info, vk_memory_allocation* allocation)
+{
+   vk_memory* memory = &devices->memory;
+
+   const u32 type = vk_memory_type(memory, requirements->memoryTypeBits, flags);
+   if(type == VK_MAX_MEMORY_TYPES)
+      return false;
+
+   *allocation = (vk_memory_allocation){.size = requirements->size, .block = TLSF_NONE, .node = TLSF_NONE};
+
+   const VkDeviceSize block_size = memory->block_sizes[memory->properties.memoryTypes[type].heapIndex];
+
+   if(!dedicated_info && requirements->size < block_size / 2)
+   {
+      for(u32 i = 0; i <= memory->block_count; ++i)
+      {
+         if(i == memory->block_count && !vk_memory_block_create(devices, type, optimal, &i))
+            break;
+
+         vk_memory_block* block = memory->blocks + i;
+         if(block->type != type || block->optimal != optimal)
+            continue;
+
+         u64 offset = 0;
+         const u32 node = tlsf_alloc(&block->placement, requirements->size, requirements->alignment, &offset);
+         if(node == TLSF_NONE)
+            continue;
+
+         allocation->handle = block->handle;
+         allocation->offset = offset;
+         allocation->data = block->data ? (u8*)block->data + offset : 0;
+         allocation->block = i;
+         allocation->node = node;
+
+         return true;
+      }
+   }
+
+   if(!vk_memory_object_allocate(devices, type, requirements->size, dedicated_info, &allocation->handle, &allocation->data))
+      return false;
+
+   memory->dedicated_count++;
+   memory->dedicated_bytes += requirements->size;
+
+   return true;
+}
+
+// memory of the buffer, bound and mapped when host visible
+static bool vk_memory_buffer_bind(vk_device* devices, VkBuffer buffer, VkMemoryPropertyFlags flags, vk_memory_allocation* allocation)
+{
+   VkMemoryDedicatedRequirements dedicated = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+   VkMemoryRequirements2 requirements = {VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+   requirements.pNext = &dedicated;
+
+   VkBufferMemoryRequirementsInfo2 info = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2};
+   info.buffer = buffer;
+
+   vkGetBufferMemoryRequirements2(devices->logical, &info, &requirements);
+
+   VkMemoryDedicatedAllocateInfo dedicated_info = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO};
+   dedicated_info.buffer = buffer;
+
+   const bool own = dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation;
+   if(!vk_memory_allocate(devices, &requirements.memoryRequirements, flags, false, own ? &dedicated_info : 0, allocation))
+      return false;
+
+   return vk_valid(vkBindBufferMemory(devices->logical, buffer, allocation->handle, allocation->offset));
+}
+
+static bool vk_memory_image_bind(vk_device* devices, VkImage image, VkMemoryPropertyFlags flags, vk_memory_allocation* allocation)
+{
+   VkMemoryDedicatedRequirements dedicated = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS};
+   VkMemoryRequirements2 requirements = {VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2};
+   requirements.pNext = &dedicated;
+
+   VkImageMemoryRequirementsInfo2 info = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2};
+   info.image = image;
+
+   vkGetImageMemoryRequirements2(devices->logical, &info, &requirements);
+
+   VkMemoryDedicatedAllocateInfo dedicated_info = {VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO};
+   dedicated_info.image = image;
+
+   const bool own = dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation;
+   if(!vk_memory_allocate(devices, &requirements.memoryRequirements, flags, true, own ? &dedicated_info : 0, allocation))
+      return false;
+
+   return vk_valid(vkBindImageMemory(devices->logical, image, allocation->handle, allocation->offset));
+}
+
+// the range goes back to its block, which stays for the next resources
+static void vk_memory_free(vk_device* devices, vk_memory_allocation* allocation)
+{
+   vk_memory* memory = &devices->memory;
+
+   if(!vk_valid_handle(allocation->handle))
+      return;
+
+   if(allocation->block == TLSF_NONE)
+   {
+      vkFreeMemory(devices->logical, allocation->handle, &global_allocator.handle);
+
+      memory->dedicated_count--;
+      memory->dedicated_bytes -= allocation->size;
+   }
+   else
+      tlsf_free(&memory->blocks[allocation->block].placement, allocation->node);
+
+   *allocation = (vk_memory_allocation){0};
+}
+
+static void vk_memory_release(vk_device* devices)
+{
+   vk_memory* memory = &devices->memory;
+
+   for(u32 i = 0; i < memory->block_count; ++i)
+      vkFreeMemory(devices->logical, memory->blocks[i].handle, &global_allocator.handle);
+
+   memory->block_count = 0;
+}
+
+static void vk_memory_report(const vk_memory* memory)
+{
+   u64 block_bytes = 0, used = 0, largest_free = 0;
+   u32 allocation_count = 0;
+
+   for(u32 i = 0; i < memory->block_count; ++i)
+   {
+      const tlsf* placement = &memory->blocks[i].placement;
+
+      block_bytes += placement->size;
+      used += placement->used;
+      allocation_count += placement->allocation_count;
+      largest_free = max(largest_free, tlsf_largest_free(placement));
+   }
+
+   printf("Device memory: %u allocations in %u blocks (%.0f MB), %.1f%% used, largest free range %.1f MB, %u dedicated with %.1f MB\n",
+          allocation_count, memory->block_count, block_bytes / (f64)MB(1), block_bytes ? 100.0 * used / block_bytes : 0.0,
+          largest_free / (f64)MB(1), memory->dedicated_count, memory->dedicated_bytes / (f64)MB(1));
+}
@@ -0,0 +1,306 @@
+#include "meshlet.h"
+
+#include <float.h>
+#include <math.h>
+
+static void meshlet_add_new_vertex_index(u32 index, u8* meshlet_vertices, struct meshlet* ml)
+{
+   if(meshlet_vertices[index] == 0xff)
+   {
+      meshlet_vertices[index] = ml->vertex_count;
+
+      assert(meshlet_vertices[index] < array_count(ml->vertex_index_buffer));
+      // store index into the main vertex buffer
+      ml->vertex_index_buffer[meshlet_vertices[index]] = index;
+      ml->vertex_count++;
+   }
+}
+
+static void meshlet_build(array_meshlet* result, u8* meshlet_vertices, u32* index_buffer, size index_count, u32 index_offset, meshlet_limits limits)
+{
+   struct meshlet ml = {0};
+
+   usize max_vertex_count = limits.max_vertices;
+   usize max_triangle_count = limits.max_triangles;
+
+   assert(max_vertex_count > 0 && max_vertex_count <= array_count(ml.vertex_index_buffer));
+   assert(max_triangle_count > 0 && max_triangle_count <= array_count(ml.primitive_indices)/3);
+
+   for(size i = 0; i < index_count; i += 3)
+   {
+      // original per primitive (triangle indices)
+      u32 i0 = index_buffer[index_offset + i + 0];
+      u32 i1 = index_buffer[index_offset + i + 1];
+      u32 i2 = index_buffer[index_offset + i + 2];
+
+      // are the mesh vertex indices not used yet
+      bool mi0 = meshlet_vertices[i0] == 0xff;
+      bool mi1 = meshlet_vertices[i1] == 0xff;
+      bool mi2 = meshlet_vertices[i2] == 0xff;
+
+      // flush meshlet if vertexes or primitives overflow
+      if((ml.vertex_count + (mi0 + mi1 + mi2) > max_vertex_count) ||
+         (ml.triangle_count + 1 > max_triangle_count))
+      {
+         arrayp_push(result) = ml;
+
+         // clear the vertex indices used for this meshlet so that they can be used for the next one
+         for(u32 j = 0; j < ml.vertex_count; ++j)
+            meshlet_vertices[ml.vertex_index_buffer[j]] = 0xff;
+
+         // begin another meshlet
+         struct_clear(&ml);
+      }
+
+      meshlet_add_new_vertex_index(i0, meshlet_vertices, &ml);
+      meshlet_add_new_vertex_index(i1, meshlet_vertices, &ml);
+      meshlet_add_new_vertex_index(i2, meshlet_vertices, &ml);
+
+      assert(ml.triangle_count*3 + 2 < array_count(ml.primitive_indices));
+
+      assert(meshlet_vertices[i0] >= 0);
+      assert(meshlet_vertices[i1] >= 0);
+      assert(meshlet_vertices[i2] >= 0);
+
+      assert(meshlet_vertices[i0] <= ml.vertex_count);
+      assert(meshlet_vertices[i1] <= ml.vertex_count);
+      assert(meshlet_vertices[i2] <= ml.vertex_count);
+
+      ml.primitive_indices[ml.triangle_count * 3 + 0] = meshlet_vertices[i0];
+      ml.primitive_indices[ml.triangle_count * 3 + 1] = meshlet_vertices[i1];
+      ml.primitive_indices[ml.triangle_count * 3 + 2] = meshlet_vertices[i2];
+
+      ml.triangle_count++;   // primitive index triplet done
+
+      // within max bounds
+      assert(ml.vertex_count <= max_vertex_count);
+      assert(ml.triangle_count <= max_triangle_count);
+   }
+
+   // add any left over meshlets
+   if(ml.vertex_count > 0)
+      arrayp_push(result) = ml;
+
+   // leave the vertex marks clean for the next mesh
+   for(u32 j = 0; j < ml.vertex_count; ++j)
+      meshlet_vertices[ml.vertex_index_buffer[j]] = 0xff;
+}
+
+// spread the low 10 bits so that two zero bits sit between each of them
+static u32 meshlet_morton_spread(u32 v)
+{
+   v &= 0x3ff;
+   v = (v | (v << 16)) & 0x030000ff;
+   v = (v | (v << 8))  & 0x0300f00f;
+   v = (v | (v << 4))  & 0x030c30c3;
+   v = (v | (v << 2))  & 0x09249249;
+
+   return v;
+}
+
+// greedy builder fed with the triangles sorted along a morton curve of their centroids
+static void meshlet_build_spatial(array_meshlet* result, arena s, u8* meshlet_vertices, const vertex* vertices, u32* index_buffer, size index_count, u32 index_offset, meshlet_limits limits)
+{
+   const size triangle_count = index_count / 3;
+   if(triangle_count == 0)
+      return;
+
+   const u32* indices = index_buffer + index_offset;
+
+   f32* centroids = push(&s, f32, triangle_count*3);
+
+   f32 lo[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+   f32 hi[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+
+   for(size t = 0; t < triangle_count; ++t)
+   {
+      const vertex* v0 = vertices + indices[t*3 + 0];
+      const vertex* v1 = vertices + indices[t*3 + 1];
+      const vertex* v2 = vertices + indices[t*3 + 2];
+
+      f32* c = centroids + t*3;
+      c[0] = (v0->vx + v1->vx + v2->vx) * (1.f/3.f);
+      c[1] = (v0->vy + v1->vy + v2->vy) * (1.f/3.f);
+      c[2] = (v0->vz + v1->vz + v2->vz) * (1.f/3.f);
+
+      for(u32 k = 0; k < 3; ++k)
+      {
+         lo[k] = c[k] < lo[k] ? c[k] : lo[k];
+         hi[k] = c[k] > hi[k] ? c[k] : hi[k];
+      }
+   }
+
+   f32 extent = 0.f;
+   for(u32 k = 0; k < 3; ++k)
+      extent = hi[k] - lo[k] > extent ? hi[k] - lo[k] : extent;
+
+   const f32 scale = extent > 0.f ? 1023.f / extent : 0.f;
+
+   u32* keys = push(&s, u32, triangle_count);
+   u32* keys_sorted = push(&s, u32, triangle_count);
+   u32* order = push(&s, u32, triangle_count);
+   u32* order_sorted = push(&s, u32, triangle_count);
+
+   for(size t = 0; t < triangle_count; ++t)
+   {
+      const f32* c = centroids + t*3;
+
+      u32 x = (u32)((c[0] - lo[0]) * scale);
+      u32 y = (u32)((c[1] - lo[1]) * scale);
+      u32 z = (u32)((c[2] - lo[2]) * scale);
+
+      keys[t] = meshlet_morton_spread(x) | (meshlet_morton_spread(y) << 1) | (meshlet_morton_spread(z) << 2);
+      order[t] = (u32)t;
+   }
+
+   // stable lsd radix sort of the 30 bit keys
+   for(u32 shift = 0; shift < 32; shift += 8)
+   {
+      size histogram[256] = {0};
+
+      for(size t = 0; t < triangle_count; ++t)
+         histogram[(keys[t] >> shift) & 0xff]++;
+
+      size sum = 0;
+      for(u32 b = 0; b < 256; ++b)
+      {
+         size count = histogram[b];
+         histogram[b] = sum;
+         sum += count;
+      }
+
+      for(size t = 0; t < triangle_count; ++t)
+      {
+         size slot = histogram[(keys[t] >> shift) & 0xff]++;
+         keys_sorted[slot] = keys[t];
+         order_sorted[slot] = order[t];
+      }
+
+      u32* swap = keys; keys = keys_sorted; keys_sorted = swap;
+      swap = order; order = order_sorted; order_sorted = swap;
+   }
+
+   u32* sorted_indices = push(&s, u32, triangle_count*3);
+   for(size t = 0; t < triangle_count; ++t)
+   {
+      sorted_indices[t*3 + 0] = indices[order[t]*3 + 0];
+      sorted_indices[t*3 + 1] = indices[order[t]*3 + 1];
+      sorted_indices[t*3 + 2] = indices[order[t]*3 + 2];
+   }
+
+   meshlet_build(result, meshlet_vertices, sorted_indices, triangle_count*3, 0, limits);
+}
+
+// bounding sphere (ritter) and normal cone of a meshlet, vertices are the ones of the owning mesh
+static meshlet_bounds meshlet_bounds_compute(const meshlet* ml, const vertex* vertices)
+{
+   meshlet_bounds result = {0};
+
+   if(ml->vertex_count == 0)
+      return result;
+
+   #define meshlet_position(i) (f32[3]){vertices[ml->vertex_index_buffer[(i)]].vx, vertices[ml->vertex_index_buffer[(i)]].vy, vertices[ml->vertex_index_buffer[(i)]].vz}
+   #define meshlet_distance2(a, b) (((a)[0]-(b)[0])*((a)[0]-(b)[0]) + ((a)[1]-(b)[1])*((a)[1]-(b)[1]) + ((a)[2]-(b)[2])*((a)[2]-(b)[2]))
+
+   // farthest pair as the initial sphere
+   f32 p0[3], pa[3], pb[3];
+   memcpy(p0, meshlet_position(0), sizeof(p0));
+   memcpy(pa, p0, sizeof(pa));
+
+   f32 best = 0.f;
+   for(u32 i = 0; i < ml->vertex_count; ++i)
+   {
+      f32* p = meshlet_position(i);
+      f32 d = meshlet_distance2(p, p0);
+      if(d > best)
+      {
+         best = d;
+         memcpy(pa, p, sizeof(pa));
+      }
+   }
+
+   memcpy(pb, pa, sizeof(pb));
+   best = 0.f;
+   for(u32 i = 0; i < ml->vertex_count; ++i)
+   {
+      f32* p = meshlet_position(i);
+      f32 d = meshlet_distance2(p, pa);
+      if(d > best)
+      {
+         best = d;
+         memcpy(pb, p, sizeof(pb));
+      }
+   }
+
+   f32 center[3] = {(pa[0] + pb[0])*.5f, (pa[1] + pb[1])*.5f, (pa[2] + pb[2])*.5f};
+   f32 radius = sqrtf(best)*.5f;
+
+   // grow to include the stragglers
+   for(u32 i = 0; i < ml->vertex_count; ++i)
+   {
+      f32* p = meshlet_position(i);
+      f32 d = sqrtf(meshlet_distance2(p, center));
+      if(d > radius)
+      {
+         f32 grow = (d - radius)*.5f;
+         for(u32 k = 0; k < 3; ++k)
+            center[k] += (p[k] - center[k]) * (grow / d);
+         radius += grow;
+      }
+   }
+
+   memcpy(result.center, center, sizeof(center));
+   result.radius = radius;
+
+   // normal cone from the triangle normals
+   f32 normals[array_count(ml->primitive_indices)];
+   u32 normal_count = 0;
+   f32 axis[3] = {0};
+
+   for(u32 t = 0; t < ml->triangle_count; ++t)
+   {
+      f32* a = meshlet_position(ml->primitive_indices[t*3 + 0]);
+      f32* b = meshlet_position(ml->primitive_indices[t*3 + 1]);
+      f32* c = meshlet_position(ml->primitive_indices[t*3 + 2]);
+
+      f32 e0[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      f32 e1[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+      f32 n[3] = {e0[1]*e1[2] - e0[2]*e1[1], e0[2]*e1[0] - e0[0]*e1[2], e0[0]*e1[1] - e0[1]*e1[0]};
+
+      f32 len = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+      if(len <= FLT_EPSILON)
+         continue;   // degenerate
+
+      for(u32 k = 0; k < 3; ++k)
+      {
+         normals[normal_count*3 + k] = n[k] / len;
+         axis[k] += n[k] / len;
+      }
+      normal_count++;
+   }
+
+   #undef meshlet_position
+   #undef meshlet_distance2
+
+   f32 axis_len = sqrtf(axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2]);
+   if(normal_count == 0 || axis_len <= FLT_EPSILON)
+   {
+      result.cone_cutoff = 2.f;
+      return result;
+   }
+
+   for(u32 k = 0; k < 3; ++k)
+      result.cone_axis[k] = axis[k] / axis_len;
+
+   f32 min_dot = 1.f;
+   for(u32 i = 0; i < normal_count; ++i)
+   {
+      f32 d = normals[i*3 + 0]*result.cone_axis[0] + normals[i*3 + 1]*result.cone_axis[1] + normals[i*3 + 2]*result.cone_axis[2];
+      min_dot = d < min_dot ? d : min_dot;
+   }
+
+   // the cone spreads over the hemisphere
+   result.cone_cutoff = min_dot <= 0.f ? 2.f : sqrtf(1.f - min_dot*min_dot);
+
+   return result;
+}
@@ -0,0 +1,37 @@
+#if !defined(_MESHLET_H)
+#define _MESHLET_H
+
+#include "common.h"
+#include "arena.h"
+
+#include "../assets/shaders/mesh.h"
+
+typedef struct vertex vertex;
+typedef struct vertex_quantized vertex_quantized;
+typedef struct meshlet meshlet;
+
+typedef array(meshlet) array_meshlet;
+
+// local vertex indices are bytes and 0xff marks a vertex unused by the current meshlet
+static_assert(MESHLET_MAX_VERTICES > 0 && MESHLET_MAX_VERTICES < 0xff);
+static_assert(MESHLET_MAX_TRIANGLES > 0);
+
+// runtime limits of the builder, never above the storage of struct meshlet
+align_struct meshlet_limits
+{
+   u32 max_vertices;
+   u32 max_triangles;
+} meshlet_limits;
+
+#define meshlet_default_limits (meshlet_limits){MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES}
+
+// culling bounds of a single meshlet in mesh space
+align_struct meshlet_bounds
+{
+   f32 center[3];       // bounding sphere
+   f32 radius;
+   f32 cone_axis[3];    // normal cone
+   f32 cone_cutoff;     // sin of the cone spread - above 1 means the cone never culls
+} meshlet_bounds;
+
+#endif
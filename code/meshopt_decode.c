@@ -0,0 +1,665 @@
+#include "common.h"
+
+#include <immintrin.h>
+
+// decoders of the EXT_meshopt_compression buffer views - the attribute codec (byte columns of the vertices
+// delta coded against the previous vertex and bit packed in groups of 16), the triangle and sequence index
+// codecs and the octahedral, quaternion and exponential filters that run over the decoded attributes.
+// the attribute codec has a scalar and an sse path, pshufb is ssse3 which every cpu that runs the
+// renderer has
+
+#define MESHOPT_VERTEX_HEADER 0xa0
+#define MESHOPT_INDEX_HEADER 0xe0
+#define MESHOPT_SEQUENCE_HEADER 0xd0
+
+#define MESHOPT_VERTEX_BLOCK_BYTES 8192
+#define MESHOPT_VERTEX_BLOCK_MAX 256
+#define MESHOPT_GROUP_SIZE 16
+#define MESHOPT_GROUP_DECODE_LIMIT 24   // most bytes one group can read, the tail keeps this readable
+#define MESHOPT_TAIL_MIN 32
+
+static u32 meshopt_vertex_block_size(usize vertex_size)
+{
+   const usize result = (MESHOPT_VERTEX_BLOCK_BYTES / vertex_size) & ~(usize)(MESHOPT_GROUP_SIZE - 1);
+
+   return (u32)min(result, MESHOPT_VERTEX_BLOCK_MAX);
+}
+
+static u8 meshopt_unzigzag8(u8 v)
+{
+   return (u8)(-(v & 1) ^ (v >> 1));
+}
+
+// 16 values of 0, 2, 4 or 8 bits, most significant first. a value with all bits set takes the next
+// byte after the packed ones
+static const u8* meshopt_group_decode(const u8* data, u8* out, u32 bitslog2)
+{
+   if(bitslog2 == 0)
+   {
+      memset(out, 0, MESHOPT_GROUP_SIZE);
+      return data;
+   }
+   if(bitslog2 == 3)
+   {
+      memcpy(out, data, MESHOPT_GROUP_SIZE);
+      return data + MESHOPT_GROUP_SIZE;
+   }
+
+   const u32 bits = 1u << bitslog2;
+   const u32 sentinel = (1u << bits) - 1;
+   const u32 per_byte = 8 / bits;
+   const u8* extra = data + MESHOPT_GROUP_SIZE / per_byte;
+
+   for(u32 i = 0; i < MESHOPT_GROUP_SIZE; ++i)
+   {
+      const u32 shift = 8 - bits * (i % per_byte + 1);
+      const u32 value = (data[i / per_byte] >> shift) & sentinel;
+
+      out[i] = value == sentinel ? *extra++ : (u8)value;
+   }
+
+   return extra;
+}
+
+// byte k of the 8 byte shuffle of a 8 bit sentinel mask is the extra byte of lane k or 0x80 for none
+static u8 meshopt_group_shuffle[256][8];
+static u8 meshopt_group_count[256];
+static bool meshopt_tables_built;
+
+static void meshopt_tables_build(void)
+{
+   if(meshopt_tables_built)
+      return;
+
+   for(u32 mask = 0; mask < 256; ++mask)
+   {
+      u8 count = 0;
+      for(u32 k = 0; k < 8; ++k)
+         meshopt_group_shuffle[mask][k] = mask & (1u << k) ? count++ : 0x80;
+
+      meshopt_group_count[mask] = count;
+   }
+
+   meshopt_tables_built = true;
+}
+
+// moves the extra bytes into the lanes that hold a sentinel and keeps the packed values elsewhere
+static const u8* meshopt_group_sentinels(const u8* extra, __m128i values, __m128i sentinel, u8* out)
+{
+   const __m128i mask = _mm_cmpeq_epi8(values, sentinel);
+   const u32 mask16 = (u32)_mm_movemask_epi8(mask);
+   const u32 mask0 = mask16 & 0xff, mask1 = mask16 >> 8;
+
+   const __m128i shuffle0 = _mm_loadl_epi64((const __m128i*)meshopt_group_shuffle[mask0]);
+   const __m128i shuffle1 = _mm_add_epi8(_mm_loadl_epi64((const __m128i*)meshopt_group_shuffle[mask1]),
+                                         _mm_set1_epi8((char)meshopt_group_count[mask0]));
+   const __m128i shuffle = _mm_unpacklo_epi64(shuffle0, shuffle1);
+
+   const __m128i rest = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)extra), shuffle);
+   _mm_storeu_si128((__m128i*)out, _mm_or_si128(rest, _mm_andnot_si128(mask, values)));
+
+   return extra + meshopt_group_count[mask0] + meshopt_group_count[mask1];
+}
+
+// same as meshopt_group_decode, reads up to MESHOPT_GROUP_DECODE_LIMIT bytes
+static const u8* meshopt_group_decode_sse(const u8* data, u8* out, u32 bitslog2)
+{
+   switch(bitslog2)
+   {
+      case 0:
+      _mm_storeu_si128((__m128i*)out, _mm_setzero_si128());
+      return data;
+
+      case 1:
+      {
+         // every byte is split in two nibbles, every nibble in two pairs of bits, in order
+         i32 bytes;
+         memcpy(&bytes, data, sizeof(bytes));
+
+         const __m128i packed = _mm_cvtsi32_si128(bytes);
+         const __m128i nibbles = _mm_unpacklo_epi8(_mm_srli_epi16(packed, 4), packed);
+         const __m128i pairs = _mm_unpacklo_epi8(_mm_srli_epi16(nibbles, 2), nibbles);
+         const __m128i values = _mm_and_si128(pairs, _mm_set1_epi8(3));
+
+         return meshopt_group_sentinels(data + 4, values, _mm_set1_epi8(3), out);
+      }
+
+      case 2:
+      {
+         const __m128i packed = _mm_loadl_epi64((const __m128i*)data);
+         const __m128i nibbles = _mm_unpacklo_epi8(_mm_srli_epi16(packed, 4), packed);
+         const __m128i values = _mm_and_si128(nibbles, _mm_set1_epi8(15));
+
+         return meshopt_group_sentinels(data + 8, values, _mm_set1_epi8(15), out);
+      }
+
+      default:
+      _mm_storeu_si128((__m128i*)out, _mm_loadu_si128((const __m128i*)data));
+      return data + MESHOPT_GROUP_SIZE;
+   }
+}
+
+// count values in groups of 16 after a header of 2 bits per group, 0 when the data runs out
+static const u8* meshopt_bytes_decode(const u8* data, const u8* end, u8* out, usize count, bool simd)
+{
+   const usize group_count = count / MESHOPT_GROUP_SIZE;
+   const usize header_size = (group_count + 3) / 4;
+
+   if((usize)(end - data) < header_size)
+      return 0;
+
+   const u8* header = data;
+   data += header_size;
+
+   for(usize g = 0; g < group_count; ++g)
+   {
+      if((usize)(end - data) < MESHOPT_GROUP_DECODE_LIMIT)
+         return 0;
+
+      const u32 bitslog2 = (header[g / 4] >> ((g % 4) * 2)) & 3;
+      u8* group = out + g*MESHOPT_GROUP_SIZE;
+
+      data = simd ? meshopt_group_decode_sse(data, group, bitslog2) : meshopt_group_decode(data, group, bitslog2);
+   }
+
+   return data;
+}
+
+static const u8* meshopt_vertex_block_decode(const u8* data, const u8* end, u8* vertices, usize count, usize vertex_size, u8* last_vertex)
+{
+   u8 column[MESHOPT_VERTEX_BLOCK_MAX];
+   const usize count_aligned = (count + MESHOPT_GROUP_SIZE - 1) & ~(usize)(MESHOPT_GROUP_SIZE - 1);
+
+   for(usize k = 0; k < vertex_size; ++k)
+   {
+      data = meshopt_bytes_decode(data, end, column, count_aligned, false);
+      if(!data)
+         return 0;
+
+      u8 p = last_vertex[k];
+      for(usize i = 0; i < count; ++i)
+      {
+         p += meshopt_unzigzag8(column[i]);
+         vertices[i*vertex_size + k] = p;
+      }
+   }
+
+   memcpy(last_vertex, vertices + (count - 1)*vertex_size, vertex_size);
+
+   return data;
+}
+
+// unzigzag and a running sum of 16 deltas, the sum is four shifted adds
+static __m128i meshopt_deltas_sum(__m128i v, __m128i p)
+{
+   const __m128i negative = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+   v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f)), negative);
+
+   v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+   v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+   v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+   v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+
+   return _mm_add_epi8(v, p);
+}
+
+// decodes all columns of the block first, then sums four columns at a time and transposes them
+// into rows of u32. vertex_size is a multiple of 4
+static const u8* meshopt_vertex_block_decode_sse(const u8* data, const u8* end, u8* vertices, usize count, usize vertex_size, u8* last_vertex)
+{
+   u8 columns[MESHOPT_VERTEX_BLOCK_BYTES];
+   const usize count_aligned = (count + MESHOPT_GROUP_SIZE - 1) & ~(usize)(MESHOPT_GROUP_SIZE - 1);
+
+   for(usize k = 0; k < vertex_size; ++k)
+   {
+      data = meshopt_bytes_decode(data, end, columns + k*count_aligned, count_aligned, true);
+      if(!data)
+         return 0;
+   }
+
+   for(usize k = 0; k < vertex_size; k += 4)
+   {
+      const u8* c = columns + k*count_aligned;
+
+      __m128i p0 = _mm_set1_epi8((char)last_vertex[k + 0]);
+      __m128i p1 = _mm_set1_epi8((char)last_vertex[k + 1]);
+      __m128i p2 = _mm_set1_epi8((char)last_vertex[k + 2]);
+      __m128i p3 = _mm_set1_epi8((char)last_vertex[k + 3]);
+
+      for(usize i = 0; i < count; i += MESHOPT_GROUP_SIZE)
+      {
+         const __m128i r0 = meshopt_deltas_sum(_mm_loadu_si128((const __m128i*)(c + i)), p0);
+         const __m128i r1 = meshopt_deltas_sum(_mm_loadu_si128((const __m128i*)(c + count_aligned + i)), p1);
+         const __m128i r2 = meshopt_deltas_sum(_mm_loadu_si128((const __m128i*)(c + 2*count_aligned + i)), p2);
+         const __m128i r3 = meshopt_deltas_sum(_mm_loadu_si128((const __m128i*)(c + 3*count_aligned + i)), p3);
+
+         // the last byte of every column is the base of the next group
+         p0 = _mm_shuffle_epi8(r0, _mm_set1_epi8(15));
+         p1 = _mm_shuffle_epi8(r1, _mm_set1_epi8(15));
+         p2 = _mm_shuffle_epi8(r2, _mm_set1_epi8(15));
+         p3 = _mm_shuffle_epi8(r3, _mm_set1_epi8(15));
+
+         const __m128i t0 = _mm_unpacklo_epi8(r0, r1);
+         const __m128i t1 = _mm_unpackhi_epi8(r0, r1);
+         const __m128i t2 = _mm_unpacklo_epi8(r2, r3);
+         const __m128i t3 = _mm_unpackhi_epi8(r2, r3);
+
+         u32 rows[MESHOPT_GROUP_SIZE];
+         _mm_storeu_si128((__m128i*)rows + 0, _mm_unpacklo_epi16(t0, t2));
+         _mm_storeu_si128((__m128i*)rows + 1, _mm_unpackhi_epi16(t0, t2));
+         _mm_storeu_si128((__m128i*)rows + 2, _mm_unpacklo_epi16(t1, t3));
+         _mm_storeu_si128((__m128i*)rows + 3, _mm_unpackhi_epi16(t1, t3));
+
+         const usize row_count = min(count - i, MESHOPT_GROUP_SIZE);
+         for(usize j = 0; j < row_count; ++j)
+            memcpy(vertices + (i + j)*vertex_size + k, rows + j, sizeof(u32));
+      }
+   }
+
+   memcpy(last_vertex, vertices + (count - 1)*vertex_size, vertex_size);
+
+   return data;
+}
+
+// count vertices of vertex_size bytes, a multiple of 4 up to 256. the stream ends with the first vertex,
+// which is the base of the deltas of the first block
+static bool meshopt_vertices_decode_with(void* out, usize count, usize vertex_size, const u8* in, usize in_size, bool simd)
+{
+   if(vertex_size == 0 || vertex_size > 256 || vertex_size % 4 != 0)
+      return false;
+   if(in_size < 1 + vertex_size || (in[0] & 0xf0) != MESHOPT_VERTEX_HEADER || (in[0] & 0x0f) > 0)
+      return false;
+
+   if(simd)
+      meshopt_tables_build();
+
+   const u8* data = in + 1;
+   const u8* end = in + in_size;
+
+   u8 last_vertex[256];
+   memcpy(last_vertex, end - vertex_size, vertex_size);
+
+   const u32 block_size = meshopt_vertex_block_size(vertex_size);
+
+   for(usize offset = 0; offset < count && data; offset += block_size)
+   {
+      const usize block_count = min(count - offset, (usize)block_size);
+      u8* vertices = (u8*)out + offset*vertex_size;
+
+      data = simd ? meshopt_vertex_block_decode_sse(data, end, vertices, block_count, vertex_size, last_vertex)
+                  : meshopt_vertex_block_decode(data, end, vertices, block_count, vertex_size, last_vertex);
+   }
+
+   return data && (usize)(end - data) == max(vertex_size, (usize)MESHOPT_TAIL_MIN);
+}
+
+static bool meshopt_vertices_decode(void* out, usize count, usize vertex_size, const u8* in, usize in_size)
+{
+   return meshopt_vertices_decode_with(out, count, vertex_size, in, in_size, true);
+}
+
+// 7 bits per byte, low groups first
+static u32 meshopt_vbyte_decode(const u8** data)
+{
+   const u8* at = *data;
+   u32 result = 0;
+
+   for(u32 shift = 0; shift < 35; shift += 7)
+   {
+      const u8 group = *at++;
+      result |= (u32)(group & 127) << shift;
+
+      if(group < 128)
+         break;
+   }
+
+   *data = at;
+
+   return result;
+}
+
+static u32 meshopt_index_decode(const u8** data, u32 last)
+{
+   const u32 v = meshopt_vbyte_decode(data);
+
+   return last + ((v >> 1) ^ (0u - (v & 1)));
+}
+
+static void meshopt_index_write(void* out, usize i, usize index_size, u32 index)
+{
+   if(index_size == 2)
+      ((u16*)out)[i] = (u16)index;
+   else
+      ((u32*)out)[i] = index;
+}
+
+align_struct meshopt_index_fifos
+{
+   u32 edges[16][2];
+   u32 vertices[16];
+   u32 edge_offset;
+   u32 vertex_offset;
+} meshopt_index_fifos;
+
+static void meshopt_edge_push(meshopt_index_fifos* fifos, u32 a, u32 b)
+{
+   fifos->edges[fifos->edge_offset][0] = a;
+   fifos->edges[fifos->edge_offset][1] = b;
+   fifos->edge_offset = (fifos->edge_offset + 1) & 15;
+}
+
+static void meshopt_vertex_push(meshopt_index_fifos* fifos, u32 v, bool cond)
+{
+   fifos->vertices[fifos->vertex_offset] = v;
+   fifos->vertex_offset = (fifos->vertex_offset + cond) & 15;
+}
+
+static u32 meshopt_vertex_fifo(const meshopt_index_fifos* fifos, u32 back)
+{
+   return fifos->vertices[(fifos->vertex_offset - back) & 15];
+}
+
+// triangle list, one code byte per triangle. the code either reuses an edge of the last 16 and takes the
+// third vertex from the vertex fifo, the next new vertex or the data, or takes all three vertices that way.
+// the last 16 bytes are the table of the common vertex codes of the second kind
+static bool meshopt_indices_decode(void* out, usize index_count, usize index_size, const u8* in, usize in_size)
+{
+   if(index_count % 3 != 0 || (index_size != 2 && index_size != 4))
+      return false;
+   if(in_size < 1 + index_count/3 + 16 || (in[0] & 0xf0) != MESHOPT_INDEX_HEADER || (in[0] & 0x0f) > 1)
+      return false;
+
+   // version 1 codes 13 and 14 of the third vertex as the last free index -1 and +1
+   const u32 fec_max = (in[0] & 0x0f) >= 1 ? 13 : 15;
+
+   meshopt_index_fifos fifos = {0};
+   memset(fifos.edges, 0xff, sizeof(fifos.edges));
+   memset(fifos.vertices, 0xff, sizeof(fifos.vertices));
+
+   u32 next = 0, last = 0;
+
+   const u8* code = in + 1;
+   const u8* data = code + index_count/3;
+   const u8* data_end = in + in_size - 16;
+   const u8* code_table = data_end;
+
+   for(usize i = 0; i < index_count; i += 3)
+   {
+      // a triangle reads at most 16 bytes and the table pads the end
+      if(data > data_end)
+         return false;
+
+      const u8 codetri = *code++;
+      u32 a, b, c;
+
+      if(codetri < 0xf0)
+      {
+         const u32* edge = fifos.edges[(fifos.edge_offset - 1 - (codetri >> 4)) & 15];
+         const u32 fec = codetri & 15;
+         a = edge[0];
+         b = edge[1];
+
+         if(fec < fec_max)
+         {
+            c = fec == 0 ? next++ : meshopt_vertex_fifo(&fifos, 1 + fec);
+            meshopt_vertex_push(&fifos, c, fec == 0);
+         }
+         else
+         {
+            c = last = fec == 15 ? meshopt_index_decode(&data, last) : fec == 13 ? last - 1 : last + 1;
+            meshopt_vertex_push(&fifos, c, true);
+         }
+
+         meshopt_edge_push(&fifos, c, b);
+         meshopt_edge_push(&fifos, a, c);
+      }
+      else
+      {
+         // 0xfe and 0xff carry the vertex codes in the data, with the first vertex new or free
+         const bool table = codetri < 0xfe;
+         const u8 codeaux = table ? code_table[codetri & 15] : *data++;
+         const u32 fea = table || codetri == 0xfe ? 0 : 15;
+         const u32 feb = codeaux >> 4;
+         const u32 fec = codeaux & 15;
+
+         // a new first triangle restarts the numbering
+         if(!table && codeaux == 0)
+            next = 0;
+
+         a = fea == 0 ? next++ : 0;
+         b = feb == 0 ? next++ : meshopt_vertex_fifo(&fifos, feb);
+         c = fec == 0 ? next++ : meshopt_vertex_fifo(&fifos, fec);
+
+         if(fea == 15)
+            last = a = meshopt_index_decode(&data, last);
+         if(feb == 15)
+            last = b = meshopt_index_decode(&data, last);
+         if(fec == 15)
+            last = c = meshopt_index_decode(&data, last);
+
+         meshopt_vertex_push(&fifos, a, true);
+         meshopt_vertex_push(&fifos, b, feb == 0 || feb == 15);
+         meshopt_vertex_push(&fifos, c, fec == 0 || fec == 15);
+
+         meshopt_edge_push(&fifos, b, a);
+         meshopt_edge_push(&fifos, c, b);
+         meshopt_edge_push(&fifos, a, c);
+      }
+
+      meshopt_index_write(out, i + 0, index_size, a);
+      meshopt_index_write(out, i + 1, index_size, b);
+      meshopt_index_write(out, i + 2, index_size, c);
+   }
+
+   return data == data_end;
+}
+
+// any index list, every index is a zigzag delta against one of two previous indices, the low bit picks which
+static bool meshopt_index_sequence_decode(void* out, usize index_count, usize index_size, const u8* in, usize in_size)
+{
+   if(index_size != 2 && index_size != 4)
+      return false;
+   if(in_size < 1 + index_count + 4 || (in[0] & 0xf0) != MESHOPT_SEQUENCE_HEADER || (in[0] & 0x0f) > 1)
+      return false;
+
+   const u8* data = in + 1;
+   const u8* data_end = in + in_size - 4;
+   u32 last[2] = {0};
+
+   for(usize i = 0; i < index_count; ++i)
+   {
+      // an index reads at most 5 bytes, the 4 byte tail pads the end
+      if(data >= data_end)
+         return false;
+
+      u32 v = meshopt_vbyte_decode(&data);
+      const u32 baseline = v & 1;
+      v >>= 1;
+
+      last[baseline] += (v >> 1) ^ (0u - (v & 1));
+      meshopt_index_write(out, i, index_size, last[baseline]);
+   }
+
+   return data == data_end;
+}
+
+static i32 meshopt_round(f32 f)
+{
+   return (i32)(f + (f >= 0.0f ? 0.5f : -0.5f));
+}
+
+// x and y of the octahedron and z as the length, back to a vector of that length. w is left as it is
+static void meshopt_filter_octahedral_scalar(void* data, usize count, usize stride)
+{
+   for(usize i = 0; i < count; ++i)
+   {
+      i32 in[3];
+      for(u32 k = 0; k < 3; ++k)
+         in[k] = stride == 4 ? ((i8*)data)[i*4 + k] : ((i16*)data)[i*4 + k];
+
+      const f32 one = stride == 4 ? 127.0f : 32767.0f;
+
+      f32 x = (f32)in[0];
+      f32 y = (f32)in[1];
+      const f32 z = (f32)in[2] - fabsf(x) - fabsf(y);
+
+      // the lower hemisphere folds back over the diagonals
+      const f32 t = min(z, 0.0f);
+      x += x >= 0.0f ? t : -t;
+      y += y >= 0.0f ? t : -t;
+
+      const f32 s = one / sqrtf(x*x + y*y + z*z);
+      const i32 out[3] = {meshopt_round(x*s), meshopt_round(y*s), meshopt_round(z*s)};
+
+      for(u32 k = 0; k < 3; ++k)
+      {
+         if(stride == 4)
+            ((i8*)data)[i*4 + k] = (i8)out[k];
+         else
+            ((i16*)data)[i*4 + k] = (i16)out[k];
+      }
+   }
+}
+
+static __m128 meshopt_round_bias(__m128 f)
+{
+   // 0.5 with the sign of f, f is never negative zero
+   return _mm_or_ps(_mm_set1_ps(0.5f), _mm_and_ps(f, _mm_set1_ps(-0.0f)));
+}
+
+// x, y and z of four vectors as i32 lanes, back in the same lanes
+static void meshopt_octahedral_sse(__m128i* x, __m128i* y, __m128i* z, f32 one)
+{
+   const __m128 sign = _mm_set1_ps(-0.0f);
+
+   __m128 fx = _mm_cvtepi32_ps(*x);
+   __m128 fy = _mm_cvtepi32_ps(*y);
+   const __m128 fz = _mm_sub_ps(_mm_sub_ps(_mm_cvtepi32_ps(*z), _mm_andnot_ps(sign, fx)), _mm_andnot_ps(sign, fy));
+
+   const __m128 t = _mm_min_ps(fz, _mm_setzero_ps());
+   fx = _mm_add_ps(fx, _mm_xor_ps(t, _mm_and_ps(fx, sign)));
+   fy = _mm_add_ps(fy, _mm_xor_ps(t, _mm_and_ps(fy, sign)));
+
+   const __m128 l = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(fx, fx), _mm_mul_ps(fy, fy)), _mm_mul_ps(fz, fz)));
+   const __m128 s = _mm_div_ps(_mm_set1_ps(one), l);
+
+   fx = _mm_mul_ps(fx, s);
+   fy = _mm_mul_ps(fy, s);
+   const __m128 sz = _mm_mul_ps(fz, s);
+
+   *x = _mm_cvttps_epi32(_mm_add_ps(fx, meshopt_round_bias(fx)));
+   *y = _mm_cvttps_epi32(_mm_add_ps(fy, meshopt_round_bias(fy)));
+   *z = _mm_cvttps_epi32(_mm_add_ps(sz, meshopt_round_bias(sz)));
+}
+
+// stride 4 is i8 x4, stride 8 is i16 x4. four vectors at a time, the rest goes the scalar way
+static void meshopt_filter_octahedral(void* data, usize count, usize stride)
+{
+   const usize bulk = count & ~(usize)3;
+   u8* bytes = data;
+
+   for(usize i = 0; i < bulk; i += 4)
+   {
+      if(stride == 4)
+      {
+         __m128i* at = (__m128i*)(bytes + i*4);
+         const __m128i v = _mm_loadu_si128(at);
+
+         __m128i x = _mm_srai_epi32(_mm_slli_epi32(v, 24), 24);
+         __m128i y = _mm_srai_epi32(_mm_slli_epi32(v, 16), 24);
+         __m128i z = _mm_srai_epi32(_mm_slli_epi32(v, 8), 24);
+         meshopt_octahedral_sse(&x, &y, &z, 127.0f);
+
+         const __m128i bytes_mask = _mm_set1_epi32(0xff);
+         __m128i result = _mm_and_si128(v, _mm_set1_epi32((i32)0xff000000));
+         result = _mm_or_si128(result, _mm_and_si128(x, bytes_mask));
+         result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(y, bytes_mask), 8));
+         result = _mm_or_si128(result, _mm_slli_epi32(_mm_and_si128(z, bytes_mask), 16));
+         _mm_storeu_si128(at, result);
+      }
+      else
+      {
+         __m128i* at = (__m128i*)(bytes + i*8);
+         const __m128 lo = _mm_castsi128_ps(_mm_loadu_si128(at));
+         const __m128 hi = _mm_castsi128_ps(_mm_loadu_si128(at + 1));
+
+         // xy and zw pairs of the four vectors
+         const __m128i xy = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+         const __m128i zw = _mm_castps_si128(_mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+
+         __m128i x = _mm_srai_epi32(_mm_slli_epi32(xy, 16), 16);
+         __m128i y = _mm_srai_epi32(xy, 16);
+         __m128i z = _mm_srai_epi32(_mm_slli_epi32(zw, 16), 16);
+         meshopt_octahedral_sse(&x, &y, &z, 32767.0f);
+
+         const __m128i low_mask = _mm_set1_epi32(0xffff);
+         const __m128i out_xy = _mm_or_si128(_mm_and_si128(x, low_mask), _mm_slli_epi32(y, 16));
+         const __m128i out_zw = _mm_or_si128(_mm_and_si128(z, low_mask), _mm_andnot_si128(low_mask, zw));
+
+         _mm_storeu_si128(at, _mm_unpacklo_epi32(out_xy, out_zw));
+         _mm_storeu_si128(at + 1, _mm_unpackhi_epi32(out_xy, out_zw));
+      }
+   }
+
+   meshopt_filter_octahedral_scalar(bytes + bulk*stride, count - bulk, stride);
+}
+
+// three components of a unit quaternion scaled by sqrt 2, the largest one is dropped and rebuilt.
+// the low 2 bits of w say which one, the rest of w is the scale of the others
+static void meshopt_filter_quaternion(void* data, usize count)
+{
+   const f32 scale = 1.0f / sqrtf(2.0f);
+   i16* q = data;
+
+   for(usize i = 0; i < count; ++i, q += 4)
+   {
+      const f32 ss = scale / (f32)(q[3] | 3);
+
+      const f32 x = q[0] * ss;
+      const f32 y = q[1] * ss;
+      const f32 z = q[2] * ss;
+      const f32 w = sqrtf(max(1.0f - x*x - y*y - z*z, 0.0f));
+
+      const i32 qc = q[3] & 3;
+      const i16 out[4] = {(i16)meshopt_round(w*32767.0f), (i16)meshopt_round(x*32767.0f),
+                          (i16)meshopt_round(y*32767.0f), (i16)meshopt_round(z*32767.0f)};
+
+      for(u32 k = 0; k < 4; ++k)
+         q[(qc + k) & 3] = out[k];
+   }
+}
+
+// 24 bit signed mantissa and 8 bit signed exponent to f32
+static void meshopt_filter_exponential_scalar(u32* data, usize count)
+{
+   for(usize i = 0; i < count; ++i)
+   {
+      const i32 m = (i32)(data[i] << 8) >> 8;
+      const i32 e = (i32)data[i] >> 24;
+
+      const u32 bits = (u32)(e + 127) << 23;
+      f32 f;
+      memcpy(&f, &bits, sizeof(f));
+
+      f *= (f32)m;
+      memcpy(data + i, &f, sizeof(f));
+   }
+}
+
+// count is in u32 values
+static void meshopt_filter_exponential(u32* data, usize count)
+{
+   const usize bulk = count & ~(usize)3;
+
+   for(usize i = 0; i < bulk; i += 4)
+   {
+      const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+      const __m128i m = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+      const __m128i e = _mm_srai_epi32(v, 24);
+
+      const __m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(e, _mm_set1_epi32(127)), 23));
+      _mm_storeu_ps((f32*)(data + i), _mm_mul_ps(power, _mm_cvtepi32_ps(m)));
+   }
+
+   meshopt_filter_exponential_scalar(data + bulk, count - bulk);
+}
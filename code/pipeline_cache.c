@@ -0,0 +1,154 @@
+#include "vulkan_ng.h"
+
+// the pipeline cache of the driver kept next to the executable between launches. the file is a header
+// naming the device and driver it was made with followed by the blob vkGetPipelineCacheData returns.
+// a file of another device, driver or format version is ignored and the pipelines compile cold, the
+// blob is written again at exit
+
+#define VK_PIPELINE_CACHE_MAGIC 0x48435050u   // "PPCH"
+#define VK_PIPELINE_CACHE_VERSION 2
+#define VK_PIPELINE_CACHE_HEADER_SIZE 56
+
+// written as is, without padding
+typedef struct vk_pipeline_cache_header
+{
+   u32 magic;
+   u32 version;
+   u32 vendor_id;
+   u32 device_id;
+   u32 driver_version;
+   u32 unused;
+   u8 uuid[VK_UUID_SIZE];     // pipelineCacheUUID of the device
+   u64 data_size;
+   u64 data_hash;
+} vk_pipeline_cache_header;
+
+static_assert(sizeof(vk_pipeline_cache_header) == VK_PIPELINE_CACHE_HEADER_SIZE);
+
+// pipeline.cache in the directory of the executable
+static s8 vk_pipeline_cache_path(arena* a)
+{
+   s8 module_path = win32_module_path(a);
+
+   size dir_len = module_path.len;
+   while(dir_len > 0 && module_path.data[dir_len - 1] != '\\')
+      dir_len--;
+
+   const s8 name = s8("pipeline.cache");
+
+   s8 result = {push(a, u8, dir_len + name.len + 1), dir_len + name.len};
+   memcpy(result.data, module_path.data, dir_len);
+   memcpy(result.data + dir_len, name.data, name.len);
+   result.data[result.len] = 0;
+
+   return result;
+}
+
+static vk_pipeline_cache_header vk_pipeline_cache_header_make(const VkPhysicalDeviceProperties* props)
+{
+   vk_pipeline_cache_header result = {0};
+   result.magic = VK_PIPELINE_CACHE_MAGIC;
+   result.version = VK_PIPELINE_CACHE_VERSION;
+   result.vendor_id = props->vendorID;
+   result.device_id = props->deviceID;
+   result.driver_version = props->driverVersion;
+   memcpy(result.uuid, props->pipelineCacheUUID, VK_UUID_SIZE);
+
+   return result;
+}
+
+// both our header and the one the driver puts in front of its blob have to match this device
+static bool vk_pipeline_cache_valid(const VkPhysicalDeviceProperties* props, const void* file, size file_size)
+{
+   const vk_pipeline_cache_header* header = file;
+   const vk_pipeline_cache_header expected = vk_pipeline_cache_header_make(props);
+
+   if(file_size < sizeof(*header) || header->magic != expected.magic || header->version != expected.version)
+      return false;
+   if(header->vendor_id != expected.vendor_id || header->device_id != expected.device_id || header->driver_version != expected.driver_version)
+      return false;
+   if(memcmp(header->uuid, expected.uuid, VK_UUID_SIZE) != 0)
+      return false;
+   if(header->data_size != file_size - sizeof(*header) || header->data_size < sizeof(VkPipelineCacheHeaderVersionOne))
+      return false;
+
+   const u8* data = (const u8*)file + sizeof(*header);
+   if(hash64(data, header->data_size) != header->data_hash)
+      return false;
+
+   VkPipelineCacheHeaderVersionOne blob = {0};
+   memcpy(&blob, data, sizeof(blob));
+
+   return blob.headerSize >= sizeof(blob) && blob.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+          blob.vendorID == props->vendorID && blob.deviceID == props->deviceID &&
+          memcmp(blob.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+// seeded from the file when it belongs to this device and driver, empty otherwise
+static bool vk_pipeline_cache_create(vk_context* context)
+{
+   arena s = context->scratch;
+   VkPhysicalDeviceProperties props;
+   vkGetPhysicalDeviceProperties(context->devices.physical, &props);
+
+   const s8 path = vk_pipeline_cache_path(&s);
+
+   VkPipelineCacheCreateInfo cache_info = {vk_info(PIPELINE_CACHE)};
+
+   win32_file_view file = {0};
+   if(win32_file_map(&file, s8_data(path)))
+   {
+      if(vk_pipeline_cache_valid(&props, file.data, file.size))
+      {
+         cache_info.initialDataSize = file.size - sizeof(vk_pipeline_cache_header);
+         cache_info.pInitialData = (const u8*)file.data + sizeof(vk_pipeline_cache_header);
+         context->pipeline_cache_warm = true;
+      }
+      else
+         printf("Ignoring the stale pipeline cache %s\n", s8_data(path));
+   }
+
+   const bool result = vk_valid(vkCreatePipelineCache(context->devices.logical, &cache_info, &global_allocator.handle, &context->pipeline_cache));
+
+   // the driver copied the blob
+   win32_file_unmap(&file);
+
+   return result;
+}
+
+// the blob goes to scratch first since the driver may return less than the size it asked for, the file
+// is sized after. header last so a torn write never passes the magic check
+static bool vk_pipeline_cache_save(vk_context* context)
+{
+   arena s = context->scratch;
+   VkPhysicalDeviceProperties props;
+   vkGetPhysicalDeviceProperties(context->devices.physical, &props);
+
+   size data_size = 0;
+   if(!vk_valid(vkGetPipelineCacheData(context->devices.logical, context->pipeline_cache, &data_size, 0)) || data_size == 0)
+      return false;
+
+   u8* data = push(&s, u8, data_size);
+   if(!vk_valid(vkGetPipelineCacheData(context->devices.logical, context->pipeline_cache, &data_size, data)) || data_size == 0)
+      return false;
+
+   const s8 path = vk_pipeline_cache_path(&s);
+
+   win32_file_view file = {0};
+   if(!win32_file_map_write(&file, s8_data(path), sizeof(vk_pipeline_cache_header) + data_size))
+   {
+      printf("Could not write the pipeline cache %s\n", s8_data(path));
+      return false;
+   }
+
+   vk_pipeline_cache_header header = vk_pipeline_cache_header_make(&props);
+   header.data_size = data_size;
+   header.data_hash = hash64(data, data_size);
+
+   memcpy((u8*)file.data + sizeof(header), data, data_size);
+   memcpy(file.data, &header, sizeof(header));
+
+   win32_file_unmap(&file);
+
+   return true;
+}
@@ -34,6 +34,33 @@ static bool rt_blas_geometry_build(arena s, vk_context* context, VkAccelerationS
    VkDeviceAddress ib_address = buffer_device_address(ib, devices);
    VkDeviceAddress vb_address = buffer_device_address(vb, devices);
 
+   // quantized positions are placed by a per geometry transform from their bounds
+   vk_buffer transform_buffer = {.size = geometry_count * sizeof(VkTransformMatrixKHR)};
+   VkDeviceAddress transform_address = 0;
+
+   if(VERTEX_QUANTIZED)
+   {
+      if(!vk_buffer_create_and_bind(&transform_buffer, devices,
+         VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+         return false;
+
+      VkTransformMatrixKHR* transforms = transform_buffer.data;
+      for(size i = 0; i < geometry_count; ++i)
+      {
+         const vk_mesh_draw* draw = geometry->mesh_draws.data + i;
+
+         transforms[i] = (VkTransformMatrixKHR){0};
+         for(u32 k = 0; k < 3; ++k)
+         {
+            transforms[i].matrix[k][k] = draw->position_extent[k];
+            transforms[i].matrix[k][3] = draw->position_center[k];
+         }
+      }
+
+      transform_address = buffer_device_address(&transform_buffer, devices);
+   }
+
    for(size i = 0; i < geometry_count; ++i)
    {
       vk_mesh_draw* draw = geometry->mesh_draws.data + i;
@@ -43,19 +70,22 @@ static bool rt_blas_geometry_build(arena s, vk_context* context, VkAccelerationS
 
       VkAccelerationStructureGeometryKHR* ag = acceleration_geometries + i;
 
-      // vertex format must match VK_FORMAT_R32G32B32_SFLOAT
+      // vertex format must match VK_FORMAT_R32G32B32_SFLOAT or the snorm16 xyzw of the quantized vertex
       static_assert(offsetof(vertex, vz) == offsetof(vertex, vx) + sizeof(float) * 2);
+      static_assert(offsetof(vertex_quantized, pzw) == offsetof(vertex_quantized, pxy) + sizeof(u32));
 
       ag->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
       ag->geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
       ag->flags = VK_GEOMETRY_OPAQUE_BIT_KHR;
 
       ag->geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-      ag->geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
-      ag->geometry.triangles.vertexStride = sizeof(vertex);
+      ag->geometry.triangles.vertexFormat = VERTEX_QUANTIZED ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+      ag->geometry.triangles.vertexStride = sizeof(vertex_gpu);
       ag->geometry.triangles.maxVertex = (u32)draw->vertex_count - 1;
       ag->geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
-      ag->geometry.triangles.vertexData.deviceAddress = vb_address + (draw->vertex_offset * sizeof(vertex));
+      ag->geometry.triangles.vertexData.deviceAddress = vb_address + (draw->vertex_offset * sizeof(vertex_gpu));
+      if(VERTEX_QUANTIZED)
+         ag->geometry.triangles.transformData.deviceAddress = transform_address + i * sizeof(VkTransformMatrixKHR);
       ag->geometry.triangles.indexData.deviceAddress = ib_address + (draw->index_offset * sizeof(u32));
 
       VkAccelerationStructureBuildGeometryInfoKHR build_info =
@@ -155,6 +185,8 @@ static bool rt_blas_geometry_build(arena s, vk_context* context, VkAccelerationS
       return false;
 
    vk_buffer_destroy(devices, &scratch_buffer);
+   if(VERTEX_QUANTIZED)
+      vk_buffer_destroy(devices, &transform_buffer);
 
    return true;
 }
@@ -299,6 +331,9 @@ static bool rt_acceleration_structures_create(vk_context* context)
 
    arena* a = context->app_storage;
 
+   // the builds read the geometry, its copies go on the queue ahead of them
+   vk_upload_flush(context);
+
    if(!vk_valid(vkResetCommandPool(devices->logical, context->cmd.pool, 0)))
       return false;
 
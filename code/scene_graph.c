@@ -0,0 +1,172 @@
+#include "common.h"
+#include "arena.h"
+#include "math.h"
+
+// flattened node hierarchy - nodes are sorted so every parent comes before its children, the local
+// transforms are kept as separate translation, rotation and scale arrays and the world matrices are
+// computed in one linear pass that only touches the dirty nodes and their descendants
+
+#define SCENE_GRAPH_ROOT 0xffffffffu
+
+align_struct scene_graph
+{
+   u32 count;
+   u32* parent;            // sorted index of the parent or SCENE_GRAPH_ROOT
+   u32* source;            // sorted index to the index the node was built from
+   u32* sorted;            // and back
+   f32* translation[3];    // soa, one array per component
+   f32* rotation[4];       // quaternion xyzw
+   f32* scale[3];
+   mat4* world;
+   u8* dirty;
+   u32 dirty_first;        // no node before this one is dirty, count when none is
+} scene_graph;
+
+// sorts the nodes breadth first from their roots. source_parents holds the parent of each node or
+// SCENE_GRAPH_ROOT, the hierarchy must be a forest. all transforms start as identity and dirty
+static bool scene_graph_build(scene_graph* graph, arena* a, const u32* source_parents, u32 count)
+{
+   *graph = (scene_graph){0};
+   if(count == 0)
+      return true;
+
+   graph->source = push(a, u32, count);
+   graph->sorted = push(a, u32, count);
+   graph->parent = push(a, u32, count);
+
+   for(u32 k = 0; k < 3; ++k)
+   {
+      graph->translation[k] = push(a, f32, count);
+      graph->scale[k] = push(a, f32, count);
+   }
+   for(u32 k = 0; k < 4; ++k)
+      graph->rotation[k] = push(a, f32, count);
+
+   graph->world = push(a, mat4, count);
+   graph->dirty = push(a, u8, count);
+
+   // children of every node packed one after another, only needed for the sort
+   arena s = *a;
+   u32* child_first = push(&s, u32, count + 1);
+   u32* child_fill = push(&s, u32, count);
+   u32* children = push(&s, u32, count);
+
+   for(u32 i = 0; i < count; ++i)
+      if(source_parents[i] != SCENE_GRAPH_ROOT)
+         child_first[source_parents[i] + 1]++;
+
+   for(u32 i = 0; i < count; ++i)
+      child_first[i + 1] += child_first[i];
+
+   memcpy(child_fill, child_first, count * sizeof(u32));
+
+   for(u32 i = 0; i < count; ++i)
+      if(source_parents[i] != SCENE_GRAPH_ROOT)
+         children[child_fill[source_parents[i]]++] = i;
+
+   // the sorted order is the queue of the walk
+   u32 sorted_count = 0;
+   for(u32 i = 0; i < count; ++i)
+      if(source_parents[i] == SCENE_GRAPH_ROOT)
+         graph->source[sorted_count++] = i;
+
+   for(u32 at = 0; at < sorted_count; ++at)
+   {
+      const u32 node = graph->source[at];
+      graph->sorted[node] = at;
+
+      for(u32 c = child_first[node]; c < child_first[node + 1]; ++c)
+         graph->source[sorted_count++] = children[c];
+   }
+
+   // a cycle is never reached from a root
+   if(sorted_count != count)
+   {
+      printf("Could not sort the scene graph: %u of %u nodes are not reachable from a root\n", count - sorted_count, count);
+      return false;
+   }
+
+   for(u32 i = 0; i < count; ++i)
+   {
+      const u32 parent = source_parents[graph->source[i]];
+      graph->parent[i] = parent == SCENE_GRAPH_ROOT ? SCENE_GRAPH_ROOT : graph->sorted[parent];
+
+      graph->rotation[3][i] = 1.0f;
+      graph->scale[0][i] = graph->scale[1][i] = graph->scale[2][i] = 1.0f;
+   }
+
+   pointer_clear_to(graph->dirty, 1, count);
+
+   graph->count = count;
+   graph->dirty_first = 0;
+
+   return true;
+}
+
+static void scene_graph_dirty(scene_graph* graph, u32 node)
+{
+   graph->dirty[node] = 1;
+   graph->dirty_first = min(graph->dirty_first, node);
+}
+
+// node is a sorted index, a null component keeps its current value
+static void scene_graph_local_set(scene_graph* graph, u32 node, const f32 translation[3], const f32 rotation[4], const f32 scale[3])
+{
+   for(u32 k = 0; k < 3 && translation; ++k)
+      graph->translation[k][node] = translation[k];
+   for(u32 k = 0; k < 4 && rotation; ++k)
+      graph->rotation[k][node] = rotation[k];
+   for(u32 k = 0; k < 3 && scale; ++k)
+      graph->scale[k][node] = scale[k];
+
+   scene_graph_dirty(graph, node);
+}
+
+// local matrix from the trs of a node, column major like quaternion_to_matrix
+static mat4 scene_graph_local(const scene_graph* graph, u32 node)
+{
+   const f32 q[4] = {graph->rotation[0][node], graph->rotation[1][node], graph->rotation[2][node], graph->rotation[3][node]};
+   const f32 s[3] = {graph->scale[0][node], graph->scale[1][node], graph->scale[2][node]};
+
+   mat4 result;
+   quaternion_to_matrix(q, result.data);
+
+   for(u32 c = 0; c < 3; ++c)
+      for(u32 r = 0; r < 3; ++r)
+         result.data[c*4 + r] *= s[c];
+
+   result.data[12] = graph->translation[0][node];
+   result.data[13] = graph->translation[1][node];
+   result.data[14] = graph->translation[2][node];
+
+   return result;
+}
+
+// parents are updated before their children so the dirty flag flows down in the same pass,
+// returns the number of world matrices that were recomputed
+static u32 scene_graph_update(scene_graph* graph)
+{
+   u32 updated = 0;
+
+   for(u32 i = graph->dirty_first; i < graph->count; ++i)
+   {
+      const u32 parent = graph->parent[i];
+
+      if(parent != SCENE_GRAPH_ROOT)
+         graph->dirty[i] |= graph->dirty[parent];
+
+      if(!graph->dirty[i])
+         continue;
+
+      const mat4 local = scene_graph_local(graph, i);
+      graph->world[i] = parent == SCENE_GRAPH_ROOT ? local : mat4_mul(graph->world[parent], local);
+      updated++;
+   }
+
+   if(graph->dirty_first < graph->count)
+      pointer_clear(graph->dirty + graph->dirty_first, graph->count - graph->dirty_first);
+
+   graph->dirty_first = graph->count;
+
+   return updated;
+}
@@ -1,12 +1,17 @@
 #include "vulkan_ng.h"
 
-#define STBI_NO_SIMD
 #define STB_IMAGE_IMPLEMENTATION
 
 #include "../extern/stb_image.h"
 
+#include "texture_mip.c"
+#include "texture_bc.c"
+#include "ktx2.c"
+#include "texture_stream.c"
+
 // TODO: wide contract
-static VkImageView vk_image_view_create(vk_device* devices, VkFormat format, VkImage image, VkImageAspectFlags aspect_mask)
+static VkImageView vk_image_view_create(vk_device* devices, VkFormat format, VkImage image, VkImageAspectFlags aspect_mask, u32 level_count,
+                                        VkComponentMapping components)
 {
    VkImageView image_view = 0;
 
@@ -14,9 +19,10 @@ static VkImageView vk_image_view_create(vk_device* devices, VkFormat format, VkI
    view_info.image = image;
    view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
    view_info.format = format;
+   view_info.components = components;
    view_info.subresourceRange.aspectMask = aspect_mask;
    view_info.subresourceRange.layerCount = 1;
-   view_info.subresourceRange.levelCount = 1;
+   view_info.subresourceRange.levelCount = level_count;
 
    if(!vk_valid(vkCreateImageView(devices->logical, &view_info, &global_allocator.handle, &image_view)))
       return VK_NULL_HANDLE;
@@ -24,13 +30,13 @@ static VkImageView vk_image_view_create(vk_device* devices, VkFormat format, VkI
    return image_view;
 }
 
-static bool vk_image_create(vk_image* image, vk_device* devices, VkFormat format, VkExtent3D extent, VkImageUsageFlags usage)
+static bool vk_image_create(vk_image* image, vk_device* devices, VkFormat format, VkExtent3D extent, u32 level_count, VkImageUsageFlags usage)
 {
    VkImageCreateInfo image_info = {0};
    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
    image_info.imageType = VK_IMAGE_TYPE_2D; 
    image_info.extent = extent;
-   image_info.mipLevels = 1;
+   image_info.mipLevels = level_count;
    image_info.arrayLayers = 1;
    image_info.format = format;
    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
@@ -44,129 +50,298 @@ static bool vk_image_create(vk_image* image, vk_device* devices, VkFormat format
    if(vkCreateImage(devices->logical, &image_info, &global_allocator.handle, &image->handle) != VK_SUCCESS)
       return false;
 
-   VkMemoryRequirements memory_requirements;
-   vkGetImageMemoryRequirements(devices->logical, image->handle, &memory_requirements);
+   return vk_memory_image_bind(devices, image->handle, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &image->allocation);
+}
 
-   VkMemoryAllocateInfo alloc_info = {0};
-   alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-   alloc_info.allocationSize = memory_requirements.size;
+static bool vk_depth_image_create(vk_image* image, vk_device* devices, VkFormat format, VkExtent3D extent)
+{
+   return vk_image_create(image, devices, format, extent, 1, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+}
 
-   VkPhysicalDeviceMemoryProperties memory_properties;
-   vkGetPhysicalDeviceMemoryProperties(devices->physical, &memory_properties);
+// bytes of a mip chain, block_size is the bytes of a 4x4 block or 0 for rgba8
+static size vk_texture_size_blocked(u32 w, u32 h, u32 levels, u32 block_size)
+{
+   size result = 0;
 
-   uint32_t memory_type_index = VK_MAX_MEMORY_TYPES;
-   for(uint32_t i = 0; i < memory_properties.memoryTypeCount; ++i)
-      if((memory_requirements.memoryTypeBits & (1 << i)) &&
-          (memory_properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
-      {
-         memory_type_index = i;
-         break;
-      }
+   for(u32 i = 0; i < levels; ++i)
+   {
+      result += block_size ? (size)((w + 3) / 4) * ((h + 3) / 4) * block_size : (size)w * h * 4;
 
-   if(memory_type_index == VK_MAX_MEMORY_TYPES)
-      return false;
+      w = max(w >> 1, 1u);
+      h = max(h >> 1, 1u);
+   }
+
+   return result;
+}
 
-   alloc_info.memoryTypeIndex = memory_type_index;
+static size vk_texture_size(u32 w, u32 h, u32 levels)
+{
+   return vk_texture_size_blocked(w, h, levels, 0);
+}
 
-   VkDeviceMemory memory;
-   if(vkAllocateMemory(devices->logical, &alloc_info, &global_allocator.handle, &memory) != VK_SUCCESS)
+static const VkFormat vk_texture_formats[texture_bc_format_count] =
+{
+   VK_FORMAT_R8G8B8A8_UNORM,
+   VK_FORMAT_BC1_RGB_UNORM_BLOCK,
+   VK_FORMAT_BC3_UNORM_BLOCK,
+   VK_FORMAT_BC4_UNORM_BLOCK,
+   VK_FORMAT_BC5_UNORM_BLOCK,
+};
+
+// bc4 and bc5 of later channels put them back where the shaders read them
+static VkComponentMapping vk_texture_components(texture_bc_encoding encoding)
+{
+   VkComponentMapping result = {0};
+
+   if(encoding.format == texture_bc5 && encoding.channel == 1)
+      result = (VkComponentMapping){VK_COMPONENT_SWIZZLE_ZERO, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_G, VK_COMPONENT_SWIZZLE_ONE};
+
+   return result;
+}
+
+// image of the levels of a chain from first_level down, their texels are uploaded after
+static bool vk_texture_image_create(vk_context* context, vk_texture* tex, const texture_mip_chain* mips, texture_bc_encoding encoding, u32 first_level)
+{
+   if(mips->size == 0 || first_level >= mips->level_count)
       return false;
 
-   image->memory = memory;
+   // the levels from first_level on are the tail of the chain
+   const texture_mip_level* first = mips->levels + first_level;
+   const u32 level_count = mips->level_count - first_level;
 
-   if(vkBindImageMemory(devices->logical, image->handle, memory, 0) != VK_SUCCESS)
+   VkExtent3D extents = {.width = first->width, .height = first->height, .depth = 1};
+   VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+   VkFormat format = vk_texture_formats[encoding.format];
+
+   vk_image image = {0};
+   if(!vk_image_create(&image, &context->devices, format, extents, level_count, usage))
       return false;
 
+   VkImageView image_view = vk_image_view_create(&context->devices, format, image.handle, VK_IMAGE_ASPECT_COLOR_BIT, level_count,
+                                                 vk_texture_components(encoding));
+
+   tex->image.handle = image.handle;
+   tex->image.allocation = image.allocation;
+   tex->image.view = image_view;
+
    return true;
 }
 
-static bool vk_depth_image_create(vk_image* image, vk_device* devices, VkFormat format, VkExtent3D extent)
+// copies the range of the chain from begin to end into the image of its levels from first_level, the range
+// holds whole rows of texels or blocks. pixels are the whole chain
+static void vk_texture_upload(vk_context* context, const vk_texture* tex, const u8* pixels, const texture_mip_chain* mips, texture_bc_encoding encoding,
+                              u32 first_level, size begin, size end)
 {
-   return vk_image_create(image, devices, format, extent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+   const u32 block_size = encoding.format == texture_bc_none ? 0 : texture_bc_block_size(encoding.format);
+   const u32 row_height = block_size ? 4 : 1;
+
+   // one region per level the range touches, each staged on its own
+   VkBufferImageCopy regions[TEXTURE_MIP_MAX_LEVELS] = {0};
+   u32 region_count = 0;
+
+   for(u32 i = first_level; i < mips->level_count; ++i)
+   {
+      const texture_mip_level* level = mips->levels + i;
+      const size level_end = i + 1 < mips->level_count ? mips->levels[i + 1].offset : mips->size;
+
+      const size from = max(begin, level->offset);
+      const size to = min(end, level_end);
+      if(from >= to)
+         continue;
+
+      const size row_bytes = block_size ? (size)((level->width + 3) / 4) * block_size : (size)level->width * 4;
+      const u32 first_row = (u32)((from - level->offset) / row_bytes) * row_height;
+      const u32 end_row = min((u32)((to - level->offset) / row_bytes) * row_height, level->height);
+
+      VkBufferImageCopy* region = regions + region_count++;
+      region->bufferOffset = from - begin;
+      region->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region->imageSubresource.mipLevel = i - first_level;
+      region->imageSubresource.layerCount = 1;
+      region->imageOffset = (VkOffset3D){0, (i32)first_row, 0};
+      region->imageExtent = (VkExtent3D){level->width, end_row - first_row, 1};
+   }
+
+   vk_buffer_to_image_upload_part(context, tex->image.handle, mips->level_count - first_level, regions, region_count, pixels + begin, end - begin,
+                                  begin == mips->levels[first_level].offset, end == mips->size);
 }
 
-static size vk_texture_size_blocked(u32 w, u32 h, u32 levels, u32 block_size)
+// image of the levels of a chain from first_level down, pixels are the whole chain decoded, filtered and
+// block compressed by the caller
+static bool vk_texture_create(vk_context* context, vk_texture* tex, const u8* pixels, const texture_mip_chain* mips, texture_bc_encoding encoding,
+                              u32 first_level)
 {
-   (void)w;
-   (void)h;
-   (void)levels;
-   (void)block_size;
-   size result = 0;
+   if(!pixels || !vk_texture_image_create(context, tex, mips, encoding, first_level))
+      return false;
 
-   return result;
+   const u32 block_size = encoding.format == texture_bc_none ? 0 : texture_bc_block_size(encoding.format);
+   assert(mips->size == vk_texture_size_blocked(mips->levels[0].width, mips->levels[0].height, mips->level_count, block_size));
+
+   vk_texture_upload(context, tex, pixels, mips, encoding, first_level, mips->levels[first_level].offset, mips->size);
+
+   return true;
 }
 
-static size vk_texture_size(u32 w, u32 h, u32 levels)
+static void vk_texture_destroy(vk_device* devices, vk_texture* tex)
 {
-   return vk_texture_size_blocked(w, h, levels, 0);
+   vkDestroyImageView(devices->logical, tex->image.view, &global_allocator.handle);
+   vkDestroyImage(devices->logical, tex->image.handle, &global_allocator.handle);
+   vk_memory_free(devices, &tex->image.allocation);
+
+   *tex = (vk_texture){0};
 }
 
-// TODO: pass devices and return the texture
-static bool vk_texture_load(vk_context* context, arena s, s8 img_uri, s8 gltf_path)
+// points the bindless slot of a texture in a texture set at its current view
+static void vk_texture_descriptor_write(vk_context* context, VkDescriptorSet set, u32 index)
 {
-   u8* gltf_end = gltf_path.data + gltf_path.len;
-   size tex_path_start = gltf_path.len;
+   VkDescriptorImageInfo image_info =
+   {
+      .sampler = context->texture_descriptor.sampler,
+      .imageView = context->textures.data[index].image.view,
+      .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+   };
 
-   while(*gltf_end != '/' && tex_path_start != 0)
+   VkWriteDescriptorSet write =
    {
-      tex_path_start--;
-      gltf_end--;
-   }
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = set,
+      .dstBinding = 0,
+      .dstArrayElement = index,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .pImageInfo = &image_info,
+   };
+
+   vkUpdateDescriptorSets(context->devices.logical, 1, &write, 0, 0);
+}
 
-   assert(*gltf_end == '/' && tex_path_start != 0);
+// the texels of a whole texture across the screen for every instance, rough - the uvs are taken to
+// cover each mesh once, so tiled textures ask for finer levels than they show
+static void vk_texture_stream_want(vk_context* context, texture_stream* stream, vec3 eye, f32 pixels_per_unit, f32 near_distance)
+{
+   const vk_geometry* geometry = &context->geometry;
 
-   s8 tex_dir = s8_slice(gltf_path, 0, tex_path_start + 1);
+   for(usize i = 0; i < geometry->mesh_instances.count; ++i)
+   {
+      const vk_mesh_instance* instance = geometry->mesh_instances.data + i;
+      const vk_mesh_draw* draw = geometry->mesh_draws.data + instance->mesh_index;
+      const f32* m = instance->world.data;
+      const f32* c = draw->position_center;
 
-   size tex_len = img_uri.len + tex_dir.len;
+      // world bounding sphere of the quantization box, rows are the axes and the translation
+      vec3 center =
+      {
+         c[0]*m[0] + c[1]*m[4] + c[2]*m[8] + m[12],
+         c[0]*m[1] + c[1]*m[5] + c[2]*m[9] + m[13],
+         c[0]*m[2] + c[1]*m[6] + c[2]*m[10] + m[14],
+      };
 
-   vk_texture tex = {0};
-   array(char) tex_path = {&s};
-   array_resize(tex_path, tex_len + 1); // for null terminate
+      f32 scale = 0.0f;
+      for(u32 k = 0; k < 3; ++k)
+         scale = max(scale, sqrtf(m[4*k]*m[4*k] + m[4*k + 1]*m[4*k + 1] + m[4*k + 2]*m[4*k + 2]));
 
-   memcpy(tex_path.data, tex_dir.data, tex_dir.len);
-   memcpy(tex_path.data + tex_dir.len, img_uri.data, img_uri.len);
+      const f32* e = draw->position_extent;
+      const f32 radius = sqrtf(e[0]*e[0] + e[1]*e[1] + e[2]*e[2]) * scale;
 
-   tex_path.data[tex_len] = 0;        // null terminate
+      vec3 to_center = vec3_sub(&center, &eye);
+      const f32 distance = max(vec3_len(to_center) - radius, near_distance);
+      const f32 screen_pixels = 2.0f * radius * pixels_per_unit / distance;
 
-   i32 tex_width = 0;
-   i32 tex_height = 0;
-   i32 tex_channels = 0;
-   stbi_uc* tex_pixels = stbi_load(s8_data(tex_path), &tex_width, &tex_height, &tex_channels, STBI_rgb_alpha);
+      if(instance->material >= geometry->materials.count)
+         continue;
 
-   VkExtent3D extents = {.width = tex_width, .height = tex_height, .depth = 1};
-   VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-   VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+      const struct material* material = geometry->materials.data + instance->material;
+      const u32 textures[] = {material->albedo, material->normal, material->metal, material->emissive, material->ao};
 
-   vk_image image = {0};
-   if(!vk_image_create(&image, &context->devices, VK_FORMAT_R8G8B8A8_UNORM, extents, usage))
-      return false;
+      for(u32 k = 0; k < array_count(textures); ++k)
+         if(textures[k] < stream->texture_count)
+            texture_stream_want(stream, textures[k], texture_stream_level_for(&stream->textures[textures[k]].mips, screen_pixels));
+   }
+}
 
-   VkImageView image_view = vk_image_view_create(&context->devices, format, image.handle, VK_IMAGE_ASPECT_COLOR_BIT);
+// moves the streamed textures to the levels the camera needs, before the frame is recorded. the parts of
+// a new image are uploaded over the frames the plan spreads them on while the frames keep sampling the
+// old one, and it takes the slot once the upload batch of its last part is done. each frame slot has its
+// own texture set, the others point at the new view when their frames come round and the old image goes
+// when this slot is retired again
+static void vk_texture_stream_update(vk_context* context, vec3 eye, f32 fov_y, f32 near_distance)
+{
+   texture_stream* stream = context->texture_stream;
+   if(!stream || stream->texture_count == 0)
+      return;
 
-   size tex_size = tex_width * tex_height * STBI_rgb_alpha;
+   vk_frame* frame = context->frames + context->frame_index;
+   const u32 frame_bit = 1u << context->frame_index;
 
-   if(tex_size == 0)
+   for(u32 i = 0; i < stream->texture_count; ++i)
    {
-      printf("Bad or missing texture: %s\n", s8_data(tex_path));
-      return false;
+      vk_streamed_texture* streamed = context->streamed_textures + i;
+
+      if(streamed->upload_serial && vk_upload_done(context, streamed->upload_serial))
+      {
+         frame->retired[frame->retired_count++] = context->textures.data[i];
+         context->textures.data[i] = streamed->next;
+         streamed->next = (vk_texture){0};
+         streamed->upload_serial = 0;
+         streamed->stale_frames = (1u << context->frame_count) - 1;
+
+         texture_stream_swapped(stream, i);
+      }
+
+      if(streamed->stale_frames & frame_bit)
+      {
+         vk_texture_descriptor_write(context, frame->texture_set, i);
+         streamed->stale_frames &= ~frame_bit;
+      }
    }
 
-   VkPhysicalDeviceMemoryProperties memory_props;
-   vkGetPhysicalDeviceMemoryProperties(context->devices.physical, &memory_props);
-   vk_buffer scratch_buffer = {.size = tex_size};
-   vk_buffer_create_and_bind(&scratch_buffer, &context->devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+   const f32 pixels_per_unit = context->swapchain.image_height / (2.0f * tanf(deg2rad(fov_y * 0.5f)));
+
+   texture_stream_frame_begin(stream);
+   vk_texture_stream_want(context, stream, eye, pixels_per_unit, near_distance);
+
+   arena s = context->scratch;
+   texture_stream_change* changes = push(&s, texture_stream_change, 2 * stream->texture_count);
+   const u32 change_count = texture_stream_plan(stream, s, changes, 2 * stream->texture_count);
+
+   for(u32 i = 0; i < change_count; ++i)
+   {
+      const texture_stream_change* change = changes + i;
+      const texture_stream_texture* texture = stream->textures + change->texture;
+      vk_streamed_texture* streamed = context->streamed_textures + change->texture;
 
-   vk_buffer_to_image_upload(context, scratch_buffer, image.handle, extents, tex_pixels, scratch_buffer.size);
+      if(!vk_valid_handle(streamed->next.image.handle) &&
+         !vk_texture_image_create(context, &streamed->next, &texture->mips, texture->encoding, change->to))
+      {
+         printf("Could not stream texture %u to level %u\n", change->texture, change->to);
+         texture_stream_cancel(stream, change->texture);
+         continue;
+      }
 
-   tex.image.handle = image.handle;
-   tex.image.memory = image.memory;
-   tex.image.view = image_view;
+      vk_texture_upload(context, &streamed->next, texture->pixels, &texture->mips, texture->encoding, change->to, change->begin, change->end);
+      if(change->end == texture->mips.size)
+         streamed->upload_serial = vk_upload_serial(context);
+
+      stream->uploaded_bytes += change->end - change->begin;
+   }
+}
 
-   array_add(context->textures, tex);
+// the images the stream holds besides the slots, once the device is idle
+static void vk_texture_stream_destroy(vk_context* context)
+{
+   for(u32 i = 0; i < context->frame_count; ++i)
+   {
+      vk_frame* frame = context->frames + i;
+      for(u32 j = 0; j < frame->retired_count; ++j)
+         vk_texture_destroy(&context->devices, frame->retired + j);
 
-   vk_buffer_destroy(&context->devices, &scratch_buffer);
+      frame->retired_count = 0;
+   }
 
-   stbi_image_free(tex_pixels);
+   if(!context->texture_stream)
+      return;
 
-   return true;
+   for(u32 i = 0; i < context->texture_stream->texture_count; ++i)
+      if(vk_valid_handle(context->streamed_textures[i].next.image.handle))
+         vk_texture_destroy(&context->devices, &context->streamed_textures[i].next);
 }
@@ -0,0 +1,399 @@
+#include "common.h"
+#include "math.h"
+
+#include <float.h>
+#include <immintrin.h>
+
+// block compression of rgba8 mip chains - bc1 for opaque colors, bc3 for colors with alpha, bc4 and
+// bc5 for one and two channel data. bc1 endpoints start on the principal axis of the block and get one
+// least squares refinement, indices pick the closest palette entry. the sse paths work on four texels
+// of one channel at a time. bc7 is not done, bc1 and bc3 cover the albedo of the scenes we load
+
+#define TEXTURE_BC_POWER_ITERATIONS 8
+
+typedef enum texture_bc_format
+{
+   texture_bc_none = 0,    // rgba8
+   texture_bc1,
+   texture_bc3,
+   texture_bc4,
+   texture_bc5,
+   texture_bc_format_count,
+} texture_bc_format;
+
+align_struct texture_bc_encoding
+{
+   texture_bc_format format;
+   u32 channel;      // first source channel of bc4 and bc5
+} texture_bc_encoding;
+
+static const char* texture_bc_format_names[texture_bc_format_count] = {"rgba8", "bc1", "bc3", "bc4", "bc5"};
+
+static u32 texture_bc_block_size(texture_bc_format format)
+{
+   return format == texture_bc1 || format == texture_bc4 ? 8 : 16;
+}
+
+// bytes of one level, rgba8 without a block format
+static size texture_bc_level_size(u32 width, u32 height, texture_bc_format format)
+{
+   if(format == texture_bc_none)
+      return (size)width * height * 4;
+
+   return (size)((width + 3) / 4) * ((height + 3) / 4) * texture_bc_block_size(format);
+}
+
+static bool texture_bc_opaque(const u8* pixels, size texel_count)
+{
+   for(size i = 0; i < texel_count; ++i)
+      if(pixels[4*i + 3] != 255)
+         return false;
+
+   return true;
+}
+
+static u16 texture_bc_565(const f32 c[3])
+{
+   const u32 r = (u32)(clamp(c[0], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+   const u32 g = (u32)(clamp(c[1], 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+   const u32 b = (u32)(clamp(c[2], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+
+   return (u16)((r << 11) | (g << 5) | b);
+}
+
+static void texture_bc_565_expand(f32 out[3], u16 c)
+{
+   const u32 r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+
+   out[0] = (f32)((r << 3) | (r >> 2));
+   out[1] = (f32)((g << 2) | (g >> 4));
+   out[2] = (f32)((b << 3) | (b >> 2));
+}
+
+// closest of the four colors of the bc1 palette for every texel, returns the squared error
+static f32 texture_bc1_indices(u8 indices[16], const f32* r, const f32* g, const f32* b, u16 c0, u16 c1)
+{
+   f32 palette[4][3];
+   texture_bc_565_expand(palette[0], c0);
+   texture_bc_565_expand(palette[1], c1);
+   for(u32 k = 0; k < 3; ++k)
+   {
+      palette[2][k] = (2.0f*palette[0][k] + palette[1][k]) / 3.0f;
+      palette[3][k] = (palette[0][k] + 2.0f*palette[1][k]) / 3.0f;
+   }
+
+   __m128 error = _mm_setzero_ps();
+
+   for(u32 i = 0; i < 16; i += 4)
+   {
+      const __m128 tr = _mm_loadu_ps(r + i), tg = _mm_loadu_ps(g + i), tb = _mm_loadu_ps(b + i);
+
+      __m128 best = _mm_set1_ps(FLT_MAX);
+      __m128i best_index = _mm_setzero_si128();
+
+      for(u32 p = 0; p < 4; ++p)
+      {
+         const __m128 dr = _mm_sub_ps(tr, _mm_set1_ps(palette[p][0]));
+         const __m128 dg = _mm_sub_ps(tg, _mm_set1_ps(palette[p][1]));
+         const __m128 db = _mm_sub_ps(tb, _mm_set1_ps(palette[p][2]));
+         const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+         const __m128 closer = _mm_cmplt_ps(d, best);
+         best = _mm_min_ps(d, best);
+         best_index = _mm_or_si128(_mm_andnot_si128(_mm_castps_si128(closer), best_index),
+                                   _mm_and_si128(_mm_castps_si128(closer), _mm_set1_epi32((i32)p)));
+      }
+
+      i32 picked[4];
+      _mm_storeu_si128((__m128i*)picked, best_index);
+      for(u32 k = 0; k < 4; ++k)
+         indices[i + k] = (u8)picked[k];
+
+      error = _mm_add_ps(error, best);
+   }
+
+   f32 sum[4];
+   _mm_storeu_ps(sum, error);
+
+   return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+// endpoints that fit the texels best for the palette weights of the indices
+static bool texture_bc1_refine(f32 e0[3], f32 e1[3], const u8 indices[16], const f32* r, const f32* g, const f32* b)
+{
+   static const f32 weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+   f32 aa = 0, ab = 0, bb = 0;
+   f32 ax[3] = {0}, bx[3] = {0};
+
+   for(u32 i = 0; i < 16; ++i)
+   {
+      const f32 wa = weights[indices[i]], wb = 1.0f - wa;
+      const f32 texel[3] = {r[i], g[i], b[i]};
+
+      aa += wa*wa;
+      ab += wa*wb;
+      bb += wb*wb;
+
+      for(u32 k = 0; k < 3; ++k)
+      {
+         ax[k] += wa * texel[k];
+         bx[k] += wb * texel[k];
+      }
+   }
+
+   const f32 det = aa*bb - ab*ab;
+   if(fabsf(det) < 1e-6f)
+      return false;
+
+   for(u32 k = 0; k < 3; ++k)
+   {
+      e0[k] = (ax[k]*bb - bx[k]*ab) / det;
+      e1[k] = (bx[k]*aa - ax[k]*ab) / det;
+   }
+
+   return true;
+}
+
+static void texture_bc1_write(u8 out[8], u16 c0, u16 c1, const u8 indices[16])
+{
+   u32 bits = 0;
+
+   // four colors need c0 above c1, swapping the endpoints swaps the indices 0 and 1, 2 and 3
+   if(c0 < c1)
+   {
+      const u16 t = c0;
+      c0 = c1;
+      c1 = t;
+
+      for(u32 i = 0; i < 16; ++i)
+         bits |= (u32)(indices[i] ^ 1) << (2*i);
+   }
+   else if(c0 > c1)
+   {
+      for(u32 i = 0; i < 16; ++i)
+         bits |= (u32)indices[i] << (2*i);
+   }
+
+   // equal endpoints are the three color mode where index 3 is black, all zero indices are c0
+
+   out[0] = (u8)c0;
+   out[1] = (u8)(c0 >> 8);
+   out[2] = (u8)c1;
+   out[3] = (u8)(c1 >> 8);
+   memcpy(out + 4, &bits, sizeof(bits));
+}
+
+static void texture_bc1_block(u8 out[8], const u8 texels[64])
+{
+   f32 r[16], g[16], b[16];
+   for(u32 i = 0; i < 16; ++i)
+   {
+      r[i] = texels[4*i + 0];
+      g[i] = texels[4*i + 1];
+      b[i] = texels[4*i + 2];
+   }
+
+   // mean and covariance of the block
+   __m128 sr = _mm_setzero_ps(), sg = _mm_setzero_ps(), sb = _mm_setzero_ps();
+   for(u32 i = 0; i < 16; i += 4)
+   {
+      sr = _mm_add_ps(sr, _mm_loadu_ps(r + i));
+      sg = _mm_add_ps(sg, _mm_loadu_ps(g + i));
+      sb = _mm_add_ps(sb, _mm_loadu_ps(b + i));
+   }
+
+   f32 lanes[3][4];
+   _mm_storeu_ps(lanes[0], sr);
+   _mm_storeu_ps(lanes[1], sg);
+   _mm_storeu_ps(lanes[2], sb);
+
+   f32 mean[3];
+   for(u32 k = 0; k < 3; ++k)
+      mean[k] = (lanes[k][0] + lanes[k][1] + lanes[k][2] + lanes[k][3]) / 16.0f;
+
+   const __m128 mr = _mm_set1_ps(mean[0]), mg = _mm_set1_ps(mean[1]), mb = _mm_set1_ps(mean[2]);
+   __m128 c[6] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+
+   for(u32 i = 0; i < 16; i += 4)
+   {
+      const __m128 dr = _mm_sub_ps(_mm_loadu_ps(r + i), mr);
+      const __m128 dg = _mm_sub_ps(_mm_loadu_ps(g + i), mg);
+      const __m128 db = _mm_sub_ps(_mm_loadu_ps(b + i), mb);
+
+      c[0] = _mm_add_ps(c[0], _mm_mul_ps(dr, dr));
+      c[1] = _mm_add_ps(c[1], _mm_mul_ps(dr, dg));
+      c[2] = _mm_add_ps(c[2], _mm_mul_ps(dr, db));
+      c[3] = _mm_add_ps(c[3], _mm_mul_ps(dg, dg));
+      c[4] = _mm_add_ps(c[4], _mm_mul_ps(dg, db));
+      c[5] = _mm_add_ps(c[5], _mm_mul_ps(db, db));
+   }
+
+   f32 cov[6];
+   for(u32 k = 0; k < 6; ++k)
+   {
+      f32 l[4];
+      _mm_storeu_ps(l, c[k]);
+      cov[k] = l[0] + l[1] + l[2] + l[3];
+   }
+
+   // principal axis by power iteration, a flat block keeps the luminance axis
+   f32 axis[3] = {0.299f, 0.587f, 0.114f};
+   for(u32 it = 0; it < TEXTURE_BC_POWER_ITERATIONS; ++it)
+   {
+      const f32 x = cov[0]*axis[0] + cov[1]*axis[1] + cov[2]*axis[2];
+      const f32 y = cov[1]*axis[0] + cov[3]*axis[1] + cov[4]*axis[2];
+      const f32 z = cov[2]*axis[0] + cov[4]*axis[1] + cov[5]*axis[2];
+
+      const f32 l = max(fabsf(x), max(fabsf(y), fabsf(z)));
+      if(l < 1e-6f)
+         break;
+
+      axis[0] = x / l;
+      axis[1] = y / l;
+      axis[2] = z / l;
+   }
+
+   const f32 axis_length = axis[0]*axis[0] + axis[1]*axis[1] + axis[2]*axis[2];
+
+   f32 lo = FLT_MAX, hi = -FLT_MAX;
+   for(u32 i = 0; i < 16; ++i)
+   {
+      const f32 t = ((r[i] - mean[0])*axis[0] + (g[i] - mean[1])*axis[1] + (b[i] - mean[2])*axis[2]) / axis_length;
+      lo = min(lo, t);
+      hi = max(hi, t);
+   }
+
+   f32 e0[3], e1[3];
+   for(u32 k = 0; k < 3; ++k)
+   {
+      e0[k] = mean[k] + axis[k]*hi;
+      e1[k] = mean[k] + axis[k]*lo;
+   }
+
+   u16 c0 = texture_bc_565(e0), c1 = texture_bc_565(e1);
+   u8 indices[16];
+   const f32 error = texture_bc1_indices(indices, r, g, b, c0, c1);
+
+   // one least squares pass over the indices, kept when it lowers the error
+   if(error > 0.0f && texture_bc1_refine(e0, e1, indices, r, g, b))
+   {
+      const u16 r0 = texture_bc_565(e0), r1 = texture_bc_565(e1);
+      u8 refined[16];
+
+      if(texture_bc1_indices(refined, r, g, b, r0, r1) < error)
+      {
+         c0 = r0;
+         c1 = r1;
+         memcpy(indices, refined, sizeof(indices));
+      }
+   }
+
+   texture_bc1_write(out, c0, c1, indices);
+}
+
+// one channel of 16 texels between the extremes of the block, eight value mode
+static void texture_bc4_block(u8 out[8], const u8* texels, u32 channel)
+{
+   f32 v[16];
+   f32 lo = 255.0f, hi = 0.0f;
+   for(u32 i = 0; i < 16; ++i)
+   {
+      v[i] = texels[4*i + channel];
+      lo = min(lo, v[i]);
+      hi = max(hi, v[i]);
+   }
+
+   out[0] = (u8)hi;
+   out[1] = (u8)lo;
+
+   u64 bits = 0;
+   if(hi > lo)
+   {
+      // steps of 1/7 from lo, step 7 is e0 at index 0, step 0 is e1 at index 1, the rest 8 - step
+      const __m128 base = _mm_set1_ps(lo);
+      const __m128 scale = _mm_set1_ps(7.0f / (hi - lo));
+
+      for(u32 i = 0; i < 16; i += 4)
+      {
+         i32 steps[4];
+         _mm_storeu_si128((__m128i*)steps, _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(v + i), base), scale)));
+
+         for(u32 k = 0; k < 4; ++k)
+         {
+            const u64 index = steps[k] == 7 ? 0 : steps[k] == 0 ? 1 : (u64)(8 - steps[k]);
+            bits |= index << (3*(i + k));
+         }
+      }
+   }
+
+   for(u32 i = 0; i < 6; ++i)
+      out[2 + i] = (u8)(bits >> (8*i));
+}
+
+static void texture_bc_block(u8* out, const u8 texels[64], texture_bc_encoding encoding)
+{
+   switch(encoding.format)
+   {
+      case texture_bc1:
+         texture_bc1_block(out, texels);
+         break;
+      case texture_bc3:
+         texture_bc4_block(out, texels, 3);
+         texture_bc1_block(out + 8, texels);
+         break;
+      case texture_bc4:
+         texture_bc4_block(out, texels, encoding.channel);
+         break;
+      case texture_bc5:
+         texture_bc4_block(out, texels, encoding.channel);
+         texture_bc4_block(out + 8, texels, encoding.channel + 1);
+         break;
+      default:
+         break;
+   }
+}
+
+// blocks past the edge of levels smaller than 4 texels repeat the last row and column
+static void texture_bc_level_compress(u8* out, const u8* pixels, u32 width, u32 height, texture_bc_encoding encoding)
+{
+   const u32 block_size = texture_bc_block_size(encoding.format);
+   const u32 blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+
+   for(u32 by = 0; by < blocks_y; ++by)
+      for(u32 bx = 0; bx < blocks_x; ++bx)
+      {
+         u8 texels[64];
+         for(u32 y = 0; y < 4; ++y)
+            for(u32 x = 0; x < 4; ++x)
+            {
+               const u32 sx = min(4*bx + x, width - 1), sy = min(4*by + y, height - 1);
+               memcpy(texels + 4*(4*y + x), pixels + 4*((size)sy*width + sx), 4);
+            }
+
+         texture_bc_block(out + ((size)by*blocks_x + bx)*block_size, texels, encoding);
+      }
+}
+
+// compresses every level of the chain in place and moves the offsets to the blocks. a block is at most
+// a byte per texel and the blocks of a level start no later than its texels, so every write lands
+// behind the texels still to be read
+static void texture_bc_chain_compress(u8* pixels, texture_mip_chain* chain, texture_bc_encoding encoding)
+{
+   if(encoding.format == texture_bc_none)
+      return;
+
+   size offset = 0;
+
+   for(u32 i = 0; i < chain->level_count; ++i)
+   {
+      texture_mip_level* level = chain->levels + i;
+
+      texture_bc_level_compress(pixels + offset, pixels + level->offset, level->width, level->height, encoding);
+
+      level->offset = offset;
+      offset += texture_bc_level_size(level->width, level->height, encoding.format);
+   }
+
+   chain->size = offset;
+}
@@ -0,0 +1,429 @@
+#include "common.h"
+#include "arena.h"
+#include "math.h"
+
+#include <immintrin.h>
+
+// cpu mip chains of rgba8 textures - every level is filtered from the one above it with a separable
+// box or kaiser windowed sinc kernel, wrapping at the edges like the repeat sampler. color is filtered
+// in linear space and stored back as srgb, alpha is linear. alpha tested textures keep the coverage
+// of their base level at the discard threshold of the fragment shaders. the sse path filters the four
+// channels of a texel in one register
+
+#define TEXTURE_MIP_MAX_LEVELS 16
+#define TEXTURE_MIP_MAX_TAPS 32             // per output texel of one pass, the kaiser kernel at 3:1 is 19
+#define TEXTURE_MIP_KAISER_RADIUS 3.0f      // in texels of the smaller level
+#define TEXTURE_MIP_KAISER_ALPHA 4.0f
+#define TEXTURE_MIP_ALPHA_CUTOFF 128        // the shaders discard alpha below 0.5
+#define TEXTURE_MIP_SRGB_TABLE_SIZE 8192    // linear to srgb, finer than half an srgb step near black
+
+typedef enum texture_mip_filter
+{
+   texture_mip_box = 0,
+   texture_mip_kaiser,
+} texture_mip_filter;
+
+typedef enum texture_mip_flags
+{
+   texture_mip_srgb = 1 << 0,          // rgb are srgb encoded
+   texture_mip_alpha_test = 1 << 1,    // keep the alpha coverage of the base level
+   texture_mip_scalar = 1 << 2,        // no sse, for the bench
+} texture_mip_flags;
+
+align_struct texture_mip_level
+{
+   size offset;      // from the start of the chain
+   u32 width;
+   u32 height;
+} texture_mip_level;
+
+// all levels packed one after another in one allocation, the base level first
+align_struct texture_mip_chain
+{
+   u32 level_count;
+   size size;
+   texture_mip_level levels[TEXTURE_MIP_MAX_LEVELS];
+} texture_mip_chain;
+
+// taps of one output texel, columns index the padded input row and rows the level itself
+align_struct texture_mip_taps
+{
+   i32 first;
+   u32 count;
+   f32 weights[TEXTURE_MIP_MAX_TAPS];
+} texture_mip_taps;
+
+static f32 texture_mip_srgb_to_linear[256];
+static u8 texture_mip_linear_to_srgb[TEXTURE_MIP_SRGB_TABLE_SIZE];
+static bool texture_mip_tables_built;
+
+// every thread writes the same values
+static void texture_mip_tables_build(void)
+{
+   if(texture_mip_tables_built)
+      return;
+
+   for(u32 i = 0; i < 256; ++i)
+   {
+      const f32 c = i / 255.0f;
+      texture_mip_srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+   }
+
+   for(u32 i = 0; i < TEXTURE_MIP_SRGB_TABLE_SIZE; ++i)
+   {
+      const f32 l = i / (f32)(TEXTURE_MIP_SRGB_TABLE_SIZE - 1);
+      const f32 c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+      texture_mip_linear_to_srgb[i] = (u8)(c * 255.0f + 0.5f);
+   }
+
+   texture_mip_tables_built = true;
+}
+
+static u32 texture_mip_level_count(u32 width, u32 height)
+{
+   u32 result = 1;
+   for(u32 extent = max(width, height); extent > 1 && result < TEXTURE_MIP_MAX_LEVELS; extent >>= 1)
+      result++;
+
+   return result;
+}
+
+static texture_mip_chain texture_mip_chain_layout(u32 width, u32 height)
+{
+   texture_mip_chain result = {0};
+   result.level_count = texture_mip_level_count(width, height);
+
+   for(u32 i = 0; i < result.level_count; ++i)
+   {
+      result.levels[i] = (texture_mip_level){result.size, width, height};
+      result.size += (size)width * height * 4;
+
+      width = max(width >> 1, 1u);
+      height = max(height >> 1, 1u);
+   }
+
+   return result;
+}
+
+// zeroth order modified bessel function of the first kind, the series converges fast for the alpha used
+static f32 texture_mip_bessel_i0(f32 x)
+{
+   f32 sum = 1.0f, term = 1.0f;
+   const f32 q = x * x * 0.25f;
+
+   for(u32 k = 1; k < 32 && term > sum * 1e-8f; ++k)
+   {
+      term *= q / (f32)(k * k);
+      sum += term;
+   }
+
+   return sum;
+}
+
+static f32 texture_mip_kaiser_weight(f32 d)
+{
+   const f32 t = d / TEXTURE_MIP_KAISER_RADIUS;
+   if(fabsf(t) >= 1.0f)
+      return 0.0f;
+
+   const f32 sinc = d == 0.0f ? 1.0f : sinf(PI * d) / (PI * d);
+   const f32 window = texture_mip_bessel_i0(TEXTURE_MIP_KAISER_ALPHA * sqrtf(1.0f - t*t)) / texture_mip_bessel_i0(TEXTURE_MIP_KAISER_ALPHA);
+
+   return sinc * window;
+}
+
+// kernels of every output texel of a from -> to pass, the first taps may fall outside of the input
+static void texture_mip_taps_build(texture_mip_taps* taps, u32 from, u32 to, texture_mip_filter filter)
+{
+   const f32 ratio = (f32)from / (f32)to;
+   const f32 radius = filter == texture_mip_box ? 0.5f * ratio : TEXTURE_MIP_KAISER_RADIUS * ratio;
+
+   for(u32 x = 0; x < to; ++x)
+   {
+      texture_mip_taps* t = taps + x;
+      const f32 center = (x + 0.5f) * ratio;
+
+      const i32 first = (i32)floorf(center - radius);
+      const i32 last = min((i32)ceilf(center + radius), first + TEXTURE_MIP_MAX_TAPS);
+
+      f32 sum = 0;
+      t->count = 0;
+      t->first = first;
+
+      for(i32 i = first; i < last; ++i)
+      {
+         f32 w = 0;
+         if(filter == texture_mip_box)
+         {
+            // area of the input texel inside the footprint of the output texel
+            const f32 lo = max((f32)i, center - radius);
+            const f32 hi = min((f32)i + 1.0f, center + radius);
+            w = max(hi - lo, 0.0f);
+         }
+         else
+            w = texture_mip_kaiser_weight((i + 0.5f - center) / ratio);
+
+         t->weights[t->count++] = w;
+         sum += w;
+      }
+
+      for(u32 k = 0; k < t->count; ++k)
+         t->weights[k] /= sum;
+   }
+}
+
+// how far the taps reach outside of the input on either side
+static u32 texture_mip_pad(const texture_mip_taps* taps, u32 from, u32 to)
+{
+   i32 result = 0;
+   for(u32 x = 0; x < to; ++x)
+   {
+      result = max(result, -taps[x].first);
+      result = max(result, taps[x].first + (i32)taps[x].count - (i32)from);
+   }
+
+   return (u32)result;
+}
+
+// one row of texels to linear rgba floats, the pad on both sides repeats the row like the sampler
+static void texture_mip_row_decode(f32* out, const u8* row, u32 width, u32 pad, bool srgb, bool simd)
+{
+   f32* texels = out + 4*pad;
+
+   for(u32 i = 0; i < width; ++i)
+   {
+      const u8* texel = row + 4*i;
+      f32* o = texels + 4*i;
+
+      if(simd && !srgb)
+      {
+         i32 packed;
+         memcpy(&packed, texel, sizeof(packed));
+
+         const __m128i bytes = _mm_cvtsi32_si128(packed);
+         const __m128i words = _mm_unpacklo_epi8(bytes, _mm_setzero_si128());
+         const __m128 v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, _mm_setzero_si128()));
+
+         _mm_storeu_ps(o, _mm_mul_ps(v, _mm_set1_ps(1.0f / 255.0f)));
+         continue;
+      }
+
+      for(u32 c = 0; c < 3; ++c)
+         o[c] = srgb ? texture_mip_srgb_to_linear[texel[c]] : texel[c] * (1.0f / 255.0f);
+      o[3] = texel[3] * (1.0f / 255.0f);
+   }
+
+   for(u32 i = 0; i < pad; ++i)
+   {
+      memcpy(out + 4*(pad - 1 - i), texels + 4*((width - 1 - i % width)), 4*sizeof(f32));
+      memcpy(texels + 4*(width + i), texels + 4*(i % width), 4*sizeof(f32));
+   }
+}
+
+static void texture_mip_row_filter(f32* out, const f32* in, const texture_mip_taps* taps, u32 count)
+{
+   for(u32 x = 0; x < count; ++x)
+   {
+      const texture_mip_taps* t = taps + x;
+      const f32* texel = in + 4*t->first;
+
+      f32 sum[4] = {0};
+      for(u32 k = 0; k < t->count; ++k)
+         for(u32 c = 0; c < 4; ++c)
+            sum[c] += t->weights[k] * texel[4*k + c];
+
+      memcpy(out + 4*x, sum, sizeof(sum));
+   }
+}
+
+static void texture_mip_row_filter_sse(f32* out, const f32* in, const texture_mip_taps* taps, u32 count)
+{
+   for(u32 x = 0; x < count; ++x)
+   {
+      const texture_mip_taps* t = taps + x;
+      const f32* texel = in + 4*t->first;
+
+      __m128 sum = _mm_setzero_ps();
+      for(u32 k = 0; k < t->count; ++k)
+         sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(t->weights[k]), _mm_loadu_ps(texel + 4*k)));
+
+      _mm_storeu_ps(out + 4*x, sum);
+   }
+}
+
+static void texture_mip_row_accumulate(f32* acc, const f32* row, f32 weight, u32 count, bool simd)
+{
+   if(simd)
+   {
+      const __m128 w = _mm_set1_ps(weight);
+      for(u32 i = 0; i < count; ++i)
+         _mm_storeu_ps(acc + 4*i, _mm_add_ps(_mm_loadu_ps(acc + 4*i), _mm_mul_ps(w, _mm_loadu_ps(row + 4*i))));
+   }
+   else
+      for(u32 i = 0; i < 4*count; ++i)
+         acc[i] += weight * row[i];
+}
+
+static void texture_mip_row_encode(u8* out, const f32* in, u32 count, bool srgb, bool simd)
+{
+   const f32 table_scale = (f32)(TEXTURE_MIP_SRGB_TABLE_SIZE - 1);
+
+   for(u32 i = 0; i < count; ++i)
+   {
+      const f32* texel = in + 4*i;
+      u8* o = out + 4*i;
+
+      if(simd)
+      {
+         // rgb scaled to the table or to 255, alpha always to 255
+         const __m128 scale = srgb ? _mm_setr_ps(table_scale, table_scale, table_scale, 255.0f) : _mm_set1_ps(255.0f);
+         __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texel), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+
+         i32 q[4];
+         _mm_storeu_si128((__m128i*)q, _mm_cvtps_epi32(_mm_mul_ps(v, scale)));
+
+         for(u32 c = 0; c < 3; ++c)
+            o[c] = srgb ? texture_mip_linear_to_srgb[q[c]] : (u8)q[c];
+         o[3] = (u8)q[3];
+      }
+      else
+      {
+         for(u32 c = 0; c < 4; ++c)
+         {
+            const f32 v = clamp(texel[c], 0.0f, 1.0f);
+
+            if(srgb && c < 3)
+               o[c] = texture_mip_linear_to_srgb[(u32)(v * table_scale + 0.5f)];
+            else
+               o[c] = (u8)(v * 255.0f + 0.5f);
+         }
+      }
+   }
+}
+
+// filters level from into level to, scratch holds the padded input row, a cache of filtered rows and the taps
+static void texture_mip_level_filter(u8* to_pixels, const texture_mip_level* to, const u8* from_pixels, const texture_mip_level* from,
+                                     texture_mip_filter filter, u32 flags, arena scratch)
+{
+   const bool srgb = flags & texture_mip_srgb;
+   const bool simd = !(flags & texture_mip_scalar);
+
+   texture_mip_taps* column_taps = push(&scratch, texture_mip_taps, to->width);
+   texture_mip_taps* row_taps = push(&scratch, texture_mip_taps, to->height);
+
+   texture_mip_taps_build(column_taps, from->width, to->width, filter);
+   texture_mip_taps_build(row_taps, from->height, to->height, filter);
+
+   // columns read a row padded with the wrapped texels, rows wrap their index
+   const u32 pad = texture_mip_pad(column_taps, from->width, to->width);
+   for(u32 x = 0; x < to->width; ++x)
+      column_taps[x].first += (i32)pad;
+
+   f32* padded = push(&scratch, f32, 4*(from->width + 2*pad));
+   f32* accumulator = push(&scratch, f32, 4*to->width);
+
+   // filtered input rows, an output row reads the taps of its kernel through the cache
+   f32* cache = push(&scratch, f32, 4*to->width*TEXTURE_MIP_MAX_TAPS);
+   i32 cache_rows[TEXTURE_MIP_MAX_TAPS];
+   for(u32 i = 0; i < TEXTURE_MIP_MAX_TAPS; ++i)
+      cache_rows[i] = -1;
+
+   for(u32 y = 0; y < to->height; ++y)
+   {
+      const texture_mip_taps* t = row_taps + y;
+      memset(accumulator, 0, 4*to->width*sizeof(f32));
+
+      for(u32 k = 0; k < t->count; ++k)
+      {
+         const i32 tap = t->first + (i32)k;
+         const u32 row = (u32)((tap % (i32)from->height + (i32)from->height) % (i32)from->height);
+
+         const u32 slot = row % TEXTURE_MIP_MAX_TAPS;
+         f32* filtered = cache + 4*to->width*slot;
+
+         if(cache_rows[slot] != (i32)row)
+         {
+            texture_mip_row_decode(padded, from_pixels + (size)row*from->width*4, from->width, pad, srgb, simd);
+
+            if(simd)
+               texture_mip_row_filter_sse(filtered, padded, column_taps, to->width);
+            else
+               texture_mip_row_filter(filtered, padded, column_taps, to->width);
+
+            cache_rows[slot] = (i32)row;
+         }
+
+         texture_mip_row_accumulate(accumulator, filtered, t->weights[k], to->width, simd);
+      }
+
+      texture_mip_row_encode(to_pixels + (size)y*to->width*4, accumulator, to->width, srgb, simd);
+   }
+}
+
+// texels that survive the alpha test
+static size texture_mip_coverage(const u8* pixels, size texel_count)
+{
+   size result = 0;
+   for(size i = 0; i < texel_count; ++i)
+      result += pixels[4*i + 3] >= TEXTURE_MIP_ALPHA_CUTOFF;
+
+   return result;
+}
+
+// scales the alpha of a level so the same fraction of texels passes the test as in the base level,
+// the threshold that keeps the closest coverage maps to the cutoff
+static void texture_mip_coverage_keep(u8* pixels, size texel_count, f64 coverage)
+{
+   size histogram[256] = {0};
+   for(size i = 0; i < texel_count; ++i)
+      histogram[pixels[4*i + 3]]++;
+
+   // texels at or above each threshold, walking down from the top
+   u32 threshold = TEXTURE_MIP_ALPHA_CUTOFF;
+   f64 best = 2.0;
+   size above = 0;
+
+   for(i32 t = 255; t >= 1; --t)
+   {
+      above += histogram[t];
+
+      const f64 error = fabs((f64)above / texel_count - coverage);
+      if(error < best)
+      {
+         best = error;
+         threshold = (u32)t;
+      }
+   }
+
+   if(threshold == TEXTURE_MIP_ALPHA_CUTOFF)
+      return;
+
+   // threshold maps to the cutoff and threshold - 1 stays below it
+   const f32 scale = (f32)TEXTURE_MIP_ALPHA_CUTOFF / (f32)threshold;
+   for(size i = 0; i < texel_count; ++i)
+      pixels[4*i + 3] = (u8)min(pixels[4*i + 3] * scale + 0.5f, 255.0f);
+}
+
+// fills levels 1 and up of a chain whose base level is already in place
+static void texture_mips_generate(u8* pixels, const texture_mip_chain* chain, texture_mip_filter filter, u32 flags, arena scratch)
+{
+   texture_mip_tables_build();
+
+   const texture_mip_level* base = chain->levels;
+   const size base_texels = (size)base->width * base->height;
+   const f64 coverage = (f64)texture_mip_coverage(pixels, base_texels) / base_texels;
+
+   // opaque and fully cut out textures have nothing to keep
+   const bool keep_coverage = (flags & texture_mip_alpha_test) && coverage > 0.0 && coverage < 1.0;
+
+   for(u32 i = 1; i < chain->level_count; ++i)
+   {
+      const texture_mip_level* from = chain->levels + i - 1;
+      const texture_mip_level* to = chain->levels + i;
+
+      texture_mip_level_filter(pixels + to->offset, to, pixels + from->offset, from, filter, flags, scratch);
+
+      if(keep_coverage)
+         texture_mip_coverage_keep(pixels + to->offset, (size)to->width * to->height, coverage);
+   }
+}
@@ -0,0 +1,320 @@
+#include "common.h"
+#include "arena.h"
+#include "math.h"
+
+// mip residency of the textures on the gpu - every texture keeps the small tail of its chain resident
+// from the load on and the finer levels come and go. each frame the renderer asks for a level per
+// texture from how large the instances that sample it are on screen. the plan brings in the textures
+// that are furthest from what they need first, within an upload budget per frame, and drops the least
+// recently wanted textures back to their tail when the resident bytes would go over the budget.
+// the resident levels of a texture are always a suffix of its chain, so they are one contiguous range
+// of the source. a move to another first level makes a new image, which is filled in parts of whole rows
+// over as many frames as the upload budget takes while the old one is still sampled
+
+#define TEXTURE_STREAM_TAIL_SIZE 64              // levels at most this many texels on a side are always resident
+#define TEXTURE_STREAM_FRAME_BYTES (MB(16))      // uploaded per frame
+
+align_struct texture_stream_texture
+{
+   const u8* pixels;             // whole chain, the levels are uploaded from here on demand
+   win32_file_view ktx2;         // mapping the pixels point into, decoded pixels otherwise
+   texture_mip_chain mips;
+   texture_bc_encoding encoding;
+   u32 tail_level;               // first level that never leaves
+   u32 resident_level;           // first level on the gpu once the move in progress is done
+   u32 image_level;              // first level of the image the renderer samples, resident_level while none moves
+   size upload_offset;           // into the chain of the next part of the new image, the chain size once it is full
+   u32 wanted_level;             // finest level asked for this frame
+   u64 last_wanted;              // frame that last asked for more than the tail
+} texture_stream_texture;
+
+// a part of the new image of a texture moving to another first level, coarser ones are evictions. the
+// range is of the chain and holds whole rows, the image is full when it reaches the chain size
+align_struct texture_stream_change
+{
+   u32 texture;
+   u32 from;
+   u32 to;
+   size begin;
+   size end;
+} texture_stream_change;
+
+align_struct texture_stream
+{
+   texture_stream_texture* textures;
+   u32 texture_count;
+   size budget;               // resident bytes of all the textures
+   size frame_bytes;          // uploaded bytes per frame
+   size resident_bytes;       // as if the moves in progress were done, the old images are kept until then
+   size full_bytes;           // of every level of every texture
+   u64 frame;
+
+   // since the load
+   u32 load_count;
+   u32 eviction_count;
+   size uploaded_bytes;
+} texture_stream;
+
+// bytes of a chain from a level down to 1x1
+static size texture_stream_level_bytes(const texture_mip_chain* mips, u32 level)
+{
+   return mips->size - mips->levels[level].offset;
+}
+
+static u32 texture_stream_tail_level(const texture_mip_chain* mips)
+{
+   u32 level = 0;
+   while(level + 1 < mips->level_count && max(mips->levels[level].width, mips->levels[level].height) > TEXTURE_STREAM_TAIL_SIZE)
+      level++;
+
+   return level;
+}
+
+// level whose texels are closest to one per pixel when the whole texture covers screen_pixels across
+static u32 texture_stream_level_for(const texture_mip_chain* mips, f32 screen_pixels)
+{
+   const f32 texels = (f32)max(mips->levels[0].width, mips->levels[0].height);
+   if(screen_pixels >= texels)
+      return 0;
+
+   const f32 level = log2f(texels / max(screen_pixels, 1.0f));
+
+   return min((u32)level, mips->level_count - 1);
+}
+
+static void texture_stream_init(texture_stream* stream, arena* a, u32 texture_count, size budget)
+{
+   *stream = (texture_stream){0};
+   stream->textures = texture_count ? push(a, texture_stream_texture, texture_count) : 0;
+   stream->budget = budget;
+   stream->frame_bytes = TEXTURE_STREAM_FRAME_BYTES;
+}
+
+// takes the chain, the texture is resident down to its tail
+static texture_stream_texture* texture_stream_add(texture_stream* stream, const u8* pixels, const texture_mip_chain* mips, texture_bc_encoding encoding)
+{
+   texture_stream_texture* texture = stream->textures + stream->texture_count++;
+
+   texture->pixels = pixels;
+   texture->mips = *mips;
+   texture->encoding = encoding;
+   texture->tail_level = texture_stream_tail_level(mips);
+   texture->resident_level = texture->tail_level;
+   texture->image_level = texture->tail_level;
+   texture->upload_offset = mips->size;
+   texture->wanted_level = texture->tail_level;
+
+   stream->resident_bytes += texture_stream_level_bytes(mips, texture->tail_level);
+   stream->full_bytes += mips->size;
+
+   return texture;
+}
+
+static void texture_stream_resident_set(texture_stream* stream, u32 index, u32 level)
+{
+   texture_stream_texture* texture = stream->textures + index;
+
+   stream->resident_bytes -= texture_stream_level_bytes(&texture->mips, texture->resident_level);
+   stream->resident_bytes += texture_stream_level_bytes(&texture->mips, level);
+   texture->resident_level = level;
+}
+
+// a new image of the texture from level on, the next plans fill it
+static void texture_stream_move(texture_stream* stream, u32 index, u32 level)
+{
+   texture_stream_resident_set(stream, index, level);
+   stream->textures[index].upload_offset = stream->textures[index].mips.levels[level].offset;
+}
+
+// the new image could not be made, the texture stays at the level it is sampled at
+static void texture_stream_cancel(texture_stream* stream, u32 index)
+{
+   texture_stream_texture* texture = stream->textures + index;
+
+   texture_stream_resident_set(stream, index, texture->image_level);
+   texture->upload_offset = texture->mips.size;
+}
+
+// the renderer samples the new image from now on, the texture can move again
+static void texture_stream_swapped(texture_stream* stream, u32 index)
+{
+   stream->textures[index].image_level = stream->textures[index].resident_level;
+}
+
+// end of the longest run of whole rows of texels or blocks from offset that is at most bytes
+static size texture_stream_part_end(const texture_stream_texture* texture, size offset, size bytes)
+{
+   const texture_mip_chain* mips = &texture->mips;
+   const u32 block_size = texture->encoding.format == texture_bc_none ? 0 : texture_bc_block_size(texture->encoding.format);
+
+   size end = offset;
+   for(u32 i = 0; i < mips->level_count && end < mips->size; ++i)
+   {
+      const size level_end = i + 1 < mips->level_count ? mips->levels[i + 1].offset : mips->size;
+      if(level_end <= end)
+         continue;
+
+      const size row_bytes = block_size ? (size)((mips->levels[i].width + 3) / 4) * block_size : (size)mips->levels[i].width * 4;
+      const size room = offset + bytes - end;
+
+      if(level_end - end > room)
+         return end + room / row_bytes * row_bytes;
+
+      end = level_end;
+   }
+
+   return end;
+}
+
+// the next part of the new image of a texture that fits what is left of the frame, false when not a row does
+static bool texture_stream_part(texture_stream* stream, u32 index, size* frame_bytes, texture_stream_change* change)
+{
+   texture_stream_texture* texture = stream->textures + index;
+
+   const size begin = texture->upload_offset;
+   const size end = texture_stream_part_end(texture, begin, stream->frame_bytes - *frame_bytes);
+   if(end == begin)
+      return false;
+
+   *change = (texture_stream_change){index, texture->image_level, texture->resident_level, begin, end};
+   texture->upload_offset = end;
+   *frame_bytes += end - begin;
+
+   return true;
+}
+
+// the wanted levels start over at the tails
+static void texture_stream_frame_begin(texture_stream* stream)
+{
+   stream->frame++;
+
+   for(u32 i = 0; i < stream->texture_count; ++i)
+      stream->textures[i].wanted_level = stream->textures[i].tail_level;
+}
+
+static void texture_stream_want(texture_stream* stream, u32 index, u32 level)
+{
+   if(index >= stream->texture_count)
+      return;
+
+   texture_stream_texture* texture = stream->textures + index;
+   if(level >= texture->wanted_level)
+      return;
+
+   texture->wanted_level = level;
+   texture->last_wanted = stream->frame;
+}
+
+align_struct texture_stream_candidate
+{
+   u32 texture;
+   u32 key;      // levels missing for a load, frame last wanted for an eviction
+} texture_stream_candidate;
+
+static int texture_stream_candidate_descending(const void* a, const void* b)
+{
+   const u32 ka = ((const texture_stream_candidate*)a)->key, kb = ((const texture_stream_candidate*)b)->key;
+   return (ka < kb) - (ka > kb);
+}
+
+// bytes a texture adds when its first level moves up to level
+static size texture_stream_grow(const texture_stream_texture* texture, u32 level)
+{
+   return texture_stream_level_bytes(&texture->mips, level) - texture_stream_level_bytes(&texture->mips, texture->resident_level);
+}
+
+// the parts uploaded this frame, at most the frame bytes. the images being filled go on first, then the
+// moves that start now in the order they have to be applied - every eviction comes before the load it
+// makes room for. the resident levels are updated as if all of the moves were done. a texture waits for
+// the renderer to swap in its new image before it moves again
+static u32 texture_stream_plan(texture_stream* stream, arena s, texture_stream_change* changes, u32 max_change_count)
+{
+   if(stream->texture_count == 0)
+      return 0;
+
+   u32 change_count = 0;
+   size frame_bytes = 0;
+
+   for(u32 i = 0; i < stream->texture_count && change_count < max_change_count; ++i)
+      if(stream->textures[i].upload_offset < stream->textures[i].mips.size && texture_stream_part(stream, i, &frame_bytes, changes + change_count))
+         change_count++;
+
+   texture_stream_candidate* loads = push(&s, texture_stream_candidate, stream->texture_count);
+   texture_stream_candidate* victims = push(&s, texture_stream_candidate, stream->texture_count);
+   u32 load_count = 0, victim_count = 0;
+
+   for(u32 i = 0; i < stream->texture_count; ++i)
+   {
+      const texture_stream_texture* texture = stream->textures + i;
+
+      if(texture->image_level != texture->resident_level)
+         continue;
+
+      if(texture->wanted_level < texture->resident_level)
+         loads[load_count++] = (texture_stream_candidate){i, texture->resident_level - texture->wanted_level};
+      else if(texture->resident_level < texture->wanted_level)
+         victims[victim_count++] = (texture_stream_candidate){i, (u32)(stream->frame - texture->last_wanted)};
+   }
+
+   // the furthest from what they need load first, the longest unwanted go first
+   qsort(loads, load_count, sizeof(*loads), texture_stream_candidate_descending);
+   qsort(victims, victim_count, sizeof(*victims), texture_stream_candidate_descending);
+
+   u32 victim = 0;
+
+   for(u32 i = 0; i < load_count && frame_bytes < stream->frame_bytes && change_count < max_change_count; ++i)
+   {
+      texture_stream_texture* texture = stream->textures + loads[i].texture;
+
+      // the finest level whose chain fits what is left of the frame, or one level up when none does and
+      // its image takes the frames after as well. the image is made again, so every level from the new
+      // first one is uploaded
+      u32 level = texture->wanted_level;
+      while(level + 1 < texture->resident_level && frame_bytes + texture_stream_level_bytes(&texture->mips, level) > stream->frame_bytes)
+         level++;
+
+      // older textures give back what they hold past their wanted level until this one fits, their new
+      // images are uploaded within the frame bytes too
+      while(stream->resident_bytes + texture_stream_grow(texture, level) > stream->budget && victim < victim_count &&
+            frame_bytes < stream->frame_bytes && change_count + 1 < max_change_count)
+      {
+         const u32 index = victims[victim++].texture;
+
+         texture_stream_move(stream, index, stream->textures[index].wanted_level);
+         if(texture_stream_part(stream, index, &frame_bytes, changes + change_count))
+            change_count++;
+
+         stream->eviction_count++;
+      }
+
+      // what is left of the budget takes a coarser level
+      while(level < texture->resident_level && stream->resident_bytes + texture_stream_grow(texture, level) > stream->budget)
+         level++;
+
+      if(level == texture->resident_level)
+         continue;
+
+      texture_stream_move(stream, loads[i].texture, level);
+      if(texture_stream_part(stream, loads[i].texture, &frame_bytes, changes + change_count))
+         change_count++;
+
+      stream->load_count++;
+   }
+
+   return change_count;
+}
+
+static void texture_stream_release(texture_stream* stream)
+{
+   for(u32 i = 0; i < stream->texture_count; ++i)
+   {
+      texture_stream_texture* texture = stream->textures + i;
+
+      if(texture->ktx2.data)
+         win32_file_unmap(&texture->ktx2);
+      else
+         stbi_image_free((void*)texture->pixels);
+
+      texture->pixels = 0;
+   }
+}
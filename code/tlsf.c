@@ -0,0 +1,323 @@
+#include "tlsf.h"
+#include "math.h"
+
+// floor of the log2 of a non zero value
+static u32 tlsf_log2(u64 v)
+{
+   assert(v);
+
+   u32 r = 0;
+   if(v >> 32) { v >>= 32; r += 32; }
+   if(v >> 16) { v >>= 16; r += 16; }
+   if(v >> 8)  { v >>= 8;  r += 8; }
+   if(v >> 4)  { v >>= 4;  r += 4; }
+   if(v >> 2)  { v >>= 2;  r += 2; }
+   if(v >> 1)  { r += 1; }
+
+   return r;
+}
+
+// index of the lowest set bit of a non zero mask
+static u32 tlsf_lowest(u32 mask)
+{
+   static const u8 debruijn[32] =
+   {
+      0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+      31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+   };
+
+   assert(mask);
+   return debruijn[((mask & (0u - mask)) * 0x077cb531u) >> 27];
+}
+
+// size class of a free range, the first level is the power of two and the second its 16th
+static void tlsf_mapping(u64 bytes, u32* fl, u32* sl)
+{
+   const u64 units = bytes >> TLSF_GRANULE_LOG2;
+   assert(units > 0);
+
+   if(units < TLSF_SL_COUNT)
+   {
+      *fl = 0;
+      *sl = (u32)units;
+      return;
+   }
+
+   const u32 l = tlsf_log2(units);
+   *fl = l - TLSF_SL_LOG2 + 1;
+   *sl = (u32)(units >> (l - TLSF_SL_LOG2)) - TLSF_SL_COUNT;
+
+   assert(*fl < TLSF_FL_COUNT);
+}
+
+static u32 tlsf_node_take(tlsf* t)
+{
+   const u32 index = t->unused;
+   assert(index != TLSF_NONE);
+
+   t->unused = t->nodes[index].next_free;
+   return index;
+}
+
+static void tlsf_node_give(tlsf* t, u32 index)
+{
+   t->nodes[index].size = 0;
+   t->nodes[index].next_free = t->unused;
+   t->unused = index;
+}
+
+static void tlsf_free_insert(tlsf* t, u32 index)
+{
+   tlsf_node* node = t->nodes + index;
+
+   u32 fl, sl;
+   tlsf_mapping(node->size, &fl, &sl);
+
+   const u32 head = t->heads[fl][sl];
+
+   node->free = true;
+   node->prev_free = TLSF_NONE;
+   node->next_free = head;
+
+   if(head != TLSF_NONE)
+      t->nodes[head].prev_free = index;
+
+   t->heads[fl][sl] = index;
+   t->fl_bitmap |= 1u << fl;
+   t->sl_bitmaps[fl] |= 1u << sl;
+}
+
+static void tlsf_free_remove(tlsf* t, u32 index)
+{
+   tlsf_node* node = t->nodes + index;
+
+   u32 fl, sl;
+   tlsf_mapping(node->size, &fl, &sl);
+
+   if(node->prev_free != TLSF_NONE)
+      t->nodes[node->prev_free].next_free = node->next_free;
+   else
+      t->heads[fl][sl] = node->next_free;
+
+   if(node->next_free != TLSF_NONE)
+      t->nodes[node->next_free].prev_free = node->prev_free;
+
+   if(t->heads[fl][sl] == TLSF_NONE)
+   {
+      t->sl_bitmaps[fl] &= ~(1u << sl);
+      if(t->sl_bitmaps[fl] == 0)
+         t->fl_bitmap &= ~(1u << fl);
+   }
+
+   node->free = false;
+}
+
+// a free range at least bytes long - the size is rounded up to the next class, so any range of the
+// class found fits without walking its list
+static u32 tlsf_search(const tlsf* t, u64 bytes)
+{
+   u64 units = bytes >> TLSF_GRANULE_LOG2;
+   if(units >= TLSF_SL_COUNT)
+   {
+      units += (1ull << (tlsf_log2(units) - TLSF_SL_LOG2)) - 1;
+
+      // larger than any range
+      if(tlsf_log2(units) - TLSF_SL_LOG2 + 1 >= TLSF_FL_COUNT)
+         return TLSF_NONE;
+   }
+
+   u32 fl, sl;
+   tlsf_mapping(units << TLSF_GRANULE_LOG2, &fl, &sl);
+
+   u32 sl_map = t->sl_bitmaps[fl] & (~0u << sl);
+   if(!sl_map)
+   {
+      const u32 fl_map = fl + 1 < 32 ? t->fl_bitmap & (~0u << (fl + 1)) : 0;
+      if(!fl_map)
+         return TLSF_NONE;
+
+      fl = tlsf_lowest(fl_map);
+      sl_map = t->sl_bitmaps[fl];
+   }
+
+   return t->heads[fl][tlsf_lowest(sl_map)];
+}
+
+// the whole range is one free node, node_count bounds the allocations and free ranges at once
+static void tlsf_init(tlsf* t, arena* a, u64 range_size, u32 node_count)
+{
+   assert(node_count >= 3);
+
+   *t = (tlsf){0};
+   t->nodes = push(a, tlsf_node, node_count);
+   t->node_count = node_count;
+   t->size = range_size & ~(TLSF_GRANULE - 1);
+
+   for(u32 fl = 0; fl < TLSF_FL_COUNT; ++fl)
+      for(u32 sl = 0; sl < TLSF_SL_COUNT; ++sl)
+         t->heads[fl][sl] = TLSF_NONE;
+
+   for(u32 i = 0; i < node_count; ++i)
+      t->nodes[i].next_free = i + 1 < node_count ? i + 1 : TLSF_NONE;
+
+   t->unused = 0;
+
+   const u32 first = tlsf_node_take(t);
+   t->nodes[first] = (tlsf_node){.offset = 0, .size = t->size, .prev_physical = TLSF_NONE, .next_physical = TLSF_NONE};
+   tlsf_free_insert(t, first);
+}
+
+// splits bytes off the front of a node into a node of their own that comes before it
+static u32 tlsf_split_front(tlsf* t, u32 index, u64 bytes)
+{
+   const u32 front = tlsf_node_take(t);
+   tlsf_node* node = t->nodes + index;
+
+   t->nodes[front] = (tlsf_node){.offset = node->offset, .size = bytes, .prev_physical = node->prev_physical, .next_physical = index};
+   if(node->prev_physical != TLSF_NONE)
+      t->nodes[node->prev_physical].next_physical = front;
+
+   node->prev_physical = front;
+   node->offset += bytes;
+   node->size -= bytes;
+
+   return front;
+}
+
+// offset of bytes aligned to alignment, a power of two, or none when nothing fits
+static u32 tlsf_alloc(tlsf* t, u64 bytes, u64 alignment, u64* offset)
+{
+   bytes = max((bytes + TLSF_GRANULE - 1) & ~(TLSF_GRANULE - 1), TLSF_GRANULE);
+   alignment = max(alignment, TLSF_GRANULE);
+   assert((alignment & (alignment - 1)) == 0);
+
+   // the padding in front and the rest behind take a node each
+   u32 unused_count = 0;
+   for(u32 i = t->unused; i != TLSF_NONE && unused_count < 2; i = t->nodes[i].next_free)
+      unused_count++;
+
+   if(unused_count < 2)
+      return TLSF_NONE;
+
+   const u32 index = tlsf_search(t, bytes + alignment - TLSF_GRANULE);
+   if(index == TLSF_NONE)
+      return TLSF_NONE;
+
+   tlsf_free_remove(t, index);
+
+   const tlsf_node* node = t->nodes + index;
+   const u64 padding = ((node->offset + alignment - 1) & ~(alignment - 1)) - node->offset;
+
+   // free neighbours are always merged, so the ranges split off cannot join one
+   if(padding > 0)
+      tlsf_free_insert(t, tlsf_split_front(t, index, padding));
+
+   if(t->nodes[index].size > bytes)
+   {
+      const u32 used = tlsf_split_front(t, index, bytes);
+      tlsf_free_insert(t, index);
+
+      t->used += bytes;
+      t->allocation_count++;
+      *offset = t->nodes[used].offset;
+
+      return used;
+   }
+
+   t->used += t->nodes[index].size;
+   t->allocation_count++;
+   *offset = t->nodes[index].offset;
+
+   return index;
+}
+
+// gives the node back, merged with its free neighbours
+static void tlsf_free(tlsf* t, u32 index)
+{
+   tlsf_node* node = t->nodes + index;
+   assert(!node->free);
+
+   t->used -= node->size;
+   t->allocation_count--;
+
+   const u32 prev = node->prev_physical;
+   if(prev != TLSF_NONE && t->nodes[prev].free)
+   {
+      tlsf_free_remove(t, prev);
+
+      node->offset = t->nodes[prev].offset;
+      node->size += t->nodes[prev].size;
+      node->prev_physical = t->nodes[prev].prev_physical;
+      if(node->prev_physical != TLSF_NONE)
+         t->nodes[node->prev_physical].next_physical = index;
+
+      tlsf_node_give(t, prev);
+   }
+
+   const u32 next = node->next_physical;
+   if(next != TLSF_NONE && t->nodes[next].free)
+   {
+      tlsf_free_remove(t, next);
+
+      node->size += t->nodes[next].size;
+      node->next_physical = t->nodes[next].next_physical;
+      if(node->next_physical != TLSF_NONE)
+         t->nodes[node->next_physical].prev_physical = index;
+
+      tlsf_node_give(t, next);
+   }
+
+   tlsf_free_insert(t, index);
+}
+
+// bytes of the largest free range, from the highest class in use
+static u64 tlsf_largest_free(const tlsf* t)
+{
+   if(!t->fl_bitmap)
+      return 0;
+
+   const u32 fl = tlsf_log2(t->fl_bitmap);
+   const u32 sl = tlsf_log2(t->sl_bitmaps[fl]);
+
+   u64 result = 0;
+   for(u32 i = t->heads[fl][sl]; i != TLSF_NONE; i = t->nodes[i].next_free)
+      result = max(result, t->nodes[i].size);
+
+   return result;
+}
+
+// walks the range by offset, the nodes tile it without gaps, no two free ones touch and the counts match
+static bool tlsf_check(const tlsf* t)
+{
+   u32 first = TLSF_NONE;
+   for(u32 i = 0; i < t->node_count && first == TLSF_NONE; ++i)
+      if(t->nodes[i].prev_physical == TLSF_NONE && t->nodes[i].offset == 0 && t->nodes[i].size > 0)
+         first = i;
+
+   u64 offset = 0, used = 0;
+   u32 allocation_count = 0;
+   bool prev_free = false;
+
+   for(u32 i = first; i != TLSF_NONE; i = t->nodes[i].next_physical)
+   {
+      const tlsf_node* node = t->nodes + i;
+
+      if(node->offset != offset || node->size == 0 || (node->size & (TLSF_GRANULE - 1)))
+         return false;
+      if(node->free && prev_free)
+         return false;
+      if(node->next_physical != TLSF_NONE && t->nodes[node->next_physical].prev_physical != i)
+         return false;
+
+      if(!node->free)
+      {
+         used += node->size;
+         allocation_count++;
+      }
+
+      prev_free = node->free;
+      offset += node->size;
+   }
+
+   return offset == t->size && used == t->used && allocation_count == t->allocation_count;
+}
@@ -0,0 +1,42 @@
+#if !defined(_TLSF_H)
+#define _TLSF_H
+
+#include "common.h"
+#include "arena.h"
+
+// two level segregated fit placement inside one range of offsets. the free ranges are kept in lists by
+// size class, a power of two split in 16 steps, and two levels of bitmaps find a class with a fitting
+// range in constant time. the range itself is never touched, so it can be device memory
+
+#define TLSF_GRANULE_LOG2 8                        // every size and offset is a multiple of 256 bytes
+#define TLSF_GRANULE (1ull << TLSF_GRANULE_LOG2)
+#define TLSF_SL_LOG2 4
+#define TLSF_SL_COUNT (1u << TLSF_SL_LOG2)
+#define TLSF_FL_COUNT 30                           // ranges up to 2^(30 + 4 + 8) bytes
+#define TLSF_NONE 0xffffffffu
+
+align_struct tlsf_node
+{
+   u64 offset;
+   u64 size;
+   u32 prev_physical;   // neighbours by offset, none at the ends of the range
+   u32 next_physical;
+   u32 prev_free;       // in the list of its size class while free
+   u32 next_free;       // next unused node while the node is not in use
+   bool free;
+} tlsf_node;
+
+align_struct tlsf
+{
+   tlsf_node* nodes;
+   u32 node_count;
+   u32 unused;          // first node not in use
+   u32 fl_bitmap;       // first levels with any free range
+   u32 sl_bitmaps[TLSF_FL_COUNT];
+   u32 heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+   u64 size;
+   u64 used;            // bytes of the allocations, rounded to the granule
+   u32 allocation_count;
+} tlsf;
+
+#endif
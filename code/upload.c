@@ -0,0 +1,423 @@
+#include "vulkan_ng.h"
+
+// staging of every copy to device memory - the data is written into one persistently mapped ring and
+// the copies out of it are recorded into a few command buffers used round robin. a batch is submitted
+// with its own fence once it holds a quarter of the ring or when the caller flushes, and it gives its
+// part of the ring back when the fence is waited for. nothing waits for the device unless the ring is
+// full or the caller needs the copies finished.
+// on a device with a transfer only queue family the copies run there, next to the rendering. what a
+// batch wrote is released to the graphics family at its submit and acquired by a small command buffer
+// on the graphics queue that waits for the copies, so the frames queued after it see the data
+
+#define VK_UPLOAD_RING_SIZE (MB(64))
+#define VK_UPLOAD_ALIGNMENT 16      // bc blocks, rgba8 texels and the 4 bytes of buffer copies
+
+static bool vk_upload_create(vk_upload* upload, vk_device* devices)
+{
+   *upload = (vk_upload){0};
+
+   upload->transfer = devices->transfer_family_index != invalid_index;
+   upload->graphics_family = (u32)devices->queue_family_index;
+   upload->transfer_family = upload->transfer ? (u32)devices->transfer_family_index : upload->graphics_family;
+
+   VkCommandPoolCreateInfo pool_info = {vk_info(COMMAND_POOL)};
+   pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+   pool_info.queueFamilyIndex = upload->transfer_family;
+
+   if(!vk_valid(vkCreateCommandPool(devices->logical, &pool_info, &global_allocator.handle, &upload->pool)))
+      return false;
+
+   pool_info.queueFamilyIndex = upload->graphics_family;
+   if(upload->transfer)
+      if(!vk_valid(vkCreateCommandPool(devices->logical, &pool_info, &global_allocator.handle, &upload->acquire_pool)))
+         return false;
+
+   VkCommandBufferAllocateInfo buffer_info = {vk_info_allocate(COMMAND_BUFFER)};
+   buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+   buffer_info.commandBufferCount = 1;
+
+   VkFenceCreateInfo fence_info = {vk_info(FENCE)};
+   VkSemaphoreCreateInfo semaphore_info = {vk_info(SEMAPHORE)};
+
+   for(u32 i = 0; i < VK_UPLOAD_BATCH_COUNT; ++i)
+   {
+      vk_upload_batch* batch = upload->batches + i;
+
+      buffer_info.commandPool = upload->pool;
+      if(!vk_valid(vkAllocateCommandBuffers(devices->logical, &buffer_info, &batch->buffer)))
+         return false;
+      if(!vk_valid(vkCreateFence(devices->logical, &fence_info, &global_allocator.handle, &batch->fence)))
+         return false;
+
+      if(!upload->transfer)
+         continue;
+
+      buffer_info.commandPool = upload->acquire_pool;
+      if(!vk_valid(vkAllocateCommandBuffers(devices->logical, &buffer_info, &batch->acquire)))
+         return false;
+      if(!vk_valid(vkCreateSemaphore(devices->logical, &semaphore_info, &global_allocator.handle, &batch->copied)))
+         return false;
+   }
+
+   upload->ring.size = VK_UPLOAD_RING_SIZE;
+
+   return vk_buffer_create_and_bind(&upload->ring, devices, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+}
+
+static void vk_upload_destroy(vk_upload* upload, vk_device* devices)
+{
+   for(u32 i = 0; i < VK_UPLOAD_BATCH_COUNT; ++i)
+   {
+      vkDestroyFence(devices->logical, upload->batches[i].fence, &global_allocator.handle);
+      vkDestroySemaphore(devices->logical, upload->batches[i].copied, &global_allocator.handle);
+   }
+
+   vkDestroyCommandPool(devices->logical, upload->pool, &global_allocator.handle);
+   vkDestroyCommandPool(devices->logical, upload->acquire_pool, &global_allocator.handle);
+   vk_buffer_destroy(devices, &upload->ring);
+}
+
+// waits for a submitted batch and takes its part of the ring back
+static void vk_upload_retire(vk_context* context, vk_upload_batch* batch)
+{
+   vk_upload* upload = &context->upload;
+
+   vk_assert(vkWaitForFences(context->devices.logical, 1, &batch->fence, VK_TRUE, UINT64_MAX));
+   vk_assert(vkResetFences(context->devices.logical, 1, &batch->fence));
+
+   upload->tail = max(upload->tail, batch->end);
+   upload->wait_count++;
+   batch->submitted = false;
+}
+
+// the batches after the one being recorded are the oldest, returns false when none is in flight
+static bool vk_upload_retire_oldest(vk_context* context)
+{
+   vk_upload* upload = &context->upload;
+
+   for(u32 i = 0; i < VK_UPLOAD_BATCH_COUNT; ++i)
+   {
+      vk_upload_batch* batch = upload->batches + (upload->current + i) % VK_UPLOAD_BATCH_COUNT;
+      if(batch->submitted)
+      {
+         vk_upload_retire(context, batch);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+// the released ranges and images of the batch go from the transfer family to the graphics family, the
+// same barriers are recorded on both sides
+static void vk_upload_transfer_ownership(vk_upload* upload, vk_upload_batch* batch)
+{
+   VkBufferMemoryBarrier* buffers = upload->buffer_releases;
+   VkImageMemoryBarrier* images = upload->image_releases;
+   const u32 buffer_count = upload->buffer_release_count, image_count = upload->image_release_count;
+
+   for(u32 i = 0; i < buffer_count; ++i)
+   {
+      buffers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      buffers[i].dstAccessMask = 0;
+   }
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      images[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      images[i].dstAccessMask = 0;
+   }
+
+   if(buffer_count || image_count)
+      vkCmdPipelineBarrier(batch->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                           0, 0, buffer_count, buffers, image_count, images);
+
+   for(u32 i = 0; i < buffer_count; ++i)
+   {
+      buffers[i].srcAccessMask = 0;
+      buffers[i].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+   }
+   for(u32 i = 0; i < image_count; ++i)
+   {
+      images[i].srcAccessMask = 0;
+      images[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+   }
+
+   // the copies recorded on the graphics side are made visible with the acquires
+   VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+   barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+   vkCmdPipelineBarrier(batch->acquire, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                        1, &barrier, buffer_count, buffers, image_count, images);
+
+   upload->buffer_release_count = upload->image_release_count = 0;
+}
+
+// submits what was recorded so far without waiting for it. the copies are made visible to every later
+// command on the graphics queue
+static void vk_upload_flush(vk_context* context)
+{
+   vk_upload* upload = &context->upload;
+   vk_upload_batch* batch = upload->batches + upload->current;
+
+   if(!upload->recording)
+      return;
+
+   VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+   submit_info.commandBufferCount = 1;
+   submit_info.pCommandBuffers = &batch->buffer;
+
+   if(upload->transfer)
+   {
+      vk_upload_transfer_ownership(upload, batch);
+
+      vk_assert(vkEndCommandBuffer(batch->buffer));
+      vk_assert(vkEndCommandBuffer(batch->acquire));
+
+      submit_info.signalSemaphoreCount = 1;
+      submit_info.pSignalSemaphores = &batch->copied;
+
+      vk_assert(vkQueueSubmit(context->transfer_queue, 1, &submit_info, VK_NULL_HANDLE));
+
+      const VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+      VkSubmitInfo acquire_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+      acquire_info.waitSemaphoreCount = 1;
+      acquire_info.pWaitSemaphores = &batch->copied;
+      acquire_info.pWaitDstStageMask = &wait_stage;
+      acquire_info.commandBufferCount = 1;
+      acquire_info.pCommandBuffers = &batch->acquire;
+
+      vk_assert(vkQueueSubmit(context->graphics_queue, 1, &acquire_info, batch->fence));
+   }
+   else
+   {
+      VkMemoryBarrier barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+      vkCmdPipelineBarrier(batch->buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+      vk_assert(vkEndCommandBuffer(batch->buffer));
+      vk_assert(vkQueueSubmit(context->graphics_queue, 1, &submit_info, batch->fence));
+   }
+
+   batch->end = upload->head;
+   batch->serial = ++upload->serial;
+   batch->submitted = true;
+
+   upload->current = (upload->current + 1) % VK_UPLOAD_BATCH_COUNT;
+   upload->recording = false;
+   upload->submit_count++;
+}
+
+// submits and waits for every batch, the ring is empty after
+static void vk_upload_finish(vk_context* context)
+{
+   vk_upload_flush(context);
+   while(vk_upload_retire_oldest(context))
+      ;
+
+   context->upload.tail = context->upload.head;
+}
+
+// the batch that holds the copies recorded so far, the one being recorded is submitted with the next serial
+static u64 vk_upload_serial(vk_context* context)
+{
+   const vk_upload* upload = &context->upload;
+   return upload->recording ? upload->serial + 1 : upload->serial;
+}
+
+// whether the batch of a serial is done, without waiting. a batch that was waited for or recorded again
+// since is done
+static bool vk_upload_done(vk_context* context, u64 serial)
+{
+   const vk_upload* upload = &context->upload;
+
+   if(serial > upload->serial)
+      return false;
+
+   for(u32 i = 0; i < VK_UPLOAD_BATCH_COUNT; ++i)
+   {
+      const vk_upload_batch* batch = upload->batches + i;
+      if(batch->submitted && batch->serial == serial)
+         return vkGetFenceStatus(context->devices.logical, batch->fence) == VK_SUCCESS;
+   }
+
+   return true;
+}
+
+// command buffer of the batch being recorded, begins one if there is none
+static VkCommandBuffer vk_upload_cmd(vk_context* context)
+{
+   vk_upload* upload = &context->upload;
+   vk_upload_batch* batch = upload->batches + upload->current;
+
+   if(upload->recording)
+      return batch->buffer;
+
+   // a batch comes around again only after the others were submitted
+   if(batch->submitted)
+      vk_upload_retire(context, batch);
+
+   vk_assert(vkResetCommandBuffer(batch->buffer, 0));
+
+   VkCommandBufferBeginInfo begin_info = {vk_info_begin(COMMAND_BUFFER)};
+   begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+   vk_assert(vkBeginCommandBuffer(batch->buffer, &begin_info));
+
+   if(upload->transfer)
+   {
+      vk_assert(vkResetCommandBuffer(batch->acquire, 0));
+      vk_assert(vkBeginCommandBuffer(batch->acquire, &begin_info));
+   }
+
+   upload->recording = true;
+   upload->batch_begin = upload->head;
+
+   return batch->buffer;
+}
+
+// command buffer on the graphics queue, for copies between resources the graphics family owns. with a
+// transfer queue the batch before is submitted first, so its acquires come before these copies
+static VkCommandBuffer vk_upload_graphics_cmd(vk_context* context)
+{
+   vk_upload* upload = &context->upload;
+
+   if(!upload->transfer)
+      return vk_upload_cmd(context);
+
+   vk_upload_flush(context);
+   vk_upload_cmd(context);
+
+   return upload->batches[upload->current].acquire;
+}
+
+// a range of a buffer written by the batch, handed to the graphics family when the batch is submitted.
+// ranges that continue the last one are merged into it
+static void vk_upload_release_buffer(vk_context* context, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range_size)
+{
+   vk_upload* upload = &context->upload;
+
+   if(!upload->transfer)
+      return;
+
+   if(upload->buffer_release_count)
+   {
+      VkBufferMemoryBarrier* last = upload->buffer_releases + upload->buffer_release_count - 1;
+      if(last->buffer == buffer && last->offset + last->size == offset)
+      {
+         last->size += range_size;
+         return;
+      }
+   }
+
+   VkBufferMemoryBarrier* barrier = upload->buffer_releases + upload->buffer_release_count++;
+   *barrier = (VkBufferMemoryBarrier){VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+   barrier->srcQueueFamilyIndex = upload->transfer_family;
+   barrier->dstQueueFamilyIndex = upload->graphics_family;
+   barrier->buffer = buffer;
+   barrier->offset = offset;
+   barrier->size = range_size;
+
+   if(upload->buffer_release_count == VK_UPLOAD_RELEASE_MAX)
+      vk_upload_flush(context);
+}
+
+// every level of an image written by the batch goes to shader reads, with a transfer queue the layout
+// changes when the graphics family acquires it
+static void vk_upload_release_image(vk_context* context, VkImage image, u32 level_count)
+{
+   vk_upload* upload = &context->upload;
+
+   VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+   barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+   barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+   barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+   barrier.srcQueueFamilyIndex = upload->transfer ? upload->transfer_family : VK_QUEUE_FAMILY_IGNORED;
+   barrier.dstQueueFamilyIndex = upload->transfer ? upload->graphics_family : VK_QUEUE_FAMILY_IGNORED;
+   barrier.image = image;
+   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+   barrier.subresourceRange.levelCount = level_count;
+   barrier.subresourceRange.layerCount = 1;
+
+   if(!upload->transfer)
+   {
+      vkCmdPipelineBarrier(vk_upload_cmd(context), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                           0, 0, 0, 0, 0, 1, &barrier);
+      return;
+   }
+
+   upload->image_releases[upload->image_release_count++] = barrier;
+
+   if(upload->image_release_count == VK_UPLOAD_RELEASE_MAX)
+      vk_upload_flush(context);
+}
+
+// copies the data into the ring and returns its offset there, waits for the oldest batches while the
+// ring is full. the end of the ring is skipped when the data does not fit before it
+static VkDeviceSize vk_upload_stage(vk_context* context, const void* data, size data_size)
+{
+   vk_upload* upload = &context->upload;
+   const u64 ring_size = (u64)upload->ring.size;
+
+   assert(data_size > 0 && (u64)data_size <= ring_size);
+
+   u64 begin = 0;
+   for(;;)
+   {
+      begin = (upload->head + VK_UPLOAD_ALIGNMENT - 1) & ~(u64)(VK_UPLOAD_ALIGNMENT - 1);
+      if(begin % ring_size + data_size > ring_size)
+         begin += ring_size - begin % ring_size;
+
+      if(begin + data_size - upload->tail <= ring_size)
+         break;
+
+      if(vk_upload_retire_oldest(context))
+         continue;
+
+      // the batch being recorded holds the rest of the ring
+      if(upload->recording)
+      {
+         vk_upload_flush(context);
+         continue;
+      }
+
+      // nothing in flight, the ring starts over at its beginning
+      upload->head = upload->tail = (upload->head + ring_size - 1) / ring_size * ring_size;
+   }
+
+   upload->head = begin + data_size;
+   upload->bytes += data_size;
+
+   const VkDeviceSize offset = begin % ring_size;
+   memcpy((u8*)upload->ring.data + offset, data, data_size);
+
+   return offset;
+}
+
+// a full enough batch goes to the device so the copies overlap the staging of the next ones
+static void vk_upload_commit(vk_context* context)
+{
+   vk_upload* upload = &context->upload;
+
+   upload->copy_count++;
+   if(upload->recording && upload->head - upload->batch_begin >= (u64)upload->ring.size / VK_UPLOAD_BATCH_COUNT)
+      vk_upload_flush(context);
+}
+
+// counts since the last report
+static void vk_upload_report(vk_context* context)
+{
+   vk_upload* upload = &context->upload;
+
+   printf("Uploads: %u copies, %.1f MB through the %.0f MB staging ring in %u submits to the %s queue, %u fence waits\n",
+          upload->copy_count, upload->bytes / (f64)MB(1), upload->ring.size / (f64)MB(1), upload->submit_count,
+          upload->transfer ? "transfer" : "graphics", upload->wait_count);
+
+   upload->copy_count = upload->submit_count = upload->wait_count = 0;
+   upload->bytes = 0;
+}
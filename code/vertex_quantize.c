@@ -0,0 +1,134 @@
+#include "meshlet.h"
+#include "fixed_point.h"
+
+// encoder of the compact vertex layout - positions relative to the bounds of their mesh draw,
+// octahedral normals and half float uvs, together with the error against the float vertices
+
+static_assert(sizeof(vertex_quantized) == 16);
+
+align_struct vertex_quantize_bounds
+{
+   f32 center[3];
+   f32 extent[3];    // half size per axis, never zero
+} vertex_quantize_bounds;
+
+align_struct vertex_quantize_error
+{
+   f64 position_max;          // in mesh units
+   f64 position_max_relative; // of the largest extent of the mesh draw
+   f64 normal_max_degrees;
+   f64 uv_max;
+   usize vertex_count;
+} vertex_quantize_error;
+
+static vertex_quantize_bounds vertex_quantize_bounds_compute(const vertex* vertices, usize count)
+{
+   vertex_quantize_bounds result = {.extent = {1.0f, 1.0f, 1.0f}};
+   if(count == 0)
+      return result;
+
+   f32 lo[3] = {vertices[0].vx, vertices[0].vy, vertices[0].vz};
+   f32 hi[3] = {lo[0], lo[1], lo[2]};
+
+   for(usize i = 1; i < count; ++i)
+   {
+      const f32 p[3] = {vertices[i].vx, vertices[i].vy, vertices[i].vz};
+      for(u32 k = 0; k < 3; ++k)
+      {
+         lo[k] = min(lo[k], p[k]);
+         hi[k] = max(hi[k], p[k]);
+      }
+   }
+
+   for(u32 k = 0; k < 3; ++k)
+   {
+      result.center[k] = 0.5f * (lo[k] + hi[k]);
+      result.extent[k] = max(0.5f * (hi[k] - lo[k]), 1e-20f);
+   }
+
+   return result;
+}
+
+// the u8 normal of struct vertex
+static void vertex_quantize_normal_unpack(f32 n[3], const vertex* v)
+{
+   n[0] = ((f32)v->nx - 127.5f) / 127.5f;
+   n[1] = ((f32)v->ny - 127.5f) / 127.5f;
+   n[2] = ((f32)v->nz - 127.5f) / 127.5f;
+
+   const f32 l = sqrtf(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+   if(l > 0.0f)
+   {
+      n[0] /= l;
+      n[1] /= l;
+      n[2] /= l;
+   }
+}
+
+static u32 vertex_quantize_pack(i16 lo, i16 hi)
+{
+   return (u32)(u16)lo | ((u32)(u16)hi << 16);
+}
+
+static void vertex_quantize(vertex_quantized* out, const vertex* in, usize count, vertex_quantize_bounds bounds)
+{
+   const f32 inv_extent[3] = {1.0f / bounds.extent[0], 1.0f / bounds.extent[1], 1.0f / bounds.extent[2]};
+
+   for(usize i = 0; i < count; ++i)
+   {
+      const vertex* v = in + i;
+
+      const i16 px = FP_snorm16((v->vx - bounds.center[0]) * inv_extent[0]);
+      const i16 py = FP_snorm16((v->vy - bounds.center[1]) * inv_extent[1]);
+      const i16 pz = FP_snorm16((v->vz - bounds.center[2]) * inv_extent[2]);
+
+      f32 n[3], e[2];
+      vertex_quantize_normal_unpack(n, v);
+      FP_octahedral_encode(e, n);
+
+      out[i].pxy = vertex_quantize_pack(px, py);
+      out[i].pzw = vertex_quantize_pack(pz, 0);
+      out[i].n = vertex_quantize_pack(FP_snorm16(e[0]), FP_snorm16(e[1]));
+      out[i].t = (u32)FP_half(v->tu) | ((u32)FP_half(v->tv) << 16);
+   }
+}
+
+// decodes like vertex.glsl and keeps the largest differences
+static void vertex_quantize_error_measure(vertex_quantize_error* error, const vertex_quantized* quantized, const vertex* in,
+                                          usize count, vertex_quantize_bounds bounds)
+{
+   const f64 largest_extent = max(bounds.extent[0], max(bounds.extent[1], bounds.extent[2]));
+
+   for(usize i = 0; i < count; ++i)
+   {
+      const vertex_quantized* q = quantized + i;
+      const vertex* v = in + i;
+
+      const f32 p[3] =
+      {
+         bounds.center[0] + bounds.extent[0] * FP_from_snorm16((i16)(q->pxy & 0xffff)),
+         bounds.center[1] + bounds.extent[1] * FP_from_snorm16((i16)(q->pxy >> 16)),
+         bounds.center[2] + bounds.extent[2] * FP_from_snorm16((i16)(q->pzw & 0xffff)),
+      };
+
+      const f64 dx = p[0] - v->vx, dy = p[1] - v->vy, dz = p[2] - v->vz;
+      const f64 position_error = sqrt(dx*dx + dy*dy + dz*dz);
+
+      error->position_max = max(error->position_max, position_error);
+      error->position_max_relative = max(error->position_max_relative, position_error / largest_extent);
+
+      f32 n[3], decoded[3];
+      const f32 e[2] = {FP_from_snorm16((i16)(q->n & 0xffff)), FP_from_snorm16((i16)(q->n >> 16))};
+      vertex_quantize_normal_unpack(n, v);
+      FP_octahedral_decode(decoded, e);
+
+      const f64 cosine = clamp((f64)n[0]*decoded[0] + (f64)n[1]*decoded[1] + (f64)n[2]*decoded[2], -1.0, 1.0);
+      error->normal_max_degrees = max(error->normal_max_degrees, acos(cosine) * (180.0 / PI));
+
+      const f64 du = fabs((f64)FP_from_half((u16)(q->t & 0xffff)) - v->tu);
+      const f64 dv = fabs((f64)FP_from_half((u16)(q->t >> 16)) - v->tv);
+      error->uv_max = max(error->uv_max, max(du, dv));
+   }
+
+   error->vertex_count += count;
+}
@@ -8,25 +8,23 @@ static vk_allocator global_allocator;
 
 #include "vulkan_spirv_loader.c"
 #include "free_list.c"
+#include "tlsf.c"
+#include "memory.c"
 #include "texture.c"
 #include "hash.c"
+#include "draw_batch.c"
+#include "upload.c"
 #include "buffer.c"
+#include "meshlet.c"
 #include "gltf.c"
 #include "rt.c"
+#include "pipeline_cache.c"
 
-static void* VKAPI_PTR vk_allocation(void* user_data,
-                                     size_t new_size,
-                                     size_t alignment,
-                                     VkSystemAllocationScope scope)
+// callers hold the lock
+static void* vk_allocator_take(vk_allocator* allocator, size_t new_size, size_t alignment)
 {
-   (void)scope;
    (void)alignment;
 
-   if(new_size == 0)
-      return 0;
-
-   vk_allocator* allocator = user_data;
-
    arena* a = allocator->a;
    list* l = &allocator->slots;
 
@@ -71,6 +69,25 @@ static void* VKAPI_PTR vk_allocation(void* user_data,
    return (byte*)memory + sizeof(size);
 }
 
+static void* VKAPI_PTR vk_allocation(void* user_data,
+                                     size_t new_size,
+                                     size_t alignment,
+                                     VkSystemAllocationScope scope)
+{
+   (void)scope;
+
+   if(new_size == 0)
+      return 0;
+
+   vk_allocator* allocator = user_data;
+
+   AcquireSRWLockExclusive(&allocator->lock);
+   void* result = vk_allocator_take(allocator, new_size, alignment);
+   ReleaseSRWLockExclusive(&allocator->lock);
+
+   return result;
+}
+
 static void* VKAPI_PTR vk_reallocation(void* user_data,
                                        void* original,
                                        size_t new_size,
@@ -108,7 +125,9 @@ static void VKAPI_PTR vk_free(void* user_data, void* memory)
 
    list_node* n = (list_node*)((byte*)memory - (sizeof(list_node) + sizeof(size)));
 
+   AcquireSRWLockExclusive(&allocator->lock);
    node_release(l, n);
+   ReleaseSRWLockExclusive(&allocator->lock);
 
    #if _DEBUG
    printf("RELEASING node to free-list: %p with %zu bytes\n", n, n->data.slot_size);
@@ -137,7 +156,7 @@ static void VKAPI_PTR vk_internal_free(void* user_data,
    (void)scope;
 }
 
-static bool vk_gltf_read(vk_context* context, s8 filename)
+static bool vk_gltf_read(vk_context* context, s8 filename, gltf_load_options options)
 {
    array(char) file_path = {context->app_storage};
    s8 prefix = s8("%s\\assets\\gltf\\%s");
@@ -149,8 +168,9 @@ static bool vk_gltf_read(vk_context* context, s8 filename)
 
    s8 gltf_path = {.data = (u8*)file_path.data, .len = file_path.count};
 
-   assert(s8_equals(s8_slice(gltf_path, gltf_path.len - s8(".gltf").len, gltf_path.len), s8(".gltf")));
-   return gltf_load(context, gltf_path);
+   assert(s8_equals(s8_slice(gltf_path, gltf_path.len - s8(".gltf").len, gltf_path.len), s8(".gltf")) ||
+          s8_equals(s8_slice(gltf_path, gltf_path.len - s8(".glb").len, gltf_path.len), s8(".glb")));
+   return gltf_load(context, gltf_path, options);
 }
 
 static vk_shader_module vk_shader_load(VkDevice logical_device, arena scratch, const char* shader_name_raw)
@@ -254,11 +274,11 @@ static bool spirv_initialize(vk_context* context)
    return true;
 }
 
-static bool vk_assets_read(vk_context* context, s8 asset_file)
+static bool vk_assets_read(vk_context* context, s8 asset_file, gltf_load_options options)
 {
    bool success = false;
-   if (s8_is_substr(asset_file, s8(".gltf")))
-      success = vk_gltf_read(context, asset_file);
+   if (s8_is_substr(asset_file, s8(".gltf")) || s8_is_substr(asset_file, s8(".glb")))
+      success = vk_gltf_read(context, asset_file, options);
    else if (s8_is_substr(asset_file, s8(".obj")))
       ;
       //vk_obj_read(context, asset_file);
@@ -471,6 +491,37 @@ static hw_result vk_physical_device_select(arena s, vk_device* device, vk_featur
    return (hw_result){.h = devs[fallback_gpu]};
 }
 
+// the meshlet limits are compiled in, only the workgroup size follows the device preference
+static bool vk_mesh_limits_select(vk_device* devices, vk_features* features)
+{
+   features->mesh_workgroup_size = MESHLET_MAX_VERTICES;
+
+   if(!features->mesh_shading_supported)
+      return true;
+
+   VkPhysicalDeviceMeshShaderPropertiesEXT mesh_props = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT};
+   VkPhysicalDeviceProperties2 props = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2};
+   props.pNext = &mesh_props;
+
+   vkGetPhysicalDeviceProperties2(devices->physical, &props);
+
+   if(MESHLET_MAX_VERTICES > mesh_props.maxMeshOutputVertices || MESHLET_MAX_TRIANGLES > mesh_props.maxMeshOutputPrimitives)
+   {
+      printf("Meshlet limits %u/%u exceed the device limits %u/%u\n", MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES,
+             mesh_props.maxMeshOutputVertices, mesh_props.maxMeshOutputPrimitives);
+      return false;
+   }
+
+   u32 workgroup_size = min(mesh_props.maxPreferredMeshWorkGroupInvocations, mesh_props.maxMeshWorkGroupInvocations);
+   workgroup_size = min(workgroup_size, (u32)MESHLET_MAX_VERTICES);
+
+   features->mesh_workgroup_size = max(workgroup_size, 1u);
+
+   printf("Mesh shader workgroup size: %u, meshlet limits: %u/%u\n", features->mesh_workgroup_size, MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+
+   return true;
+}
+
 static hw_result vk_logical_device_select_family_index(arena scratch, vk_device* devices, VkSurfaceKHR surface)
 {
    u32 queue_family_count = 0;
@@ -492,6 +543,24 @@ static hw_result vk_logical_device_select_family_index(arena scratch, vk_device*
    return (hw_result){.i = invalid_index};
 }
 
+// a family with transfers only, the copy engine that runs next to the graphics queue
+static hw_result vk_logical_device_select_transfer_family_index(arena scratch, vk_device* devices)
+{
+   u32 queue_family_count = 0;
+   vkGetPhysicalDeviceQueueFamilyProperties(devices->physical, &queue_family_count, 0);
+
+   VkQueueFamilyProperties* queue_families = push(&scratch, VkQueueFamilyProperties, queue_family_count);
+   vkGetPhysicalDeviceQueueFamilyProperties(devices->physical, &queue_family_count, queue_families);
+
+   const VkQueueFlags other_work = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+
+   for(u32 i = 0; i < queue_family_count; i++)
+      if((queue_families[i].queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queue_families[i].queueFlags & other_work) && queue_families[i].queueCount > 0)
+         return (hw_result){.i = i};
+
+   return (hw_result){.i = invalid_index};
+}
+
 static hw_result vk_logical_device_create(arena scratch, vk_device* devices, vk_features* features)
 {
    array(s8) extensions = {&scratch};
@@ -565,6 +634,8 @@ static hw_result vk_logical_device_create(arena scratch, vk_device* devices, vk_
 
    vkGetPhysicalDeviceFeatures2(devices->physical, &features2);
 
+   features->block_compression_supported = features2.features.textureCompressionBC;
+
    features2.features.depthBounds = true;
    features2.features.wideLines = true;
    features2.features.fillModeNonSolid = true;
@@ -579,17 +650,26 @@ static hw_result vk_logical_device_create(arena scratch, vk_device* devices, vk_
       printf("Using Vulkan device extension[%u]: %s\n", i, extension_names[i]);
    }
 
-   enum { queue_count = 1 };
-   f32 priorities[queue_count] = {1.0f};
-   VkDeviceQueueCreateInfo queue_info[queue_count] = {vk_info(DEVICE_QUEUE)};
+   // one graphics queue and one transfer queue when the device has a transfer family
+   f32 priorities[1] = {1.0f};
+   VkDeviceQueueCreateInfo queue_info[2] = {{vk_info(DEVICE_QUEUE)}, {vk_info(DEVICE_QUEUE)}};
+   u32 queue_info_count = 1;
 
    queue_info[0].queueFamilyIndex = (u32)devices->queue_family_index;
-   queue_info[0].queueCount = queue_count;
+   queue_info[0].queueCount = 1;
    queue_info[0].pQueuePriorities = priorities;
 
+   if(devices->transfer_family_index != invalid_index)
+   {
+      queue_info[1].queueFamilyIndex = (u32)devices->transfer_family_index;
+      queue_info[1].queueCount = 1;
+      queue_info[1].pQueuePriorities = priorities;
+      queue_info_count++;
+   }
+
    VkDeviceCreateInfo ldev_info = {vk_info(DEVICE)};
 
-   ldev_info.queueCreateInfoCount = 1;
+   ldev_info.queueCreateInfoCount = queue_info_count;
    ldev_info.pQueueCreateInfos = queue_info;
    ldev_info.enabledExtensionCount = (u32)extensions.count;
    ldev_info.ppEnabledExtensionNames = extension_names;
@@ -612,6 +692,16 @@ static VkQueue vk_graphics_queue_get(vk_device* devices)
    return graphics_queue;
 }
 
+static VkQueue vk_transfer_queue_get(vk_device* devices)
+{
+   VkQueue transfer_queue = 0;
+   u32 queue_index = 0;
+
+   vkGetDeviceQueue(devices->logical, (u32)devices->transfer_family_index, queue_index, &transfer_queue);
+
+   return transfer_queue;
+}
+
 static hw_result vk_semaphore_create(vk_device* devices)
 {
    VkSemaphore sema = 0;
@@ -628,13 +718,13 @@ static vk_swapchain_surface vk_swapchain_surface_create(arena scratch, const vk_
    return vk_window_swapchain_surface_create(scratch, devices, surface, width, height);
 }
 
-static hw_result vk_command_buffer_create(vk_cmd* cmd, vk_device* devices)
+static hw_result vk_command_buffer_create(vk_cmd* cmd, vk_device* devices, VkCommandBufferLevel level)
 {
    VkCommandBufferAllocateInfo buffer_allocate_info = {vk_info_allocate(COMMAND_BUFFER)};
 
    buffer_allocate_info.commandBufferCount = 1;
    buffer_allocate_info.commandPool = cmd->pool;
-   buffer_allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+   buffer_allocate_info.level = level;
 
    VkCommandBuffer buffer = 0;
    if(!vk_valid(vkAllocateCommandBuffers(devices->logical, &buffer_allocate_info, &buffer)))
@@ -655,6 +745,104 @@ static hw_result vk_command_pool_create(vk_device* devices)
    return (hw_result){pool};
 }
 
+static hw_result vk_fence_create(vk_device* devices)
+{
+   VkFence fence = 0;
+
+   VkFenceCreateInfo fence_info = {vk_info(FENCE)};
+   if(!vk_valid(vkCreateFence(devices->logical, &fence_info, &global_allocator.handle, &fence)))
+      return (hw_result){0};
+
+   return (hw_result){fence};
+}
+
+// command pool, fence and semaphores of every frame in flight, each with two timestamps of the query pool.
+// the secondaries of the recording threads get a pool each since a pool is used by one thread at a time
+static bool vk_frames_create(vk_context* context, u32 frame_count)
+{
+   vk_device* devices = &context->devices;
+
+   context->frame_count = frame_count;
+   context->frame_index = 0;
+
+   for(u32 i = 0; i < frame_count; ++i)
+   {
+      vk_frame* frame = context->frames + i;
+
+      if(!(frame->cmd.pool = vk_command_pool_create(devices).h))
+         return false;
+      if(!(frame->cmd.buffer = vk_command_buffer_create(&frame->cmd, devices, VK_COMMAND_BUFFER_LEVEL_PRIMARY).h))
+         return false;
+
+      for(u32 j = 0; j < context->record_threads; ++j)
+      {
+         vk_cmd* secondary = frame->secondaries + j;
+
+         if(!(secondary->pool = vk_command_pool_create(devices).h))
+            return false;
+         if(!(secondary->buffer = vk_command_buffer_create(secondary, devices, VK_COMMAND_BUFFER_LEVEL_SECONDARY).h))
+            return false;
+      }
+
+      if(!(frame->fence = vk_fence_create(devices).h))
+         return false;
+      if(!(frame->image_ready = vk_semaphore_create(devices).h))
+         return false;
+      if(!(frame->image_done = vk_semaphore_create(devices).h))
+         return false;
+
+      frame->query_base = 2 * i;
+   }
+
+   return true;
+}
+
+static void vk_frames_destroy(vk_context* context)
+{
+   for(u32 i = 0; i < context->frame_count; ++i)
+   {
+      vk_frame* frame = context->frames + i;
+
+      vkDestroyCommandPool(context->devices.logical, frame->cmd.pool, &global_allocator.handle);
+      for(u32 j = 0; j < context->record_threads; ++j)
+         vkDestroyCommandPool(context->devices.logical, frame->secondaries[j].pool, &global_allocator.handle);
+
+      vkDestroyFence(context->devices.logical, frame->fence, &global_allocator.handle);
+      vkDestroySemaphore(context->devices.logical, frame->image_ready, &global_allocator.handle);
+      vkDestroySemaphore(context->devices.logical, frame->image_done, &global_allocator.handle);
+   }
+}
+
+// waits for a submitted frame, its timestamps become the gpu time of the last frame
+static void vk_frame_retire(vk_context* context, vk_frame* frame)
+{
+   if(!frame->submitted)
+      return;
+
+   const i64 begin = context->timer->time();
+   vk_assert(vkWaitForFences(context->devices.logical, 1, &frame->fence, VK_TRUE, UINT64_MAX));
+   context->frame_wait_seconds += context->timer->seconds_elapsed(begin, context->timer->time());
+
+   vk_assert(vkResetFences(context->devices.logical, 1, &frame->fence));
+   frame->submitted = false;
+
+   // the frames that sampled the textures the stream replaced are done
+   for(u32 i = 0; i < frame->retired_count; ++i)
+      vk_texture_destroy(&context->devices, frame->retired + i);
+   frame->retired_count = 0;
+
+   u64 query_results[2] = {0};
+   if(!vk_valid(vkGetQueryPoolResults(context->devices.logical, context->query_pool, frame->query_base, array_count(query_results),
+                                      sizeof(query_results), query_results, sizeof(query_results[0]), VK_QUERY_RESULT_64_BIT)))
+      return;
+
+   const f64 gpu_begin = (f64)(query_results[0]) * context->features.time_period;
+   const f64 gpu_end = (f64)(query_results[1]) * context->features.time_period;
+
+   // timestamp period is in nanoseconds
+   context->gpu_seconds = max(gpu_end - gpu_begin, 0.f) * 1e-9;
+}
+
 
 static hw_result vk_renderpass_create(vk_device* devices, vk_swapchain_surface* swapchain)
 {
@@ -759,7 +947,7 @@ static void vk_swapchain_destroy(vk_device* devices, vk_swapchain_images* images
    {
       vkDestroyImageView(devices->logical, images->depths.data[i].view, &global_allocator.handle);
       vkDestroyImage(devices->logical, images->depths.data[i].handle, &global_allocator.handle);
-      vkFreeMemory(devices->logical, images->depths.data[i].memory, &global_allocator.handle);
+      vk_memory_free(devices, &images->depths.data[i].allocation);
    }
 
    for (u32 i = 0; i < images->images.count; ++i)
@@ -783,8 +971,8 @@ static void vk_swapchain_update(arena scratch, vk_device* devices, vk_swapchain_
 
       vk_depth_image_create(&images->depths.data[i], devices, VK_FORMAT_D32_SFLOAT, depth_extent); // TODO: Return false here if fail
 
-      images->images.data[i].view = vk_image_view_create(devices, swapchain->format, images->images.data[i].handle, VK_IMAGE_ASPECT_COLOR_BIT);
-      images->depths.data[i].view = vk_image_view_create(devices, VK_FORMAT_D32_SFLOAT, images->depths.data[i].handle, VK_IMAGE_ASPECT_DEPTH_BIT);
+      images->images.data[i].view = vk_image_view_create(devices, swapchain->format, images->images.data[i].handle, VK_IMAGE_ASPECT_COLOR_BIT, 1, (VkComponentMapping){0});
+      images->depths.data[i].view = vk_image_view_create(devices, VK_FORMAT_D32_SFLOAT, images->depths.data[i].handle, VK_IMAGE_ASPECT_DEPTH_BIT, 1, (VkComponentMapping){0});
 
       VkImageView attachments[2] = {images->images.data[i].view, images->depths.data[i].view};
 
@@ -793,38 +981,80 @@ static void vk_swapchain_update(arena scratch, vk_device* devices, vk_swapchain_
    }
 }
 
-static void gpu_log(hw* hw)
+// gpu time in seconds of the last frame the cpu waited for, frames in flight behind the one presented
+static f64 gpu_time(hw* hw)
 {
    u32 renderer_index = hw->renderer.renderer_index;
    assert(renderer_index < RENDERER_COUNT);
 
    vk_context* context = hw->renderer.backends[renderer_index];
 
-   u64 query_results[2] = {0};
-   vkGetQueryPoolResults(context->devices.logical,
-                         context->query_pool,
-                         0,
-                         array_count(query_results),
-                         sizeof(query_results),
-                         query_results,
-                         sizeof(query_results[0]),
-                         VK_QUERY_RESULT_64_BIT);
+   return context->gpu_seconds;
+}
 
-   const f64 gpu_begin = (f64)(query_results[0]) * context->features.time_period;
-   const f64 gpu_end = (f64)(query_results[1]) * context->features.time_period;
+static void gpu_log(hw* hw)
+{
+   u32 renderer_index = hw->renderer.renderer_index;
+   assert(renderer_index < RENDERER_COUNT);
+
+   vk_context* context = hw->renderer.backends[renderer_index];
 
    const f64 ms = 1e3;
-   const f64 us = 1e6;
-   const f64 gpu_delta = max(gpu_end - gpu_begin, 0.f);
+   const f64 gpu_delta = gpu_time(hw);
 
    if(hw->state.is_mesh_shading)
       hw->window_title_set(hw,
                        s8("cpu: %.2f ms; gpu: %.2f ms; #Meshlets: %u; Hold 'a' to show world axis; Press 'f' to toggle fullscreen; Press 'r' to reset camera; Press 'm' to toggle RTX; RTX ON"),
-                       hw->state.frame_delta_in_seconds * ms, gpu_delta / us, context->meshlets.count);
+                       hw->state.frame_delta_in_seconds * ms, gpu_delta * ms, context->meshlets.count);
    else
       hw->window_title_set(hw,
                        s8("cpu: %.2f ms; gpu: %.2f ms; #Meshlets: 0; Hold 'a' to show world axis; Press 'f' to toggle fullscreen; Press 'r' to reset camera; Press 'm' to toggle RTX; RTX OFF"),
-                       hw->state.frame_delta_in_seconds * ms, gpu_delta / us);
+                       hw->state.frame_delta_in_seconds * ms, gpu_delta * ms);
+}
+
+// draws a frame records, an indirect command per batch or a draw per instance
+static u32 vk_draw_count(const vk_context* context, bool mesh_shading)
+{
+   const array_draw_batch* batches = &context->geometry.draw_batches;
+   if(batches->count == 0)
+      return 0;
+
+   if(!context->instance_draws || mesh_shading)
+      return (u32)batches->count;
+
+   const draw_batch* last = batches->data + batches->count - 1;
+   return last->instance_offset + last->instance_count;
+}
+
+// one json line per benchmark run, see meshlet_sweep.bat
+static void bench_log(hw* hw, u32 frame_count, f64 cpu_seconds, f64 gpu_seconds)
+{
+   u32 renderer_index = hw->renderer.renderer_index;
+   assert(renderer_index < RENDERER_COUNT);
+
+   vk_context* context = hw->renderer.backends[renderer_index];
+
+   const f64 ms = 1e3;
+   const f64 frames = (f64)max(frame_count, 1u);
+
+   printf("{\"bench\":\"frame\",\"file\":\"%s\",\"max_vertices\":%u,\"max_triangles\":%u,\"workgroup_size\":%u",
+          s8_data(hw->state.asset_file), MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES, context->features.mesh_workgroup_size);
+   printf(",\"meshlets\":%zu,\"meshlet_bytes\":%zu,\"mesh_shading\":%s,\"frames\":%u",
+          context->meshlets.count, context->meshlets.count * sizeof(meshlet), hw->state.is_mesh_shading ? "true" : "false", frame_count);
+
+   const texture_stream* stream = context->texture_stream;
+   if(stream)
+      printf(",\"texture_resident_mb\":%.1f,\"texture_full_mb\":%.1f,\"texture_loads\":%u,\"texture_evictions\":%u,\"texture_uploaded_mb\":%.1f",
+             stream->resident_bytes / (f64)MB(1), stream->full_bytes / (f64)MB(1), stream->load_count, stream->eviction_count,
+             stream->uploaded_bytes / (f64)MB(1));
+
+   // the fence wait is the part of the cpu frame the gpu did not overlap
+   printf(",\"frames_in_flight\":%u,\"fence_wait_ms\":%.3f,\"transfer_queue\":%s", context->frame_count,
+          context->frame_wait_seconds * ms / (f64)max(context->frame_number, 1ull), context->upload.transfer ? "true" : "false");
+   printf(",\"pipeline_ms\":%.3f,\"pipeline_cache\":\"%s\"", context->pipeline_seconds * ms, context->pipeline_cache_warm ? "warm" : "cold");
+   printf(",\"draws\":%u,\"record_threads\":%u,\"record_ms\":%.3f", vk_draw_count(context, hw->state.is_mesh_shading), context->record_threads,
+          context->record_seconds * ms / (f64)max(context->frame_number, 1ull));
+   printf(",\"cpu_ms\":%.3f,\"gpu_ms\":%.3f}\n", cpu_seconds * ms / frames, gpu_seconds * ms / frames);
 }
 
 static void vk_resize_swapchain(hw_renderer* renderer, u32 width, u32 height)
@@ -978,133 +1208,93 @@ static void cmd_bind_descriptor_set(VkCommandBuffer command_buffer, VkPipelineLa
    );
 }
 
+// the next frame records while this one renders, it waits only for the frame that used its slot before
 static void vk_present(hw_renderer* renderer, vk_context* context)
 {
+   vk_frame* frame = context->frames + context->frame_index;
+   if(!frame->submitted)
+      return; // the frame was dropped
+
    VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
    present_info.swapchainCount = 1;
    present_info.pSwapchains = &context->swapchain.handle;
    present_info.pImageIndices = &context->image_index;
    present_info.waitSemaphoreCount = 1;
-   present_info.pWaitSemaphores = &context->image_done_semaphore;
+   present_info.pWaitSemaphores = &frame->image_done;
 
    VkResult present_result = vkQueuePresentKHR(context->graphics_queue, &present_info);
 
+   context->frame_index = (context->frame_index + 1) % context->frame_count;
+
    if(present_result == VK_SUBOPTIMAL_KHR || present_result == VK_ERROR_OUT_OF_DATE_KHR)
       vk_resize_swapchain(renderer, context->swapchain.image_width, context->swapchain.image_height);
+}
 
-   // wait until all queue ops are done
-   // essentialy run gpu and cpu in sync (driver decides this)
-   // TODO: This is bad way to do sync but who cares for now
-   // TODO: Use fences really
-   vk_assert(vkDeviceWaitIdle(context->devices.logical));
+static void cmd_push_draw_offset(VkCommandBuffer command_buffer, VkPipelineLayout layout, u32 draw_offset)
+{
+   vkCmdPushConstants(command_buffer, layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                      offsetof(mvp_transform, draw_offset), sizeof(draw_offset), &draw_offset);
 }
 
-static void vk_render(hw_renderer* renderer, vk_context* context, app_state* state)
+// a draw per instance in place of the indirect command of its batch, what a renderer without multi draw
+// indirect records. begin and end count instances, which the batches hold in order
+static void vk_instance_draws_record(VkCommandBuffer command_buffer, vk_context* context, VkPipelineLayout layout, u32 instance_begin, u32 instance_end)
 {
-   u32 image_index = 0;
-   VkResult next_image_result = vkAcquireNextImageKHR(context->devices.logical, context->swapchain.handle, UINT64_MAX, context->image_ready_semaphore, VK_NULL_HANDLE, &image_index);
+   const array_draw_batch* batches = &context->geometry.draw_batches;
 
-   context->image_index = image_index;
+   u32 i = 0;
+   while(i < batches->count && batches->data[i].instance_offset + batches->data[i].instance_count <= instance_begin)
+      i++;
 
-   if(next_image_result == VK_ERROR_OUT_OF_DATE_KHR)
+   for(; i < batches->count && batches->data[i].instance_offset < instance_end; ++i)
    {
-      // TODO: recycle semaphores with free-list
-      vkDestroySemaphore(context->devices.logical, context->image_ready_semaphore, &global_allocator.handle);
-      context->image_ready_semaphore = vk_semaphore_create(&context->devices).h;
-
-      vk_resize_swapchain(renderer, renderer->window.width, renderer->window.height);
-
-      return; // drop this frame
-   }
-
-   if(next_image_result == VK_SUBOPTIMAL_KHR)
-      vk_resize_swapchain(renderer, renderer->window.width, renderer->window.height);
-
-   vk_assert(vkResetCommandPool(context->devices.logical, context->cmd.pool, 0));
-
-   VkCommandBufferBeginInfo buffer_begin_info = {vk_info_begin(COMMAND_BUFFER)};
-   buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-   VkRenderPassBeginInfo renderpass_info = {vk_info_begin(RENDER_PASS)};
-   renderpass_info.renderPass = context->renderpass;
-   renderpass_info.framebuffer = context->framebuffers.data[image_index];
-   renderpass_info.renderArea.extent = (VkExtent2D)
-   {context->swapchain.image_width, context->swapchain.image_height};
-
-   VkCommandBuffer command_buffer = context->cmd.buffer;
-
-   vk_assert(vkBeginCommandBuffer(command_buffer, &buffer_begin_info));
-
-   vkCmdResetQueryPool(context->cmd.buffer, context->query_pool, 0, context->query_pool_size);
-   vkCmdWriteTimestamp(context->cmd.buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, context->query_pool, 0);
-
-   mvp_transform mvp = {0};
-   const f32 ar = (f32)context->swapchain.image_width / context->swapchain.image_height;
-
-   // world space origin
-   vec3 eye = state->camera.eye;
-   vec3 dir = state->camera.dir;
-   vec3_normalize(dir);
-
-   mvp.n = 0.01f;
-   mvp.f = 10000.0f;
-   mvp.ar = ar;
-   mvp.projection = mat4_perspective(ar, 75.0f, mvp.n, mvp.f);
-   mvp.view = mat4_view(eye, dir);
-
-   assert(mvp.n > 0.0f);
-   assert(mvp.ar != 0.0f);
-
-   VkClearValue clear[2] = {0};
-   clear[0].color = (VkClearColorValue){0.19f, 0.19f, 0.19f};
-   clear[1].depthStencil = (VkClearDepthStencilValue){1.0f, 0};
-
-   renderpass_info.clearValueCount = 2;
-   renderpass_info.pClearValues = clear;
-
-   VkImage color_image = context->images.images.data[image_index].handle;
-   VkImageMemoryBarrier color_image_begin_barrier = vk_pipeline_barrier(color_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
-   vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      VK_DEPENDENCY_BY_REGION_BIT, 0, 0, 0, 0, 1, &color_image_begin_barrier);
-
-   VkImage depth_image = context->images.depths.data[image_index].handle;
-   VkImageMemoryBarrier depth_image_begin_barrier = vk_pipeline_barrier(depth_image, VK_IMAGE_ASPECT_DEPTH_BIT, 0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-   vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-      VK_DEPENDENCY_BY_REGION_BIT, 0, 0, 0, 0, 1, &depth_image_begin_barrier);
+      const draw_batch* batch = batches->data + i;
+      const vk_mesh_draw* md = context->geometry.mesh_draws.data + batch->mesh_index;
 
+      // gl_DrawID is zero for a direct draw
+      cmd_push_draw_offset(command_buffer, layout, i);
 
-   vkCmdBeginRenderPass(command_buffer, &renderpass_info, VK_SUBPASS_CONTENTS_INLINE);
+      const u32 first = max(batch->instance_offset, instance_begin);
+      const u32 last = min(batch->instance_offset + batch->instance_count, instance_end);
 
-   VkViewport viewport = {0};
-
-   // y-is-up
-   viewport.x = 0.0f;
-   viewport.y = (f32)context->swapchain.image_height;
-   viewport.width = (f32)context->swapchain.image_width;
-   viewport.height = -(f32)context->swapchain.image_height;
-
-   viewport.minDepth = 0.0f;
-   viewport.maxDepth = 1.0f;
+      for(u32 j = first; j < last; ++j)
+         vkCmdDrawIndexed(command_buffer, (u32)md->index_count, 1, (u32)md->index_offset, (i32)md->vertex_offset, j);
+   }
+}
 
-   VkRect2D scissor = {0};
-   scissor.offset.x = 0;
-   scissor.offset.y = 0;
-   scissor.extent.width = (u32)context->swapchain.image_width;
-   scissor.extent.height = (u32)context->swapchain.image_height;
+// state every recording of the scene starts from, the same for all threads of a frame
+align_struct vk_record_pass
+{
+   vk_context* context;
+   vk_frame* frame;
+   VkCommandBufferInheritanceInfo inheritance;   // render pass and framebuffer the secondaries continue
+   mvp_transform mvp;
+   VkViewport viewport;
+   VkRect2D scissor;
+   u32 job_count;
+   bool mesh_shading;
+   bool draw_axis;
+} vk_record_pass;
+
+// the draws from begin to end of vk_draw_count with everything they bind - a secondary inherits none of
+// the state, so each recording sets all of it. the first range also draws the ground plane and the axis
+static void vk_scene_record(VkCommandBuffer command_buffer, const vk_record_pass* pass, arena s, u32 draw_begin, u32 draw_end, bool first)
+{
+   vk_context* context = pass->context;
+   mvp_transform mvp = pass->mvp;
 
-   vkCmdSetViewport(command_buffer, 0, 1, &viewport);
-   vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+   vkCmdSetViewport(command_buffer, 0, 1, &pass->viewport);
+   vkCmdSetScissor(command_buffer, 0, 1, &pass->scissor);
    vkCmdSetPrimitiveTopology(command_buffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
 
-   if(state->is_mesh_shading)
+   if(pass->mesh_shading)
    {
       VkPipeline pipeline = context->rtx_pipeline;
       VkPipelineLayout pipeline_layout = context->rtx_pipeline_layout;
 
-      cmd_bind_descriptor_set(command_buffer, pipeline_layout, &context->texture_descriptor.set, 1, 1);
+      cmd_bind_descriptor_set(command_buffer, pipeline_layout, &context->frames[context->frame_index].texture_set, 1, 1);
       cmd_bind_pipeline(command_buffer, pipeline);
 
-      arena s = context->scratch;
       array(vk_buffer_binding) bindings = {&s};
 
       if(buffer_hash_lookup(&context->buffer_table, vb_buffer_name))
@@ -1131,13 +1321,27 @@ static void vk_render(hw_renderer* renderer, vk_context* context, app_state* sta
          array_push(bindings) = (vk_buffer_binding){buffer, 3, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, &context->rt_as.tlas};
       }
 
+      if(buffer_hash_lookup(&context->buffer_table, mesh_instance_buffer_name))
+      {
+         vk_buffer buffer = *buffer_hash_lookup(&context->buffer_table, mesh_instance_buffer_name);
+         array_push(bindings) = (vk_buffer_binding){buffer, 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+      }
+
+      if(buffer_hash_lookup(&context->buffer_table, material_buffer_name))
+      {
+         vk_buffer buffer = *buffer_hash_lookup(&context->buffer_table, material_buffer_name);
+         array_push(bindings) = (vk_buffer_binding){buffer, 5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+      }
+
+      mvp.draw_offset = draw_begin;
+
       cmd_push_storage_buffer(command_buffer, s, pipeline_layout, bindings.data, (u32)bindings.count, 0);
       cmd_push_all_rtx_constants(command_buffer, pipeline_layout, &mvp);
 
-      if(buffer_hash_lookup(&context->buffer_table, indirect_rtx_buffer_name))
+      if(buffer_hash_lookup(&context->buffer_table, indirect_rtx_buffer_name) && draw_end > draw_begin)
          vkCmdDrawMeshTasksIndirectEXT(command_buffer,
                                        buffer_hash_lookup(&context->buffer_table, indirect_rtx_buffer_name)->handle,
-                                       0, (u32)context->geometry.mesh_draws.count,
+                                       draw_begin * sizeof(VkDrawMeshTasksIndirectCommandEXT), draw_end - draw_begin,
                                        sizeof(VkDrawMeshTasksIndirectCommandEXT));
    }
    else
@@ -1145,12 +1349,11 @@ static void vk_render(hw_renderer* renderer, vk_context* context, app_state* sta
       VkPipeline pipeline = context->non_rtx_pipeline;
       VkPipelineLayout pipeline_layout = context->non_rtx_pipeline_layout;
 
-      cmd_bind_descriptor_set(command_buffer, pipeline_layout, &context->texture_descriptor.set, 1, 1);
+      cmd_bind_descriptor_set(command_buffer, pipeline_layout, &context->frames[context->frame_index].texture_set, 1, 1);
       cmd_bind_pipeline(command_buffer, pipeline);
       if(buffer_hash_lookup(&context->buffer_table, ib_buffer_name))
          cmd_bind_index_buffer(command_buffer, buffer_hash_lookup(&context->buffer_table, ib_buffer_name)->handle, 0);
 
-      arena s = context->scratch;
       array(vk_buffer_binding) bindings = {&s};
 
       if(buffer_hash_lookup(&context->buffer_table, vb_buffer_name))
@@ -1165,15 +1368,35 @@ static void vk_render(hw_renderer* renderer, vk_context* context, app_state* sta
          array_push(bindings) = (vk_buffer_binding){buffer, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
       }
 
+      if(buffer_hash_lookup(&context->buffer_table, mesh_instance_buffer_name))
+      {
+         vk_buffer buffer = *buffer_hash_lookup(&context->buffer_table, mesh_instance_buffer_name);
+         array_push(bindings) = (vk_buffer_binding){buffer, 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+      }
+
+      if(buffer_hash_lookup(&context->buffer_table, material_buffer_name))
+      {
+         vk_buffer buffer = *buffer_hash_lookup(&context->buffer_table, material_buffer_name);
+         array_push(bindings) = (vk_buffer_binding){buffer, 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+      }
+
+      // the instance draws push the offset of every batch they draw
+      mvp.draw_offset = context->instance_draws ? 0 : draw_begin;
+
       cmd_push_storage_buffer(command_buffer, s, pipeline_layout, bindings.data, (u32)bindings.count, 0);
       cmd_push_all_constants(command_buffer, pipeline_layout, &mvp);
 
-      if(buffer_hash_lookup(&context->buffer_table, indirect_buffer_name))
+      if(context->instance_draws)
+         vk_instance_draws_record(command_buffer, context, pipeline_layout, draw_begin, draw_end);
+      else if(buffer_hash_lookup(&context->buffer_table, indirect_buffer_name) && draw_end > draw_begin)
          vkCmdDrawIndexedIndirect(command_buffer,
                                   buffer_hash_lookup(&context->buffer_table, indirect_buffer_name)->handle,
-                                  0, (u32)context->geometry.mesh_draws.count,
+                                  draw_begin * sizeof(VkDrawIndexedIndirectCommand), draw_end - draw_begin,
                                   sizeof(VkDrawIndexedIndirectCommand));
 
+      if(!first)
+         return;
+
       vkCmdSetPrimitiveTopology(command_buffer, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP);
 
       mvp.draw_ground_plane = 1;
@@ -1190,12 +1413,173 @@ static void vk_render(hw_renderer* renderer, vk_context* context, app_state* sta
    //vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->frustum_pipeline);
    //vkCmdDraw(command_buffer, 12, 1, 0, 0);
 
-   if(state->draw_axis)
+   if(first && pass->draw_axis)
    {
       // draw axis
       vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context->axis_pipeline);
       vkCmdDraw(command_buffer, 18, 1, 0, 0);
    }
+}
+
+// one range of the draws into the secondary of the job, its pool is reset on the thread that records it
+static void vk_record_job_run(void* data, u32 job_index, arena* storage)
+{
+   const vk_record_pass* pass = data;
+   vk_cmd* secondary = pass->frame->secondaries + job_index;
+
+   vk_assert(vkResetCommandPool(pass->context->devices.logical, secondary->pool, 0));
+
+   VkCommandBufferBeginInfo begin_info = {vk_info_begin(COMMAND_BUFFER)};
+   begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+   begin_info.pInheritanceInfo = &pass->inheritance;
+
+   vk_assert(vkBeginCommandBuffer(secondary->buffer, &begin_info));
+
+   const u64 draw_count = vk_draw_count(pass->context, pass->mesh_shading);
+   const u32 draw_begin = (u32)(draw_count * job_index / pass->job_count);
+   const u32 draw_end = (u32)(draw_count * (job_index + 1) / pass->job_count);
+
+   vk_scene_record(secondary->buffer, pass, *storage, draw_begin, draw_end, job_index == 0);
+
+   vk_assert(vkEndCommandBuffer(secondary->buffer));
+}
+
+static void vk_render(hw_renderer* renderer, vk_context* context, app_state* state)
+{
+   vk_frame* frame = context->frames + context->frame_index;
+
+   // the pool, semaphores and timestamps of this slot are free once its last frame is done
+   vk_frame_retire(context, frame);
+
+   u32 image_index = 0;
+   VkResult next_image_result = vkAcquireNextImageKHR(context->devices.logical, context->swapchain.handle, UINT64_MAX, frame->image_ready, VK_NULL_HANDLE, &image_index);
+
+   context->image_index = image_index;
+
+   if(next_image_result == VK_ERROR_OUT_OF_DATE_KHR)
+   {
+      // TODO: recycle semaphores with free-list
+      vkDestroySemaphore(context->devices.logical, frame->image_ready, &global_allocator.handle);
+      frame->image_ready = vk_semaphore_create(&context->devices).h;
+
+      vk_resize_swapchain(renderer, renderer->window.width, renderer->window.height);
+
+      return; // drop this frame
+   }
+
+   if(next_image_result == VK_SUBOPTIMAL_KHR)
+      vk_resize_swapchain(renderer, renderer->window.width, renderer->window.height);
+
+   const f32 fov_y = 75.0f;
+   const f32 near_plane = 0.01f;
+
+   // the texture uploads are submitted ahead of the frame, which is queued after they are acquired
+   vk_texture_stream_update(context, state->camera.eye, fov_y, near_plane);
+   vk_upload_flush(context);
+
+   const i64 record_begin = context->timer->time();
+
+   vk_assert(vkResetCommandPool(context->devices.logical, frame->cmd.pool, 0));
+
+   VkCommandBufferBeginInfo buffer_begin_info = {vk_info_begin(COMMAND_BUFFER)};
+   buffer_begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+   VkRenderPassBeginInfo renderpass_info = {vk_info_begin(RENDER_PASS)};
+   renderpass_info.renderPass = context->renderpass;
+   renderpass_info.framebuffer = context->framebuffers.data[image_index];
+   renderpass_info.renderArea.extent = (VkExtent2D)
+   {context->swapchain.image_width, context->swapchain.image_height};
+
+   VkCommandBuffer command_buffer = frame->cmd.buffer;
+
+   vk_assert(vkBeginCommandBuffer(command_buffer, &buffer_begin_info));
+
+   vkCmdResetQueryPool(command_buffer, context->query_pool, frame->query_base, 2);
+   vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, context->query_pool, frame->query_base);
+
+   mvp_transform mvp = {0};
+   const f32 ar = (f32)context->swapchain.image_width / context->swapchain.image_height;
+
+   // world space origin
+   vec3 eye = state->camera.eye;
+   vec3 dir = state->camera.dir;
+   vec3_normalize(dir);
+
+   mvp.n = near_plane;
+   mvp.f = 10000.0f;
+   mvp.ar = ar;
+   mvp.projection = mat4_perspective(ar, fov_y, mvp.n, mvp.f);
+   mvp.view = mat4_view(eye, dir);
+
+   assert(mvp.n > 0.0f);
+   assert(mvp.ar != 0.0f);
+
+   VkClearValue clear[2] = {0};
+   clear[0].color = (VkClearColorValue){0.19f, 0.19f, 0.19f};
+   clear[1].depthStencil = (VkClearDepthStencilValue){1.0f, 0};
+
+   renderpass_info.clearValueCount = 2;
+   renderpass_info.pClearValues = clear;
+
+   VkImage color_image = context->images.images.data[image_index].handle;
+   VkImageMemoryBarrier color_image_begin_barrier = vk_pipeline_barrier(color_image, VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+   vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+      VK_DEPENDENCY_BY_REGION_BIT, 0, 0, 0, 0, 1, &color_image_begin_barrier);
+
+   VkImage depth_image = context->images.depths.data[image_index].handle;
+   VkImageMemoryBarrier depth_image_begin_barrier = vk_pipeline_barrier(depth_image, VK_IMAGE_ASPECT_DEPTH_BIT, 0, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+   vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
+      VK_DEPENDENCY_BY_REGION_BIT, 0, 0, 0, 0, 1, &depth_image_begin_barrier);
+
+   VkViewport viewport = {0};
+
+   // y-is-up
+   viewport.x = 0.0f;
+   viewport.y = (f32)context->swapchain.image_height;
+   viewport.width = (f32)context->swapchain.image_width;
+   viewport.height = -(f32)context->swapchain.image_height;
+
+   viewport.minDepth = 0.0f;
+   viewport.maxDepth = 1.0f;
+
+   VkRect2D scissor = {0};
+   scissor.offset.x = 0;
+   scissor.offset.y = 0;
+   scissor.extent.width = (u32)context->swapchain.image_width;
+   scissor.extent.height = (u32)context->swapchain.image_height;
+
+   vk_record_pass pass = {0};
+   pass.context = context;
+   pass.frame = frame;
+   pass.mvp = mvp;
+   pass.viewport = viewport;
+   pass.scissor = scissor;
+   pass.job_count = context->record_threads;
+   pass.mesh_shading = state->is_mesh_shading;
+   pass.draw_axis = state->draw_axis;
+
+   pass.inheritance = (VkCommandBufferInheritanceInfo){VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+   pass.inheritance.renderPass = context->renderpass;
+   pass.inheritance.subpass = 0;
+   pass.inheritance.framebuffer = renderpass_info.framebuffer;
+
+   if(pass.job_count == 0)
+   {
+      vkCmdBeginRenderPass(command_buffer, &renderpass_info, VK_SUBPASS_CONTENTS_INLINE);
+      vk_scene_record(command_buffer, &pass, context->scratch, 0, vk_draw_count(context, pass.mesh_shading), true);
+   }
+   else
+   {
+      // the ranges record on the job threads, parallel_for returns once every secondary has ended
+      context->jobs->parallel_for(context->jobs, vk_record_job_run, &pass, pass.job_count);
+
+      VkCommandBuffer secondaries[VK_RECORD_THREAD_MAX];
+      for(u32 i = 0; i < pass.job_count; ++i)
+         secondaries[i] = frame->secondaries[i].buffer;
+
+      vkCmdBeginRenderPass(command_buffer, &renderpass_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+      vkCmdExecuteCommands(command_buffer, pass.job_count, secondaries);
+   }
 
    vkCmdEndRenderPass(command_buffer);
 
@@ -1203,14 +1587,16 @@ static void vk_render(hw_renderer* renderer, vk_context* context, app_state* sta
    vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
       VK_DEPENDENCY_BY_REGION_BIT, 0, 0, 0, 0, 1, &color_image_end_barrier);
 
-   vkCmdWriteTimestamp(context->cmd.buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, context->query_pool, 1);
+   vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, context->query_pool, frame->query_base + 1);
 
    // end command buffer
    vk_assert(vkEndCommandBuffer(command_buffer));
 
+   context->record_seconds += context->timer->seconds_elapsed(record_begin, context->timer->time());
+
    VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
    submit_info.waitSemaphoreCount = 1;
-   submit_info.pWaitSemaphores = &context->image_ready_semaphore;
+   submit_info.pWaitSemaphores = &frame->image_ready;
 
    submit_info.pWaitDstStageMask = &(VkPipelineStageFlags) { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
@@ -1218,9 +1604,11 @@ static void vk_render(hw_renderer* renderer, vk_context* context, app_state* sta
    submit_info.pCommandBuffers = &command_buffer;
 
    submit_info.signalSemaphoreCount = 1;
-   submit_info.pSignalSemaphores = &context->image_done_semaphore;
+   submit_info.pSignalSemaphores = &frame->image_done;
 
-   vk_assert(vkQueueSubmit(context->graphics_queue, 1, &submit_info, VK_NULL_HANDLE));
+   vk_assert(vkQueueSubmit(context->graphics_queue, 1, &submit_info, frame->fence));
+   frame->submitted = true;
+   context->frame_number++;
 }
 
 // TODO: pass amount of bindings to create here
@@ -1230,7 +1618,7 @@ static bool vk_pipeline_set_layout_create(VkDescriptorSetLayout* set_layout, VkD
    // TODO: cleanup this nonsense
    if(is_rtx)
    {
-      VkDescriptorSetLayoutBinding bindings[4] = {0};
+      VkDescriptorSetLayoutBinding bindings[6] = {0};
       bindings[0].binding = 0;
       bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
       bindings[0].descriptorCount = 1;
@@ -1251,6 +1639,16 @@ static bool vk_pipeline_set_layout_create(VkDescriptorSetLayout* set_layout, VkD
       bindings[3].descriptorCount = 1;
       bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
+      bindings[4].binding = 4;
+      bindings[4].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[4].descriptorCount = 1;
+      bindings[4].stageFlags = VK_SHADER_STAGE_MESH_BIT_EXT;
+
+      bindings[5].binding = 5;
+      bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[5].descriptorCount = 1;
+      bindings[5].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
       VkDescriptorSetLayoutCreateInfo info = {vk_info(DESCRIPTOR_SET_LAYOUT)};
 
       info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
@@ -1262,7 +1660,7 @@ static bool vk_pipeline_set_layout_create(VkDescriptorSetLayout* set_layout, VkD
    }
    else
    {
-      VkDescriptorSetLayoutBinding bindings[2] = {0};
+      VkDescriptorSetLayoutBinding bindings[4] = {0};
       bindings[0].binding = 0;
       bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
       bindings[0].descriptorCount = 1;
@@ -1273,6 +1671,16 @@ static bool vk_pipeline_set_layout_create(VkDescriptorSetLayout* set_layout, VkD
       bindings[1].descriptorCount = 1;
       bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
 
+      bindings[2].binding = 2;
+      bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[2].descriptorCount = 1;
+      bindings[2].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+      bindings[3].binding = 3;
+      bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      bindings[3].descriptorCount = 1;
+      bindings[3].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
       VkDescriptorSetLayoutCreateInfo info = {vk_info(DESCRIPTOR_SET_LAYOUT)};
 
       info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
@@ -1327,14 +1735,21 @@ static VkPipelineShaderStageCreateInfo vk_shader_stage_create_info(vk_shader_mod
    return result;
 }
 
-static bool vk_mesh_pipeline_create(VkPipeline* pipeline, vk_context* context, VkPipelineCache cache, const vk_shader_module* shader_modules, size shader_module_count)
+static bool vk_mesh_pipeline_create(VkPipeline* pipeline, vk_context* context, arena scratch, VkPipelineCache cache, const vk_shader_module* shader_modules, size shader_module_count)
 {
-   arena scratch = context->scratch;
-
    array(VkPipelineShaderStageCreateInfo) stages = {&scratch};
 
+   // constant_id 0 is the workgroup size of the mesh shader
+   const u32 workgroup_size = context->features.mesh_workgroup_size;
+   VkSpecializationMapEntry specialization_entry = {.constantID = 0, .offset = 0, .size = sizeof(workgroup_size)};
+   VkSpecializationInfo specialization_info = {1, &specialization_entry, sizeof(workgroup_size), &workgroup_size};
+
    for (size i = 0; i < shader_module_count; ++i)
+   {
       array_push(stages) = vk_shader_stage_create_info(shader_modules[i]);
+      if(shader_modules[i].stage == VK_SHADER_STAGE_MESH_BIT_EXT)
+         stages.data[i].pSpecializationInfo = &specialization_info;
+   }
 
    VkGraphicsPipelineCreateInfo pipeline_info = {vk_info(GRAPHICS_PIPELINE)};
    pipeline_info.stageCount = (u32)stages.count;
@@ -1410,10 +1825,8 @@ static bool vk_mesh_pipeline_create(VkPipeline* pipeline, vk_context* context, V
    return true;
 }
 
-static bool vk_graphics_pipeline_create(VkPipeline* pipeline, vk_context* context, VkPipelineCache cache, const vk_shader_module* shader_modules, size shader_module_count)
+static bool vk_graphics_pipeline_create(VkPipeline* pipeline, vk_context* context, arena scratch, VkPipelineCache cache, const vk_shader_module* shader_modules, size shader_module_count)
 {
-   arena scratch = context->scratch;
-
    array(VkPipelineShaderStageCreateInfo) stages = {&scratch};
 
    for (size i = 0; i < shader_module_count; ++i)
@@ -1493,10 +1906,8 @@ static bool vk_graphics_pipeline_create(VkPipeline* pipeline, vk_context* contex
    return true;
 }
 
-static bool vk_axis_pipeline_create(VkPipeline* pipeline, vk_context* context, VkPipelineCache cache, const vk_shader_module* shader_modules, size shader_module_count)
+static bool vk_axis_pipeline_create(VkPipeline* pipeline, vk_context* context, arena scratch, VkPipelineCache cache, const vk_shader_module* shader_modules, size shader_module_count)
 {
-   arena scratch = context->scratch;
-
    array(VkPipelineShaderStageCreateInfo) stages = {&scratch};
 
    for (size i = 0; i < shader_module_count; ++i)
@@ -1603,10 +2014,15 @@ static bool vk_buffers_create(vk_context* context)
    vk_buffer indirect_buffer = {0};
    vk_buffer indirect_rtx_buffer = {0};
    vk_buffer mesh_draw_buffer = {0};
+   vk_buffer mesh_instance_buffer = {0};
+   vk_buffer material_buffer = {0};
    vk_buffer rt_buffer = {0};
 
    arena s = context->scratch;
 
+   // the draws and the indirect commands are one per batch
+   buffer_draw_batches_build(context, s);
+
    // TODO: pass devices and geometry
    if(!buffer_indirect_create(&indirect_buffer, context, s, false))
       return false;
@@ -1623,14 +2039,55 @@ static bool vk_buffers_create(vk_context* context)
 
    buffer_hash_insert(&context->buffer_table, mesh_draw_buffer_name, mesh_draw_buffer);
 
+   if(!buffer_instances_create(&mesh_instance_buffer, context, s))
+      return false;
+
+   buffer_hash_insert(&context->buffer_table, mesh_instance_buffer_name, mesh_instance_buffer);
+
+   if(!buffer_materials_create(&material_buffer, context))
+      return false;
+
+   buffer_hash_insert(&context->buffer_table, material_buffer_name, material_buffer);
+
+   buffer_tables_report(context);
+
    if(!buffer_rt_create(&rt_buffer, context))
       return false;
 
    buffer_hash_insert(&context->buffer_table, rt_buffer_name, rt_buffer);
 
+   // the tables are on the gpu before the first frame
+   vk_upload_finish(context);
+   vk_upload_report(context);
+
    return true;
 }
 
+typedef bool (*vk_pipeline_create_function)(VkPipeline* pipeline, vk_context* context, arena scratch, VkPipelineCache cache,
+                                            const vk_shader_module* shader_modules, size shader_module_count);
+
+align_struct vk_pipeline_job
+{
+   vk_context* context;
+   vk_pipeline_create_function create;
+   VkPipeline* pipeline;
+   const char* name;
+   vk_shader_module shader_modules[2];
+   bool result;
+   f64 seconds;
+} vk_pipeline_job;
+
+// the shader stage arrays go to the storage of the thread, the cache is synchronized by the driver
+static void vk_pipeline_job_run(void* data, u32 job_index, arena* storage)
+{
+   vk_pipeline_job* job = (vk_pipeline_job*)data + job_index;
+   hw_timer* timer = job->context->timer;
+
+   const i64 begin = timer->time();
+   job->result = job->create(job->pipeline, job->context, *storage, job->context->pipeline_cache, job->shader_modules, array_count(job->shader_modules));
+   job->seconds = timer->seconds_elapsed(begin, timer->time());
+}
+
 static bool vk_pipelines_create(vk_features* features, vk_context* context)
 {
    VkDescriptorSetLayout non_rtx_set_layout = 0;
@@ -1672,67 +2129,44 @@ static bool vk_pipelines_create(vk_features* features, vk_context* context)
    context->non_rtx_pipeline_layout = non_rtx_pipeline_layout;
    context->rtx_pipeline_layout = rtx_pipeline_layout;
 
-   VkPipelineCache cache = 0; // TODO: enable
-
-   VkPipeline graphics = 0;
-   VkPipeline axis = 0;
-   VkPipeline frustum = 0;
-   VkPipeline mesh = 0;
-
-   enum {shader_module_count = 2};
-   vk_shader_module shader_modules[shader_module_count] = {0};
-
-   vk_shader_module gm_vs = spv_hash_lookup(&context->shader_table, graphics_module_name"_vs");
-   vk_shader_module gm_fs = spv_hash_lookup(&context->shader_table, graphics_module_name"_fs");
-
-   shader_modules[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-   shader_modules[0].handle = gm_vs.handle;
-
-   shader_modules[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-   shader_modules[1].handle = gm_fs.handle;
-
-   if (!vk_graphics_pipeline_create(&graphics, context, cache, shader_modules, shader_module_count))
-      return false;
-   context->non_rtx_pipeline = graphics;
-
-   vk_shader_module mm_ms = spv_hash_lookup(&context->shader_table, meshlet_module_name"_ms");
-   vk_shader_module mm_fs = spv_hash_lookup(&context->shader_table, meshlet_module_name"_fs");
-
-   shader_modules[0].stage = VK_SHADER_STAGE_MESH_BIT_EXT;
-   shader_modules[0].handle = mm_ms.handle;
-
-   shader_modules[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-   shader_modules[1].handle = mm_fs.handle;
-
-   if(!vk_mesh_pipeline_create(&mesh, context, cache, shader_modules, shader_module_count))
-      return false;
-   context->rtx_pipeline = mesh;
-
-   vk_shader_module am_vs = spv_hash_lookup(&context->shader_table, axis_module_name"_vs");
-   vk_shader_module am_fs = spv_hash_lookup(&context->shader_table, axis_module_name"_fs");
-
-   shader_modules[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-   shader_modules[0].handle = am_vs.handle;
-
-   shader_modules[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-   shader_modules[1].handle = am_fs.handle;
-
-   if(!vk_axis_pipeline_create(&axis, context, cache, shader_modules, shader_module_count))
-      return false;
-   context->axis_pipeline = axis;
-
-   vk_shader_module fm_vs = spv_hash_lookup(&context->shader_table, frustum_module_name"_vs");
-   vk_shader_module fm_fs = spv_hash_lookup(&context->shader_table, frustum_module_name"_fs");
-
-   shader_modules[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-   shader_modules[0].handle = fm_vs.handle;
+   // one job per pipeline, each with the stages it compiles
+   enum {pipeline_count = 4};
+   vk_pipeline_job* pipeline_jobs = push(&scratch, vk_pipeline_job, pipeline_count);
+
+   pipeline_jobs[0] = (vk_pipeline_job){context, vk_graphics_pipeline_create, &context->non_rtx_pipeline, "graphics",
+                                        {{.stage = VK_SHADER_STAGE_VERTEX_BIT, .handle = spv_hash_lookup(&context->shader_table, graphics_module_name"_vs").handle},
+                                         {.stage = VK_SHADER_STAGE_FRAGMENT_BIT, .handle = spv_hash_lookup(&context->shader_table, graphics_module_name"_fs").handle}}};
+   pipeline_jobs[1] = (vk_pipeline_job){context, vk_mesh_pipeline_create, &context->rtx_pipeline, "mesh",
+                                        {{.stage = VK_SHADER_STAGE_MESH_BIT_EXT, .handle = spv_hash_lookup(&context->shader_table, meshlet_module_name"_ms").handle},
+                                         {.stage = VK_SHADER_STAGE_FRAGMENT_BIT, .handle = spv_hash_lookup(&context->shader_table, meshlet_module_name"_fs").handle}}};
+   pipeline_jobs[2] = (vk_pipeline_job){context, vk_axis_pipeline_create, &context->axis_pipeline, "axis",
+                                        {{.stage = VK_SHADER_STAGE_VERTEX_BIT, .handle = spv_hash_lookup(&context->shader_table, axis_module_name"_vs").handle},
+                                         {.stage = VK_SHADER_STAGE_FRAGMENT_BIT, .handle = spv_hash_lookup(&context->shader_table, axis_module_name"_fs").handle}}};
+   pipeline_jobs[3] = (vk_pipeline_job){context, vk_graphics_pipeline_create, &context->frustum_pipeline, "frustum",
+                                        {{.stage = VK_SHADER_STAGE_VERTEX_BIT, .handle = spv_hash_lookup(&context->shader_table, frustum_module_name"_vs").handle},
+                                         {.stage = VK_SHADER_STAGE_FRAGMENT_BIT, .handle = spv_hash_lookup(&context->shader_table, frustum_module_name"_fs").handle}}};
+
+   // the pipelines compile on the job threads, parallel_for returns once all of them are done so they
+   // are ready before the first frame
+   const i64 pipeline_begin = context->timer->time();
+   context->jobs->parallel_for(context->jobs, vk_pipeline_job_run, pipeline_jobs, pipeline_count);
+   context->pipeline_seconds = context->timer->seconds_elapsed(pipeline_begin, context->timer->time());
+
+   f64 compile_seconds = 0.0;
+   for(u32 i = 0; i < pipeline_count; ++i)
+   {
+      if(!pipeline_jobs[i].result)
+      {
+         printf("Could not create the %s pipeline\n", pipeline_jobs[i].name);
+         return false;
+      }
 
-   shader_modules[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-   shader_modules[1].handle = fm_fs.handle;
+      compile_seconds += pipeline_jobs[i].seconds;
+   }
 
-   if (!vk_graphics_pipeline_create(&frustum, context, cache, shader_modules, shader_module_count))
-      return false;
-   context->frustum_pipeline = frustum;
+   printf("Pipelines: %u created in %.2f ms on %u threads (%.2f ms summed over the pipelines) from a %s cache\n",
+          pipeline_count, context->pipeline_seconds * 1e3, min(context->jobs->thread_count, (u32)pipeline_count), compile_seconds * 1e3,
+          context->pipeline_cache_warm ? "warm" : "cold");
 
    return true;
 }
@@ -1755,16 +2189,21 @@ bool vk_initialize(hw* hw)
    hw->renderer.frame_present = vk_present;
    hw->renderer.frame_resize = vk_resize_swapchain;
    hw->renderer.gpu_log = gpu_log;
+   hw->renderer.gpu_time = gpu_time;
+   hw->renderer.bench_log = bench_log;
    hw->renderer.renderer_index = VULKAN_RENDERER_INDEX;
 
    context->app_storage = hw->app_storage;
    context->vulkan_storage = hw->vulkan_storage;
    context->scratch = hw->scratch;
+   context->timer = &hw->timer;
+   context->jobs = &hw->jobs;
 
    arena* a = context->app_storage;
    arena s = context->scratch;
 
    global_allocator.a = context->vulkan_storage;
+   InitializeSRWLock(&global_allocator.lock);
    global_allocator.handle.pUserData = &global_allocator;
    global_allocator.handle.pfnAllocation = vk_allocation;
    global_allocator.handle.pfnReallocation = vk_reallocation;
@@ -1785,6 +2224,11 @@ bool vk_initialize(hw* hw)
       printf("Could not select physical device\n");
       return false;
    }
+   if(!vk_mesh_limits_select(devices, features))
+   {
+      printf("Could not select mesh shader limits\n");
+      return false;
+   }
    #ifdef _DEBUG
    if(!(context->messenger = vk_create_debugutils_messenger_ext(hw, devices).h))
    {
@@ -1802,21 +2246,17 @@ bool vk_initialize(hw* hw)
       printf("Could not select queue family index for surface\n");
       return false;
    }
+   context->devices.transfer_family_index = hw->state.graphics_uploads ? invalid_index : vk_logical_device_select_transfer_family_index(s, devices).i;
+   if(context->devices.transfer_family_index != invalid_index)
+      printf("Uploading on the transfer queue family %zu\n", context->devices.transfer_family_index);
+   else
+      printf("Uploading on the graphics queue\n");
    if(!(context->devices.logical = vk_logical_device_create(s, devices, features).h))
    {
       printf("Could not create logical device\n");
       return false;
    }
-   if(!(context->image_ready_semaphore = vk_semaphore_create(devices).h))
-   {
-      printf("Could not create image ready semaphore\n");
-      return false;
-   }
-   if(!(context->image_done_semaphore = vk_semaphore_create(devices).h))
-   {
-      printf("Could not create image done semaphore\n");
-      return false;
-   }
+   vk_memory_init(devices, a);
 
    const u32 query_pool_size = 128;
    if(!(context->query_pool = vk_query_pool_create(devices, query_pool_size).h))
@@ -1826,12 +2266,21 @@ bool vk_initialize(hw* hw)
    }
    context->query_pool_size = query_pool_size;
 
+   const u32 frame_count = hw->state.frames_in_flight ? min(hw->state.frames_in_flight, VK_FRAME_MAX) : VK_FRAME_DEFAULT;
+   context->record_threads = min(hw->state.record_threads, VK_RECORD_THREAD_MAX);
+   context->instance_draws = hw->state.instance_draws;
+   if(!vk_frames_create(context, frame_count))
+   {
+      printf("Could not create the resources of %u frames in flight\n", frame_count);
+      return false;
+   }
+
    if(!(context->cmd.pool = vk_command_pool_create(devices).h))
    {
       printf("Could not create command pool\n");
       return false;
    }
-   if(!(context->cmd.buffer = vk_command_buffer_create(cmd, devices).h))
+   if(!(context->cmd.buffer = vk_command_buffer_create(cmd, devices, VK_COMMAND_BUFFER_LEVEL_PRIMARY).h))
    {
       printf("Could not create command buffer\n");
       return false;
@@ -1845,6 +2294,13 @@ bool vk_initialize(hw* hw)
       return false;
    }
    context->graphics_queue = vk_graphics_queue_get(devices);
+   context->transfer_queue = devices->transfer_family_index != invalid_index ? vk_transfer_queue_get(devices) : context->graphics_queue;
+
+   if(!vk_upload_create(&context->upload, devices))
+   {
+      printf("Could not create the upload staging ring\n");
+      return false;
+   }
 
    // framebuffers
    context->framebuffers.arena = a;
@@ -1877,7 +2333,9 @@ bool vk_initialize(hw* hw)
       return false;
    }
 
-   if(!vk_assets_read(context, hw->state.asset_file))
+   gltf_load_options load_options = {.recook = hw->state.cook, .stream_budget = MB(hw->state.stream_budget_mb),
+                                     .texture_trace = hw->state.texture_trace, .texture_budget = MB(hw->state.texture_budget_mb)};
+   if(!vk_assets_read(context, hw->state.asset_file, load_options))
    {
       printf("Could not read all the assets\n");
       return false;
@@ -1902,6 +2360,12 @@ bool vk_initialize(hw* hw)
       return false;
    }
 
+   if(!vk_pipeline_cache_create(context))
+   {
+      printf("Could not create the pipeline cache\n");
+      return false;
+   }
+
    // TODO: remove vk_* prefix
    if(!vk_pipelines_create(features, context))
    {
@@ -1910,6 +2374,7 @@ bool vk_initialize(hw* hw)
    }
 
    spv_hash_function(&context->shader_table, spv_hash_log_module_name, 0);
+   vk_memory_report(&devices->memory);
 
    return true;
 }
@@ -1938,6 +2403,8 @@ void vk_uninitialize(hw* hw)
    vk_buffer indirect = *buffer_hash_lookup(buffer_table, indirect_buffer_name);
    vk_buffer indirect_rtx = *buffer_hash_lookup(buffer_table, indirect_rtx_buffer_name);
    vk_buffer transform = *buffer_hash_lookup(buffer_table, mesh_draw_buffer_name);
+   vk_buffer instance = *buffer_hash_lookup(buffer_table, mesh_instance_buffer_name);
+   vk_buffer material = *buffer_hash_lookup(buffer_table, material_buffer_name);
 
    vk_buffer tlas = *buffer_hash_lookup(buffer_table, tlas_buffer_name);
    vk_buffer blas = *buffer_hash_lookup(buffer_table, blas_buffer_name);
@@ -1950,6 +2417,7 @@ void vk_uninitialize(hw* hw)
 
    vkDestroyDescriptorSetLayout(context->devices.logical, context->texture_descriptor.layout, &global_allocator.handle);
    vkDestroyDescriptorPool(context->devices.logical, context->texture_descriptor.descriptor_pool, &global_allocator.handle);
+   vkDestroySampler(context->devices.logical, context->texture_descriptor.sampler, &global_allocator.handle);
 
    vkDestroyPipeline(context->devices.logical, context->axis_pipeline, &global_allocator.handle);
    vkDestroyPipeline(context->devices.logical, context->frustum_pipeline, &global_allocator.handle);
@@ -1959,7 +2427,11 @@ void vk_uninitialize(hw* hw)
    vkDestroyPipelineLayout(context->devices.logical, context->non_rtx_pipeline_layout, &global_allocator.handle);
    vkDestroyPipelineLayout(context->devices.logical, context->rtx_pipeline_layout, &global_allocator.handle);
 
+   vk_pipeline_cache_save(context);
+   vkDestroyPipelineCache(context->devices.logical, context->pipeline_cache, &global_allocator.handle);
+
    vkDestroyCommandPool(context->devices.logical, context->cmd.pool, &global_allocator.handle);
+   vk_upload_destroy(&context->upload, &context->devices);
    vkDestroyQueryPool(context->devices.logical, context->query_pool, &global_allocator.handle);
 
    vk_buffer_destroy(&context->devices, &ib);
@@ -1969,6 +2441,8 @@ void vk_uninitialize(hw* hw)
    vk_buffer_destroy(&context->devices, &indirect);
    vk_buffer_destroy(&context->devices, &indirect_rtx);
    vk_buffer_destroy(&context->devices, &transform);
+   vk_buffer_destroy(&context->devices, &instance);
+   vk_buffer_destroy(&context->devices, &material);
 
    vk_buffer_destroy(&context->devices, &tlas);
    vk_buffer_destroy(&context->devices, &blas);
@@ -1980,29 +2454,30 @@ void vk_uninitialize(hw* hw)
    vkDestroyAccelerationStructureKHR(context->devices.logical, context->rt_as.tlas, &global_allocator.handle);
 
    vkDestroyRenderPass(context->devices.logical, context->renderpass, &global_allocator.handle);
-   vkDestroySemaphore(context->devices.logical, context->image_done_semaphore, &global_allocator.handle);
-   vkDestroySemaphore(context->devices.logical, context->image_ready_semaphore, &global_allocator.handle);
+   vk_frames_destroy(context);
 
    for(u32 i = 0; i < context->framebuffers.count; ++i)
       vkDestroyFramebuffer(context->devices.logical, context->framebuffers.data[i], &global_allocator.handle);
 
    for(u32 i = 0; i < context->textures.count; ++i)
-   {
-      vkDestroyImageView(context->devices.logical, context->textures.data[i].image.view, &global_allocator.handle);
-      vkDestroyImage(context->devices.logical, context->textures.data[i].image.handle, &global_allocator.handle);
-      vkFreeMemory(context->devices.logical, context->textures.data[i].image.memory, &global_allocator.handle);
-   }
+      vk_texture_destroy(&context->devices, context->textures.data + i);
+
+   vk_texture_stream_destroy(context);
+   if(context->texture_stream)
+      texture_stream_release(context->texture_stream);
 
    for (u32 i = 0; i < context->images.depths.count; ++i)
    {
       vkDestroyImageView(context->devices.logical, context->images.depths.data[i].view, &global_allocator.handle);
       vkDestroyImage(context->devices.logical, context->images.depths.data[i].handle, &global_allocator.handle);
-      vkFreeMemory(context->devices.logical, context->images.depths.data[i].memory, &global_allocator.handle);
+      vk_memory_free(&context->devices, &context->images.depths.data[i].allocation);
    }
 
    for (u32 i = 0; i < context->images.images.count; ++i)
       vkDestroyImageView(context->devices.logical, context->images.images.data[i].view, &global_allocator.handle);
 
+   vk_memory_release(&context->devices);
+
    //TODO: call vk_swapchain_destroy(context);
    vkDestroySwapchainKHR(context->devices.logical, context->swapchain.handle, &global_allocator.handle);
    vkDestroySurfaceKHR(devices->instance, context->surface, &global_allocator.handle);
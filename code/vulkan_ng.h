@@ -14,6 +14,9 @@
 #include "arena.h"
 #include "free_list.h"
 #include "vulkan_shader_module.h"
+#include "meshlet.h"
+#include "draw_batch.h"
+#include "tlsf.h"
 
 #include "../assets/shaders/mesh.h"
 
@@ -52,11 +55,22 @@ align_struct vk_swapchain_surface
    VkSwapchainKHR handle;
 } vk_swapchain_surface;
 
+// a range of a memory block, or a whole device memory object of its own when dedicated
+align_struct vk_memory_allocation
+{
+   VkDeviceMemory handle;
+   VkDeviceSize offset;
+   VkDeviceSize size;
+   void* data;          // mapped at the offset when host visible
+   u32 block;           // none when dedicated
+   u32 node;            // of the block placement
+} vk_memory_allocation;
+
 align_struct vk_image
 {
    VkImage handle;
    VkImageView view;
-   VkDeviceMemory memory;
+   vk_memory_allocation allocation;
 } vk_image;
 
 align_struct vk_swapchain_images
@@ -68,7 +82,7 @@ align_struct vk_swapchain_images
 align_struct vk_buffer
 {
    VkBuffer handle;
-   VkDeviceMemory memory;
+   vk_memory_allocation allocation;
    void* data; // host or local memory
    size size;
 } vk_buffer;
@@ -81,20 +95,12 @@ align_struct vk_buffer_binding
    void* extras;
 } vk_buffer_binding;
 
-typedef struct meshlet meshlet;
-
-typedef array(meshlet) array_meshlet;
-
 align_struct vk_mesh_instance
 {
    u32 mesh_index;  // which vk_mesh_draw this instance draws
-   u32 albedo; 
-   u32 normal;
-   u32 ao; 
-   u32 metal;
-   u32 emissive;
+   u32 material;    // into vk_geometry materials
    u32 index_offset;
-   mat4 world;
+   mat4 world;      // packed to translation, rotation and scale for the gpu
 } vk_mesh_instance;
 
 align_struct vk_mesh_draw
@@ -104,6 +110,8 @@ align_struct vk_mesh_draw
    size index_count;
    size vertex_count;
    size vertex_offset;
+   f32 position_center[3];    // bounds the quantized positions are relative to
+   f32 position_extent[3];
 } vk_mesh_draw;
 
 align_struct vk_texture
@@ -111,11 +119,20 @@ align_struct vk_texture
    vk_image image;
 } vk_texture;
 
+// a streamed texture next to its slot in the textures
+align_struct vk_streamed_texture
+{
+   vk_texture next;        // image of the move in progress, filled while the slot is still sampled
+   u64 upload_serial;      // upload batch of its last part, zero while parts are left
+   u32 stale_frames;       // frame slots whose texture set still points at the replaced view
+} vk_streamed_texture;
+
+// the sets are in the frames
 align_struct vk_descriptor
 {
    VkDescriptorPool descriptor_pool;
-   VkDescriptorSet set;
    VkDescriptorSetLayout layout;
+   VkSampler sampler;   // of every texture, kept for the slots written after the load
 } vk_descriptor;
 
 align_struct vk_pipeline
@@ -132,12 +149,40 @@ align_struct vk_buffer_hash_table
    size count;
 } vk_buffer_hash_table;
 
+#define VK_MEMORY_BLOCK_MAX 64
+#define VK_MEMORY_BLOCK_SIZE (MB(64))       // smaller on heaps under 512 MB
+#define VK_MEMORY_BLOCK_NODES (1u << 12)    // allocations and free ranges of one block
+
+// device memory object the allocations of one memory type are placed in. buffers and optimal tiling
+// images never share a block, so no two neighbours can break the buffer image granularity
+align_struct vk_memory_block
+{
+   VkDeviceMemory handle;
+   void* data;          // mapped once when host visible
+   tlsf placement;
+   u32 type;
+   bool optimal;
+} vk_memory_block;
+
+align_struct vk_memory
+{
+   VkPhysicalDeviceMemoryProperties properties;
+   VkDeviceSize block_sizes[VK_MAX_MEMORY_HEAPS];
+   vk_memory_block blocks[VK_MEMORY_BLOCK_MAX];
+   u32 block_count;
+   arena* a;                     // placement nodes of the blocks
+   u32 dedicated_count;
+   VkDeviceSize dedicated_bytes;
+} vk_memory;
+
 align_struct vk_device
 {
    VkPhysicalDevice physical;
    VkDevice logical;
    VkInstance instance;
    size queue_family_index;
+   size transfer_family_index;   // transfer only family, invalid_index when the uploads use the graphics queue
+   vk_memory memory;
 } vk_device;
 
 align_struct ctx_shader_destroy
@@ -148,7 +193,9 @@ align_struct ctx_shader_destroy
 align_struct vk_geometry
 {
    array(vk_mesh_draw) mesh_draws;
-   array(vk_mesh_instance) mesh_instances;
+   array(vk_mesh_instance) mesh_instances;   // sorted by mesh once the batches are built
+   array(struct material) materials;         // deduplicated, shared by the draws
+   array_draw_batch draw_batches;
 } vk_geometry; 
 
 align_struct vk_cmd
@@ -157,6 +204,72 @@ align_struct vk_cmd
    VkCommandPool pool;
 } vk_cmd;
 
+#define VK_FRAME_MAX 3             // frames recorded ahead of the gpu at most
+#define VK_FRAME_DEFAULT 2
+#define VK_RECORD_THREAD_MAX 16    // secondary command buffers the draws of a frame are split into at most
+
+// what one frame in flight owns until its fence signals
+align_struct vk_frame
+{
+   vk_cmd cmd;
+   vk_cmd secondaries[VK_RECORD_THREAD_MAX];   // a pool each, only the job recording it touches the pool
+   VkFence fence;                   // signals when its frame is done
+   VkSemaphore image_ready;         // acquire
+   VkSemaphore image_done;          // release to present
+   VkDescriptorSet texture_set;     // bindless textures as its frame sees them
+   vk_texture* retired;             // replaced by the stream while the frames before sampled them, one per texture at most
+   u32 retired_count;
+   u32 query_base;                  // its begin and end timestamps
+   bool submitted;                  // not waited for since its submit
+} vk_frame;
+
+#define VK_UPLOAD_BATCH_COUNT 4
+
+// copies recorded into one command buffer and submitted together
+#define VK_UPLOAD_RELEASE_MAX 256
+
+align_struct vk_upload_batch
+{
+   VkCommandBuffer buffer;
+   VkCommandBuffer acquire;   // on the graphics queue after the copies when they run on a transfer queue
+   VkSemaphore copied;        // signals the acquire that the copies are done
+   VkFence fence;
+   u64 end;          // ring position after its data, free again once the fence signals
+   u64 serial;       // of its last submit
+   bool submitted;
+} vk_upload_batch;
+
+// staging ring the uploads go through, the positions only grow and wrap modulo the ring size
+align_struct vk_upload
+{
+   vk_buffer ring;
+   u64 head;
+   u64 tail;
+   VkCommandPool pool;
+   VkCommandPool acquire_pool;
+   vk_upload_batch batches[VK_UPLOAD_BATCH_COUNT];
+   u32 current;      // batch being recorded or the next one
+   bool recording;
+   u64 batch_begin;
+   u64 serial;       // batches submitted since the start
+
+   // with a transfer queue the resources written by the batch go to the graphics family when it is
+   // submitted, released on the transfer queue and acquired on the graphics queue
+   bool transfer;
+   u32 transfer_family;
+   u32 graphics_family;
+   VkBufferMemoryBarrier buffer_releases[VK_UPLOAD_RELEASE_MAX];
+   VkImageMemoryBarrier image_releases[VK_UPLOAD_RELEASE_MAX];
+   u32 buffer_release_count;
+   u32 image_release_count;
+
+   // since the last report
+   u32 copy_count;
+   u32 submit_count;
+   u32 wait_count;
+   size bytes;
+} vk_upload;
+
 align_struct vk_rt_as
 {
    VkAccelerationStructureKHR* blases;
@@ -168,7 +281,9 @@ align_struct vk_features
 {
    bool mesh_shading_supported;
    bool raytracing_supported;
+   bool block_compression_supported;   // bc1-7 sampled images, the loader keeps rgba8 without them
    f32 time_period;
+   u32 mesh_workgroup_size;   // specialized into the mesh shader
 } vk_features;
 
 // TODO: change to hw_gpu_allocator and add to hw.h
@@ -177,6 +292,7 @@ align_struct vk_allocator
    VkAllocationCallbacks handle;
    list slots;
    arena* a;
+   SRWLOCK lock;     // the driver allocates on every thread that creates objects
 } vk_allocator;
 
 typedef array(VkFramebuffer) framebuffers_array;
@@ -205,14 +321,24 @@ align_struct vk_context
 
    vk_descriptor texture_descriptor;
 
-   VkSemaphore image_ready_semaphore;
-   VkSemaphore image_done_semaphore;
+   vk_frame frames[VK_FRAME_MAX];
+   u32 frame_count;           // in flight
+   u32 frame_index;           // being recorded
+   u64 frame_number;          // frames submitted
+   f64 frame_wait_seconds;    // cpu blocked on the frame fences over all of them
+   f64 gpu_seconds;           // of the last frame known to be done
    u32 image_index;
 
+   u32 record_threads;        // secondaries per frame, zero records the draws into the primary
+   bool instance_draws;       // a draw per instance instead of the indirect commands
+   f64 record_seconds;        // cpu recording the command buffers over all frames
+
    VkQueue graphics_queue;
+   VkQueue transfer_queue;    // graphics_queue without a transfer family
    VkQueryPool query_pool;
 
-   vk_cmd cmd;
+   vk_cmd cmd;                // one off work at load, the frames record into their own
+   vk_upload upload;
 
    VkRenderPass renderpass;
 
@@ -225,6 +351,10 @@ align_struct vk_context
    VkPipelineLayout non_rtx_pipeline_layout;
    VkPipelineLayout rtx_pipeline_layout;
 
+   VkPipelineCache pipeline_cache;
+   bool pipeline_cache_warm;     // seeded from the file of an earlier launch
+   f64 pipeline_seconds;         // creating the pipelines at startup
+
    spv_hash_table shader_table;
 
    vk_buffer_hash_table buffer_table;
@@ -235,6 +365,10 @@ align_struct vk_context
    arena* app_storage;
    arena* vulkan_storage;
    arena scratch;
+   struct hw_timer* timer;
+   struct hw_jobs* jobs;
+   struct texture_stream* texture_stream;   // mip residency of the textures, none keeps every level resident
+   vk_streamed_texture* streamed_textures;  // one per texture with a stream
 
 #ifdef _DEBUG
    VkDebugUtilsMessengerEXT messenger;
@@ -249,8 +383,12 @@ void vk_uninitialize(hw* hw);
 
 // TODO: these in buffer.h
 static void vk_buffer_upload(vk_context* context, vk_buffer* to, const void* data);
-static void vk_buffer_to_image_upload(vk_context* context, vk_buffer scratch, VkImage image, VkExtent3D image_extent, const void* data, VkDeviceSize size);
+static void vk_buffer_to_image_upload(vk_context* context, VkImage image, const VkBufferImageCopy* regions, u32 region_count, const void* data, VkDeviceSize size);
+static void vk_buffer_to_image_upload_part(vk_context* context, VkImage image, u32 level_count, const VkBufferImageCopy* regions, u32 region_count,
+                                           const void* data, VkDeviceSize size, bool first, bool last);
 static void vk_buffer_destroy(vk_device* device, vk_buffer* buffer);
+static u64 vk_upload_serial(vk_context* context);
+static bool vk_upload_done(vk_context* context, u64 serial);
 // TODO: pass the size for the buffer to be created instead of embedding it inside the buffer
 // TODO: (vk_buffer* buffer, size buffer_size, vk_device* device, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_flags)
 static bool vk_buffer_create_and_bind(vk_buffer* buffer, vk_device* device, VkBufferUsageFlags usage, VkMemoryPropertyFlags memory_flags);
@@ -9,6 +9,7 @@
 #include "stdio.h"
 
 #include "hw.c"
+#include "win32_job.c"
 
 static void win32_sleep(u32 ms)
 {
@@ -497,6 +498,9 @@ int main(int argc, char** argv)
    hw.timer.seconds_elapsed = win32_seconds_elapsed;
    hw.timer.time_to_counter = win32_time_to_counter;
 
+   // the timer is used before the event loop starts, e.g. for the asset load timings
+   clock_query_frequency();
+
    hw.platform_loop = win32_platform_loop;
 
    hw.window_title_set = win32_window_title;
@@ -544,6 +548,37 @@ int main(int argc, char** argv)
    else
       asset_file = s8(argv[1]);
 
+   // program_name.exe <gltf> [-bench <frames>] [-threads <count>] [-cook] [-stream <budget_mb>] [-texture-trace]
+   //                  [-texture-budget <budget_mb>] [-frames <in_flight>] [-graphics-uploads]
+   //                  [-record-threads <count>] [-instance-draws]
+   u32 thread_count = 0;   // 0 is one per logical processor
+   for(int i = 2; i < argc; ++i)
+   {
+      if(strcmp(argv[i], "-cook") == 0)
+         hw.state.cook = true;
+      else if(strcmp(argv[i], "-texture-trace") == 0)
+         hw.state.texture_trace = true;
+      else if(strcmp(argv[i], "-graphics-uploads") == 0)
+         hw.state.graphics_uploads = true;
+      else if(strcmp(argv[i], "-instance-draws") == 0)
+         hw.state.instance_draws = true;
+      else if(i + 1 < argc && strcmp(argv[i], "-bench") == 0)
+         hw.state.bench_frames = (u32)atoi(argv[++i]);
+      else if(i + 1 < argc && strcmp(argv[i], "-threads") == 0)
+         thread_count = (u32)atoi(argv[++i]);
+      else if(i + 1 < argc && strcmp(argv[i], "-stream") == 0)
+         hw.state.stream_budget_mb = (u32)atoi(argv[++i]);
+      else if(i + 1 < argc && strcmp(argv[i], "-texture-budget") == 0)
+         hw.state.texture_budget_mb = (u32)atoi(argv[++i]);
+      else if(i + 1 < argc && strcmp(argv[i], "-frames") == 0)
+         hw.state.frames_in_flight = (u32)atoi(argv[++i]);
+      else if(i + 1 < argc && strcmp(argv[i], "-record-threads") == 0)
+         hw.state.record_threads = (u32)atoi(argv[++i]);
+   }
+
+   // the last quarter of the reserve holds the storage of the job threads
+   win32_jobs_init(&hw.jobs, (byte*)scratch_arena.end + arena_part_size, arena_part_size, thread_count);
+
    app_start(&hw, asset_file);
 
    #endif
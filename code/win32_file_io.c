@@ -37,3 +37,89 @@ static arena win32_file_read(arena* a, const char* path)
    return result;
 }
 
+
+// whole file mapped into memory, valid until win32_file_unmap
+align_struct win32_file_view
+{
+   void* data;
+   size size;
+   HANDLE file;
+   HANDLE mapping;
+} win32_file_view;
+
+static void win32_file_unmap(win32_file_view* view)
+{
+   if(view->data)
+      UnmapViewOfFile(view->data);
+   if(view->mapping)
+      CloseHandle(view->mapping);
+   if(view->file && view->file != INVALID_HANDLE_VALUE)
+      CloseHandle(view->file);
+
+   *view = (win32_file_view){0};
+}
+
+static bool win32_file_map(win32_file_view* view, const char* path)
+{
+   *view = (win32_file_view){0};
+
+   view->file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, 0);
+   if(view->file == INVALID_HANDLE_VALUE)
+      return false;
+
+   LARGE_INTEGER file_size;
+   if(!GetFileSizeEx(view->file, &file_size) || file_size.QuadPart == 0)
+   {
+      win32_file_unmap(view);
+      return false;
+   }
+
+   view->mapping = CreateFileMapping(view->file, 0, PAGE_READONLY, 0, 0, 0);
+   view->data = view->mapping ? MapViewOfFile(view->mapping, FILE_MAP_READ, 0, 0, 0) : 0;
+
+   if(!view->data)
+   {
+      win32_file_unmap(view);
+      return false;
+   }
+
+   view->size = (size)file_size.QuadPart;
+
+   return true;
+}
+
+// creates or truncates the file to file_size and maps it for writing
+static bool win32_file_map_write(win32_file_view* view, const char* path, size file_size)
+{
+   *view = (win32_file_view){0};
+
+   view->file = CreateFile(path, GENERIC_READ | GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+   if(view->file == INVALID_HANDLE_VALUE)
+      return false;
+
+   view->mapping = CreateFileMapping(view->file, 0, PAGE_READWRITE, (DWORD)((u64)file_size >> 32), (DWORD)file_size, 0);
+   view->data = view->mapping ? MapViewOfFile(view->mapping, FILE_MAP_WRITE, 0, 0, 0) : 0;
+
+   if(!view->data)
+   {
+      win32_file_unmap(view);
+      return false;
+   }
+
+   view->size = file_size;
+
+   return true;
+}
+
+// size and last write time, stand in for the contents of a file that is too big to hash
+static bool win32_file_stamp(const char* path, u64* file_size, u64* write_time)
+{
+   WIN32_FILE_ATTRIBUTE_DATA attributes;
+   if(!GetFileAttributesEx(path, GetFileExInfoStandard, &attributes))
+      return false;
+
+   *file_size = ((u64)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+   *write_time = ((u64)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+
+   return true;
+}
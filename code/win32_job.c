@@ -0,0 +1,169 @@
+#include "hw_job.h"
+
+#include <Windows.h>
+
+align_struct win32_job_batch
+{
+   hw_job_function function;
+   void* data;
+   u32 job_count;
+   volatile LONG next_job;
+} win32_job_batch;
+
+// the workers are created once and park on the wake semaphore between batches, one batch runs at a time
+align_struct win32_job_pool
+{
+   win32_job_batch batch;
+   const arena* thread_storage;  // of the hw_jobs that started the batch
+   arena caller_storage;
+   HANDLE wake;                  // one count per worker the batch wakes
+   HANDLE done;                  // set by the last woken worker to finish
+   volatile LONG busy;           // woken workers still on the batch
+   u32 woken;
+   u32 worker_count;
+} win32_job_pool;
+
+align_struct win32_job_worker
+{
+   win32_job_pool* pool;
+   u32 index;                    // of its storage, the caller is 0
+} win32_job_worker;
+
+static win32_job_pool win32_jobs_pool;
+static win32_job_worker win32_jobs_workers[HW_MAX_THREAD_COUNT];
+
+static void win32_jobs_run(win32_job_batch* batch, arena* storage)
+{
+   for(;;)
+   {
+      LONG job_index = InterlockedIncrement(&batch->next_job) - 1;
+      if(job_index >= (LONG)batch->job_count)
+         break;
+
+      batch->function(batch->data, (u32)job_index, storage);
+   }
+}
+
+// parked for the life of the process, exiting the process ends the workers
+static DWORD WINAPI win32_job_thread_proc(void* parameter)
+{
+   win32_job_worker* worker = parameter;
+   win32_job_pool* pool = worker->pool;
+
+   for(;;)
+   {
+      WaitForSingleObject(pool->wake, INFINITE);
+
+      // a copy rewinds the storage
+      arena storage = pool->thread_storage[worker->index];
+      win32_jobs_run(&pool->batch, &storage);
+
+      if(InterlockedDecrement(&pool->busy) == 0)
+         SetEvent(pool->done);
+   }
+}
+
+// wakes a worker per thread after the caller, a worker woken late finds the batch done and only checks in
+static void win32_parallel_begin(hw_jobs* jobs, hw_job_function function, void* data, u32 job_count)
+{
+   win32_job_pool* pool = jobs->pool;
+   assert(pool->woken == 0);
+
+   pool->batch = (win32_job_batch){.function = function, .data = data, .job_count = job_count};
+   pool->thread_storage = jobs->thread_storage;
+   pool->caller_storage = jobs->thread_storage[0];
+
+   u32 thread_count = jobs->thread_count < job_count ? jobs->thread_count : job_count;
+   thread_count = clamp(thread_count, 1u, (u32)HW_MAX_THREAD_COUNT);
+
+   pool->woken = thread_count - 1 < pool->worker_count ? thread_count - 1 : pool->worker_count;
+   pool->busy = (LONG)pool->woken;
+
+   if(pool->woken > 0)
+      ReleaseSemaphore(pool->wake, (LONG)pool->woken, 0);
+}
+
+static bool win32_parallel_help(hw_jobs* jobs)
+{
+   win32_job_pool* pool = jobs->pool;
+   win32_job_batch* batch = &pool->batch;
+
+   LONG job_index = InterlockedIncrement(&batch->next_job) - 1;
+   if(job_index >= (LONG)batch->job_count)
+      return false;
+
+   batch->function(batch->data, (u32)job_index, &pool->caller_storage);
+
+   return true;
+}
+
+// the caller runs the jobs left and waits for the woken workers
+static void win32_parallel_wait(hw_jobs* jobs)
+{
+   win32_job_pool* pool = jobs->pool;
+
+   win32_jobs_run(&pool->batch, &pool->caller_storage);
+
+   if(pool->woken > 0)
+      WaitForSingleObject(pool->done, INFINITE);
+
+   pool->woken = 0;
+}
+
+static void win32_parallel_for(hw_jobs* jobs, hw_job_function function, void* data, u32 job_count)
+{
+   if(job_count == 0)
+      return;
+
+   win32_parallel_begin(jobs, function, data, job_count);
+   win32_parallel_wait(jobs);
+}
+
+// carves one storage arena per thread out of the reserved range and starts the workers
+static void win32_jobs_init(hw_jobs* jobs, void* base, size range_size, u32 thread_count)
+{
+   if(thread_count == 0)
+   {
+      SYSTEM_INFO system_info;
+      GetSystemInfo(&system_info);
+      thread_count = system_info.dwNumberOfProcessors;
+   }
+
+   jobs->thread_count = clamp(thread_count, 1u, (u32)HW_MAX_THREAD_COUNT);
+   jobs->parallel_for = win32_parallel_for;
+   jobs->parallel_begin = win32_parallel_begin;
+   jobs->parallel_help = win32_parallel_help;
+   jobs->parallel_wait = win32_parallel_wait;
+
+   const size thread_range_size = range_size / HW_MAX_THREAD_COUNT;
+
+   for(u32 i = 0; i < jobs->thread_count; ++i)
+   {
+      arena thread_arena = {0};
+      thread_arena.end = (byte*)base + i*thread_range_size;
+      thread_arena.kind = arena_scratch_kind;
+
+      jobs->thread_storage[i] = arena_new(&thread_arena, PAGE_SIZE);
+   }
+
+   // a worker per thread after the caller, a batch runs on fewer when some could not be started
+   win32_job_pool* pool = &win32_jobs_pool;
+   pool->wake = CreateSemaphore(0, 0, HW_MAX_THREAD_COUNT, 0);
+   pool->done = CreateEvent(0, FALSE, FALSE, 0);
+
+   for(u32 i = 1; pool->wake && pool->done && i < jobs->thread_count; ++i)
+   {
+      win32_job_worker* worker = win32_jobs_workers + pool->worker_count;
+      worker->pool = pool;
+      worker->index = pool->worker_count + 1;
+
+      HANDLE handle = CreateThread(0, 0, win32_job_thread_proc, worker, 0, 0);
+      if(!handle)
+         break;
+
+      CloseHandle(handle);
+      pool->worker_count++;
+   }
+
+   jobs->pool = pool;
+}
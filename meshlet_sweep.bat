@@ -0,0 +1,38 @@
+@echo off
+
+REM rebuilds the shaders and the renderer for each meshlet limit configuration
+REM and prints one json line of cpu/gpu frame timings per configuration
+REM usage: meshlet_sweep.bat [gltf] [frames]
+
+cd /d "%~dp0"
+
+set ASSET=%1
+IF "%ASSET%"=="" set ASSET=sponza/sponza.gltf
+
+set FRAMES=%2
+IF "%FRAMES%"=="" set FRAMES=256
+
+IF NOT EXIST "%cd%\build" mkdir "%cd%\build"
+
+echo Meshlet counts for all configurations...
+call code\build.bat b > build\meshlet_sweep.log
+build\bench_release.exe sweep "assets\gltf\%ASSET%"
+
+for %%C in ("32 64" "64 84" "64 126" "64 127" "96 192" "128 128" "128 256") do (
+   call :run %%~C
+)
+
+REM restore the default limits
+set MESHLET_LIMITS=
+call shader_build.bat >> build\meshlet_sweep.log
+call code\build.bat r >> build\meshlet_sweep.log
+
+exit /b 0
+
+:run
+set MESHLET_LIMITS=-DMESHLET_MAX_VERTICES=%1 -DMESHLET_MAX_TRIANGLES=%2
+echo Frame timings for %1/%2...
+call shader_build.bat >> build\meshlet_sweep.log
+call code\build.bat r >> build\meshlet_sweep.log
+build\vulkan_3d_release.exe %ASSET% -bench %FRAMES% | findstr /b "{"
+exit /b 0
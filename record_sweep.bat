@@ -0,0 +1,28 @@
+@echo off
+
+REM writes a scene of 10000 instances and renders it with a draw per instance recorded on 0 to 16 job
+REM threads, 0 records inline into the primary command buffer. prints one json line of frame timings
+REM per thread count, "record_ms" is the cpu time of the recording
+REM usage: record_sweep.bat [instances] [frames]
+
+cd /d "%~dp0"
+
+set INSTANCES=%1
+IF "%INSTANCES%"=="" set INSTANCES=10000
+
+set FRAMES=%2
+IF "%FRAMES%"=="" set FRAMES=256
+
+IF NOT EXIST "%cd%\build" mkdir "%cd%\build"
+IF NOT EXIST "%cd%\assets\gltf\record_sweep" mkdir "%cd%\assets\gltf\record_sweep"
+
+call code\build.bat b > build\record_sweep.log
+call code\build.bat r >> build\record_sweep.log
+build\bench_release.exe instances %INSTANCES% 4 assets\gltf\record_sweep\scene.gltf
+
+for %%T in (0 1 2 4 8 16) do (
+   echo Frame timings for %%T recording threads...
+   build\vulkan_3d_release.exe record_sweep/scene.gltf -bench %FRAMES% -instance-draws -record-threads %%T | findstr /b "{"
+)
+
+exit /b 0
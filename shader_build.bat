@@ -8,21 +8,23 @@ IF NOT EXIST "%cd%\bin\assets\shaders" mkdir "%cd%\bin\assets\shaders"
 
 echo "Compiling shaders..."
 
+REM MESHLET_LIMITS and VERTEX_FORMAT must match the ones given to build.bat
+
 for %%F in (assets\shaders\*.vert.glsl) do (
     echo Compiling %%F
-    %VULKAN_SDK%\bin\glslc.exe -fshader-stage=vert "%%F" -o "bin\assets\shaders\%%~nF.spv"
+    %VULKAN_SDK%\bin\glslc.exe -fshader-stage=vert %MESHLET_LIMITS% %VERTEX_FORMAT% "%%F" -o "bin\assets\shaders\%%~nF.spv"
     IF %ERRORLEVEL% NEQ 0 (echo Error compiling %%F: %ERRORLEVEL%)
 )
 
 for %%F in (assets\shaders\*.frag.glsl) do (
     echo Compiling %%F
-    %VULKAN_SDK%\bin\glslc.exe -fshader-stage=frag "%%F" -o "bin\assets\shaders\%%~nF.spv"
+    %VULKAN_SDK%\bin\glslc.exe -fshader-stage=frag %MESHLET_LIMITS% %VERTEX_FORMAT% "%%F" -o "bin\assets\shaders\%%~nF.spv"
     IF %ERRORLEVEL% NEQ 0 (echo Error compiling %%F: %ERRORLEVEL%)
 )
 
 for %%F in (assets\shaders\*.mesh.glsl) do (
     echo Compiling %%F
-	 %VULKAN_SDK%\bin\glslangValidator.exe -V --target-env vulkan1.3 --target-env spirv1.5 -S mesh "%%F" -o "bin\assets\shaders\%%~nF.spv"
+	 %VULKAN_SDK%\bin\glslangValidator.exe -V --target-env vulkan1.3 --target-env spirv1.5 -S mesh %MESHLET_LIMITS% %VERTEX_FORMAT% "%%F" -o "bin\assets\shaders\%%~nF.spv"
     IF %ERRORLEVEL% NEQ 0 (echo Error compiling %%F: %ERRORLEVEL%)
 )
 